@@ -0,0 +1,182 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <utility>
+#include <stdint.h>
+
+#include "admission.h"
+#include "auction.h"
+#include "auction_host.h"
+#include "error.h"
+#include "quote_board.h"
+#include "status.h"
+
+namespace auction_engine {
+
+namespace {
+
+/// Key of a user's or item's bucket within an auction.
+inline uint64_t bucketKey(uint32_t auction_id, uint32_t id) {
+  return uint64_t(auction_id) << 32 | id;
+}
+}  // namespace
+
+const size_t TokenBuckets::kMinSweep;
+
+bool TokenBuckets::tryTake(uint64_t key,
+                           std::chrono::steady_clock::time_point now) {
+  if (limit.rate <= 0)
+    return true;
+  Shard& shard = shardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (shard.buckets.size() >= shard.sweep_at)
+    sweep(shard, now);
+  auto it = shard.buckets.try_emplace(key, Bucket{limit.burst, now}).first;
+  Bucket& bucket = it->second;
+  const double elapsed =
+      std::chrono::duration<double>(now - bucket.refilled).count();
+  if (elapsed > 0) {
+    bucket.tokens = std::min(limit.burst,
+                             bucket.tokens + elapsed * limit.rate);
+    bucket.refilled = now;
+  }
+  if (bucket.tokens < 1)
+    return false;
+  bucket.tokens -= 1;
+  return true;
+}
+
+void TokenBuckets::giveBack(uint64_t key) {
+  if (limit.rate <= 0)
+    return;
+  Shard& shard = shardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.buckets.find(key);
+  if (it != shard.buckets.end())
+    it->second.tokens = std::min(limit.burst, it->second.tokens + 1);
+}
+
+size_t TokenBuckets::size() {
+  size_t num_buckets = 0;
+  for (Shard& shard: shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    num_buckets += shard.buckets.size();
+  }
+  return num_buckets;
+}
+
+void TokenBuckets::sweep(Shard& shard,
+                         std::chrono::steady_clock::time_point now) {
+  const auto refill_time = std::chrono::duration<double>(
+      limit.burst / limit.rate);
+  for (auto it = shard.buckets.begin(); it != shard.buckets.end();) {
+    if (now - it->second.refilled >= refill_time)
+      it = shard.buckets.erase(it);
+    else
+      ++it;
+  }
+  // Waiting for the shard to double again keeps the sweeps' cost
+  // proportional to the buckets added between them.
+  shard.sweep_at = std::max(kMinSweep, 2 * shard.buckets.size());
+}
+
+AdmissionController::AdmissionController(AuctionHost& host,
+                                         const AdmissionLimits& limits)
+    : host(host),
+      max_queued(limits.max_queued),
+      user_buckets(limits.per_user),
+      item_buckets(limits.per_item),
+      num_admitted(0),
+      num_stale(0),
+      num_rate_limited(0),
+      num_overloaded(0) {}
+
+Status AdmissionController::submitBid(uint32_t auction_id, uint32_t item_id,
+                                      uint32_t user_id, uint32_t value,
+                                      Callback done) {
+  // The published quote can only be behind the auction. Values only rise
+  // except when a bid is retracted, so a bid rejected here would be rejected
+  // by the auction too unless a retraction is queued ahead of it. That race
+  // is accepted: the bid is refused against a value the item really had,
+  // which is no different from it arriving just before the retraction, and
+  // letting every bid at or below the quote through would queue exactly the
+  // bids this check exists to shed.
+  Quote quote;
+  Status status = host.getQuote(auction_id, item_id, quote);
+  if (!status.ok())
+    return status;
+  if (!quote.open || quote.sold) {
+    num_stale.fetch_add(1, std::memory_order_relaxed);
+    return error::ItemUnavailable(
+        "Item \"",
+        item_id,
+        "\" is not currently open in the auction.");
+  }
+  if (value <= quote.value) {
+    num_stale.fetch_add(1, std::memory_order_relaxed);
+    return error::InvalidBid(
+        "Attempted bid value ",
+        value,
+        " is not higher than the current value ",
+        quote.value, ".");
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  const uint64_t user_key = bucketKey(auction_id, user_id);
+  const uint64_t item_key = bucketKey(auction_id, item_id);
+  if (!user_buckets.tryTake(user_key, now)) {
+    num_rate_limited.fetch_add(1, std::memory_order_relaxed);
+    return error::ResourceExhausted(
+        "User \"", user_id, "\" is bidding too fast.");
+  }
+  if (!item_buckets.tryTake(item_key, now)) {
+    user_buckets.giveBack(user_key);
+    num_rate_limited.fetch_add(1, std::memory_order_relaxed);
+    return error::ResourceExhausted(
+        "Item \"", item_id, "\" is receiving bids too fast.");
+  }
+
+  status = host.trySubmit(
+      auction_id,
+      [item_id, user_id, value, done = std::move(done)](Auction& auction) {
+        Status placed = auction.placeBid(item_id, user_id, value);
+        if (done)
+          done(std::move(placed));
+      },
+      max_queued);
+  if (!status.ok()) {
+    // A bid turned away by a full queue did not use its tokens.
+    user_buckets.giveBack(user_key);
+    item_buckets.giveBack(item_key);
+    num_overloaded.fetch_add(1, std::memory_order_relaxed);
+    return status;
+  }
+  num_admitted.fetch_add(1, std::memory_order_relaxed);
+  return Status::OK();
+}
+
+AdmissionStats AdmissionController::getStats() const {
+  AdmissionStats stats;
+  stats.num_admitted = num_admitted.load(std::memory_order_relaxed);
+  stats.num_stale = num_stale.load(std::memory_order_relaxed);
+  stats.num_rate_limited = num_rate_limited.load(std::memory_order_relaxed);
+  stats.num_overloaded = num_overloaded.load(std::memory_order_relaxed);
+  return stats;
+}
+}  // namespace auction_engine
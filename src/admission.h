@@ -0,0 +1,190 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "auction_host.h"
+#include "status.h"
+
+namespace auction_engine {
+
+/// Sustained rate and burst of a token bucket.
+struct RateLimit {
+  /// Tokens added per second, or 0 for no limit.
+  double rate = 0;
+  /// Most tokens a bucket holds, and so the longest burst allowed.
+  double burst = 1;
+};
+
+/**
+ * \brief Token buckets for any number of keys, safe to use from any thread.
+ *
+ * Each key starts with a full bucket. Buckets are spread over
+ * \c kNumShards independently locked shards, so threads admitting bids for
+ * different users or items rarely wait for each other.
+ *
+ * A bucket untouched for \c burst / \c rate seconds is full again and so no
+ * different from a new one. Each shard drops such buckets whenever it has
+ * doubled in size since it last did, so keys that stop bidding, such as
+ * removed users and items, do not hold memory forever.
+ */
+class TokenBuckets {
+public:
+  /// Number of independently locked shards.
+  static const size_t kNumShards = 64;
+  /// Fewest buckets a shard holds before it drops full ones.
+  static const size_t kMinSweep = 64;
+
+  explicit TokenBuckets(const RateLimit& limit) : limit(limit) {}
+
+  TokenBuckets(const TokenBuckets&) = delete;
+  TokenBuckets& operator=(const TokenBuckets&) = delete;
+
+  /// Take a token from \c key's bucket. Returns \c false if it is empty.
+  bool tryTake(uint64_t key, std::chrono::steady_clock::time_point now);
+
+  /// Put back a token taken from \c key's bucket that was not used.
+  void giveBack(uint64_t key);
+
+  /// Return the number of buckets currently held.
+  size_t size();
+
+private:
+  struct Bucket {
+    double tokens;
+    std::chrono::steady_clock::time_point refilled;
+  };
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Bucket> buckets;
+    /// Size at which the shard next drops full buckets.
+    size_t sweep_at = kMinSweep;
+  };
+
+  /// Drop the buckets of \c shard that have been full since before \c now.
+  void sweep(Shard& shard, std::chrono::steady_clock::time_point now);
+
+  Shard& shardOf(uint64_t key) {
+    return shards[(key * 0x9e3779b97f4a7c15ULL) >> 58];
+  }
+
+  const RateLimit limit;
+  Shard shards[kNumShards];
+};
+
+/// Limits enforced by \c AdmissionController.
+struct AdmissionLimits {
+  /// Bids each user may place in each auction.
+  RateLimit per_user;
+  /// Bids each item may receive.
+  RateLimit per_item;
+  /// Most tasks that may be waiting in an auction's queue for a bid to be
+  /// admitted, or 0 for no bound.
+  size_t max_queued = 0;
+};
+
+/// Counts of the decisions an \c AdmissionController has made.
+struct AdmissionStats {
+  uint64_t num_admitted = 0;
+  /// Bids not above the item's published value, or on a closed item.
+  uint64_t num_stale = 0;
+  /// Bids over a user's or item's rate limit.
+  uint64_t num_rate_limited = 0;
+  /// Bids refused because the auction's queue was full.
+  uint64_t num_overloaded = 0;
+};
+
+/**
+ * \brief Decides which bids reach an \c AuctionHost when it is overloaded.
+ *
+ * Every bid is checked, cheapest check first, before it is queued:
+ *
+ *  - A bid that is not above the value the item has published to its
+ *    \c QuoteBoard, or on an item that is not open, fails as if it had been
+ *    placed when the quote was published, so it is rejected straight away
+ *    with the error \c placeBid() would give. A retraction lowers the value,
+ *    so a bid checked while one is queued may be rejected although it would
+ *    succeed once the retraction is applied; the caller sees the higher
+ *    value it was refused against and can bid again once the quote falls.
+ *  - Each user and each item has a token bucket; a bid over either limit is
+ *    rejected with \c RESOURCE_EXHAUSTED, so one hot item or one flooding
+ *    user cannot crowd out everyone else.
+ *  - The auction's queue is bounded; a bid that finds it full is rejected
+ *    with \c RESOURCE_EXHAUSTED rather than waiting behind it, so a bid that
+ *    is admitted is applied within a bounded time.
+ *
+ * Rejections cost a few atomic reads and at most two short locks, and are
+ * reported to the caller at once so it can back off. Admitted bids are still
+ * fully validated by \c Auction::placeBid().
+ */
+class AdmissionController {
+public:
+  /// Called on a host thread with the result of an admitted bid.
+  using Callback = std::function<void(Status)>;
+
+  AdmissionController(AuctionHost& host, const AdmissionLimits& limits);
+
+  AdmissionController(const AdmissionController&) = delete;
+  AdmissionController& operator=(const AdmissionController&) = delete;
+
+  /**
+   * \brief Admit a bid and queue it, or reject it.
+   *
+   * \param auction_id
+   *    ID of the auction in the host.
+   *
+   * \param item_id
+   *    The id of the item to bid on.
+   *
+   * \param user_id
+   *    The id of the user placing the bid.
+   *
+   * \param value
+   *    The value of the bid.
+   *
+   * \param done
+   *    Called with the result of \c Auction::placeBid() if the bid is
+   *    admitted. May be empty.
+   *
+   * \return \c Status containing error code and message. OK means the bid was
+   *    admitted and queued, not that it was placed.
+   */
+  Status submitBid(uint32_t auction_id, uint32_t item_id, uint32_t user_id,
+                   uint32_t value, Callback done=Callback());
+
+  /// Return the number of bids admitted and rejected so far.
+  AdmissionStats getStats() const;
+
+private:
+  AuctionHost& host;
+  const size_t max_queued;
+  TokenBuckets user_buckets;
+  TokenBuckets item_buckets;
+  std::atomic<uint64_t> num_admitted;
+  std::atomic<uint64_t> num_stale;
+  std::atomic<uint64_t> num_rate_limited;
+  std::atomic<uint64_t> num_overloaded;
+};
+}  // namespace auction_engine
@@ -0,0 +1,192 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "admission.h"
+#include "auction.h"
+#include "auction_host.h"
+#include "error.h"
+#include "status.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+int main() {
+  namespace error = auction_engine::error;
+  using auction_engine::Auction;
+  using auction_engine::Status;
+  using Clock = std::chrono::steady_clock;
+
+  printTest("Testing TokenBuckets...");
+  auction_engine::TokenBuckets buckets({10, 3});
+  const Clock::time_point start = Clock::now();
+  bool burst_ok = buckets.tryTake(1, start) && buckets.tryTake(1, start) &&
+                  buckets.tryTake(1, start);
+  const bool emptied = !buckets.tryTake(1, start);
+  buckets.giveBack(1);
+  const bool given_back = buckets.tryTake(1, start);
+  const bool other_key = buckets.tryTake(2, start);
+  // A tenth of a second refills one token at ten per second.
+  const Clock::time_point later = start + std::chrono::milliseconds(100);
+  const bool refilled = buckets.tryTake(1, later) && !buckets.tryTake(1, later);
+  auction_engine::TokenBuckets unlimited({0, 1});
+  bool never_empty = true;
+  for (int i=0; i<1000; ++i)
+    never_empty = never_empty && unlimited.tryTake(1, start);
+  printTestResult(burst_ok && emptied && given_back && other_key &&
+                  refilled && never_empty);
+
+  printTest("Testing TokenBuckets pruning...");
+  auction_engine::TokenBuckets pruned({10, 3});
+  for (uint64_t key=0; key<10000; ++key)
+    pruned.tryTake(key, start);
+  const size_t num_early = pruned.size();
+  // Three tenths of a second refills every early bucket, so they can go.
+  const Clock::time_point idle = start + std::chrono::seconds(1);
+  for (uint64_t key=10000; key<20000; ++key)
+    pruned.tryTake(key, idle);
+  printTestResult(num_early == 10000 && pruned.size() < 15000 &&
+                  pruned.tryTake(0, idle) && pruned.tryTake(0, idle) &&
+                  pruned.tryTake(0, idle) && !pruned.tryTake(0, idle));
+
+  auction_engine::AuctionHost host(2);
+  const uint32_t auction_id = host.addAuction();
+  host.submit(auction_id, [](Auction& auction) {
+    auction.addUser("Alice", 1000000);
+    auction.addUser("Bob", 1000000);
+    auction.addUser("Carol", 1000000);
+    auction.addItem("Rug", 0);
+    auction.addItem("Lamp", 0);
+    auction.openItem(0);
+    auction.openItem(1);
+    auction.placeBid(0, 0, 100);
+  });
+  host.drain();
+
+  printTest("Testing AdmissionController stale bids...");
+  auction_engine::AdmissionLimits limits;
+  limits.per_user = {1, 2};
+  limits.per_item = {1000, 100};
+  auction_engine::AdmissionController admission(host, limits);
+  Status stale = admission.submitBid(auction_id, 0, 1, 100);
+  Status missing = admission.submitBid(auction_id, 7, 1, 100);
+  host.submit(auction_id, [](Auction& auction) { auction.closeItem(1); });
+  host.drain();
+  Status closed_item = admission.submitBid(auction_id, 1, 1, 5);
+  printTestResult(error::IsInvalidBid(stale) && error::IsNotFound(missing) &&
+                  error::IsItemUnavailable(closed_item) &&
+                  admission.getStats().num_stale == 2 &&
+                  admission.getStats().num_admitted == 0);
+
+  printTest("Testing AdmissionController rate limits...");
+  std::mutex results_mutex;
+  std::vector<bool> results;
+  auto record = [&](Status status) {
+    std::lock_guard<std::mutex> lock(results_mutex);
+    results.push_back(status.ok());
+  };
+  // Bob's bucket holds two bids, so a third straight away is refused, while
+  // Carol still gets through.
+  Status first = admission.submitBid(auction_id, 0, 1, 200, record);
+  Status second = admission.submitBid(auction_id, 0, 1, 300, record);
+  Status third = admission.submitBid(auction_id, 0, 1, 400, record);
+  Status carol = admission.submitBid(auction_id, 0, 2, 500, record);
+  host.drain();
+  auction_engine::Quote quote;
+  host.getQuote(auction_id, 0, quote);
+  printTestResult(first.ok() && second.ok() &&
+                  error::IsResourceExhausted(third) && carol.ok() &&
+                  results == std::vector<bool>({true, true, true}) &&
+                  quote.value == 500 && quote.leader == 2 &&
+                  admission.getStats().num_rate_limited == 1 &&
+                  admission.getStats().num_admitted == 3);
+
+  printTest("Testing AdmissionController overload...");
+  limits.per_user = auction_engine::RateLimit();
+  limits.max_queued = 4;
+  auction_engine::AdmissionController bounded(host, limits);
+  // Hold the auction's strand so that bids pile up in its queue.
+  std::atomic<bool> blocked(false), release(false);
+  host.submit(auction_id, [&](Auction&) {
+    blocked.store(true);
+    while (!release.load())
+      std::this_thread::yield();
+  });
+  while (!blocked.load())
+    std::this_thread::yield();
+  size_t num_admitted = 0, num_overloaded = 0;
+  for (uint32_t value=1000; value<1010; ++value) {
+    Status status = bounded.submitBid(auction_id, 0, value % 2, value);
+    num_admitted += status.ok();
+    num_overloaded += error::IsResourceExhausted(status);
+  }
+  release.store(true);
+  host.drain();
+  host.getQuote(auction_id, 0, quote);
+  printTestResult(num_admitted == 4 && num_overloaded == 6 &&
+                  bounded.getStats().num_overloaded == 6 &&
+                  quote.value == 1003 &&
+                  host.trySubmit(auction_id, [](Auction&) {}, 1).ok());
+
+  printTest("Testing AdmissionController retractions...");
+  blocked.store(false);
+  release.store(false);
+  host.submit(auction_id, [&](Auction&) {
+    blocked.store(true);
+    while (!release.load())
+      std::this_thread::yield();
+  });
+  while (!blocked.load())
+    std::this_thread::yield();
+  // Retract the leading bid of 1003, leaving 1002 in the lead.
+  host.submit(auction_id, [](Auction& auction) {
+    auction_engine::Quote before;
+    auction.getQuote(0, before);
+    auction.retractBid(0, before.num_bids - 1);
+  });
+  // The quote still shows 1003 while the retraction waits.
+  Status raced = bounded.submitBid(auction_id, 0, 1, 1003);
+  release.store(true);
+  host.drain();
+  auction_engine::Quote retracted;
+  host.getQuote(auction_id, 0, retracted);
+  std::atomic<bool> placed(false);
+  Status rebid = bounded.submitBid(auction_id, 0, 1, 1003,
+                                   [&](Status status) {
+    placed.store(status.ok());
+  });
+  host.drain();
+  host.getQuote(auction_id, 0, quote);
+  printTestResult(error::IsInvalidBid(raced) && retracted.value == 1002 &&
+                  rebid.ok() && placed.load() && quote.value == 1003 &&
+                  quote.leader == 1);
+
+  host.drain();
+  return 0;
+}
@@ -0,0 +1,61 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+
+namespace auction_engine {
+
+/**
+ * \brief Aggregates an auction keeps up to date for each item.
+ *
+ * They are updated as bids are recorded and the item is opened, so reading
+ * them costs the same however many bids the item has had.
+ */
+struct ItemAnalytics {
+  using Clock = std::chrono::system_clock;
+
+  /// Number of bids recorded on the item.
+  uint32_t num_bids = 0;
+
+  /// Number of distinct users who have bid on the item.
+  uint32_t num_bidders = 0;
+
+  /// Sum of how much each bid raised the item's value, the first counted from
+  /// the starting value.
+  uint64_t total_increment = 0;
+
+  /// When the item was first opened, or the epoch if it never has been.
+  Clock::time_point opened;
+
+  /// When the first bid was recorded, or the epoch if there is none. Bid
+  /// times are not kept, so this stays put when the first bid is retracted
+  /// while others are left.
+  Clock::time_point first_bid;
+
+  /// Return the average amount a bid raised the item's value by.
+  double getAverageIncrement() const {
+    return num_bids ? double(total_increment) / num_bids : 0;
+  }
+
+  /// Return how long after the item was first opened its first bid came, or
+  /// zero if it has no bids.
+  Clock::duration getTimeToFirstBid() const {
+    return num_bids ? first_bid - opened : Clock::duration::zero();
+  }
+};
+}  // namespace auction_engine
@@ -0,0 +1,109 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <coroutine>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "async_auction.h"
+#include "auction.h"
+#include "auction_host.h"
+#include "status.h"
+
+namespace auction_engine {
+
+void CompletionQueue::post(std::coroutine_handle<> handle) {
+  bool wake;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Only the first post after the owner went to sleep needs to wake it;
+    // it takes everything posted until then in one batch.
+    wake = waiting && handles.empty();
+    handles.push_back(handle);
+  }
+  if (wake)
+    posted.notify_one();
+}
+
+size_t CompletionQueue::poll() {
+  std::vector<std::coroutine_handle<>> batch;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    batch.swap(handles);
+  }
+  return resume(batch);
+}
+
+size_t CompletionQueue::wait() {
+  std::vector<std::coroutine_handle<>> batch;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    waiting = true;
+    posted.wait(lock, [this]{ return !handles.empty(); });
+    waiting = false;
+    batch.swap(handles);
+  }
+  return resume(batch);
+}
+
+size_t CompletionQueue::resume(std::vector<std::coroutine_handle<>>& batch) {
+  // Resumed coroutines may await again and post to the queue, which is
+  // unlocked by now; those are picked up by the next batch.
+  for (std::coroutine_handle<>& handle: batch)
+    handle.resume();
+  return batch.size();
+}
+
+bool AsyncAuction::Operation::await_suspend(std::coroutine_handle<> handle) {
+  Status submitted = engine.host.submit(
+      engine.auction_id, [this, handle](Auction& auction) {
+        status = function(auction);
+        engine.completions.post(handle);
+      });
+  // Once submitted the coroutine may already have been resumed elsewhere and
+  // this operation destroyed, so only touch it if the task will never run.
+  if (submitted.ok())
+    return true;
+  status = std::move(submitted);
+  return false;
+}
+
+AsyncAuction::Operation AsyncAuction::placeBid(uint32_t item_id,
+                                               uint32_t user_id,
+                                               uint32_t value) {
+  return Operation(*this, [=](Auction& auction) {
+    return auction.placeBid(item_id, user_id, value);
+  });
+}
+
+AsyncAuction::Operation AsyncAuction::openItem(uint32_t item_id) {
+  return Operation(*this, [=](Auction& auction) {
+    return auction.openItem(item_id);
+  });
+}
+
+AsyncAuction::Operation AsyncAuction::closeItem(uint32_t item_id, bool sell) {
+  return Operation(*this, [=](Auction& auction) {
+    return auction.closeItem(item_id, sell);
+  });
+}
+
+AsyncAuction::Operation AsyncAuction::run(Function function) {
+  return Operation(*this, std::move(function));
+}
+}  // namespace auction_engine
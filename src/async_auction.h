@@ -0,0 +1,143 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "auction.h"
+#include "auction_host.h"
+#include "status.h"
+
+namespace auction_engine {
+
+/**
+ * \brief Coroutines waiting to be resumed on the thread that owns the queue.
+ *
+ * Operations finished by an \c AuctionHost worker post the coroutine that
+ * awaited them here instead of resuming it on the worker. The owning thread
+ * resumes every posted coroutine at once with \c poll() or \c wait(), so a
+ * burst of completions costs it one wakeup rather than one per operation,
+ * and the coroutines never move to another thread.
+ */
+class CompletionQueue {
+public:
+  CompletionQueue() : waiting(false) {}
+
+  CompletionQueue(const CompletionQueue&) = delete;
+  CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+  /// Queue \c handle to be resumed. Safe to call from any thread.
+  void post(std::coroutine_handle<> handle);
+
+  /// Resume every coroutine posted so far without blocking. Returns the
+  /// number resumed.
+  size_t poll();
+
+  /// Block until at least one coroutine has been posted, then resume every
+  /// coroutine posted so far. Returns the number resumed.
+  size_t wait();
+
+private:
+  /// Resume the coroutines in \c batch and return how many there were.
+  static size_t resume(std::vector<std::coroutine_handle<>>& batch);
+
+  std::mutex mutex;
+  std::condition_variable posted;
+  std::vector<std::coroutine_handle<>> handles;
+  /// \c true while the owning thread is blocked in \c wait().
+  bool waiting;
+};
+
+/**
+ * \brief Awaitable access to one auction of an \c AuctionHost.
+ *
+ * Each operation returns an awaitable; awaiting it from a coroutine queues
+ * the operation on the auction's strand and suspends the coroutine, which is
+ * resumed through \c completions with the operation's \c Status once it has
+ * run:
+ *
+ * \code
+ *   Status status = co_await engine.placeBid(item_id, user_id, value);
+ * \endcode
+ *
+ * Operations awaited on one auction run in the order they were awaited, like
+ * any other tasks submitted to the host.
+ */
+class AsyncAuction {
+public:
+  /// An operation on the auction, run by the host when awaited.
+  using Function = std::function<Status(Auction&)>;
+
+  /// Awaitable returned by the operations below. Await it exactly once.
+  class Operation {
+  public:
+    Operation(AsyncAuction& engine, Function function)
+        : engine(engine), function(std::move(function)) {}
+
+    bool await_ready() const { return false; }
+
+    /// Queue the operation. Does not suspend if the auction is not hosted.
+    bool await_suspend(std::coroutine_handle<> handle);
+
+    /// Return the \c Status of the operation.
+    Status await_resume() { return std::move(status); }
+
+  private:
+    AsyncAuction& engine;
+    Function function;
+    Status status;
+  };
+
+  /**
+   * \brief Give coroutines on one thread awaitable access to an auction.
+   *
+   * \param host
+   *    Host running the auction.
+   *
+   * \param auction_id
+   *    ID of the auction returned by \c AuctionHost::addAuction().
+   *
+   * \param completions
+   *    Queue the awaiting coroutines are resumed from.
+   */
+  AsyncAuction(AuctionHost& host, uint32_t auction_id,
+               CompletionQueue& completions)
+      : host(host), auction_id(auction_id), completions(completions) {}
+
+  /// Awaitable \c Auction::placeBid().
+  Operation placeBid(uint32_t item_id, uint32_t user_id, uint32_t value);
+
+  /// Awaitable \c Auction::openItem().
+  Operation openItem(uint32_t item_id);
+
+  /// Awaitable \c Auction::closeItem().
+  Operation closeItem(uint32_t item_id, bool sell=false);
+
+  /// Awaitable call of any other \c function on the auction.
+  Operation run(Function function);
+
+private:
+  AuctionHost& host;
+  const uint32_t auction_id;
+  CompletionQueue& completions;
+};
+}  // namespace auction_engine
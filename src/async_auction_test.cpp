@@ -0,0 +1,143 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <coroutine>
+#include <exception>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+#include "async_auction.h"
+#include "auction.h"
+#include "auction_host.h"
+#include "error.h"
+#include "item.h"
+#include "status.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+/// Coroutine that starts immediately and frees itself when it finishes.
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() { return {}; }
+    std::suspend_never initial_suspend() { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+struct Results {
+  int finished = 0;
+  int failures = 0;
+  int wrong_thread = 0;
+};
+
+/// Open an item, bid on it for two users in turn and sell it.
+Detached bidOnItem(auction_engine::AsyncAuction& engine, uint32_t item_id,
+                   uint32_t num_bids, Results& results) {
+  const std::thread::id owner = std::this_thread::get_id();
+  if (!(co_await engine.openItem(item_id)).ok())
+    ++results.failures;
+  for (uint32_t value=1; value<=num_bids; ++value) {
+    if (!(co_await engine.placeBid(item_id, value % 2, value)).ok())
+      ++results.failures;
+    if (std::this_thread::get_id() != owner)
+      ++results.wrong_thread;
+  }
+  if (!(co_await engine.closeItem(item_id, true)).ok())
+    ++results.failures;
+  ++results.finished;
+}
+
+/// Await an operation on an auction that is not hosted.
+Detached awaitMissing(auction_engine::AsyncAuction& engine,
+                      auction_engine::Status& status) {
+  status = co_await engine.openItem(0);
+}
+
+int main() {
+  using auction_engine::Auction;
+  const uint32_t kNumAuctions = 4;
+  const uint32_t kItemsPerAuction = 8;
+  const uint32_t kNumBids = 500;
+
+  auction_engine::AuctionHost host(4);
+  auction_engine::CompletionQueue completions;
+  std::vector<auction_engine::AsyncAuction> engines;
+  for (uint32_t i=0; i<kNumAuctions; ++i) {
+    engines.emplace_back(host, host.addAuction(), completions);
+    host.submit(i, [](Auction& auction) {
+      auction.addUser("Alice", 1000000);
+      auction.addUser("Bob", 1000000);
+      for (uint32_t item=0; item<kItemsPerAuction; ++item)
+        auction.addItem("Item " + std::to_string(item), 0);
+    });
+  }
+
+  printTest("Testing co_await AsyncAuction...");
+  Results results;
+  for (auto& engine: engines) {
+    for (uint32_t item=0; item<kItemsPerAuction; ++item)
+      bidOnItem(engine, item, kNumBids, results);
+  }
+  const int kNumCoroutines = kNumAuctions * kItemsPerAuction;
+  size_t num_wakeups = 0, num_resumed = 0;
+  while (results.finished < kNumCoroutines) {
+    num_resumed += completions.wait();
+    ++num_wakeups;
+  }
+  bool sold = true;
+  for (uint32_t i=0; i<kNumAuctions; ++i) {
+    host.submit(i, [&sold, kNumBids](Auction& auction) {
+      for (uint32_t item=0; item<kItemsPerAuction; ++item) {
+        const auction_engine::Item* sold_item;
+        auction.getItem(item, sold_item);
+        if (!auction.isSold(item) ||
+            sold_item->getCurrentValue() != kNumBids)
+          sold = false;
+      }
+    });
+  }
+  host.drain();
+  printTestResult(results.failures == 0 && results.wrong_thread == 0 &&
+                  sold &&
+                  num_resumed == kNumCoroutines * (kNumBids + 2));
+
+  printTest("Testing CompletionQueue batching...");
+  // Operations of many coroutines finish while the owner is busy resuming
+  // others, so most wakeups resume more than one.
+  printTestResult(num_wakeups < num_resumed);
+
+  printTest("Testing co_await on a missing auction...");
+  auction_engine::CompletionQueue missing_completions;
+  auction_engine::AsyncAuction missing(host, kNumAuctions,
+                                       missing_completions);
+  auction_engine::Status status;
+  awaitMissing(missing, status);
+  printTestResult(auction_engine::error::IsNotFound(status) &&
+                  missing_completions.poll() == 0);
+
+  return 0;
+}
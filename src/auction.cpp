@@ -13,56 +13,109 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <chrono>
 #include <string>
 #include <vector>
 #include <map>
 #include <algorithm>
 #include <memory>
+#include <utility>
+#include <stddef.h>
 #include <stdint.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 #include "bid.h"
+#include "bid_archive.h"
 #include "auction.h"
+#include "auction_snapshot.h"
+#include "id_allocator.h"
+#include "scan.h"
 #include "item.h"
 #include "user.h"
+#include "wallet_ledger.h"
 #include "error.h"
 #include "status.h"
 
 namespace auction_engine {
 
+namespace {
+
+/// Bytes a typical allocator adds to each heap allocation, for the estimates
+/// of \c getMemoryUsage().
+const size_t kHeapOverhead = 16;
+/// Bytes of a \c std::map node besides its value.
+const size_t kTreeNodeOverhead = 4 * sizeof(void*) + kHeapOverhead;
+/// Bytes of a \c std::make_shared control block besides its value.
+const size_t kControlBlockOverhead = 2 * sizeof(uint32_t) + sizeof(void*);
+
+// Turn the page-relative indices a scan appended to \c slots from \c first on
+// into slots.
+void addPageBase(size_t page, size_t first, std::vector<uint32_t>& slots) {
+  const uint32_t base = page << PagedColumn<uint32_t>::kPageBits;
+  for (size_t i=first; i<slots.size(); ++i)
+    slots[i] += base;
+}
+
+// The values of a page of item records, for the scan kernels.
+scan::Strided valuesOf(const HotItem* items) {
+  static_assert(offsetof(HotItem, value) == 0 &&
+                sizeof(HotItem) % sizeof(uint32_t) == 0,
+                "Item values are scanned as every fourth uint32_t.");
+  return {&items->value, sizeof(HotItem) / sizeof(uint32_t)};
+}
+
+// The available funds of a page of user records, for the scan kernels.
+scan::Strided availableFundsOf(const HotUser* users) {
+  static_assert(offsetof(HotUser, available_funds) == 0 &&
+                sizeof(HotUser) % sizeof(uint32_t) == 0,
+                "Available funds are scanned as every other uint32_t.");
+  return {&users->available_funds, sizeof(HotUser) / sizeof(uint32_t)};
+}
+}  // namespace
+
 std::vector<uint32_t> const Auction::getItems() const {
   std::vector<uint32_t> item_id_vec;
-  for (const auto& kv: items)
-    item_id_vec.push_back(kv.first);
+  item_id_vec.reserve(item_ids->getNumLive());
+  for (uint32_t slot=0; slot<item_ids->getNumSlots(); ++slot) {
+    if (item_ids->isSlotLive(slot))
+      item_id_vec.push_back(item_ids->idOf(slot));
+  }
   return item_id_vec;
 }
 
 std::vector<uint32_t> const Auction::getUsers() const {
   std::vector<uint32_t> user_id_vec;
-  for (const auto& kv: users)
-    user_id_vec.push_back(kv.first);
+  user_id_vec.reserve(user_ids->getNumLive());
+  for (uint32_t slot=0; slot<user_ids->getNumSlots(); ++slot) {
+    if (user_ids->isSlotLive(slot))
+      user_id_vec.push_back(user_ids->idOf(slot));
+  }
   return user_id_vec;
 }
 
 bool Auction::isItemRegistered(uint32_t item_id) const {
-  return items.count(item_id);
-
+  return item_ids->isLive(item_id);
 }
 
 bool Auction::isUserRegistered(uint32_t user_id) const {
-  return users.count(user_id);
+  return user_ids->isLive(user_id);
 }
 
 bool Auction::isOpen(uint32_t item_id) const {
-  return std::binary_search(open_items.cbegin(), open_items.cend(), item_id);
+  return isItemRegistered(item_id) &&
+         (item_hot_column[IdAllocator::slotOf(item_id)].state & kItemOpen);
 }
 
 bool Auction::isSold(uint32_t item_id) const {
-  return std::binary_search(sold_items.cbegin(), sold_items.cend(), item_id);
+  return isItemRegistered(item_id) &&
+         (item_hot_column[IdAllocator::slotOf(item_id)].state & kItemSold);
 }
 
 Status Auction::getItem(uint32_t item_id, const Item*& item) const {
   if (isItemRegistered(item_id)) {
-    item = items.at(item_id).get();
+    item = itemAt(item_id);
     return Status::OK();
   } else {
     return error::NotFound(
@@ -74,7 +127,7 @@ Status Auction::getItem(uint32_t item_id, const Item*& item) const {
 
 Status Auction::getUser(uint32_t user_id, const User*& user) const {
   if (isUserRegistered(user_id)) {
-    user = users.at(user_id).get();
+    user = userAt(user_id);
     return Status::OK();
   } else {
     return error::NotFound(
@@ -84,39 +137,139 @@ Status Auction::getUser(uint32_t user_id, const User*& user) const {
   }
 }
 
-Status Auction::addItem(std::string name, uint32_t starting_value) {
-  for (const auto& kv: items) {
-    if (name == kv.second->getName()) {
-      return error::NameTaken(
-          "An item with name \"", 
-          name,
-          "\"already exists.");
-    }
+Status Auction::findItem(std::string_view name, uint32_t& item_id) const {
+  const uint32_t found = findName(item_ids_by_name, name);
+  if (found != IdAllocator::kInvalidId) {
+    item_id = found;
+    return Status::OK();
+  }
+  return error::NotFound(
+      "No item named \"",
+      name,
+      "\" is registered in the auction.");
+}
+
+Status Auction::findUser(std::string_view name, uint32_t& user_id) const {
+  const uint32_t found = findName(user_ids_by_name, name);
+  if (found != IdAllocator::kInvalidId) {
+    user_id = found;
+    return Status::OK();
+  }
+  return error::NotFound(
+      "No user named \"",
+      name,
+      "\" is registered in the auction.");
+}
+
+Status Auction::addItem(std::string_view name, uint32_t starting_value) {
+  if (findName(item_ids_by_name, name) != IdAllocator::kInvalidId) {
+    return error::NameTaken(
+        "An item with name \"", 
+        name,
+        "\"already exists.");
   }
 
-  // Create and add item
-  items[item_id_counter] = std::make_unique<Item>(*this, item_id_counter,
-      name, starting_value);
-  item_id_counter++;
+  uint32_t item_id;
+  if (!item_ids.mutate().allocate(item_id)) {
+    return error::ResourceExhausted(
+        "No item IDs are left to register item \"",
+        name,
+        "\".");
+  }
 
+  registerItem(item_id, name, starting_value);
   return Status::OK();
 }
 
-Status Auction::addUser(std::string name, uint32_t funds) {
-  for (const auto& kv: users) {
-    if (name == kv.second->getName()) {
-      return error::NameTaken(
-          "A user with name \"",
-          name,
-          "\"already exists.");
-    }
+Status Auction::addItems(const std::vector<BulkEntry>& entries,
+                         unsigned num_threads) {
+  const size_t taken = findFirstTakenName(
+      entries, num_threads, [this](std::string_view name) {
+        return findName(item_ids_by_name, name) != IdAllocator::kInvalidId;
+      });
+  if (taken < entries.size()) {
+    return error::NameTaken(
+        "Entry ",
+        taken,
+        ": an item with name \"",
+        entries[taken].name,
+        "\" already exists.");
+  }
+  if (entries.size() > item_ids->getNumFree()) {
+    return error::ResourceExhausted(
+        "Only ",
+        item_ids->getNumFree(),
+        " item IDs are left to register ",
+        entries.size(),
+        " items.");
   }
 
-  // Create and add user
-  users[user_id_counter] = std::make_unique<User>(*this, user_id_counter,
-      name, funds);
-  user_id_counter++;
+  uint32_t last_slot;
+  if (getLastNewSlot(*item_ids, entries.size(), last_slot))
+    reserveItemSlot(last_slot);
+  names->reserve(names->size() + entries.size());
+  IdAllocator& ids = item_ids.mutate();
+  for (const BulkEntry& entry: entries) {
+    uint32_t item_id;
+    ids.allocate(item_id);
+    registerItem(item_id, entry.name, entry.value);
+  }
+  return Status::OK();
+}
+
+Status Auction::addUser(std::string_view name, uint32_t funds) {
+  if (findName(user_ids_by_name, name) != IdAllocator::kInvalidId) {
+    return error::NameTaken(
+        "A user with name \"",
+        name,
+        "\"already exists.");
+  }
+
+  uint32_t user_id;
+  if (!user_ids.mutate().allocate(user_id)) {
+    return error::ResourceExhausted(
+        "No user IDs are left to register user \"",
+        name,
+        "\".");
+  }
 
+  registerUser(user_id, name, funds);
+  return Status::OK();
+}
+
+Status Auction::addUsers(const std::vector<BulkEntry>& entries,
+                         unsigned num_threads) {
+  const size_t taken = findFirstTakenName(
+      entries, num_threads, [this](std::string_view name) {
+        return findName(user_ids_by_name, name) != IdAllocator::kInvalidId;
+      });
+  if (taken < entries.size()) {
+    return error::NameTaken(
+        "Entry ",
+        taken,
+        ": a user with name \"",
+        entries[taken].name,
+        "\" already exists.");
+  }
+  if (entries.size() > user_ids->getNumFree()) {
+    return error::ResourceExhausted(
+        "Only ",
+        user_ids->getNumFree(),
+        " user IDs are left to register ",
+        entries.size(),
+        " users.");
+  }
+
+  uint32_t last_slot;
+  if (getLastNewSlot(*user_ids, entries.size(), last_slot))
+    reserveUserSlot(last_slot);
+  names->reserve(names->size() + entries.size());
+  IdAllocator& ids = user_ids.mutate();
+  for (const BulkEntry& entry: entries) {
+    uint32_t user_id;
+    ids.allocate(user_id);
+    registerUser(user_id, entry.name, entry.value);
+  }
   return Status::OK();
 }
 
@@ -129,7 +282,7 @@ Status Auction::openItem(uint32_t item_id) {
         " is not registered in the auction.");
   }
 
-  const Item* item = items.at(item_id).get();
+  const Item* item = itemAt(item_id);
 
   // Check if item is sold, return ITEM_UNAVAILABLE if not
   if (isSold(item_id)) {
@@ -141,8 +294,15 @@ Status Auction::openItem(uint32_t item_id) {
 
   // Check if item is already open, if not add it.
   if (!isOpen(item_id)) {
-    auto it = std::upper_bound(open_items.cbegin(), open_items.cend(), item_id);
-    open_items.insert(it, item_id);
+    std::vector<uint32_t>& open = open_items.mutate();
+    open.insert(std::upper_bound(open.cbegin(), open.cend(), item_id), item_id);
+    const uint32_t slot = IdAllocator::slotOf(item_id);
+    item_hot_column.mutate(slot).state |= kItemOpen;
+    // Reopening an item doesn't restart its time to first bid.
+    const ItemAnalytics& analytics = item_analytics_column[slot];
+    if (analytics.opened == ItemAnalytics::Clock::time_point())
+      item_analytics_column.mutate(slot).opened = ItemAnalytics::Clock::now();
+    publishQuote(item_id);
   }
 
   return Status::OK();
@@ -157,7 +317,7 @@ Status Auction::sellItem(uint32_t item_id) {
         "\" is not registered in the auction.");
   }
 
-  const Item* item = items.at(item_id).get();
+  const Item* item = itemAt(item_id);
 
   // Check if item is sold, return ITEM_UNAVAILABLE if not
   if (isSold(item_id)) {
@@ -167,22 +327,36 @@ Status Auction::sellItem(uint32_t item_id) {
         "\" has been sold.");
   } 
 
-  if (item->getBids().empty()) {
+  const uint32_t slot = IdAllocator::slotOf(item_id);
+  if (item_hot_column[slot].num_bids == 0) {
     return error::NoBid(
         "No bids have been placed on Item \"",
         item->getName(),
         "\".");
   }
 
-  auto it = std::upper_bound(sold_items.cbegin(), sold_items.cend(), item_id);
-  sold_items.insert(it, item_id);
-  revenue += item->getCurrentValue();
-  std::vector<uint32_t> bidding_users = users_for_item.at(item_id);
-  uint32_t winning_user = item->getCurrentBid()->user_id;
+  std::vector<uint32_t>& sold = sold_items.mutate();
+  sold.insert(std::upper_bound(sold.cbegin(), sold.cend(), item_id), item_id);
+  item_hot_column.mutate(slot).state |= kItemSold;
+  // A multi-unit item has quantity bids rather than a leader, and no bid
+  // history to archive.
+  if (item_hot_column[slot].state & kItemMultiUnit) {
+    clearMultiUnitItem(item_id);
+    publishQuote(item_id);
+    return Status::OK();
+  }
+  publishQuote(item_id);
+  addRevenue(item_hot_column[slot].value);
+  const std::vector<uint32_t> bidding_users = item->getBidders();
+  uint32_t winning_user = item_hot_column[slot].leader;
   for (auto it: bidding_users)
-    users[it]->reportBidResult(item_id, it==winning_user);
+    userAt(it)->reportBidResult(item_id, it==winning_user);
+  const uint32_t winning_wallet =
+      user_hot_column[IdAllocator::slotOf(winning_user)].wallet;
+  if (winning_wallet != IdAllocator::kInvalidId)
+    ledger->settle(winning_wallet, item_hot_column[slot].value);
 
-  return Status::OK();
+  return retireSoldItem(item_id);
 }
 
 Status Auction::closeItem(uint32_t item_id, bool sell) {
@@ -194,16 +368,31 @@ Status Auction::closeItem(uint32_t item_id, bool sell) {
         "\" is not registered in the auction.");
   }
 
+  // A sale that is bound to fail is refused before the item is closed, so a
+  // failed command leaves the auction as it was.
+  if (sell && !isSold(item_id) &&
+      item_hot_column[IdAllocator::slotOf(item_id)].num_bids == 0) {
+    return error::NoBid(
+        "No bids have been placed on Item \"",
+        itemAt(item_id)->getName(),
+        "\".");
+  }
+
   // If item is open, find it in open items, sell it, and close it
   if (isOpen(item_id)) {
-    auto it = std::lower_bound(open_items.cbegin(), open_items.cend(), item_id);
-    open_items.erase(it+1);
+    std::vector<uint32_t>& open = open_items.mutate();
+    open.erase(std::lower_bound(open.cbegin(), open.cend(), item_id));
+    item_hot_column.mutate(IdAllocator::slotOf(item_id)).state &=
+        ~(kItemOpen | kItemDutch);
+    if (dutch_clocks->count(item_id))
+      dutch_clocks.mutate().erase(item_id);
+    publishQuote(item_id);
   } else {
     // Item is closed. Return error code if trying to sell a sold item
     if (sell && isSold(item_id)) {
       return error::ItemUnavailable(
           "Item \"",
-          items.at(item_id)->getName(),
+          itemAt(item_id)->getName(),
           "\" has been sold.");
     }
   }
@@ -230,38 +419,65 @@ Status Auction::placeBid(uint32_t item_id, uint32_t user_id, uint32_t value) {
         "\" is not registered in the auction.");
   }
 
-  Item* item = items.at(item_id).get();
-  User* user = users.at(user_id).get();
+  // Validation only reads the item's and the user's hot records, one cache
+  // line each. The cold User and Item objects are only touched to build error
+  // messages and to record an accepted bid.
+  const HotItem& hot_item = item_hot_column[IdAllocator::slotOf(item_id)];
+  const HotUser& hot_user = user_hot_column[IdAllocator::slotOf(user_id)];
+  const uint8_t state = hot_item.state;
 
-  if (!isOpen(item_id)) {
+  if (!(state & kItemOpen)) {
     return error::ItemUnavailable(
         "Item \"",
-        item->getName(),
+        itemAt(item_id)->getName(),
         "\" is not currently open in the auction.");
   }
 
-  if (isSold(item_id)) {
+  if (state & kItemSold) {
     return error::ItemUnavailable(
         "Item \"",
-        item->getName(),
+        itemAt(item_id)->getName(),
         "\" is already sold.");
   }
 
+  if (state & kItemDutch) {
+    return error::InvalidBid(
+        "Item \"",
+        itemAt(item_id)->getName(),
+        "\" is sold by Dutch auction; its price can only be accepted.");
+  }
+
+  if (state & kItemMultiUnit) {
+    return error::InvalidBid(
+        "Item \"",
+        itemAt(item_id)->getName(),
+        "\" is sold in units and only takes quantity bids.");
+  }
+
   // The amount the user can bid on this item is what they've already bid plus
   // their available funds i.e. they can up the bid by their available funds.
-  if (value > user->getAvailableFunds() + user->getBidValueOnItem(item_id)) {
-    return error::InsufficientFunds(
-        "Attempted bid value ",
-        value,
-        " is greater than user's available funds.");
+  // What they've already bid is only looked up when the available funds alone
+  // don't cover the bid, and the leader's standing bid is the current value.
+  const uint32_t available_funds = hot_user.available_funds;
+  const uint32_t current_value = hot_item.value;
+  const uint32_t leader = hot_item.leader;
+  const uint32_t wallet_id = hot_user.wallet;
+  if (wallet_id == IdAllocator::kInvalidId && value > available_funds) {
+    const uint32_t standing_bid = leader == user_id ?
+        current_value : userAt(user_id)->getBidValueOnItem(item_id);
+    if (value > available_funds + standing_bid) {
+      return error::InsufficientFunds(
+          "Attempted bid value ",
+          value,
+          " is greater than user's available funds.");
+    }
   }
   
-  const uint32_t current_value = item->getCurrentValue();
   // The new bid must be strictly greater than the current bid, unless no bids 
   // have been made, in which case it can be greater than or equal to the 
   // starting value.
-  if ((!item->getBids().empty() && value < current_value) ||
-      value <= current_value) {
+  const uint32_t num_bids = hot_item.num_bids;
+  if ((num_bids && value < current_value) || value <= current_value) {
     return error::InvalidBid(
         "Attempted bid value ",
         value,
@@ -269,18 +485,1419 @@ Status Auction::placeBid(uint32_t item_id, uint32_t user_id, uint32_t value) {
         current_value, ".");
   }
 
+  // Only a leading bid holds a reservation in the ledger, so a leader raising
+  // their bid reserves the difference and anyone else the whole value. The
+  // reservation is made last so that nothing can fail after it.
+  if (wallet_id != IdAllocator::kInvalidId) {
+    const uint32_t reserved = leader == user_id ? current_value : 0;
+    Status status = ledger->reserve(wallet_id, value - reserved);
+    if (!status.ok())
+      return status;
+  }
+  if (leader != IdAllocator::kInvalidId && leader != user_id) {
+    const uint32_t leader_wallet =
+        user_hot_column[IdAllocator::slotOf(leader)].wallet;
+    if (leader_wallet != IdAllocator::kInvalidId)
+      ledger->release(leader_wallet, current_value);
+  }
+
+  recordBid(item_id, user_id, value);
+  return Status::OK();
+}
+
+void Auction::placeCoalescedBids(uint32_t item_id,
+                                 const std::vector<PendingBid>& bids,
+                                 std::vector<Status>& results) {
+  // Whether a bid passes the funds check doesn't depend on the other bids in
+  // the batch, since a user's own bids on the item only move funds between
+  // their standing bid and their available funds. So the bid that would have
+  // ended up leading is the highest one that passes, earliest among equals,
+  // and once it's placed every bid tried after it is too low.
+  std::vector<uint32_t> order(bids.size());
+  for (uint32_t index = 0; index < order.size(); ++index)
+    order[index] = index;
+  std::stable_sort(order.begin(), order.end(),
+                   [&bids](uint32_t lhs, uint32_t rhs) {
+                     return bids[lhs].value > bids[rhs].value;
+                   });
+
+  results.clear();
+  results.resize(bids.size());
+  for (uint32_t index : order)
+    results[index] = placeBid(item_id, bids[index].user_id, bids[index].value);
+}
+
+Status Auction::retractBid(uint32_t item_id, uint32_t bid_number) {
+  if (!isItemRegistered(item_id)) {
+    return error::NotFound(
+        "Item \"",
+        item_id,
+        "\" is not registered in the auction.");
+  }
+
+  Item* item = itemAt(item_id);
+
+  if (isSold(item_id)) {
+    return error::ItemUnavailable(
+        "Item \"",
+        item->getName(),
+        "\" has been sold and its bids can no longer be retracted.");
+  }
+
+  const Bid* previous;
+  const Bid* bid = item->findBid(bid_number, previous);
+  if (!bid) {
+    return error::NotFound(
+        "Item \"",
+        item->getName(),
+        "\" has no bid ",
+        bid_number,
+        ".");
+  }
+
+  // Only a leading bid holds a reservation in the ledger, so retracting one
+  // moves the reservation to the bid that takes the lead. That is reserved
+  // first, so that nothing can fail after it.
+  const bool leading = bid == item->getCurrentBid();
+  const Bid* next = leading ? previous : nullptr;
+  if (leading) {
+    const uint32_t wallet_id =
+        user_hot_column[IdAllocator::slotOf(bid->user_id)].wallet;
+    const uint32_t next_wallet = next ?
+        user_hot_column[IdAllocator::slotOf(next->user_id)].wallet :
+        IdAllocator::kInvalidId;
+    const bool same_user = next && next->user_id == bid->user_id;
+    if (next_wallet != IdAllocator::kInvalidId && !same_user) {
+      Status status = ledger->reserve(next_wallet, next->value);
+      if (!status.ok())
+        return status;
+    }
+    if (wallet_id != IdAllocator::kInvalidId)
+      ledger->release(wallet_id, bid->value - (same_user ? next->value : 0));
+  }
+
+  const uint32_t user_id = bid->user_id;
+  User* user = userAt(user_id);
+  // The item holds the bid, so the user lets go of it first.
+  user->removeBid(*bid);
+  item->removeBid(bid_number);
+  --num_live_bids;
+
+  const uint32_t slot = IdAllocator::slotOf(item_id);
+  ItemAnalytics& analytics = item_analytics_column.mutate(slot);
+  if (!user->alreadyBidOnItem(item_id)) {
+    item->removeBidder(user_id);
+    --num_bidder_links;
+    --analytics.num_bidders;
+  }
+  // Bids left on the item still rise from the starting value, so their
+  // increments add up to how far the value has risen. The time of the first
+  // bid left is not known, so the first bid time is only reset at zero.
+  if (--analytics.num_bids == 0) {
+    analytics.total_increment = 0;
+    analytics.first_bid = ItemAnalytics::Clock::time_point();
+  } else {
+    analytics.total_increment = item_hot_column[slot].value -
+                                item->getStartingValue();
+  }
+  return Status::OK();
+}
+
+Status Auction::openDutchItem(uint32_t item_id, uint32_t start_price,
+                              uint32_t floor_price, uint32_t decrement,
+                              std::chrono::steady_clock::duration tick) {
+  if (!isItemRegistered(item_id)) {
+    return error::NotFound(
+        "Item \"",
+        item_id,
+        "\" is not registered in the auction.");
+  }
+
+  if (floor_price > start_price || tick.count() <= 0) {
+    return error::InvalidRequest(
+        "A Dutch auction needs a floor price no higher than its start price "
+        "and a positive tick.");
+  }
+
+  const Item* item = itemAt(item_id);
+  const uint32_t slot = IdAllocator::slotOf(item_id);
+  const uint8_t state = item_hot_column[slot].state;
+
+  if (state & (kItemOpen | kItemSold)) {
+    return error::ItemUnavailable(
+        "Item \"",
+        item->getName(),
+        state & kItemSold ? "\" has been sold." : "\" is already open.");
+  }
+
+  if (item_hot_column[slot].num_bids || (state & kItemMultiUnit)) {
+    return error::ItemUnavailable(
+        "Item \"",
+        item->getName(),
+        state & kItemMultiUnit ? "\" is sold in units." :
+                                 "\" already has bids.");
+  }
+
+  dutch_clocks.mutate()[item_id] = {start_price, floor_price, decrement, tick,
+                           std::chrono::steady_clock::now()};
+  item_hot_column.mutate(slot).state |= kItemDutch;
+  return openItem(item_id);
+}
+
+Status Auction::getDutchClock(uint32_t item_id, DutchClock& clock) const {
+  if (!isItemRegistered(item_id)) {
+    return error::NotFound(
+        "Item \"",
+        item_id,
+        "\" is not registered in the auction.");
+  }
+
+  auto it = dutch_clocks->find(item_id);
+  if (it == dutch_clocks->end()) {
+    return error::ItemUnavailable(
+        "Item \"",
+        itemAt(item_id)->getName(),
+        "\" is not open for Dutch auction.");
+  }
+
+  clock = it->second;
+  return Status::OK();
+}
+
+Status Auction::getDutchPrice(uint32_t item_id, uint32_t& price) const {
+  DutchClock clock;
+  Status status = getDutchClock(item_id, clock);
+  if (status.ok())
+    price = clock.getPrice(std::chrono::steady_clock::now());
+  return status;
+}
+
+Status Auction::acceptDutchPrice(uint32_t item_id, uint32_t user_id,
+                                 uint32_t& price) {
+  // The price is taken before anything else, so a slow check never makes
+  // the buyer pay less than the price when they accepted.
+  const auto now = std::chrono::steady_clock::now();
+
+  DutchClock clock;
+  Status status = findDutchClock(item_id, user_id, clock);
+  if (!status.ok())
+    return status;
+
+  const uint32_t value = clock.getPrice(now);
+  status = sellDutchItem(item_id, user_id, value);
+  // A sale whose bids could not be archived has still been made.
+  if (status.ok() || isSold(item_id))
+    price = value;
+  return status;
+}
+
+Status Auction::acceptDutchPriceAt(uint32_t item_id, uint32_t user_id,
+                                   uint32_t price) {
+  DutchClock clock;
+  Status status = findDutchClock(item_id, user_id, clock);
+  if (!status.ok())
+    return status;
+
+  if (!clock.shows(price)) {
+    return error::InvalidBid(
+        "Price ",
+        price,
+        " is not one the Dutch clock of item \"",
+        itemAt(item_id)->getName(),
+        "\" shows.");
+  }
+  return sellDutchItem(item_id, user_id, price);
+}
+
+Status Auction::findDutchClock(uint32_t item_id, uint32_t user_id,
+                               DutchClock& clock) const {
+  if (!isUserRegistered(user_id)) {
+    return error::NotFound(
+        "User \"",
+        user_id,
+        "\" is not registered in the auction.");
+  }
+
+  Status status = getDutchClock(item_id, clock);
+  // An item that was just bought reports why it is no longer available.
+  if (error::IsItemUnavailable(status) && isSold(item_id)) {
+    return error::ItemUnavailable(
+        "Item \"",
+        itemAt(item_id)->getName(),
+        "\" has been sold.");
+  }
+  return status;
+}
+
+Status Auction::sellDutchItem(uint32_t item_id, uint32_t user_id,
+                              uint32_t price) {
+  const uint32_t user_slot = IdAllocator::slotOf(user_id);
+  const uint32_t wallet_id = user_hot_column[user_slot].wallet;
+  if (wallet_id != IdAllocator::kInvalidId) {
+    Status status = ledger->reserve(wallet_id, price);
+    if (!status.ok())
+      return status;
+  } else if (price > user_hot_column[user_slot].available_funds) {
+    return error::InsufficientFunds(
+        "Price ",
+        price,
+        " is greater than user's available funds.");
+  }
+
+  // The item has no bids, so the acceptance is its only and winning bid.
+  recordBid(item_id, user_id, price);
+  return closeItem(item_id, true);
+}
+
+Status Auction::openMultiUnitItem(uint32_t item_id, uint32_t num_units) {
+  if (!isItemRegistered(item_id)) {
+    return error::NotFound(
+        "Item \"",
+        item_id,
+        "\" is not registered in the auction.");
+  }
+
+  if (num_units == 0)
+    return error::InvalidRequest("A multi-unit item needs at least one unit.");
+
+  const Item* item = itemAt(item_id);
+  const uint32_t slot = IdAllocator::slotOf(item_id);
+  const uint8_t state = item_hot_column[slot].state;
+
+  if (state & (kItemOpen | kItemSold)) {
+    return error::ItemUnavailable(
+        "Item \"",
+        item->getName(),
+        state & kItemSold ? "\" has been sold." : "\" is already open.");
+  }
+
+  if (item_hot_column[slot].num_bids) {
+    return error::ItemUnavailable(
+        "Item \"",
+        item->getName(),
+        "\" already has bids.");
+  }
+
+  multi_unit_lots.mutate()[item_id].num_units = num_units;
+  item_hot_column.mutate(slot).state |= kItemMultiUnit;
+  return openItem(item_id);
+}
+
+Status Auction::placeQuantityBid(uint32_t item_id, uint32_t user_id,
+                                 uint32_t quantity, uint32_t unit_price) {
+  if (!isItemRegistered(item_id)) {
+    return error::NotFound(
+        "Item \"",
+        item_id,
+        "\" is not registered in the auction.");
+  }
+
+  if (!isUserRegistered(user_id)) {
+    return error::NotFound(
+        "User \"",
+        user_id,
+        "\" is not registered in the auction.");
+  }
+
+  const Item* item = itemAt(item_id);
+  const uint32_t item_slot = IdAllocator::slotOf(item_id);
+  const uint32_t user_slot = IdAllocator::slotOf(user_id);
+  const uint8_t state = item_hot_column[item_slot].state;
+
+  if (!(state & kItemOpen) || (state & kItemSold)) {
+    return error::ItemUnavailable(
+        "Item \"",
+        item->getName(),
+        "\" is not currently open in the auction.");
+  }
+
+  if (!(state & kItemMultiUnit)) {
+    return error::InvalidBid(
+        "Item \"",
+        item->getName(),
+        "\" is not sold in units.");
+  }
+
+  MultiUnitLot& lot = multi_unit_lots.mutate().at(item_id);
+  if (quantity == 0 || quantity > lot.num_units) {
+    return error::InvalidBid(
+        "Attempted quantity ",
+        quantity,
+        " is not between 1 and the ",
+        lot.num_units,
+        " units for sale.");
+  }
+
+  if (unit_price < item->getStartingValue()) {
+    return error::InvalidBid(
+        "Attempted unit price ",
+        unit_price,
+        " is lower than the starting value ",
+        item->getStartingValue(), ".");
+  }
+
+  // The whole quantity is reserved, since every unit may be won.
+  const uint64_t cost = uint64_t(quantity) * unit_price;
+  const uint32_t wallet_id = user_hot_column[user_slot].wallet;
+  if (cost > UINT32_MAX ||
+      (wallet_id == IdAllocator::kInvalidId &&
+       cost > user_hot_column[user_slot].available_funds)) {
+    return error::InsufficientFunds(
+        "Attempted bid cost ",
+        cost,
+        " is greater than user's available funds.");
+  }
+  if (wallet_id != IdAllocator::kInvalidId) {
+    Status status = ledger->reserve(wallet_id, cost);
+    if (!status.ok())
+      return status;
+  } else {
+    user_hot_column.mutate(user_slot).available_funds -= cost;
+  }
+
+  lot.bids.push_back({user_id, quantity, unit_price, takeBidSequence()});
+  multi_unit_bytes += sizeof(QuantityBid);
+  ++num_pending_bids.mutate()[user_id];
+  ++item_hot_column.mutate(item_slot).num_bids;
+  publishQuote(item_id);
+  return Status::OK();
+}
+
+Status Auction::getMultiUnitLot(uint32_t item_id,
+                                const MultiUnitLot*& lot) const {
+  if (!isItemRegistered(item_id)) {
+    return error::NotFound(
+        "Item \"",
+        item_id,
+        "\" is not registered in the auction.");
+  }
+
+  auto it = multi_unit_lots->find(item_id);
+  if (it == multi_unit_lots->end()) {
+    return error::ItemUnavailable(
+        "Item \"",
+        itemAt(item_id)->getName(),
+        "\" is not sold in units.");
+  }
+
+  lot = &it->second;
+  return Status::OK();
+}
+
+Status Auction::placeBundleBid(uint32_t user_id, std::vector<uint32_t> item_ids,
+                               uint32_t value, uint32_t& bundle_id) {
+  if (!isUserRegistered(user_id)) {
+    return error::NotFound(
+        "User \"",
+        user_id,
+        "\" is not registered in the auction.");
+  }
+
+  std::sort(item_ids.begin(), item_ids.end());
+  if (item_ids.empty() ||
+      std::adjacent_find(item_ids.begin(), item_ids.end()) != item_ids.end()) {
+    return error::InvalidBid(
+        "A bundle needs at least one item and cannot repeat an item.");
+  }
+
+  for (uint32_t item_id: item_ids) {
+    if (!isItemRegistered(item_id)) {
+      return error::NotFound(
+          "Item \"",
+          item_id,
+          "\" is not registered in the auction.");
+    }
+    const uint8_t state = item_hot_column[IdAllocator::slotOf(item_id)].state;
+    if (!(state & kItemOpen) || (state & kItemSold)) {
+      return error::ItemUnavailable(
+          "Item \"",
+          itemAt(item_id)->getName(),
+          "\" is not currently open in the auction.");
+    }
+    if (state & (kItemDutch | kItemMultiUnit)) {
+      return error::InvalidBid(
+          "Item \"",
+          itemAt(item_id)->getName(),
+          "\" does not take ordinary bids and cannot be in a bundle.");
+    }
+  }
+
+  const uint32_t user_slot = IdAllocator::slotOf(user_id);
+  const uint32_t wallet_id = user_hot_column[user_slot].wallet;
+  if (wallet_id != IdAllocator::kInvalidId) {
+    Status status = ledger->reserve(wallet_id, value);
+    if (!status.ok())
+      return status;
+  } else if (value > user_hot_column[user_slot].available_funds) {
+    return error::InsufficientFunds(
+        "Attempted bundle value ",
+        value,
+        " is greater than user's available funds.");
+  } else {
+    user_hot_column.mutate(user_slot).available_funds -= value;
+  }
+
+  bundle_id = next_bundle_id++;
+  bundle_bytes += kTreeNodeOverhead + sizeof(bundle_id) + sizeof(BundleBid) +
+                  item_ids.size() * sizeof(uint32_t);
+  bundle_bids.mutate()[bundle_id] = {user_id, std::move(item_ids), value};
+  ++num_pending_bids.mutate()[user_id];
+  return Status::OK();
+}
+
+Status Auction::clearBundles(BundleClearing& clearing, uint64_t max_nodes) {
+  clearing = BundleClearing();
+
+  // Bundles whose items have all stayed open compete with the high bids on
+  // those items. Bundle IDs are kInvalidId for the high bids.
+  std::vector<BundleBid> candidates;
+  std::vector<uint32_t> candidate_ids;
+  std::vector<uint32_t> bundled_items;
+  for (const auto& entry: *bundle_bids) {
+    const BundleBid& bundle = entry.second;
+    bool live = true;
+    for (uint32_t item_id: bundle.item_ids) {
+      live = live && isItemRegistered(item_id) &&
+             (item_hot_column[IdAllocator::slotOf(item_id)].state &
+              (kItemOpen | kItemSold)) == kItemOpen;
+    }
+    if (!live)
+      continue;
+    candidates.push_back(bundle);
+    candidate_ids.push_back(entry.first);
+    bundled_items.insert(bundled_items.end(), bundle.item_ids.begin(),
+                         bundle.item_ids.end());
+  }
+  std::sort(bundled_items.begin(), bundled_items.end());
+  bundled_items.erase(std::unique(bundled_items.begin(), bundled_items.end()),
+                      bundled_items.end());
+  for (uint32_t item_id: bundled_items) {
+    const uint32_t slot = IdAllocator::slotOf(item_id);
+    if (item_hot_column[slot].leader == IdAllocator::kInvalidId)
+      continue;
+    candidates.push_back({item_hot_column[slot].leader, {item_id},
+                          item_hot_column[slot].value});
+    candidate_ids.push_back(IdAllocator::kInvalidId);
+  }
+
+  WinnerDetermination result;
+  determineWinners(candidates, max_nodes, result);
+  clearing.optimal = result.optimal;
+
+  Status status;
+  for (size_t index: result.winners) {
+    const BundleBid& winner = candidates[index];
+    if (candidate_ids[index] == IdAllocator::kInvalidId) {
+      Status sold = closeItem(winner.item_ids[0], true);
+      if (status.ok())
+        status = std::move(sold);
+    } else {
+      clearing.winning_bundles.push_back(candidate_ids[index]);
+      const uint32_t num_items = winner.item_ids.size();
+      for (uint32_t i=0; i<num_items; ++i) {
+        const uint32_t share = winner.value / num_items +
+                               (i < winner.value % num_items);
+        Status sold = sellItemInBundle(winner.item_ids[i], winner.user_id,
+                                       share);
+        if (status.ok())
+          status = std::move(sold);
+      }
+    }
+    clearing.items_sold.insert(clearing.items_sold.end(),
+                               winner.item_ids.begin(), winner.item_ids.end());
+    clearing.revenue += winner.value;
+  }
+  std::sort(clearing.items_sold.begin(), clearing.items_sold.end());
+
+  // Candidates list bundles in ID order, so the winners are sorted too.
+  for (const auto& entry: *bundle_bids) {
+    settleBundleBid(entry.second,
+                    std::binary_search(clearing.winning_bundles.begin(),
+                                       clearing.winning_bundles.end(),
+                                       entry.first));
+  }
+  bundle_bids.mutate().clear();
+  bundle_bytes = 0;
+  return status;
+}
+
+Status Auction::enableArchive(const std::string& path) {
+  std::unique_ptr<BidArchive> new_archive = std::make_unique<BidArchive>();
+  Status status = new_archive->open(path);
+  if (!status.ok())
+    return status;
+  archive = std::move(new_archive);
+  return Status::OK();
+}
+
+MemoryUsage Auction::getMemoryUsage() const {
+  MemoryUsage usage;
+  // Views and records are counted as if every item had both.
+  usage.items = items.capacity() * sizeof(items[0]) +
+                item_ids->getNumLive() *
+                    (sizeof(Item) + sizeof(ItemRecord) + 2 * kHeapOverhead) +
+                item_record_column.getBytesAllocated() +
+                item_id_column.getBytesAllocated() +
+                item_name_column.getBytesAllocated() +
+                item_hot_column.getBytesAllocated() +
+                item_analytics_column.getBytesAllocated();
+  usage.users = users.capacity() * sizeof(users[0]) +
+                user_ids->getNumLive() *
+                    (sizeof(User) + sizeof(UserRecord) + 2 * kHeapOverhead) +
+                user_record_column.getBytesAllocated() +
+                user_id_column.getBytesAllocated() +
+                user_name_column.getBytesAllocated() +
+                user_funds_column.getBytesAllocated() +
+                user_hot_column.getBytesAllocated() +
+                user_num_items_column.getBytesAllocated();
+
+  // Each bid is its own allocation along with its reference counts, owned
+  // by its item, counted in its item's index and listed by its bidder.
+  usage.bids = num_live_bids * (sizeof(Bid) + kControlBlockOverhead +
+                                kHeapOverhead +
+                                sizeof(std::shared_ptr<const Bid>) +
+                                sizeof(uint32_t) + sizeof(const Bid*)) +
+               multi_unit_bytes + bundle_bytes;
+
+  using BidderEntry = std::pair<const uint32_t, std::vector<const Bid*>>;
+  usage.indexes =
+      item_ids_by_name.getBytesAllocated() +
+      user_ids_by_name.getBytesAllocated() +
+      num_bidder_links *
+          (sizeof(uint32_t) + kTreeNodeOverhead + sizeof(BidderEntry)) +
+      (open_items->capacity() + sold_items->capacity() +
+       sold_in_memory.size()) * sizeof(uint32_t) +
+      (quotes ? quotes->getBytesAllocated() : 0);
+
+  // Each name is stored once in the pool's arena, plus its handle entry.
+  usage.strings = names->getBytesAllocated() +
+                  names->size() * sizeof(std::string_view);
+  return usage;
+}
+
+Status Auction::setMemoryBudget(size_t bytes) {
+  if (!archive) {
+    return error::InvalidRequest(
+        "A memory budget needs the archive to be enabled first.");
+  }
+
+  if (bytes && !memory_budget) {
+    // Queue the sold items still holding their bids, which would otherwise
+    // never be archived.
+    sold_in_memory.clear();
+    for (uint32_t item_id: *sold_items) {
+      const uint32_t slot = IdAllocator::slotOf(item_id);
+      if (!itemAt(item_id)->isArchived() &&
+          !(item_hot_column[slot].state & kItemMultiUnit))
+        sold_in_memory.push_back(item_id);
+    }
+  }
+  memory_budget = bytes;
+  return enforceMemoryBudget();
+}
+
+Status Auction::getQuote(uint32_t item_id, Quote& quote) const {
+  // Only the quote board is safe to touch here, so the item's name is not
+  // available for the message.
+  if (!quotes) {
+    // A fork has no quote board, so it reads its own columns.
+    if (!isItemRegistered(item_id)) {
+      return error::NotFound(
+          "Item \"",
+          item_id,
+          "\" is not registered in the auction.");
+    }
+    const uint32_t slot = IdAllocator::slotOf(item_id);
+    const uint8_t state = item_hot_column[slot].state;
+    quote = {item_id, item_hot_column[slot].value, item_hot_column[slot].leader,
+             item_hot_column[slot].num_bids, (state & kItemOpen) != 0,
+             (state & kItemSold) != 0};
+    return Status::OK();
+  }
+  Quote read;
+  if (!quotes->read(IdAllocator::slotOf(item_id), read) ||
+      read.item_id != item_id) {
+    return error::NotFound(
+        "Item \"",
+        item_id,
+        "\" is not registered in the auction.");
+  }
+  quote = read;
+  return Status::OK();
+}
+
+namespace {
+
+/// Fold \c value into the running hash \c hash.
+inline uint64_t mixHash(uint64_t hash, uint64_t value) {
+  hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  return hash * 0xff51afd7ed558ccdULL;
+}
+
+/// Fold the fields of packed records into \c hash, leaving out padding.
+inline uint64_t mixHash(uint64_t hash, const HotUser& user) {
+  return mixHash(mixHash(hash, user.available_funds), user.wallet);
+}
+
+inline uint64_t mixHash(uint64_t hash, const HotItem& item) {
+  hash = mixHash(mixHash(hash, item.value), item.leader);
+  return mixHash(mixHash(hash, item.num_bids), item.state);
+}
+
+template <typename T>
+uint64_t hashColumn(uint64_t hash, const PagedColumn<T>& column) {
+  hash = mixHash(hash, column.size());
+  for (size_t page=0; page<column.getNumPages(); ++page) {
+    const T* values = column.getPage(page);
+    const size_t length = column.getPageLength(page);
+    for (size_t i=0; i<length; ++i)
+      hash = mixHash(hash, values[i]);
+  }
+  return hash;
+}
+
+uint64_t hashIds(uint64_t hash, const std::vector<uint32_t>& ids) {
+  hash = mixHash(hash, ids.size());
+  for (uint32_t id: ids)
+    hash = mixHash(hash, id);
+  return hash;
+}
+
+/// Fold the entries of an unordered map into \c hash. Each entry is hashed
+/// on its own and the results are summed, so the order the map happens to
+/// keep them in does not matter.
+template <typename T, typename HashEntry>
+uint64_t hashMap(uint64_t hash, const std::unordered_map<uint32_t, T>& map,
+                 HashEntry hashEntry) {
+  uint64_t sum = 0;
+  for (const auto& entry: map)
+    sum += hashEntry(mixHash(0, entry.first), entry.second);
+  return mixHash(mixHash(hash, map.size()), sum);
+}
+}  // namespace
+
+uint64_t Auction::getStateHash() const {
+  uint64_t hash = mixHash(0, revenue);
+  hash = mixHash(hash, bid_sequence_counter);
+  hash = hashColumn(hash, user_id_column);
+  hash = hashColumn(hash, user_funds_column);
+  hash = hashColumn(hash, user_hot_column);
+  hash = hashColumn(hash, user_num_items_column);
+  hash = hashColumn(hash, item_id_column);
+  hash = hashColumn(hash, item_hot_column);
+  hash = hashIds(hash, *open_items);
+  hash = hashIds(hash, *sold_items);
+  // A clock's start is read from this process's steady clock, so only the
+  // shape of the price curve is compared.
+  hash = hashMap(hash, *dutch_clocks,
+                 [](uint64_t entry_hash, const DutchClock& clock) {
+    entry_hash = mixHash(mixHash(entry_hash, clock.start_price),
+                         clock.floor_price);
+    return mixHash(mixHash(entry_hash, clock.decrement), clock.tick.count());
+  });
+  // Sequence numbers may come from a shared sequencer, and the order of the
+  // bids is hashed anyway.
+  hash = hashMap(hash, *multi_unit_lots,
+                 [](uint64_t entry_hash, const MultiUnitLot& lot) {
+    entry_hash = mixHash(mixHash(entry_hash, lot.num_units),
+                         lot.clearing_price);
+    entry_hash = mixHash(entry_hash, lot.bids.size());
+    for (const QuantityBid& bid: lot.bids) {
+      entry_hash = mixHash(mixHash(entry_hash, bid.user_id), bid.quantity);
+      entry_hash = mixHash(entry_hash, bid.unit_price);
+    }
+    entry_hash = mixHash(entry_hash, lot.allocations.size());
+    for (const UnitAllocation& allocation: lot.allocations) {
+      entry_hash = mixHash(mixHash(entry_hash, allocation.user_id),
+                           allocation.quantity);
+      entry_hash = mixHash(entry_hash, allocation.cost);
+    }
+    return entry_hash;
+  });
+  hash = mixHash(mixHash(hash, next_bundle_id), bundle_bids->size());
+  for (const auto& entry: *bundle_bids) {
+    hash = mixHash(mixHash(hash, entry.first), entry.second.user_id);
+    hash = mixHash(hash, entry.second.value);
+    hash = hashIds(hash, entry.second.item_ids);
+  }
+  // Hash the names themselves rather than their handles, so that a replica
+  // whose pool was built differently is still caught if a name differs.
+  auto hashNames = [this, &hash](const PagedColumn<uint32_t>& ids,
+                                 const PagedColumn<uint32_t>& name_handles) {
+    for (size_t slot=0; slot<ids.size(); ++slot) {
+      if (ids[slot] == IdAllocator::kInvalidId)
+        continue;
+      for (char c: names->get(name_handles[slot]))
+        hash = mixHash(hash, uint8_t(c));
+    }
+  };
+  hashNames(user_id_column, user_name_column);
+  hashNames(item_id_column, item_name_column);
+  return hash;
+}
+
+Status Auction::getItemAnalytics(uint32_t item_id,
+                                 ItemAnalytics& analytics) const {
+  if (!isItemRegistered(item_id)) {
+    return error::NotFound(
+        "Item ",
+        item_id,
+        " is not registered in the auction.");
+  }
+  analytics = item_analytics_column[IdAllocator::slotOf(item_id)];
+  return Status::OK();
+}
+
+void Auction::addRevenue(uint64_t amount) {
+  revenue += amount;
+  const auto hour = std::chrono::duration_cast<std::chrono::hours>(
+      ItemAnalytics::Clock::now().time_since_epoch());
+  revenue_by_hour.mutate()[hour.count()] += amount;
+}
+
+uint64_t Auction::sequenceCommand() {
+  if (!sequence_taken)
+    takeBidSequence();
+  sequence_taken = false;
+  command_sequence = last_sequence;
+  return command_sequence;
+}
+
+Status Auction::setSequencer(std::shared_ptr<Sequencer> sequencer) {
+  if (bid_sequence_counter) {
+    return error::InvalidRequest(
+        "The auction has already accepted ",
+        bid_sequence_counter,
+        " bids; its sequencer can no longer change.");
+  }
+  this->sequencer = std::move(sequencer);
+  return Status::OK();
+}
+
+std::shared_ptr<const AuctionSnapshot> Auction::getSnapshot() const {
+  return std::make_shared<const AuctionSnapshot>(*this);
+}
+
+Status Auction::fork(std::unique_ptr<Auction>& forked) const {
+  if (ledger) {
+    return error::InvalidRequest(
+        "An auction whose users can bid from a shared ledger cannot be "
+        "forked.");
+  }
+
+  auto copy = std::make_unique<Auction>();
+  copy->open_items = open_items;
+  copy->sold_items = sold_items;
+  copy->dutch_clocks = dutch_clocks;
+  copy->multi_unit_lots = multi_unit_lots;
+  copy->num_pending_bids = num_pending_bids;
+  copy->bundle_bids = bundle_bids;
+  copy->next_bundle_id = next_bundle_id;
+  copy->item_ids = item_ids;
+  copy->user_ids = user_ids;
+  copy->revenue = revenue;
+  copy->revenue_by_hour = revenue_by_hour;
+  // The auction keeps adding names to its pool, so the fork adds its own to
+  // a pool layered over the names there so far.
+  copy->names = std::make_shared<NamePool>(
+      std::shared_ptr<const NamePool>(names));
+  copy->item_ids_by_name = item_ids_by_name;
+  copy->user_ids_by_name = user_ids_by_name;
+  copy->bid_sequence_counter = bid_sequence_counter;
+  copy->last_sequence = last_sequence;
+  copy->command_sequence = command_sequence;
+  copy->sequence_taken = sequence_taken;
+  if (sequencer)
+    copy->sequencer = std::make_shared<Sequencer>(sequencer->peek());
+  copy->user_id_column = user_id_column;
+  copy->user_name_column = user_name_column;
+  copy->user_funds_column = user_funds_column;
+  copy->user_hot_column = user_hot_column;
+  copy->user_num_items_column = user_num_items_column;
+  copy->user_record_column = user_record_column;
+  copy->item_id_column = item_id_column;
+  copy->item_name_column = item_name_column;
+  copy->item_hot_column = item_hot_column;
+  copy->item_analytics_column = item_analytics_column;
+  copy->item_record_column = item_record_column;
+  copy->quotes.reset();
+  // Archived items point into the archive files, which stay open for as
+  // long as the fork does.
+  copy->inherited_archives = inherited_archives;
+  if (archive)
+    copy->inherited_archives.push_back(archive);
+  copy->num_live_bids = num_live_bids;
+  copy->num_bidder_links = num_bidder_links;
+  copy->multi_unit_bytes = multi_unit_bytes;
+  copy->bundle_bytes = bundle_bytes;
+  forked = std::move(copy);
+  return Status::OK();
+}
+
+void Auction::setLedger(std::shared_ptr<WalletLedger> ledger) {
+  this->ledger = std::move(ledger);
+}
+
+Status Auction::linkWallet(uint32_t user_id, uint32_t wallet_id) {
+  if (!isUserRegistered(user_id)) {
+    return error::NotFound(
+        "User \"",
+        user_id,
+        "\" is not registered in the auction.");
+  }
+
+  if (!ledger || !ledger->isWallet(wallet_id)) {
+    return error::NotFound(
+        "Wallet \"",
+        wallet_id,
+        "\" is not in the auction's ledger.");
+  }
+
+  User* user = userAt(user_id);
+  if (!user->getItemsBidOn().empty() || num_pending_bids->count(user_id)) {
+    return error::UserActive(
+        "User \"",
+        user->getName(),
+        "\" has already placed bids.");
+  }
+
+  const uint32_t slot = IdAllocator::slotOf(user_id);
+  user_funds_column.mutate(slot) = 0;
+  user_hot_column.mutate(slot).available_funds = 0;
+  user_hot_column.mutate(slot).wallet = wallet_id;
+  return Status::OK();
+}
+
+Status Auction::archiveItem(uint32_t item_id) {
+  Item* item = itemAt(item_id);
+  const std::vector<const Bid*> bids = item->getBids();
+  const Bid* archived;
+  Status status = archive->append(bids, archived);
+  if (!status.ok())
+    return status;
+
+  const std::vector<uint32_t>& bidders = item->getBidders();
+  for (uint32_t user_id: bidders)
+    userAt(user_id)->archiveItem(item_id);
+  num_bidder_links -= bidders.size();
+  // Once the item and its bidders point at the archive this drops the
+  // auction's references to the bids, which are freed unless a fork still
+  // shares them.
+  item->archiveBids(archived);
+  num_live_bids -= bids.size();
+  return Status::OK();
+}
+
+Status Auction::removeItem(uint32_t item_id) {
+  if (!isItemRegistered(item_id)) {
+    return error::NotFound(
+        "Item \"",
+        item_id,
+        "\" is not registered in the auction.");
+  }
+
+  Item* item = itemAt(item_id);
+
+  if (isOpen(item_id)) {
+    return error::ItemUnavailable(
+        "Item \"",
+        item->getName(),
+        "\" must be closed before it is removed.");
+  }
+
+  const bool sold = isSold(item_id);
+  const bool multi_unit =
+      item_hot_column[IdAllocator::slotOf(item_id)].state & kItemMultiUnit;
+  if (sold && !item->isArchived() && !multi_unit) {
+    return error::ItemUnavailable(
+        "Item \"",
+        item->getName(),
+        "\" has been sold and its bids have not been archived.");
+  }
+
+  // Archiving drops the item's list of bidders, so recover it from the bids.
+  std::vector<uint32_t> bidders;
+  if (!item->isArchived()) {
+    bidders = item->getBidders();
+    num_bidder_links -= bidders.size();
+  } else {
+    for (size_t i=0; i<item->getNumBids(); ++i)
+      bidders.push_back(item->getBid(i)->user_id);
+    std::sort(bidders.begin(), bidders.end());
+    bidders.erase(std::unique(bidders.begin(), bidders.end()), bidders.end());
+  }
+
+  // Bidders on an unsold item get their bids back as if they had lost it.
+  const uint32_t leader = item_hot_column[IdAllocator::slotOf(item_id)].leader;
+  if (!sold && leader != IdAllocator::kInvalidId) {
+    const uint32_t leader_wallet =
+        user_hot_column[IdAllocator::slotOf(leader)].wallet;
+    if (leader_wallet != IdAllocator::kInvalidId)
+      ledger->release(leader_wallet, item->getCurrentValue());
+  }
+  for (uint32_t user_id: bidders) {
+    if (!isUserRegistered(user_id))
+      continue;
+    User* user = userAt(user_id);
+    if (!sold)
+      user->reportBidResult(item_id, false);
+    user->forgetItem(item_id);
+  }
+
+  if (!item->isArchived())
+    num_live_bids -= item->getNumBids();
+
+  // Quantity bids on an unsold item are returned in full.
+  if (multi_unit) {
+    if (!sold) {
+      for (const QuantityBid& bid: multi_unit_lots->at(item_id).bids)
+        releaseQuantityBid(bid, 0);
+    }
+    const MultiUnitLot& lot = multi_unit_lots->at(item_id);
+    multi_unit_bytes -= lot.bids.size() * sizeof(QuantityBid) +
+                        lot.allocations.size() * sizeof(UnitAllocation);
+    multi_unit_lots.mutate().erase(item_id);
+  }
+
+  if (sold) {
+    std::vector<uint32_t>& sold_ids = sold_items.mutate();
+    sold_ids.erase(std::lower_bound(sold_ids.cbegin(), sold_ids.cend(),
+                                    item_id));
+  }
+
+  // The name stays in the pool, but another item may now take it.
+  const uint32_t slot = IdAllocator::slotOf(item_id);
+  item_ids_by_name.mutate(item_name_column[slot]) = IdAllocator::kInvalidId;
+
+  items[slot].reset();
+  item_record_column.mutate(slot).reset();
+  item_id_column.mutate(slot) = IdAllocator::kInvalidId;
+  item_name_column.mutate(slot) = 0;
+  item_hot_column.mutate(slot).value = 0;
+  item_hot_column.mutate(slot).leader = IdAllocator::kInvalidId;
+  item_hot_column.mutate(slot).num_bids = 0;
+  item_hot_column.mutate(slot).state = 0;
+  if (quotes) {
+    quotes->publish(slot, {IdAllocator::kInvalidId, 0,
+                           IdAllocator::kInvalidId, 0, false, false});
+  }
+  item_ids.mutate().release(item_id);
+  return Status::OK();
+}
+
+Status Auction::removeUser(uint32_t user_id) {
+  if (!isUserRegistered(user_id)) {
+    return error::NotFound(
+        "User \"",
+        user_id,
+        "\" is not registered in the auction.");
+  }
+
+  User* user = userAt(user_id);
+  if (num_pending_bids->count(user_id)) {
+    return error::UserActive(
+        "User \"",
+        user->getName(),
+        "\" has quantity or bundle bids waiting to be settled.");
+  }
+  for (uint32_t item_id: user->getItemsBidOn()) {
+    if (isItemRegistered(item_id) && !isSold(item_id)) {
+      return error::UserActive(
+          "User \"",
+          user->getName(),
+          "\" has a bid on unsold item \"",
+          itemAt(item_id)->getName(),
+          "\".");
+    }
+  }
+
+  const uint32_t slot = IdAllocator::slotOf(user_id);
+  user_ids_by_name.mutate(user_name_column[slot]) = IdAllocator::kInvalidId;
+
+  users[slot].reset();
+  user_record_column.mutate(slot).reset();
+  user_id_column.mutate(slot) = IdAllocator::kInvalidId;
+  user_name_column.mutate(slot) = 0;
+  user_funds_column.mutate(slot) = 0;
+  user_hot_column.mutate(slot).available_funds = 0;
+  user_num_items_column.mutate(slot) = 0;
+  user_hot_column.mutate(slot).wallet = IdAllocator::kInvalidId;
+  user_ids.mutate().release(user_id);
+  return Status::OK();
+}
+
+void Auction::compact() {
+  const uint32_t item_end = item_ids->getSlotEnd();
+  items.resize(std::min<size_t>(items.size(), item_end));
+  items.shrink_to_fit();
+  item_record_column.resize(item_end);
+  item_record_column.shrink_to_fit();
+  item_id_column.resize(item_end);
+  item_id_column.shrink_to_fit();
+  item_name_column.resize(item_end);
+  item_name_column.shrink_to_fit();
+  item_hot_column.resize(item_end);
+  item_hot_column.shrink_to_fit();
+  item_analytics_column.resize(item_end);
+  item_analytics_column.shrink_to_fit();
+  const uint32_t user_end = user_ids->getSlotEnd();
+  users.resize(std::min<size_t>(users.size(), user_end));
+  users.shrink_to_fit();
+  user_record_column.resize(user_end);
+  user_record_column.shrink_to_fit();
+  user_id_column.resize(user_end);
+  user_id_column.shrink_to_fit();
+  user_name_column.resize(user_end);
+  user_name_column.shrink_to_fit();
+  user_funds_column.resize(user_end);
+  user_funds_column.shrink_to_fit();
+  user_hot_column.resize(user_end);
+  user_hot_column.shrink_to_fit();
+  user_num_items_column.resize(user_end);
+  user_num_items_column.shrink_to_fit();
+  open_items.mutate().shrink_to_fit();
+  sold_items.mutate().shrink_to_fit();
+  item_ids.mutate().compact();
+  user_ids.mutate().compact();
+#ifdef __GLIBC__
+  // Hand freed heap pages back to the operating system.
+  malloc_trim(0);
+#endif
+}
+
+void Auction::recycleRetiredIds() {
+  if (item_ids->getNumRetired())
+    item_ids.mutate().recycleRetired();
+  if (user_ids->getNumRetired())
+    user_ids.mutate().recycleRetired();
+}
+
+std::vector<uint32_t> Auction::findUsersWithAvailableFundsBelow(
+    uint32_t bound) const {
+  std::vector<uint32_t> slots;
+  for (size_t page=0; page<user_hot_column.getNumPages(); ++page) {
+    const size_t first = slots.size();
+    scan::findLess(availableFundsOf(user_hot_column.getPage(page)),
+                   user_hot_column.getPageLength(page), bound, slots);
+    addPageBase(page, first, slots);
+  }
+  // Empty slots hold zero funds, so drop them from the matches.
+  std::vector<uint32_t> user_id_vec;
+  user_id_vec.reserve(slots.size());
+  for (uint32_t slot: slots) {
+    if (user_ids->isSlotLive(slot))
+      user_id_vec.push_back(user_ids->idOf(slot));
+  }
+  return user_id_vec;
+}
+
+std::vector<uint32_t> Auction::findOpenItemsWithValueIn(uint32_t min,
+                                                        uint32_t max) const {
+  std::vector<uint32_t> slots;
+  for (size_t page=0; page<item_hot_column.getNumPages(); ++page) {
+    const size_t first = slots.size();
+    scan::findInRange(valuesOf(item_hot_column.getPage(page)),
+                      item_hot_column.getPageLength(page), min, max, slots);
+    addPageBase(page, first, slots);
+  }
+  std::vector<uint32_t> item_id_vec;
+  for (uint32_t slot: slots) {
+    if (item_hot_column[slot].state == kItemOpen && item_ids->isSlotLive(slot))
+      item_id_vec.push_back(item_ids->idOf(slot));
+  }
+  return item_id_vec;
+}
+
+uint64_t Auction::getTotalFunds() const {
+  uint64_t total = 0;
+  for (size_t page=0; page<user_funds_column.getNumPages(); ++page) {
+    total += scan::sum(user_funds_column.getPage(page),
+                       user_funds_column.getPageLength(page));
+  }
+  return total;
+}
+
+uint64_t Auction::getTotalCommittedFunds() const {
+  // Both columns always have the same size, and pages hold the same number
+  // of values whatever their type, so their pages line up.
+  uint64_t total = 0;
+  for (size_t page=0; page<user_funds_column.getNumPages(); ++page) {
+    total += scan::sumDifference(
+        user_funds_column.getPage(page),
+        availableFundsOf(user_hot_column.getPage(page)),
+        user_funds_column.getPageLength(page));
+  }
+  return total;
+}
+
+void Auction::claimItemSlot(uint32_t item_id, std::string_view name,
+                            uint32_t starting_value) {
+  const uint32_t slot = IdAllocator::slotOf(item_id);
+  reserveItemSlot(slot);
+  item_id_column.mutate(slot) = item_id;
+  item_name_column.mutate(slot) = names->intern(name);
+  HotItem& hot = item_hot_column.mutate(slot);
+  hot = HotItem();
+  hot.value = starting_value;
+  item_analytics_column.mutate(slot) = ItemAnalytics();
+  CopyOnWrite<ItemRecord>& record = item_record_column.mutate(slot);
+  record.reset();
+  record.mutate().starting_value = starting_value;
+  publishQuote(item_id);
+}
+
+void Auction::claimUserSlot(uint32_t user_id, std::string_view name,
+                            uint32_t funds) {
+  const uint32_t slot = IdAllocator::slotOf(user_id);
+  reserveUserSlot(slot);
+  user_id_column.mutate(slot) = user_id;
+  user_name_column.mutate(slot) = names->intern(name);
+  user_num_items_column.mutate(slot) = 0;
+  user_funds_column.mutate(slot) = funds;
+  user_hot_column.mutate(slot).available_funds = funds;
+  user_record_column.mutate(slot).reset();
+}
+
+void Auction::registerItem(uint32_t item_id, std::string_view name,
+                           uint32_t starting_value) {
+  claimItemSlot(item_id, name, starting_value);
+  const uint32_t slot = IdAllocator::slotOf(item_id);
+  // The item's name was interned, so the column holds its handle.
+  const uint32_t name_handle = item_name_column[slot];
+  if (name_handle >= item_ids_by_name.size())
+    item_ids_by_name.resize(name_handle+1);
+  item_ids_by_name.mutate(name_handle) = item_id;
+}
+
+void Auction::registerUser(uint32_t user_id, std::string_view name,
+                           uint32_t funds) {
+  claimUserSlot(user_id, name, funds);
+  const uint32_t slot = IdAllocator::slotOf(user_id);
+  const uint32_t name_handle = user_name_column[slot];
+  if (name_handle >= user_ids_by_name.size())
+    user_ids_by_name.resize(name_handle+1);
+  user_ids_by_name.mutate(name_handle) = user_id;
+}
+
+Item* Auction::createItemView(uint32_t item_id) const {
+  const uint32_t slot = IdAllocator::slotOf(item_id);
+  if (slot >= items.size())
+    items.resize(slot+1);
+  // Views only hold the auction to read its columns and records, so looking
+  // one up through a const auction does not change what it reads.
+  items[slot] = std::make_unique<Item>(const_cast<Auction&>(*this), item_id);
+  return items[slot].get();
+}
+
+User* Auction::createUserView(uint32_t user_id) const {
+  const uint32_t slot = IdAllocator::slotOf(user_id);
+  if (slot >= users.size())
+    users.resize(slot+1);
+  users[slot] = std::make_unique<User>(const_cast<Auction&>(*this), user_id);
+  return users[slot].get();
+}
+
+uint32_t Auction::findName(const PagedColumn<uint32_t>& ids_by_name,
+                           std::string_view name) const {
+  uint32_t name_handle;
+  if (!names->find(name, name_handle) || name_handle >= ids_by_name.size())
+    return IdAllocator::kInvalidId;
+  return ids_by_name[name_handle];
+}
+
+bool Auction::getLastNewSlot(const IdAllocator& ids, size_t num_ids,
+                             uint32_t& slot) {
+  // Released slots are reused first, then new ones are taken in order.
+  if (num_ids <= ids.getNumReusable())
+    return false;
+  slot = ids.getNumSlots() + (num_ids - ids.getNumReusable()) - 1;
+  return true;
+}
+
+void Auction::reserveUserSlot(uint32_t slot) {
+  if (slot >= user_funds_column.size()) {
+    user_id_column.resize(slot+1);
+    user_name_column.resize(slot+1);
+    user_funds_column.resize(slot+1);
+    user_hot_column.resize(slot+1);
+    user_num_items_column.resize(slot+1);
+    user_record_column.resize(slot+1);
+  }
+}
+
+void Auction::reserveItemSlot(uint32_t slot) {
+  if (slot >= item_hot_column.size()) {
+    item_id_column.resize(slot+1);
+    item_name_column.resize(slot+1);
+    item_hot_column.resize(slot+1);
+    item_analytics_column.resize(slot+1);
+    item_record_column.resize(slot+1);
+  }
+  if (quotes)
+    quotes->reserve(slot);
+}
+
+void Auction::recordBid(uint32_t item_id, uint32_t user_id, uint32_t value) {
+  Item* item = itemAt(item_id);
+  User* user = userAt(user_id);
+
   // If the user hasn't bid on the item yet, add them to the list.
-  if (!user->getBidValueOnItem(item_id))
-    users_for_item[item_id].push_back(user_id);
+  const uint32_t item_slot = IdAllocator::slotOf(item_id);
+  ItemAnalytics& analytics = item_analytics_column.mutate(item_slot);
+  if (item_hot_column[item_slot].leader != user_id &&
+      !user->alreadyBidOnItem(item_id)) {
+    item->addBidder(user_id);
+    ++num_bidder_links;
+    ++analytics.num_bidders;
+  }
+  // A Dutch or bundle price can be below the value it replaces.
+  const uint32_t previous_value = item_hot_column[item_slot].value;
+  if (value > previous_value)
+    analytics.total_increment += value - previous_value;
+  if (analytics.num_bids++ == 0)
+    analytics.first_bid = ItemAnalytics::Clock::now();
 
-  const Bid* current_bid = item->getCurrentBid();
-  uint16_t bid_number = current_bid ? current_bid->number+1 : 0;
-  const Bid* bid = new Bid(value, user_id, item_id, bid_number);
+  const uint32_t bid_number = item->getNextBidNumber();
+  auto bid = std::make_shared<const Bid>(value, user_id, item_id, bid_number,
+                                        takeBidSequence());
 
   user->addBid(*bid);
-  item->addBid(*bid);
+  item->addBid(std::move(bid));
+  ++num_live_bids;
+}
+
+void Auction::clearMultiUnitItem(uint32_t item_id) {
+  MultiUnitLot& lot = multi_unit_lots.mutate().at(item_id);
+  std::vector<uint32_t> filled;
+  lot.clearing_price = clearUniformPrice(lot.num_units, lot.bids, filled);
+
+  std::vector<uint32_t> winners;
+  for (size_t i=0; i<lot.bids.size(); ++i) {
+    const QuantityBid& bid = lot.bids[i];
+    const uint32_t cost = filled[i] * lot.clearing_price;
+    releaseQuantityBid(bid, cost);
+    if (!filled[i])
+      continue;
+    lot.allocations.push_back({bid.user_id, filled[i], cost});
+    multi_unit_bytes += sizeof(UnitAllocation);
+    winners.push_back(bid.user_id);
+    addRevenue(cost);
+  }
+
+  std::sort(winners.begin(), winners.end());
+  winners.erase(std::unique(winners.begin(), winners.end()), winners.end());
+  for (uint32_t user_id: winners)
+    userAt(user_id)->reportItemWon(item_id);
+  item_hot_column.mutate(IdAllocator::slotOf(item_id)).value =
+      lot.clearing_price;
+}
+
+void Auction::releaseQuantityBid(const QuantityBid& bid, uint32_t paid) {
+  const uint32_t user_slot = IdAllocator::slotOf(bid.user_id);
+  const uint32_t reserved = bid.quantity * bid.unit_price;
+  const uint32_t wallet_id = user_hot_column[user_slot].wallet;
+  if (wallet_id != IdAllocator::kInvalidId) {
+    if (reserved > paid)
+      ledger->release(wallet_id, reserved - paid);
+    if (paid)
+      ledger->settle(wallet_id, paid);
+  } else {
+    user_hot_column.mutate(user_slot).available_funds += reserved - paid;
+    user_funds_column.mutate(user_slot) -= paid;
+  }
 
+  std::unordered_map<uint32_t, uint32_t>& pending = num_pending_bids.mutate();
+  auto it = pending.find(bid.user_id);
+  if (--it->second == 0)
+    pending.erase(it);
+}
+
+void Auction::settleBundleBid(const BundleBid& bundle, bool won) {
+  const uint32_t user_slot = IdAllocator::slotOf(bundle.user_id);
+  const uint32_t wallet_id = user_hot_column[user_slot].wallet;
+  if (wallet_id != IdAllocator::kInvalidId && won) {
+    ledger->settle(wallet_id, bundle.value);
+  } else if (wallet_id != IdAllocator::kInvalidId) {
+    ledger->release(wallet_id, bundle.value);
+  } else if (won) {
+    user_funds_column.mutate(user_slot) -= bundle.value;
+  } else {
+    user_hot_column.mutate(user_slot).available_funds += bundle.value;
+  }
+
+  std::unordered_map<uint32_t, uint32_t>& pending = num_pending_bids.mutate();
+  auto it = pending.find(bundle.user_id);
+  if (--it->second == 0)
+    pending.erase(it);
+}
+
+Status Auction::sellItemInBundle(uint32_t item_id, uint32_t user_id,
+                                 uint32_t value) {
+  const uint32_t slot = IdAllocator::slotOf(item_id);
+  std::vector<uint32_t>& open = open_items.mutate();
+  open.erase(std::lower_bound(open.cbegin(), open.cend(), item_id));
+  std::vector<uint32_t>& sold = sold_items.mutate();
+  sold.insert(std::upper_bound(sold.cbegin(), sold.cend(), item_id), item_id);
+  item_hot_column.mutate(slot).state =
+      (item_hot_column[slot].state & ~kItemOpen) | kItemSold;
+
+  // Everyone who bid on the item on its own has lost it.
+  const uint32_t leader = item_hot_column[slot].leader;
+  if (leader != IdAllocator::kInvalidId) {
+    const uint32_t leader_wallet =
+        user_hot_column[IdAllocator::slotOf(leader)].wallet;
+    if (leader_wallet != IdAllocator::kInvalidId)
+      ledger->release(leader_wallet, item_hot_column[slot].value);
+  }
+  for (uint32_t bidder: itemAt(item_id)->getBidders())
+    userAt(bidder)->reportBidResult(item_id, false);
+
+  // The share goes into the bid history as the winning bid, so the item's
+  // columns, analytics and archive name the bundle's bidder. It is paid from
+  // the bundle's reservation, which settleBundleBid() settles, so recording
+  // it must not reserve the bidder's funds again.
+  const uint32_t user_slot = IdAllocator::slotOf(user_id);
+  const uint32_t available_funds = user_hot_column[user_slot].available_funds;
+  recordBid(item_id, user_id, value);
+  user_hot_column.mutate(user_slot).available_funds = available_funds;
+  userAt(user_id)->reportItemWon(item_id);
+  addRevenue(value);
+  return retireSoldItem(item_id);
+}
+
+Status Auction::retireSoldItem(uint32_t item_id) {
+  if (!archive)
+    return Status::OK();
+  if (!memory_budget)
+    return archiveItem(item_id);
+  sold_in_memory.push_back(item_id);
+  return enforceMemoryBudget();
+}
+
+Status Auction::enforceMemoryBudget() {
+  // Without a budget everything waiting is archived.
+  while (!sold_in_memory.empty() &&
+         (!memory_budget || getMemoryUsage().getTotal() > memory_budget)) {
+    const uint32_t item_id = sold_in_memory.front();
+    // Items removed since they were sold have nothing left to archive.
+    if (isItemRegistered(item_id) && !itemAt(item_id)->isArchived()) {
+      Status status = archiveItem(item_id);
+      if (!status.ok())
+        return status;
+    }
+    sold_in_memory.pop_front();
+  }
   return Status::OK();
 }
+
+void Auction::publishQuote(uint32_t item_id) {
+  if (!quotes)
+    return;
+  const uint32_t slot = IdAllocator::slotOf(item_id);
+  const HotItem& hot = item_hot_column[slot];
+  quotes->publish(slot, {item_id, hot.value, hot.leader, hot.num_bids,
+                         (hot.state & kItemOpen) != 0,
+                         (hot.state & kItemSold) != 0});
+}
 }  // namespace auction_engine
 
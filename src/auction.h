@@ -16,12 +16,32 @@ limitations under the License.
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
+#include <chrono>
+#include <deque>
 #include <map>
+#include <memory>
 #include <stdint.h>
 
+#include "analytics.h"
 #include "bid.h"
+#include "bid_archive.h"
+#include "bulk_load.h"
+#include "bundle.h"
+#include "copy_on_write.h"
+#include "dutch_clock.h"
+#include "id_allocator.h"
+#include "memory_usage.h"
+#include "multi_unit.h"
+#include "name_pool.h"
+#include "paged_column.h"
+#include "quote_board.h"
+#include "records.h"
+#include "sequencer.h"
 #include "status.h"
+#include "wallet_ledger.h"
 #include "item.h"
 #include "user.h"
 
@@ -31,6 +51,7 @@ namespace auction_engine {
 struct Bid;
 class User;
 class Item;
+class AuctionSnapshot;
 
 /**
  * \brief Auction class
@@ -39,8 +60,30 @@ class Item;
  * functionality 
  */
 class Auction {
+  // Users and items are views over the auction's columns.
+  friend class User;
+  friend class Item;
+  friend class AuctionSnapshot;
+
 public:
-  Auction() : item_id_counter(0), user_id_counter(0), revenue(0) {} 
+  Auction()
+      : next_bundle_id(0),
+        revenue(0),
+        names(std::make_shared<NamePool>()),
+        item_ids_by_name(IdAllocator::kInvalidId),
+        user_ids_by_name(IdAllocator::kInvalidId),
+        bid_sequence_counter(0),
+        last_sequence(0),
+        command_sequence(0),
+        sequence_taken(false),
+        user_id_column(IdAllocator::kInvalidId),
+        item_id_column(IdAllocator::kInvalidId),
+        quotes(std::make_unique<QuoteBoard>()),
+        memory_budget(0),
+        num_live_bids(0),
+        num_bidder_links(0),
+        multi_unit_bytes(0),
+        bundle_bytes(0) {}
 
   /// Return all items registered in the auction.
   std::vector<uint32_t> const getItems() const;
@@ -50,9 +93,85 @@ public:
 
   /// Return all items open in the auction.
   std::vector<uint32_t> const& getOpenItems() const { 
-    return open_items; 
+    return *open_items; 
+  }
+
+  /// Return all items sold in the auction.
+  std::vector<uint32_t> const& getSoldItems() const {
+    return *sold_items;
+  }
+
+  /// Returns the sequence number the next accepted bid or sequenced command
+  /// will be assigned, or a lower bound on it if the auction shares a
+  /// \c Sequencer. Otherwise this is also the total number of sequence
+  /// numbers taken so far.
+  uint64_t getBidSequence() const {
+    return sequencer ? sequencer->peek() : bid_sequence_counter;
   }
 
+  /// Start a command that \c sequenceCommand() will number, so that numbers
+  /// taken before it, such as by a bid placed directly, are not taken for
+  /// its own.
+  void beginCommand() { sequence_taken = false; }
+
+  /**
+   * \brief Assign a sequence number to a command the auction has accepted.
+   *
+   * Commands are numbered from the same sequence as bids. A command that
+   * placed bids since \c beginCommand() takes the number of the last one,
+   * and any other command takes a new number, so every accepted command
+   * gets one and each gets a higher number than the one before.
+   *
+   * Only \c AuctionServer, where it journals a command, and
+   * \c applyCommand(), where a follower or an ingest applies one, number
+   * commands, so a replica numbers them as its leader did. Commands made
+   * through \c AuctionHost, \c AsyncAuction or the auction's other methods
+   * are not numbered, though the bids they place still take bid sequence
+   * numbers.
+   *
+   * \return The command's sequence number.
+   */
+  uint64_t sequenceCommand();
+
+  /// Return the sequence number of the last command sequenced, or 0 if there
+  /// has been none.
+  uint64_t getCommandSequence() const { return command_sequence; }
+
+  /**
+   * \brief Draw bid sequence numbers from a sequencer shared with other
+   * auctions.
+   *
+   * Bids accepted by every auction sharing \c sequencer are then numbered in
+   * one order, which lets their histories, journals and exports be merged.
+   * The auction's state hash does not depend on the numbers drawn, so a
+   * follower replaying its journal alone still matches it.
+   *
+   * \param sequencer
+   *    The sequencer to share, or \c nullptr to number bids locally again.
+   *
+   * \return \c Status containing error code and message. Fails with
+   *    \c INVALID_REQUEST once bids have been accepted, since numbers drawn
+   *    from the sequencer might then be lower than ones already given out.
+   */
+  Status setSequencer(std::shared_ptr<Sequencer> sequencer);
+
+  /**
+   * \brief Return a hash of the auction's state.
+   *
+   * The auction is deterministic: two auctions given the same operations in
+   * the same order end up in the same state, including the IDs they assign,
+   * and so have the same hash. Comparing hashes therefore checks that a
+   * replica replaying another auction's operations has not diverged from
+   * it. The hash covers every user's and item's ID, name, funds and bidding
+   * state, the open and sold items, the revenue and the bid sequence, the
+   * clocks of items open for Dutch auction, the units, quantity bids and
+   * allocations of multi-unit items, and the unsettled bundle bids and the
+   * next bundle ID, but not the wallets of a shared \c WalletLedger or the
+   * time a Dutch clock started, which each auction reads from its own steady
+   * clock.
+   */
+  uint64_t getStateHash() const;
+
   /// Returns \c true if \c item_id is registered in the auction, \c false 
   /// otherwise.
   bool isItemRegistered(uint32_t item_id) const;
@@ -70,6 +189,26 @@ public:
   /// Returns the total revenue of the auction
   const uint32_t getRevenue() const { return revenue; }
 
+  /// Return the revenue taken in each hour that had sales, keyed by the
+  /// number of whole hours since the Unix epoch the hour began at.
+  const std::map<int64_t, uint64_t>& getRevenueByHour() const {
+    return *revenue_by_hour;
+  }
+
+  /**
+   * \brief Read the aggregates kept for an item.
+   *
+   * \param item_id
+   *    The id of the item.
+   *
+   * \param analytics
+   *    Set to the item's bid count, distinct bidders, total increment and
+   *    the times it was opened and first bid on.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status getItemAnalytics(uint32_t item_id, ItemAnalytics& analytics) const;
+
   /**
    * \brief Get an item registered in the auction.
    *
@@ -106,6 +245,32 @@ public:
    */
   Status getUser(uint32_t user_id, const User*& user) const;
 
+  /**
+   * \brief Look up the ID of an item by name.
+   *
+   * \param name
+   *    The name of the item.
+   *
+   * \param item_id
+   *    Set to the ID of the item registered under \c name.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status findItem(std::string_view name, uint32_t& item_id) const;
+
+  /**
+   * \brief Look up the ID of a user by name.
+   *
+   * \param name
+   *    The name of the user.
+   *
+   * \param user_id
+   *    Set to the ID of the user registered under \c name.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status findUser(std::string_view name, uint32_t& user_id) const;
+
   /**
    * \brief Add an item to the auction.
    *
@@ -113,10 +278,18 @@ public:
    *  (optional) \c starting_value are passed as parameters. If the \c name 
    *  passed is already in use by another item in the auction, the return \c 
    *  Status will contain an error code and message. The item's \c id is 
-   *  assigned using the class's \c item_id_counter. 
+   *  assigned using the class's \c item_ids allocator, which reuses the slots
+   *  of removed items under a new generation.
+   *
+   *  IDs hold a 24-bit slot and an 8-bit generation, so at most
+   *  \c IdAllocator::kMaxSlots (16,777,216) items can be registered at once.
+   *  A slot is retired after 255 reuses, until \c recycleRetiredIds() is
+   *  called; once no slot is left, the return \c Status will contain a
+   *  \c RESOURCE_EXHAUSTED error.
    *
    * \param name
-   *    A \c string specifying the name of the item.
+   *    A \c string_view specifying the name of the item. It is copied into
+   *    the auction's \c NamePool.
    *
    * \param starting_value
    *    An optional \c uint23_t specifying the value bidding will start at for 
@@ -124,7 +297,7 @@ public:
    *
    * \return \c Status containing error code and message.
    */
-  Status addItem(std::string name, uint32_t starting_value=0);
+  Status addItem(std::string_view name, uint32_t starting_value=0);
 
   /**
    * \brief Add a user to the auction
@@ -133,10 +306,16 @@ public:
    * (optional) \c funds are passed as parameters. If the \c name passed is
    * already in use by another user in the auction, the return \c Status will 
    * contain an error code and message. The user's \c id is assigned using the
-   * class's \c user_id_counter. 
+   * class's \c user_ids allocator, which reuses the slots of removed users
+   * under a new generation.
+   *
+   * As for items, at most \c IdAllocator::kMaxSlots (16,777,216) users can
+   * be registered at once, and a slot is retired after 255 reuses until
+   * \c recycleRetiredIds() is called.
    *
    * \param name
-   *    A \c string specifying the name of the user.
+   *    A \c string_view specifying the name of the user. It is copied into
+   *    the auction's \c NamePool.
    *
    * \param funds
    *    An optional uint32_t specifying the amount of funds to initialize the
@@ -144,7 +323,32 @@ public:
    *
    * \return \c Status containing error code and message.
    */
-  Status addUser(std::string name, uint32_t funds=0);
+  Status addUser(std::string_view name, uint32_t funds=0);
+
+  /**
+   * \brief Add many items to the auction at once.
+   *
+   * The items get the same IDs as adding them one by one with \c addItem()
+   * would give them, but their names are checked in parallel and storage is
+   * sized for all of them up front. Nothing is added unless every item can
+   * be.
+   *
+   * \param entries
+   *    The name and starting value of each item.
+   *
+   * \param num_threads
+   *    Most threads to check names with, or 0 for one per hardware thread.
+   *
+   * \return \c Status containing error code and message. A \c NAME_TAKEN
+   *    error gives the index of the first entry whose name is already used by
+   *    an item or by an earlier entry.
+   */
+  Status addItems(const std::vector<BulkEntry>& entries,
+                  unsigned num_threads=0);
+
+  /// Add many users to the auction at once. Works like \c addItems().
+  Status addUsers(const std::vector<BulkEntry>& entries,
+                  unsigned num_threads=0);
 
   /**
    * \brief Open a registered item for bidding.
@@ -169,7 +373,9 @@ public:
    * must be registered in the auction but doesn not have to be open. If the
    * item is not registered in the auction or if it has already been sold, the
    * return \c Status will contain an appropriate error code and message.
-   * Otherwise it will return an OK statu.s
+   * Otherwise it will return an OK status. If archiving is enabled and the
+   * item's bids cannot be archived, the item is still sold, its bids stay in
+   * memory, and an \c IO_ERROR status is returned.
    *
    * \param item_id
    *    The ID of the \c Item to open for auction. 
@@ -185,7 +391,9 @@ public:
    * the return \c Status will contain an error code and message. When the item
    * is sold, the winning bid's value is subtracted from the winners total
    * funds, and all losing bids have their value added back to their users
-   * available funds.
+   * available funds. An item that is to be sold but has no bids is left open
+   * and a \c NO_BID status is returned. As with \c sellItem(), an
+   * \c IO_ERROR status means the item was sold but its bids stay in memory.
    *
    * \param item
    *    An \c Item that is currently open to close for bidding. 
@@ -223,23 +431,736 @@ public:
    */
   Status placeBid(uint32_t item_id, uint32_t user_id, uint32_t value);
 
+  /**
+   * \brief Place a batch of bids on one item, keeping only the one that wins.
+   *
+   * The outcome for the item is the same as placing the bids one by one in
+   * order: the same bid ends up leading at the same value. But the bids are
+   * tried highest first, earliest first among equal values, so the first
+   * that \c placeBid() accepts is the one that would have won, and every bid
+   * after it fails the value check without allocating a \c Bid or touching
+   * anyone's funds. Bids that would have been accepted and then outbid
+   * within the batch are rejected with \c INVALID_BID instead; bids that fail
+   * for any other reason get the error \c placeBid() gives them.
+   *
+   * The batch is applied at once, so it is ordered against other commands
+   * by when this is called, not by when each of its bids arrived; see
+   * \c BidCoalescer.
+   *
+   * \param item_id
+   *    The id of the item to bid on.
+   *
+   * \param bids
+   *    The bids, in the order they arrived.
+   *
+   * \param results
+   *    Set to the result of each bid, indexed like \c bids.
+   */
+  void placeCoalescedBids(uint32_t item_id, const std::vector<PendingBid>& bids,
+                          std::vector<Status>& results);
+
+  /**
+   * \brief Retract a bid on an unsold item, e.g. to undo a fraudulent one.
+   *
+   * The bid is removed from the item's and the bidder's bids as if it had
+   * never been placed. If it was leading, the highest bid left takes the
+   * lead; accepted bids only ever rise, so that is the bid before it, and the
+   * item goes back to its starting value if there is none. If it was the
+   * bidder's standing bid on the item, their bid before it stands again and
+   * the difference goes back to their available funds. Other bids' numbers
+   * are unchanged, and the retracted number is not given out again.
+   *
+   * An item keeps its bids in a vector indexed by bid number, leaving a
+   * retracted bid's slot empty, with a Fenwick tree counting the bids left,
+   * so the bid is found, removed and the leader restored in O(log n) in the
+   * item's number of bids. The bidder's bids on the item are a vector in
+   * the same order, so removing the bid from it is linear in their own
+   * bids on the item, which are usually few. If it was their last bid on
+   * the item, they are also dropped from the item's list of bidders, which
+   * is linear in the item's number of bidders. The item's analytics only
+   * record when its first bid came, so retracting the first of several bids
+   * leaves its time to first bid unchanged; it is only reset once no bids
+   * are left.
+   * If the item is not registered, is sold, or has no bid \c bid_number, or
+   * if the bidder that takes the lead bids from a wallet that can no longer
+   * cover their bid, the return \c Status will contain an error code and
+   * message and nothing is changed.
+   *
+   * \param item_id
+   *    The ID of the item the bid was placed on.
+   *
+   * \param bid_number
+   *    The \c Bid::number of the bid.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status retractBid(uint32_t item_id, uint32_t bid_number);
+
+  /**
+   * \brief Open a registered item for sale by Dutch auction.
+   *
+   * The item is offered at a price that starts at \c start_price and drops by
+   * \c decrement every \c tick until it reaches \c floor_price, and is sold to
+   * the first user to accept the price with \c acceptDutchPrice(). Nothing is
+   * written as the price falls; it is computed from the item's \c DutchClock
+   * whenever it is read. Bids cannot be placed on the item while it is open.
+   * Closing the item without selling it ends the Dutch auction. The clock
+   * runs on this auction's steady clock, so a replica replaying the opening
+   * starts its own clock later and replays acceptances at the leader's price
+   * with \c acceptDutchPriceAt().
+   *
+   * If the item is not registered, is sold, is already open, or already has
+   * bids, or if \c floor_price is above \c start_price or \c tick is not
+   * positive, the return \c Status will contain an error code and message.
+   *
+   * \param item_id
+   *    The ID of the \c Item to offer.
+   *
+   * \param start_price
+   *    The price the item is first offered at.
+   *
+   * \param floor_price
+   *    The lowest price the item is offered at.
+   *
+   * \param decrement
+   *    The amount the price drops by every \c tick.
+   *
+   * \param tick
+   *    The time between price drops.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status openDutchItem(uint32_t item_id, uint32_t start_price,
+                       uint32_t floor_price, uint32_t decrement,
+                       std::chrono::steady_clock::duration tick);
+
+  /**
+   * \brief Read the clock of an item open for Dutch auction.
+   *
+   * The clock gives the item's price at any time, so a reader can keep
+   * pricing the item without asking the auction again.
+   *
+   * \param item_id
+   *    The ID of the \c Item.
+   *
+   * \param clock
+   *    Set to the item's clock.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status getDutchClock(uint32_t item_id, DutchClock& clock) const;
+
+  /**
+   * \brief Read the current price of an item open for Dutch auction.
+   *
+   * \param item_id
+   *    The ID of the \c Item.
+   *
+   * \param price
+   *    Set to the item's price now.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status getDutchPrice(uint32_t item_id, uint32_t& price) const;
+
+  /**
+   * \brief Buy an item open for Dutch auction at its current price.
+   *
+   * The price is read from the item's clock at the time of the call. The
+   * acceptance is recorded as a bid at that price and the item is closed and
+   * sold through \c sellItem() in the same call, so the first acceptance the
+   * auction applies wins and any later one finds the item sold. If the item
+   * or user is not registered, if the item is not open for Dutch auction, or
+   * if the user cannot pay the price, the return \c Status will contain an
+   * error code and message. As with \c sellItem(), an \c IO_ERROR status
+   * means the item was sold but its bids stay in memory; \c price is still
+   * set.
+   *
+   * \param item_id
+   *    The ID of the \c Item to buy.
+   *
+   * \param user_id
+   *    The ID of the user buying it.
+   *
+   * \param price
+   *    Set to the price paid.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status acceptDutchPrice(uint32_t item_id, uint32_t user_id,
+                          uint32_t& price);
+
+  /**
+   * \brief Buy an item open for Dutch auction at a price already accepted.
+   *
+   * This replays an acceptance made on another auction. Each auction starts
+   * an item's clock when it opens the item, so the clocks of a leader and a
+   * replica show different prices at the same moment; the replica charges
+   * the price the leader charged instead of reading its own clock. The
+   * server journals \c acceptDutchPrice() with the price paid, and
+   * \c applyCommand() replays it with this function. If \c price is not one
+   * the item's clock shows, the return \c Status will contain an error code
+   * and message; otherwise this works like \c acceptDutchPrice().
+   *
+   * \param item_id
+   *    The ID of the \c Item to buy.
+   *
+   * \param user_id
+   *    The ID of the user buying it.
+   *
+   * \param price
+   *    The price paid.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status acceptDutchPriceAt(uint32_t item_id, uint32_t user_id,
+                            uint32_t price);
+
+  /**
+   * \brief Open a registered item for sale as several identical units.
+   *
+   * A multi-unit item takes quantity bids with \c placeQuantityBid() instead
+   * of ordinary bids. When it is sold with \c sellItem() or
+   * \c closeItem(item_id, true), its units go to the highest bids and every
+   * unit is sold at one clearing price (see \c clearUniformPrice()). The
+   * item's starting value is the lowest price per unit it can be bid. The item
+   * can be closed and reopened like any other and stays multi-unit.
+   *
+   * If the item is not registered, is sold, is already open, or already has
+   * bids, or if \c num_units is 0, the return \c Status will contain an error
+   * code and message.
+   *
+   * \param item_id
+   *    The ID of the \c Item to sell.
+   *
+   * \param num_units
+   *    Number of units for sale.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status openMultiUnitItem(uint32_t item_id, uint32_t num_units);
+
+  /**
+   * \brief Bid for units of a multi-unit item.
+   *
+   * The whole \c quantity times \c unit_price is reserved from the user's
+   * funds until the item is sold; what the user does not end up paying is
+   * then returned to them. A user can place any number of quantity bids. If
+   * the item or user is not registered, if the item is not an open
+   * multi-unit item, if \c quantity is 0 or more than the item has units, if
+   * \c unit_price is below the item's starting value, or if the user cannot
+   * cover the bid, the return \c Status will contain an error code and
+   * message.
+   *
+   * \param item_id
+   *    The ID of the multi-unit item to bid on.
+   *
+   * \param user_id
+   *    The ID of the user placing the bid.
+   *
+   * \param quantity
+   *    Number of units wanted.
+   *
+   * \param unit_price
+   *    Highest price the user will pay per unit.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status placeQuantityBid(uint32_t item_id, uint32_t user_id,
+                          uint32_t quantity, uint32_t unit_price);
+
+  /**
+   * \brief Get the units, bids and, once sold, allocations of an item.
+   *
+   * \param item_id
+   *    The ID of a multi-unit item.
+   *
+   * \param lot
+   *    Set to the item's lot. The pointer is valid until the item is
+   *    removed.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status getMultiUnitLot(uint32_t item_id, const MultiUnitLot*& lot) const;
+
+  /// Default search node limit of \c clearBundles().
+  static const uint64_t kDefaultMaxBundleNodes = 1 << 24;
+
+  /**
+   * \brief Bid for a set of items as a whole.
+   *
+   * The bundle is only won whole, and only when \c clearBundles() finds that
+   * selling it beats selling its items any other way. Its whole \c value is
+   * reserved from the user's funds until then. If the user or any item is
+   * not registered, if \c item_ids is empty or repeats an item, if any item
+   * is not open for ordinary bidding, or if the user cannot cover \c value,
+   * the return \c Status will contain an error code and message.
+   *
+   * \param user_id
+   *    The ID of the user placing the bid.
+   *
+   * \param item_ids
+   *    The IDs of the items in the bundle.
+   *
+   * \param value
+   *    The price offered for all of the items together.
+   *
+   * \param bundle_id
+   *    Set to the ID of the bundle bid.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status placeBundleBid(uint32_t user_id, std::vector<uint32_t> item_ids,
+                        uint32_t value, uint32_t& bundle_id);
+
+  /**
+   * \brief Settle every bundle bid by picking the best set of winners.
+   *
+   * The candidates are the bundle bids whose items are all still open and
+   * unsold, and the high bid on each of their items. \c determineWinners()
+   * picks the non-overlapping candidates worth the most in total. Items
+   * whose high bid wins are sold as by \c closeItem(item_id, true). Items in a
+   * winning bundle are closed and sold to its user, their bidders lose, and
+   * the bundle's price is split evenly over them, the first items taking any
+   * remainder. Each item's share is recorded as its winning \c Bid, so its
+   * bid history and \c getItemAnalytics() show the sale. Losing bundles have
+   * their funds returned. Items in no winning candidate stay open, and all
+   * bundle bids are settled.
+   *
+   * \param clearing
+   *    Set to the winning bundles, the items sold and the revenue.
+   *
+   * \param max_nodes
+   *    Most search nodes to expand per independent group of items before
+   *    settling for the best winners found, or 0 for no limit.
+   *
+   * \return \c Status containing error code and message. Only fails if
+   *    archiving the bids of an item sold fails.
+   */
+  Status clearBundles(BundleClearing& clearing,
+                      uint64_t max_nodes=kDefaultMaxBundleNodes);
+
+  /**
+   * \brief Archive the bid histories of sold items.
+   *
+   * Once enabled, every item sold has its bids copied to an append-only,
+   * memory-mapped archive file and their in-memory copies released, along
+   * with the bidders' records of them. Archived bids are still returned by
+   * \c Item::getBids(), \c User::getBids() and the other accessors. Items sold
+   * before the archive is enabled are left as they are.
+   *
+   * \param path
+   *    The path of the archive file. Any existing file is truncated.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status enableArchive(const std::string& path);
+
+  /// Return an estimate of the memory the auction holds, by structure. Cheap
+  /// enough to call after every operation.
+  MemoryUsage getMemoryUsage() const;
+
+  /**
+   * \brief Archive sold items only once the auction outgrows a budget.
+   *
+   * While a budget is set, sold items keep their bids in memory rather than
+   * being archived the moment they are sold. Whenever a sale takes
+   * \c getMemoryUsage() over the budget, the items sold longest ago are
+   * archived until it is back within it or none are left. Items sold before
+   * the budget was set, and not archived, are queued first and the budget is
+   * enforced straight away.
+   *
+   * \param bytes
+   *    The budget, or 0 to archive every item as it is sold again, which
+   *    archives any items still waiting.
+   *
+   * \return \c Status containing error code and message. Fails with
+   *    \c INVALID_REQUEST if the archive is not enabled, since it is where
+   *    bids go to free memory.
+   */
+  Status setMemoryBudget(size_t bytes);
+
+  /**
+   * \brief Read an item's current value, high bidder and number of bids.
+   *
+   * Unlike the rest of the class, this may be called from any thread while
+   * another thread places bids, opens, sells or removes items. The quote is
+   * read without locking and is always consistent: its fields come from the
+   * same point between two changes to the item.
+   *
+   * \param item_id
+   *    The ID of the item.
+   *
+   * \param quote
+   *    Set to the item's current \c Quote.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status getQuote(uint32_t item_id, Quote& quote) const;
+
+  /**
+   * \brief Take a point-in-time snapshot of the auction.
+   *
+   * Must be called on the thread applying bids, but the snapshot it returns
+   * can then be handed to any other thread and read there for as long as
+   * needed. Taking it copies page pointers rather than values, and later
+   * bids only copy the pages they change, so long-running reports and
+   * exports do not hold up bidding.
+   *
+   * \return The snapshot.
+   */
+  std::shared_ptr<const AuctionSnapshot> getSnapshot() const;
+
+  /**
+   * \brief Fork the auction for a what-if simulation.
+   *
+   * The fork starts in exactly the auction's state, with the same IDs and
+   * state hash, and then changes independently of it: operations on either
+   * one are never seen by the other. Like a snapshot, the fork shares the
+   * auction's column pages and per-user and per-item records, so forking
+   * copies page pointers rather than users, items or bids, and whichever
+   * side changes a page or record first copies only that one. Forks can be
+   * forked in turn.
+   *
+   * Must be called on the thread applying bids, after which the fork can be
+   * used on any one thread. A fork does not write to the auction's archive,
+   * draw from its \c Sequencer or keep its memory budget, and since it has
+   * no quote board of its own, \c getQuote() on a fork must be called on the
+   * thread using it.
+   *
+   * \param forked
+   *    Set to the fork.
+   *
+   * \return \c Status containing error code and message. Fails with
+   *    \c INVALID_REQUEST if the auction has a \c WalletLedger, whose
+   *    wallets are shared with other auctions and cannot be forked.
+   */
+  Status fork(std::unique_ptr<Auction>& forked) const;
+
+  /**
+   * \brief Set the ledger that users' wallets are kept in.
+   *
+   * Several auctions, possibly running on different threads, can share one
+   * ledger so that a user bidding in all of them draws on a single wallet.
+   * Must be called before any user is linked with \c linkWallet().
+   *
+   * \param ledger
+   *    The shared \c WalletLedger.
+   */
+  void setLedger(std::shared_ptr<WalletLedger> ledger);
+
+  /**
+   * \brief Make a user bid with the funds of a wallet.
+   *
+   * From then on the user's bids are reserved against the wallet instead of
+   * the funds the user was added with, which are dropped. Only a leading bid
+   * holds a reservation: it is released when the bid is outbid or its unsold
+   * item is removed, and spent when the item is sold. If the user is not
+   * registered, the wallet is not in the auction's ledger, or the user has
+   * already placed bids, the return \c Status will contain an error code and
+   * message.
+   *
+   * \param user_id
+   *    The ID of the \c User to link.
+   *
+   * \param wallet_id
+   *    The ID of a wallet in the ledger set with \c setLedger().
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status linkWallet(uint32_t user_id, uint32_t wallet_id);
+
+  /**
+   * \brief Remove an item from the auction.
+   *
+   * The item must be closed. An unsold item can always be removed; any bids on
+   * it are dropped and their value is returned to the bidders' available
+   * funds. A sold item can only be removed once its bids have been archived
+   * (see \c enableArchive()), and the auction's revenue is left as it is. If
+   * the item is not registered, is open, or is sold but not archived, the
+   * return \c Status will contain an error code and message.
+   *
+   * The item's ID is not valid again. Its slot is reused for a later item
+   * under a new ID, or once it has run out of generations, after
+   * \c recycleRetiredIds().
+   *
+   * \param item_id
+   *    The ID of the \c Item to remove.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status removeItem(uint32_t item_id);
+
+  /**
+   * \brief Remove an inactive user from the auction.
+   *
+   * A user is inactive if every item they have bid on is sold or removed. If
+   * the user is not registered or still has a bid on an unsold item, the
+   * return \c Status will contain an error code and message. Bids the user
+   * placed stay in the history of the items they were placed on.
+   *
+   * The user's ID is not valid again. Its slot is reused for a later user
+   * under a new ID, or once it has run out of generations, after
+   * \c recycleRetiredIds().
+   *
+   * \param user_id
+   *    The ID of the \c User to remove.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status removeUser(uint32_t user_id);
+
+  /// Release memory left behind by removed items and users.
+  void compact();
+
+  /**
+   * \brief Let the item and user slots retired after their last generation
+   *    be reused.
+   *
+   * A long-running auction that keeps removing and adding users or items
+   * otherwise loses a slot each time one is reused 255 times. Recycled slots
+   * start over at generation 0, so their old IDs become valid again once
+   * they are reused: call this only when no client can still hold an ID of
+   * a removed user or item, and on every replica at the same point in the
+   * operation order.
+   */
+  void recycleRetiredIds();
+
+  /// Return all users whose available funds are less than \c bound.
+  std::vector<uint32_t> findUsersWithAvailableFundsBelow(uint32_t bound) const;
+
+  /// Return all items that are open, unsold, and have a current value between
+  /// \c min and \c max inclusive.
+  std::vector<uint32_t> findOpenItemsWithValueIn(uint32_t min,
+                                                 uint32_t max) const;
+
+  /// Return the total funds of all users. Users linked to a wallet are not
+  /// included.
+  uint64_t getTotalFunds() const;
+
+  /// Return the funds all users have committed to standing bids, i.e. the sum
+  /// of their total funds minus their available funds. Users linked to a
+  /// wallet are not included.
+  uint64_t getTotalCommittedFunds() const;
+
 protected:
-  /// Items registered in the auction.
-  std::map<uint32_t, std::unique_ptr<Item>> items;
+  /// Return the item with a registered \c item_id.
+  Item* itemAt(uint32_t item_id) const {
+    const uint32_t slot = IdAllocator::slotOf(item_id);
+    if (slot < items.size() && items[slot])
+      return items[slot].get();
+    return createItemView(item_id);
+  }
+
+  /// Return the user with a registered \c user_id.
+  User* userAt(uint32_t user_id) const {
+    const uint32_t slot = IdAllocator::slotOf(user_id);
+    if (slot < users.size() && users[slot])
+      return users[slot].get();
+    return createUserView(user_id);
+  }
+
+  /// Create the view of a registered item the first time it is looked up.
+  Item* createItemView(uint32_t item_id) const;
+
+  /// Create the view of a registered user the first time it is looked up.
+  User* createUserView(uint32_t user_id) const;
+
+  /// Return the ID registered under \c name in \c ids_by_name, or
+  /// \c IdAllocator::kInvalidId.
+  uint32_t findName(const PagedColumn<uint32_t>& ids_by_name,
+                    std::string_view name) const;
+
+  /// Move a sold item's bids into the archive.
+  Status archiveItem(uint32_t item_id);
+
+  /// Archive a newly sold item, or queue it for archiving under the memory
+  /// budget.
+  Status retireSoldItem(uint32_t item_id);
+
+  /// Archive queued sold items, oldest first, while over the memory budget.
+  Status enforceMemoryBudget();
+
+  /// Make sure the user columns have an entry for \c slot.
+  void reserveUserSlot(uint32_t slot);
+
+  /// Fill in the columns and record of \c item_id's slot for a new item.
+  void claimItemSlot(uint32_t item_id, std::string_view name,
+                     uint32_t starting_value);
+
+  /// Fill in the columns and record of \c user_id's slot for a new user.
+  void claimUserSlot(uint32_t user_id, std::string_view name, uint32_t funds);
+
+  /// Claim the slot of a newly allocated \c item_id and index its name.
+  void registerItem(uint32_t item_id, std::string_view name,
+                    uint32_t starting_value);
+
+  /// Claim the slot of a newly allocated \c user_id and index its name.
+  void registerUser(uint32_t user_id, std::string_view name, uint32_t funds);
+
+  /// Set \c slot to the highest new slot that taking \c num_ids IDs from
+  /// \c ids would use. Returns \c false if they would all reuse slots.
+  static bool getLastNewSlot(const IdAllocator& ids, size_t num_ids,
+                             uint32_t& slot);
+
+  /// Make sure the item columns have an entry for \c slot.
+  void reserveItemSlot(uint32_t slot);
+
+  /// Publish the item columns of \c item_id to \c quotes.
+  void publishQuote(uint32_t item_id);
+
+  /// Take the sequence number of a bid being accepted.
+  uint64_t takeBidSequence() {
+    const uint64_t local = bid_sequence_counter++;
+    last_sequence = sequencer ? sequencer->next() : local;
+    sequence_taken = true;
+    return last_sequence;
+  }
+
+  /// Add \c amount to the revenue and to the current hour's revenue.
+  void addRevenue(uint64_t amount);
+
+  /// Record a validated bid of \c value, with its funds already reserved.
+  void recordBid(uint32_t item_id, uint32_t user_id, uint32_t value);
+
+  /// Find the clock of a Dutch item that \c user_id is accepting a price on.
+  Status findDutchClock(uint32_t item_id, uint32_t user_id,
+                        DutchClock& clock) const;
+
+  /// Sell a Dutch item to \c user_id at \c price, once they can pay it.
+  Status sellDutchItem(uint32_t item_id, uint32_t user_id, uint32_t price);
+
+  /// Clear a multi-unit item that is being sold and settle its bids.
+  void clearMultiUnitItem(uint32_t item_id);
+
+  /// Return the funds reserved for a quantity bid that \c paid does not use.
+  void releaseQuantityBid(const QuantityBid& bid, uint32_t paid);
+
+  /// Settle a bundle bid that won, or return its funds if it lost.
+  void settleBundleBid(const BundleBid& bundle, bool won);
+
+  /// Close an item and sell it to the winner of a bundle, recording their
+  /// share \c value as its winning bid.
+  Status sellItemInBundle(uint32_t item_id, uint32_t user_id, uint32_t value);
+
+  /// Bits of \c HotItem::state.
+  enum ItemState : uint8_t {
+    kItemOpen = 1,
+    kItemSold = 2,
+    /// The item is open for Dutch auction and has a clock in \c dutch_clocks.
+    kItemDutch = 4,
+    /// The item sells in units and has a lot in \c multi_unit_lots.
+    kItemMultiUnit = 8
+  };
+
+  // Everything below other than plain values is paged or copy-on-write, so
+  // that \c fork() only copies pointers, and an auction and its forks copy
+  // what they change as they go.
+
+  /// Views of the items looked up so far, indexed by slot. Removed items
+  /// leave a \c nullptr behind until their slot is reused.
+  mutable std::vector<std::unique_ptr<Item>> items;
   /// Item IDs currently open for bidding.
-  std::vector<uint32_t> open_items;
+  CopyOnWrite<std::vector<uint32_t>> open_items;
   /// Item ID's for sold items.
-  std::vector<uint32_t> sold_items;
-  /// Users Registered in the auction.
-  std::map<uint32_t, std::unique_ptr<User>> users;
-  /// Users that have placed bids for each item
-  std::map<uint32_t, std::vector<uint32_t>> users_for_item;
-  /// Counter for assigning item ids.
-  uint32_t item_id_counter;
-  /// Counter for assigning user ids.
-  uint32_t user_id_counter;
+  CopyOnWrite<std::vector<uint32_t>> sold_items;
+  /// Views of the users looked up so far, indexed by slot. Removed users
+  /// leave a \c nullptr behind until their slot is reused.
+  mutable std::vector<std::unique_ptr<User>> users;
+  /// Clocks of the items open for Dutch auction.
+  CopyOnWrite<std::unordered_map<uint32_t, DutchClock>> dutch_clocks;
+  /// Units and quantity bids of the multi-unit items.
+  CopyOnWrite<std::unordered_map<uint32_t, MultiUnitLot>> multi_unit_lots;
+  /// Number of quantity and bundle bids each user has waiting to be
+  /// settled, for users that have any.
+  CopyOnWrite<std::unordered_map<uint32_t, uint32_t>> num_pending_bids;
+  /// Bundle bids waiting for \c clearBundles(), by ID.
+  CopyOnWrite<std::map<uint32_t, BundleBid>> bundle_bids;
+  /// ID of the next bundle bid.
+  uint32_t next_bundle_id;
+  /// Allocator for item IDs. The item columns are indexed by their slots.
+  CopyOnWrite<IdAllocator> item_ids;
+  /// Allocator for user IDs. The user columns are indexed by their slots.
+  CopyOnWrite<IdAllocator> user_ids;
   ///  Total revenue of the auction.
   uint32_t revenue;
+  /// Revenue taken in each hour, keyed by hours since the Unix epoch.
+  CopyOnWrite<std::map<int64_t, uint64_t>> revenue_by_hour;
+  /// Names of the auction's items and users. Shared with snapshots, which
+  /// read it from other threads, and read by forks through pools layered
+  /// over it.
+  std::shared_ptr<NamePool> names;
+  /// Registered item ID of each name handle, or \c IdAllocator::kInvalidId.
+  PagedColumn<uint32_t> item_ids_by_name;
+  /// Registered user ID of each name handle, or \c IdAllocator::kInvalidId.
+  PagedColumn<uint32_t> user_ids_by_name;
+  /// Number of sequence numbers taken by bids and commands, which numbers
+  /// them unless \c sequencer is set.
+  uint64_t bid_sequence_counter;
+  /// Last sequence number taken.
+  uint64_t last_sequence;
+  /// Sequence number of the last command sequenced.
+  uint64_t command_sequence;
+  /// Whether a number has been taken since \c beginCommand().
+  bool sequence_taken;
+  /// Sequencer shared with other auctions, if any.
+  std::shared_ptr<Sequencer> sequencer;
+
+  // Hot per-user and per-item state is stored here in columns indexed by
+  // slot, rather than in the \c User and \c Item objects. The fields every
+  // bid validation reads are packed together in \c user_hot_column and
+  // \c item_hot_column, so a validation touches one cache line of each;
+  // bulk scans read single fields of them with a stride. The cold data (bid
+  // histories) is kept in the record columns, and the objects are views that
+  // read both back from here. The columns are paged and copy-on-write so that
+  // \c getSnapshot() and \c fork() can share them.
+
+  /// ID of the user in each slot, or \c IdAllocator::kInvalidId.
+  PagedColumn<uint32_t> user_id_column;
+  /// Handle of each user's name in \c names.
+  PagedColumn<uint32_t> user_name_column;
+  /// Total funds of each user. Zero for empty slots.
+  PagedColumn<uint32_t> user_funds_column;
+  /// Available funds and wallet of each user.
+  PagedColumn<HotUser> user_hot_column;
+  /// Number of items each user has bid on.
+  PagedColumn<uint32_t> user_num_items_column;
+  /// Cold data of each user, read through the \c User views.
+  PagedColumn<CopyOnWrite<UserRecord>> user_record_column;
+  /// ID of the item in each slot, or \c IdAllocator::kInvalidId.
+  PagedColumn<uint32_t> item_id_column;
+  /// Handle of each item's name in \c names.
+  PagedColumn<uint32_t> item_name_column;
+  /// Value, leader, number of bids and \c ItemState bits of each item.
+  PagedColumn<HotItem> item_hot_column;
+  /// Aggregates of each item's bids, kept for \c getItemAnalytics().
+  PagedColumn<ItemAnalytics> item_analytics_column;
+  /// Cold data of each item, read through the \c Item views.
+  PagedColumn<CopyOnWrite<ItemRecord>> item_record_column;
+  /// Copy of the item columns for readers on other threads. Republished
+  /// whenever an item's columns change. Forks have none.
+  std::unique_ptr<QuoteBoard> quotes;
+  /// Ledger holding the wallets in \c user_hot_column.
+  std::shared_ptr<WalletLedger> ledger;
+  /// Archive for sold items' bids, or \c nullptr if archiving is disabled.
+  std::shared_ptr<BidArchive> archive;
+  /// Archives of the auctions this one was forked from, kept open for the
+  /// bids archived before the fork.
+  std::vector<std::shared_ptr<const BidArchive>> inherited_archives;
+  /// Memory budget in bytes, or 0 for none.
+  size_t memory_budget;
+  /// Sold items waiting to be archived under the budget, oldest sale first.
+  std::deque<uint32_t> sold_in_memory;
+  /// Number of \c Bid objects held in memory rather than in the archive.
+  uint64_t num_live_bids;
+  /// Number of (item, bidder) pairs in the items' lists of bidders, each of
+  /// which also has an entry in the bidder's record of the items they bid
+  /// on.
+  uint64_t num_bidder_links;
+  /// Bytes of the quantity bids and allocations in \c multi_unit_lots.
+  uint64_t multi_unit_bytes;
+  /// Estimated bytes held by the bundle bids waiting to be cleared.
+  uint64_t bundle_bytes;
 };
 }  // namespace auction_engine
 
@@ -0,0 +1,79 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <iostream>
+#include <string>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "auction.h"
+#include "bulk_load.h"
+#include "status.h"
+
+/*
+ * Loads users and items from CSV files into one auction and reports how fast
+ * each file was parsed and registered.
+ */
+
+namespace {
+
+void printUsage(const char* program) {
+  std::cerr << "Usage: " << program
+            << " [--threads N] [--users PATH] [--items PATH]..." << std::endl
+            << "Each --users file holds name,funds lines and each --items"
+            << " file name,starting_value lines; files are loaded in order."
+            << std::endl
+            << "--threads bounds the threads used (default: one per hardware"
+            << " thread)." << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned num_threads = 0;
+  auction_engine::Auction auction;
+  bool loaded_any = false;
+  for (int i=1; i<argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 < argc && arg == "--threads") {
+      num_threads = atoi(argv[++i]);
+      continue;
+    }
+    if (i + 1 >= argc || (arg != "--users" && arg != "--items")) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    const std::string path = argv[++i];
+    auction_engine::BulkLoadReport report;
+    auction_engine::Status status = arg == "--users" ?
+        auction_engine::loadUsersCsv(auction, path, num_threads, report) :
+        auction_engine::loadItemsCsv(auction, path, num_threads, report);
+    if (!status.ok()) {
+      std::cerr << status.error_message() << std::endl;
+      return 1;
+    }
+    std::cout << path << ": loaded " << report.num_loaded
+              << (arg == "--users" ? " users" : " items") << " (parsed in "
+              << report.parse_seconds << "s, registered in "
+              << report.load_seconds << "s, "
+              << uint64_t(report.getEntriesPerSecond()) << " entries/s)"
+              << std::endl;
+    loaded_any = true;
+  }
+  if (!loaded_any) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,163 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "auction_client.h"
+#include "error.h"
+#include "protocol.h"
+#include "status.h"
+
+namespace auction_engine {
+
+namespace {
+
+/// Bytes read from the server at a time.
+const size_t kReadSize = 64 * 1024;
+
+Status ioError(const char* what) {
+  return error::IoError(what, " failed: ", strerror(errno));
+}
+}  // namespace
+
+AuctionClient::~AuctionClient() {
+  if (fd >= 0)
+    close(fd);
+}
+
+Status AuctionClient::connectTcp(const std::string& address, uint16_t port) {
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+    return error::IoError("\"", address, "\" is not an IPv4 address.");
+
+  const int new_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (new_fd < 0)
+    return ioError("socket");
+  if (connect(new_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    Status status = ioError("Connecting over TCP");
+    close(new_fd);
+    return status;
+  }
+  const int one = 1;
+  setsockopt(new_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return adopt(new_fd);
+}
+
+Status AuctionClient::connectUnix(const std::string& path) {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path))
+    return error::IoError("Socket path \"", path, "\" is too long.");
+  path.copy(addr.sun_path, path.size());
+
+  const int new_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (new_fd < 0)
+    return ioError("socket");
+  if (connect(new_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    Status status = ioError("Connecting over a Unix socket");
+    close(new_fd);
+    return status;
+  }
+  return adopt(new_fd);
+}
+
+Status AuctionClient::adopt(int new_fd) {
+  if (fd >= 0)
+    close(fd);
+  fd = new_fd;
+  output.clear();
+  input.clear();
+  consumed = 0;
+  num_pending = 0;
+  return Status::OK();
+}
+
+void AuctionClient::send(protocol::Opcode opcode,
+                         std::initializer_list<uint32_t> args,
+                         std::string_view name, bool want_message) {
+  protocol::appendRequest(output, opcode,
+                          want_message ? protocol::kWantMessage : 0,
+                          name, args.begin(), args.size());
+  ++num_pending;
+}
+
+Status AuctionClient::flush() {
+  size_t sent = 0;
+  while (sent < output.size()) {
+    const ssize_t num_sent = ::send(fd, output.data() + sent,
+                                    output.size() - sent, MSG_NOSIGNAL);
+    if (num_sent < 0) {
+      if (errno == EINTR)
+        continue;
+      return ioError("Sending requests");
+    }
+    sent += num_sent;
+  }
+  output.clear();
+  return Status::OK();
+}
+
+Status AuctionClient::receive(protocol::Response& response) {
+  if (num_pending == 0)
+    return error::NotFound("No request is waiting for a response.");
+  Status status = flush();
+  if (!status.ok())
+    return status;
+
+  uint32_t body_size;
+  while (!protocol::nextFrame(input.data() + consumed,
+                              input.size() - consumed, body_size)) {
+    // Drop what has been consumed before reading more.
+    input.erase(0, consumed);
+    consumed = 0;
+    const size_t old_size = input.size();
+    input.resize(old_size + kReadSize);
+    const ssize_t num_read = recv(fd, &input[old_size], kReadSize, 0);
+    input.resize(old_size + (num_read > 0 ? num_read : 0));
+    if (num_read == 0)
+      return error::IoError("The server closed the connection.");
+    if (num_read < 0 && errno != EINTR)
+      return ioError("Receiving responses");
+  }
+  const char* body = input.data() + consumed + protocol::kFrameHeaderSize;
+  consumed += protocol::kFrameHeaderSize + body_size;
+  --num_pending;
+  if (!protocol::parseResponse(body, body_size, response))
+    return error::InvalidRequest("The server sent a malformed response.");
+  return Status::OK();
+}
+
+Status AuctionClient::call(protocol::Opcode opcode,
+                           std::initializer_list<uint32_t> args,
+                           protocol::Response& response,
+                           std::string_view name, bool want_message) {
+  send(opcode, args, name, want_message);
+  return receive(response);
+}
+}  // namespace auction_engine
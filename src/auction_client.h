@@ -0,0 +1,99 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+#include "status.h"
+
+namespace auction_engine {
+
+/**
+ * \brief A blocking client for \c AuctionServer.
+ *
+ * Requests are queued with \c send() and written out together by
+ * \c flush(), or by the next \c receive(), so any number of requests can be
+ * in flight on one connection. Responses come back in the order the
+ * requests were sent. Keep the number in flight bounded: the server stops
+ * reading from a connection whose responses are not being received.
+ */
+class AuctionClient {
+public:
+  AuctionClient() : fd(-1), consumed(0), num_pending(0) {}
+  ~AuctionClient();
+
+  AuctionClient(const AuctionClient&) = delete;
+  AuctionClient& operator=(const AuctionClient&) = delete;
+
+  /// Connect to a server listening on TCP.
+  Status connectTcp(const std::string& address, uint16_t port);
+
+  /// Connect to a server listening on a Unix socket.
+  Status connectUnix(const std::string& path);
+
+  /**
+   * \brief Queue a request.
+   *
+   * \param opcode
+   *    The \c protocol::Opcode of the request.
+   *
+   * \param args
+   *    Arguments of the request.
+   *
+   * \param name
+   *    Name argument of the request, if it takes one.
+   *
+   * \param want_message
+   *    Whether an error response should carry its message.
+   */
+  void send(protocol::Opcode opcode, std::initializer_list<uint32_t> args,
+            std::string_view name=std::string_view(),
+            bool want_message=false);
+
+  /// Write every queued request to the server.
+  Status flush();
+
+  /// Flush, then wait for the response to the oldest request not yet
+  /// answered.
+  Status receive(protocol::Response& response);
+
+  /// Send one request and wait for its response. Any requests already in
+  /// flight must have been received first.
+  Status call(protocol::Opcode opcode, std::initializer_list<uint32_t> args,
+              protocol::Response& response,
+              std::string_view name=std::string_view(),
+              bool want_message=false);
+
+  /// Return the number of requests sent that have not been answered.
+  size_t getNumPending() const { return num_pending; }
+
+private:
+  /// Take ownership of connected socket \c fd.
+  Status adopt(int fd);
+
+  int fd;
+  std::string output;
+  std::string input;
+  /// Bytes of \c input already consumed.
+  size_t consumed;
+  size_t num_pending;
+};
+}  // namespace auction_engine
@@ -0,0 +1,243 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "auction_host.h"
+#include "auction.h"
+#include "error.h"
+#include "status.h"
+
+namespace auction_engine {
+
+const size_t AuctionHost::kMaxTasksPerTurn;
+
+namespace {
+
+// The host and worker index of the calling thread, if it is a worker. Lets
+// tasks submitted from a task go on the submitting worker's own deque.
+thread_local const AuctionHost* current_host = nullptr;
+thread_local size_t current_worker = 0;
+}  // namespace
+
+AuctionHost::AuctionHost(unsigned num_threads)
+    : sequencer(std::make_shared<Sequencer>()),
+      num_scheduled(0),
+      num_sleeping(0),
+      num_pending(0),
+      next_worker(0),
+      stopping(false) {
+  if (num_threads == 0)
+    num_threads = std::thread::hardware_concurrency();
+  if (num_threads == 0)
+    num_threads = 1;
+
+  for (unsigned i=0; i<num_threads; ++i)
+    workers.push_back(std::make_unique<Worker>());
+  for (unsigned i=0; i<num_threads; ++i)
+    threads.emplace_back(&AuctionHost::run, this, i);
+}
+
+AuctionHost::~AuctionHost() {
+  drain();
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  work_available.notify_all();
+  for (std::thread& thread: threads)
+    thread.join();
+}
+
+uint32_t AuctionHost::addAuction() {
+  std::unique_lock<std::shared_mutex> lock(strands_mutex);
+  strands.push_back(std::make_unique<Strand>());
+  strands.back()->auction.setSequencer(sequencer);
+  return strands.size() - 1;
+}
+
+size_t AuctionHost::getNumAuctions() const {
+  std::shared_lock<std::shared_mutex> lock(strands_mutex);
+  return strands.size();
+}
+
+Status AuctionHost::submit(uint32_t auction_id, Task task) {
+  return trySubmit(auction_id, std::move(task), 0);
+}
+
+Status AuctionHost::trySubmit(uint32_t auction_id, Task task,
+                              size_t max_queued) {
+  Strand* strand = findStrand(auction_id);
+  if (!strand) {
+    return error::NotFound(
+        "Auction \"",
+        auction_id,
+        "\" is not hosted.");
+  }
+
+  bool idle;
+  {
+    std::lock_guard<std::mutex> lock(strand->mutex);
+    if (max_queued && strand->tasks.size() >= max_queued) {
+      return error::ResourceExhausted(
+          "Auction \"",
+          auction_id,
+          "\" is overloaded; ",
+          max_queued,
+          " tasks are already queued.");
+    }
+    num_pending.fetch_add(1);
+    strand->tasks.push_back(std::move(task));
+    idle = !strand->scheduled;
+    strand->scheduled = true;
+  }
+  // Only the submit that finds the strand idle schedules it; later tasks
+  // are picked up by whichever worker is running it.
+  if (idle)
+    schedule(strand, false);
+
+  return Status::OK();
+}
+
+Status AuctionHost::getQuote(uint32_t auction_id, uint32_t item_id,
+                             Quote& quote) const {
+  Strand* strand = findStrand(auction_id);
+  if (!strand) {
+    return error::NotFound(
+        "Auction \"",
+        auction_id,
+        "\" is not hosted.");
+  }
+  return strand->auction.getQuote(item_id, quote);
+}
+
+AuctionHost::Strand* AuctionHost::findStrand(uint32_t auction_id) const {
+  std::shared_lock<std::shared_mutex> lock(strands_mutex);
+  return auction_id < strands.size() ? strands[auction_id].get() : nullptr;
+}
+
+void AuctionHost::drain() {
+  std::unique_lock<std::mutex> lock(sleep_mutex);
+  drained.wait(lock, [this]{ return num_pending.load() == 0; });
+}
+
+void AuctionHost::schedule(Strand* strand, bool at_front) {
+  const size_t index = current_host == this
+      ? current_worker
+      : next_worker.fetch_add(1) % workers.size();
+  {
+    Worker& worker = *workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (at_front)
+      worker.strands.push_front(strand);
+    else
+      worker.strands.push_back(strand);
+  }
+
+  // A worker going to sleep counts itself in num_sleeping before checking
+  // num_scheduled, so one of the two sides always sees the other.
+  num_scheduled.fetch_add(1);
+  if (num_sleeping.load() > 0) {
+    { std::lock_guard<std::mutex> lock(sleep_mutex); }
+    work_available.notify_one();
+  }
+}
+
+AuctionHost::Strand* AuctionHost::take(size_t index) {
+  {
+    Worker& worker = *workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (!worker.strands.empty()) {
+      Strand* strand = worker.strands.back();
+      worker.strands.pop_back();
+      num_scheduled.fetch_sub(1);
+      return strand;
+    }
+  }
+
+  for (size_t i=1; i<workers.size(); ++i) {
+    Worker& victim = *workers[(index + i) % workers.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.strands.empty()) {
+      Strand* strand = victim.strands.front();
+      victim.strands.pop_front();
+      num_scheduled.fetch_sub(1);
+      return strand;
+    }
+  }
+  return nullptr;
+}
+
+void AuctionHost::run(size_t index) {
+  current_host = this;
+  current_worker = index;
+
+  while (true) {
+    Strand* strand = take(index);
+    if (strand) {
+      runStrand(strand);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    num_sleeping.fetch_add(1);
+    work_available.wait(lock, [this]{
+      return stopping || num_scheduled.load() > 0;
+    });
+    num_sleeping.fetch_sub(1);
+    if (stopping && num_scheduled.load() == 0)
+      return;
+  }
+}
+
+void AuctionHost::runStrand(Strand* strand) {
+  for (size_t i=0; i<kMaxTasksPerTurn; ++i) {
+    Task task;
+    {
+      std::lock_guard<std::mutex> lock(strand->mutex);
+      if (strand->tasks.empty()) {
+        strand->scheduled = false;
+        return;
+      }
+      task = std::move(strand->tasks.front());
+      strand->tasks.pop_front();
+    }
+
+    task(strand->auction);
+
+    if (num_pending.fetch_sub(1) == 1) {
+      { std::lock_guard<std::mutex> lock(sleep_mutex); }
+      drained.notify_all();
+    }
+  }
+
+  // Out of turns: stay scheduled, behind everything else on this worker.
+  {
+    std::lock_guard<std::mutex> lock(strand->mutex);
+    if (strand->tasks.empty()) {
+      strand->scheduled = false;
+      return;
+    }
+  }
+  schedule(strand, true);
+}
+}  // namespace auction_engine
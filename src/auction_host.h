@@ -0,0 +1,194 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "auction.h"
+#include "sequencer.h"
+#include "status.h"
+
+namespace auction_engine {
+
+/**
+ * \brief Runs many independent auctions on a shared pool of threads.
+ *
+ * Each auction hosted has its own queue of tasks. Tasks for one auction are
+ * run one at a time in the order they were submitted, so they can use the
+ * \c Auction without locking, while tasks for different auctions run in
+ * parallel. An auction with queued tasks is scheduled on one worker's deque;
+ * idle workers steal scheduled auctions from busy ones, and sleep when there
+ * is nothing to run, so an idle auction costs nothing but its memory.
+ *
+ * A worker runs at most \c kMaxTasksPerTurn tasks of an auction before
+ * putting it back at the end of its deque that other workers steal from,
+ * which keeps one busy auction from starving the others queued behind it.
+ *
+ * Every hosted auction draws its bid sequence numbers from the host's
+ * \c Sequencer, so bids across all of them have one unambiguous order.
+ */
+class AuctionHost {
+public:
+  /// A task to run against one auction.
+  using Task = std::function<void(Auction&)>;
+
+  /// Most tasks of one auction a worker runs before scheduling another.
+  static const size_t kMaxTasksPerTurn = 64;
+
+  /**
+   * \brief Start the host's worker threads.
+   *
+   * \param num_threads
+   *    Number of worker threads. Defaults to one per hardware thread.
+   */
+  explicit AuctionHost(unsigned num_threads=0);
+
+  /// Run every task already submitted, then stop the worker threads.
+  ~AuctionHost();
+
+  AuctionHost(const AuctionHost&) = delete;
+  AuctionHost& operator=(const AuctionHost&) = delete;
+
+  /// Add a new, empty auction to the host and return its id.
+  uint32_t addAuction();
+
+  /// Return the number of auctions hosted.
+  size_t getNumAuctions() const;
+
+  /// Return the number of worker threads.
+  unsigned getNumThreads() const { return workers.size(); }
+
+  /// Return the sequencer numbering the bids of every hosted auction.
+  const Sequencer& getSequencer() const { return *sequencer; }
+
+  /**
+   * \brief Queue a task to run against an auction.
+   *
+   * The task runs on one of the host's worker threads after every task
+   * submitted earlier for the same auction has finished. Tasks may submit
+   * further tasks, for the same auction or others.
+   *
+   * \param auction_id
+   *    ID of the auction returned by \c addAuction().
+   *
+   * \param task
+   *    Function to call with the auction.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status submit(uint32_t auction_id, Task task);
+
+  /**
+   * \brief Queue a task unless an auction's queue is full.
+   *
+   * Like \c submit(), but fails with \c RESOURCE_EXHAUSTED instead of
+   * queueing the task if \c max_queued tasks of the auction are already
+   * waiting to run, which bounds how long a task admitted can wait.
+   *
+   * \param auction_id
+   *    ID of the auction returned by \c addAuction().
+   *
+   * \param task
+   *    Function to call with the auction.
+   *
+   * \param max_queued
+   *    Most tasks that may be waiting, or 0 for no bound.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status trySubmit(uint32_t auction_id, Task task, size_t max_queued);
+
+  /**
+   * \brief Read an item's quote from any thread.
+   *
+   * This reads the auction's \c QuoteBoard, so it does not wait for the
+   * auction's tasks and may be a little behind them.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status getQuote(uint32_t auction_id, uint32_t item_id, Quote& quote) const;
+
+  /// Block until every task submitted so far, and every task those submit,
+  /// has finished. Must not be called from a task.
+  void drain();
+
+private:
+  /// An auction and its queue of tasks.
+  struct Strand {
+    Auction auction;
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    /// \c true while the strand is on a worker's deque or being run.
+    bool scheduled = false;
+  };
+
+  /// A worker's deque of scheduled strands. The owner pushes and pops at the
+  /// back; thieves take from the front.
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Strand*> strands;
+  };
+
+  /// Return the strand of \c auction_id, or \c nullptr if there is none.
+  Strand* findStrand(uint32_t auction_id) const;
+
+  /// Body of worker thread \c index.
+  void run(size_t index);
+
+  /// Run up to \c kMaxTasksPerTurn tasks of \c strand.
+  void runStrand(Strand* strand);
+
+  /// Put \c strand on a worker's deque and wake a sleeping worker.
+  void schedule(Strand* strand, bool at_front);
+
+  /// Take a strand from worker \c index's own deque, or steal one.
+  Strand* take(size_t index);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+
+  /// Shared by every hosted auction.
+  const std::shared_ptr<Sequencer> sequencer;
+
+  /// Hosted auctions, indexed by ID.
+  std::vector<std::unique_ptr<Strand>> strands;
+  mutable std::shared_mutex strands_mutex;
+
+  /// Number of strands on the workers' deques.
+  std::atomic<size_t> num_scheduled;
+  /// Number of workers waiting for work.
+  std::atomic<size_t> num_sleeping;
+  /// Number of tasks submitted that have not finished.
+  std::atomic<uint64_t> num_pending;
+  /// Worker to schedule onto next for tasks submitted from outside the pool.
+  std::atomic<size_t> next_worker;
+  bool stopping;
+
+  /// Guards sleeping and waking of workers and \c drain().
+  std::mutex sleep_mutex;
+  std::condition_variable work_available;
+  std::condition_variable drained;
+};
+}  // namespace auction_engine
@@ -0,0 +1,143 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "auction.h"
+#include "auction_host.h"
+#include "error.h"
+#include "status.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+int main() {
+  using auction_engine::Auction;
+  const uint32_t kNumAuctions = 16;
+  const uint32_t kNumBids = 2000;
+
+  auction_engine::AuctionHost host(4);
+
+  printTest("Testing AuctionHost::addAuction()...");
+  for (uint32_t i=0; i<kNumAuctions; ++i)
+    host.addAuction();
+  printTestResult(host.getNumAuctions() == kNumAuctions &&
+                  host.getNumThreads() == 4);
+
+  printTest("Testing AuctionHost::submit()...");
+  for (uint32_t i=0; i<kNumAuctions; ++i) {
+    host.submit(i, [](Auction& auction) {
+      auction.addUser("Alice", 1000000);
+      auction.addUser("Bob", 1000000);
+      auction.addItem("Rug", 0);
+      auction.openItem(0);
+    });
+  }
+
+  // Submit from several threads at once, each bidding as its own user. Tasks
+  // for one auction run one at a time, so they can record the order they ran
+  // in without locking.
+  std::vector<std::vector<uint32_t>> order(2 * kNumAuctions);
+  std::vector<std::thread> submitters;
+  for (uint32_t user_id=0; user_id<2; ++user_id) {
+    submitters.emplace_back([&, user_id]() {
+      for (uint32_t i=0; i<kNumBids; ++i) {
+        const uint32_t auction_id = i % kNumAuctions;
+        const uint32_t value = 2 * (i / kNumAuctions + 1) + user_id;
+        host.submit(auction_id, [&, auction_id, user_id, i, value](
+                                    Auction& auction) {
+          auction.placeBid(0, user_id, value);
+          order[2 * auction_id + user_id].push_back(i);
+        });
+      }
+    });
+  }
+  for (std::thread& submitter: submitters)
+    submitter.join();
+  host.drain();
+
+  // Every task ran once, in the order its thread submitted it, and every
+  // auction ended with Bob's last and highest bid.
+  bool in_order = true;
+  for (const std::vector<uint32_t>& ran: order) {
+    in_order = in_order && ran.size() == kNumBids / kNumAuctions &&
+               std::is_sorted(ran.cbegin(), ran.cend());
+  }
+  std::atomic<uint32_t> num_correct(0);
+  for (uint32_t i=0; i<kNumAuctions; ++i) {
+    host.submit(i, [&](Auction& auction) {
+      const uint32_t expected = 2 * (kNumBids / kNumAuctions) + 1;
+      const auction_engine::Item* rug;
+      auction.getItem(0, rug);
+      if (rug->getCurrentValue() == expected &&
+          rug->getCurrentBid()->user_id == 1)
+        num_correct.fetch_add(1);
+    });
+  }
+  host.drain();
+  printTestResult(in_order && num_correct.load() == kNumAuctions);
+
+  printTest("Testing AuctionHost bid sequence...");
+  // Bids in every auction are numbered from the host's one sequencer, so
+  // together they use each number once.
+  std::vector<uint64_t> sequences;
+  std::mutex sequences_mutex;
+  bool rejected = true;
+  for (uint32_t i=0; i<kNumAuctions; ++i) {
+    host.submit(i, [&](Auction& auction) {
+      const auction_engine::Item* rug;
+      auction.getItem(0, rug);
+      std::lock_guard<std::mutex> lock(sequences_mutex);
+      for (const auction_engine::Bid* bid: rug->getBids())
+        sequences.push_back(bid->sequence);
+      auction_engine::Status status = auction.setSequencer(nullptr);
+      rejected = rejected && auction_engine::error::IsInvalidRequest(status);
+    });
+  }
+  host.drain();
+  std::sort(sequences.begin(), sequences.end());
+  bool dense = sequences.size() == host.getSequencer().peek();
+  for (size_t i=0; i<sequences.size(); ++i)
+    dense = dense && sequences[i] == i;
+  printTestResult(dense && rejected && sequences.size() > kNumAuctions);
+
+  printTest("Testing AuctionHost::submit() from a task...");
+  std::atomic<uint32_t> num_run(0);
+  host.submit(0, [&](Auction&) {
+    for (uint32_t i=0; i<kNumAuctions; ++i)
+      host.submit(i, [&](Auction&) { num_run.fetch_add(1); });
+  });
+  host.drain();
+  printTestResult(num_run.load() == kNumAuctions);
+
+  printTest("Testing AuctionHost::submit() unknown auction...");
+  auction_engine::Status status = host.submit(kNumAuctions, [](Auction&) {});
+  printTestResult(auction_engine::error::IsNotFound(status));
+
+  return 0;
+}
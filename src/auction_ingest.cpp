@@ -0,0 +1,53 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <iostream>
+
+#include "auction.h"
+#include "command_file.h"
+#include "status.h"
+
+/*
+ * Applies the command files given on the command line, in order, to one
+ * auction and reports how fast each was applied and where it failed.
+ */
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " COMMAND_FILE..." << std::endl;
+    return 1;
+  }
+
+  auction_engine::Auction auction;
+  for (int i=1; i<argc; ++i) {
+    auction_engine::IngestReport report;
+    auction_engine::Status status =
+        auction_engine::ingestCommandFile(auction, argv[i], report);
+    std::cout << argv[i] << ": applied " << report.num_applied << " of "
+              << report.num_records << " records in " << report.seconds
+              << "s (" << uint64_t(report.getRecordsPerSecond())
+              << " records/s)" << std::endl;
+    if (report.num_unarchived) {
+      std::cerr << argv[i] << ": " << report.num_unarchived
+                << " sales could not archive their bids: "
+                << report.archive_status.error_message() << std::endl;
+    }
+    if (!status.ok()) {
+      std::cerr << argv[i] << ": " << status.error_message() << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,172 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "auction_client.h"
+#include "error_codes.h"
+#include "protocol.h"
+#include "status.h"
+
+/*
+ * Generates load against a running auction_server. Each connection registers
+ * its own user and item, then places ever higher bids on that item, keeping
+ * up to --depth requests in flight, until --requests bids have been answered
+ * on every connection.
+ */
+
+namespace {
+
+using auction_engine::AuctionClient;
+using auction_engine::Status;
+using auction_engine::protocol::Response;
+namespace protocol = auction_engine::protocol;
+
+struct Options {
+  std::string address = "127.0.0.1";
+  uint16_t port = 7070;
+  std::string unix_path;
+  unsigned num_connections = 4;
+  unsigned depth = 64;
+  unsigned num_requests = 100000;
+};
+
+void printUsage(const char* program) {
+  std::cerr << "Usage: " << program << " [--address ADDRESS] [--port PORT]"
+            << " [--unix PATH] [--connections N] [--depth N]"
+            << " [--requests N]" << std::endl;
+}
+
+Status connect(const Options& options, AuctionClient& client) {
+  if (!options.unix_path.empty())
+    return client.connectUnix(options.unix_path);
+  return client.connectTcp(options.address, options.port);
+}
+
+/// Turn a failed call or an error response into a \c Status.
+Status checkCall(Status status, const Response& response) {
+  if (!status.ok() || response.code == auction_engine::error::OK)
+    return status;
+  return Status(response.code, response.message);
+}
+
+/// Register the user and item connection \c index bids with.
+Status setUp(AuctionClient& client, unsigned index, uint32_t& user_id,
+             uint32_t& item_id) {
+  // Names must not clash with those of an earlier run against the server.
+  const std::string suffix = std::to_string(index) + "-" +
+                             std::to_string(time(nullptr));
+  Response response;
+  Status status = checkCall(client.call(protocol::kAddUser, {0xFFFFFFFFu},
+                                        response, "load-user-" + suffix,
+                                        true),
+                            response);
+  if (!status.ok())
+    return status;
+  user_id = response.results[0];
+  status = checkCall(client.call(protocol::kAddItem, {0}, response,
+                                 "load-item-" + suffix, true),
+                     response);
+  if (!status.ok())
+    return status;
+  item_id = response.results[0];
+  return checkCall(client.call(protocol::kOpenItem, {item_id}, response,
+                               std::string_view(), true),
+                   response);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i=1; i<argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    if (arg == "--address") {
+      options.address = argv[++i];
+    } else if (arg == "--port") {
+      options.port = atoi(argv[++i]);
+    } else if (arg == "--unix") {
+      options.unix_path = argv[++i];
+    } else if (arg == "--connections") {
+      options.num_connections = atoi(argv[++i]);
+    } else if (arg == "--depth") {
+      options.depth = atoi(argv[++i]);
+    } else if (arg == "--requests") {
+      options.num_requests = atoi(argv[++i]);
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (options.num_connections == 0 || options.depth == 0) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  std::atomic<uint64_t> num_rejected(0);
+  std::atomic<bool> failed(false);
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned index=0; index<options.num_connections; ++index) {
+    threads.emplace_back([&, index]() {
+      AuctionClient client;
+      uint32_t user_id, item_id;
+      Status status = connect(options, client);
+      if (status.ok())
+        status = setUp(client, index, user_id, item_id);
+      uint32_t value = 0;
+      uint32_t num_answered = 0;
+      Response response;
+      while (status.ok() && num_answered < options.num_requests) {
+        while (client.getNumPending() < options.depth &&
+               value < options.num_requests)
+          client.send(protocol::kPlaceBid, {item_id, user_id, ++value});
+        status = client.receive(response);
+        ++num_answered;
+        if (status.ok() && response.code != auction_engine::error::OK)
+          ++num_rejected;
+      }
+      if (!status.ok()) {
+        std::cerr << "Connection " << index << ": " << status.error_message()
+                  << std::endl;
+        failed = true;
+      }
+    });
+  }
+  for (std::thread& thread: threads)
+    thread.join();
+  const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  const uint64_t total = uint64_t(options.num_connections) *
+                         options.num_requests;
+  std::cout << "Requests:  " << total << std::endl
+            << "Rejected:  " << num_rejected.load() << std::endl
+            << "Seconds:   " << seconds << std::endl
+            << "Requests/s " << uint64_t(total / seconds) << std::endl;
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,523 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "auction_server.h"
+#include "auction.h"
+#include "bundle.h"
+#include "command_file.h"
+#include "error.h"
+#include "journal.h"
+#include "protocol.h"
+#include "quote_board.h"
+#include "status.h"
+#include "user.h"
+
+namespace auction_engine {
+
+const size_t AuctionServer::kReadSize;
+const size_t AuctionServer::kMaxPendingOutput;
+
+namespace {
+
+/// Most events taken from epoll at once.
+const int kMaxEvents = 64;
+/// Most reads of one connection per event, so one busy client cannot hold
+/// up the others.
+const int kMaxReadsPerEvent = 4;
+
+/// Arguments a request takes, indexed by opcode.
+struct RequestShape {
+  size_t num_args;
+  bool named;
+  /// Whether one or more arguments follow the first \c num_args.
+  bool variadic = false;
+};
+const RequestShape kRequestShapes[] = {
+  {0, false},  // unused
+  {1, true},   // kAddUser
+  {1, true},   // kAddItem
+  {1, false},  // kOpenItem
+  {2, false},  // kCloseItem
+  {1, false},  // kSellItem
+  {3, false},  // kPlaceBid
+  {1, false},  // kRemoveItem
+  {1, false},  // kRemoveUser
+  {0, true},   // kFindItem
+  {0, true},   // kFindUser
+  {1, false},  // kGetQuote
+  {1, false},  // kGetUser
+  {0, false},  // kGetRevenue
+  {0, false},  // kGetOpenItems
+  {0, false},  // kGetSoldItems
+  {2, false},  // kRetractBid
+  {2, false},  // kAcceptDutchPrice
+  {5, false},  // kOpenDutchItem
+  {2, false, true},  // kPlaceBundleBid
+  {1, false},  // kClearBundles
+  {2, false},  // kOpenMultiUnitItem
+  {4, false}   // kPlaceQuantityBid
+};
+
+Status ioError(const char* what) {
+  return error::IoError(what, " failed: ", strerror(errno));
+}
+}  // namespace
+
+AuctionServer::AuctionServer()
+    : epoll_fd(epoll_create1(EPOLL_CLOEXEC)),
+      stop_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+  if (epoll_fd >= 0 && stop_fd >= 0) {
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = stop_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &event);
+  }
+}
+
+AuctionServer::~AuctionServer() {
+  for (auto& entry: connections)
+    close(entry.first);
+  for (int listener: listeners)
+    close(listener);
+  for (const std::string& path: unix_paths)
+    unlink(path.c_str());
+  if (stop_fd >= 0)
+    close(stop_fd);
+  if (epoll_fd >= 0)
+    close(epoll_fd);
+}
+
+Status AuctionServer::listenTcp(const std::string& address, uint16_t port,
+                                uint16_t& bound_port) {
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+    return error::IoError("\"", address, "\" is not an IPv4 address.");
+
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        0);
+  if (fd < 0)
+    return ioError("socket");
+  const int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  socklen_t addr_size = sizeof(addr);
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(fd, SOMAXCONN) < 0 ||
+      getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addr_size) < 0) {
+    Status status = ioError("Listening on TCP");
+    close(fd);
+    return status;
+  }
+  bound_port = ntohs(addr.sin_port);
+  return addListener(fd);
+}
+
+Status AuctionServer::listenUnix(const std::string& path) {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path))
+    return error::IoError("Socket path \"", path, "\" is too long.");
+  path.copy(addr.sun_path, path.size());
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        0);
+  if (fd < 0)
+    return ioError("socket");
+  unlink(path.c_str());
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(fd, SOMAXCONN) < 0) {
+    Status status = ioError("Listening on Unix socket");
+    close(fd);
+    return status;
+  }
+  unix_paths.push_back(path);
+  return addListener(fd);
+}
+
+Status AuctionServer::addListener(int fd) {
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+    Status status = ioError("epoll_ctl");
+    close(fd);
+    return status;
+  }
+  listeners.push_back(fd);
+  return Status::OK();
+}
+
+Status AuctionServer::run() {
+  if (epoll_fd < 0 || stop_fd < 0)
+    return error::IoError("The server's event loop could not be created.");
+
+  epoll_event events[kMaxEvents];
+  while (true) {
+    const int num_events = epoll_wait(epoll_fd, events, kMaxEvents, -1);
+    if (num_events < 0) {
+      if (errno == EINTR)
+        continue;
+      return ioError("epoll_wait");
+    }
+    for (int i=0; i<num_events; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == stop_fd) {
+        uint64_t count;
+        while (read(stop_fd, &count, sizeof(count)) > 0) {}
+        return Status::OK();
+      }
+      if (std::find(listeners.begin(), listeners.end(), fd) !=
+          listeners.end()) {
+        acceptConnections(fd);
+        continue;
+      }
+      auto it = connections.find(fd);
+      if (it == connections.end())
+        continue;
+      Connection& connection = *it->second;
+      bool open = !(events[i].events & EPOLLERR);
+      if (open && (events[i].events & (EPOLLIN | EPOLLHUP)))
+        open = readRequests(connection);
+      if (open && connection.sent < connection.output.size())
+        open = writeResponses(connection);
+      if (open)
+        updateEvents(connection);
+      else
+        closeConnection(fd);
+      if (!journal_status.ok())
+        return std::move(journal_status);
+    }
+  }
+}
+
+void AuctionServer::stop() {
+  const uint64_t one = 1;
+  // Nothing useful can be done if this fails; the counter only saturates
+  // when the loop is already being woken.
+  ssize_t written = write(stop_fd, &one, sizeof(one));
+  (void) written;
+}
+
+void AuctionServer::acceptConnections(int listener) {
+  while (true) {
+    const int fd = accept4(listener, nullptr, nullptr,
+                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+      return;
+    // Responses are written in batches, so waiting to coalesce them further
+    // only adds latency. This fails harmlessly on Unix sockets.
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      close(fd);
+      continue;
+    }
+    std::unique_ptr<Connection> connection = std::make_unique<Connection>();
+    connection->fd = fd;
+    connections[fd] = std::move(connection);
+  }
+}
+
+bool AuctionServer::readRequests(Connection& connection) {
+  bool open = true;
+  for (int i=0; i<kMaxReadsPerEvent; ++i) {
+    const size_t old_size = connection.input.size();
+    connection.input.resize(old_size + kReadSize);
+    const ssize_t num_read = recv(connection.fd, &connection.input[old_size],
+                                  kReadSize, 0);
+    connection.input.resize(old_size + std::max<ssize_t>(num_read, 0));
+    if (num_read == 0 ||
+        (num_read < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+         errno != EINTR)) {
+      // Still answer what the peer sent before it stopped sending.
+      open = false;
+      break;
+    }
+    if (num_read < ssize_t(kReadSize))
+      break;
+  }
+
+  const char* data = connection.input.data();
+  size_t size = connection.input.size();
+  uint32_t body_size;
+  protocol::Request request;
+  while (protocol::nextFrame(data, size, body_size)) {
+    const char* body = data + protocol::kFrameHeaderSize;
+    if (protocol::parseRequest(body, body_size, request)) {
+      handleRequest(request, connection.output);
+    } else {
+      protocol::appendResponse(connection.output, error::INVALID_REQUEST,
+                               nullptr, 0, std::string_view());
+    }
+    data = body + body_size;
+    size -= protocol::kFrameHeaderSize + body_size;
+  }
+  if (size >= protocol::kFrameHeaderSize) {
+    uint32_t pending_size;
+    protocol::nextFrame(data, size, pending_size);
+    if (pending_size > protocol::kMaxFrameSize)
+      open = false;
+  }
+  connection.input.erase(0, connection.input.size() - size);
+
+  // The batch's changes must reach the journal before they are acknowledged.
+  if (journal) {
+    journal_status = journal->flush();
+    if (!journal_status.ok())
+      return false;
+  }
+
+  if (!open) {
+    writeResponses(connection);
+    return false;
+  }
+  return true;
+}
+
+bool AuctionServer::writeResponses(Connection& connection) {
+  while (connection.sent < connection.output.size()) {
+    const ssize_t num_sent = send(connection.fd,
+                                  connection.output.data() + connection.sent,
+                                  connection.output.size() - connection.sent,
+                                  MSG_NOSIGNAL);
+    if (num_sent < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    connection.sent += num_sent;
+  }
+  connection.output.clear();
+  connection.sent = 0;
+  return true;
+}
+
+void AuctionServer::updateEvents(Connection& connection) {
+  const size_t pending = connection.output.size() - connection.sent;
+  const bool reading = pending < kMaxPendingOutput;
+  const bool writing = pending > 0;
+  if (reading == connection.reading && writing == connection.writing)
+    return;
+  connection.reading = reading;
+  connection.writing = writing;
+  epoll_event event = {};
+  if (reading)
+    event.events |= EPOLLIN;
+  if (writing)
+    event.events |= EPOLLOUT;
+  event.data.fd = connection.fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+void AuctionServer::closeConnection(int fd) {
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  connections.erase(fd);
+}
+
+void AuctionServer::handleRequest(const protocol::Request& request,
+                                  std::string& out) {
+  using namespace protocol;
+  const uint32_t* args = request.args;
+  results.clear();
+  auction.beginCommand();
+  Status status;
+  if (request.opcode < kAddUser || request.opcode > kPlaceQuantityBid) {
+    status = error::InvalidRequest("Unknown opcode ",
+                                   uint32_t(request.opcode), ".");
+  } else {
+    const RequestShape& shape = kRequestShapes[request.opcode];
+    const bool args_fit = shape.variadic ? request.num_args > shape.num_args :
+                                           request.num_args == shape.num_args;
+    if (!args_fit || request.name.empty() == shape.named) {
+      status = error::InvalidRequest("Wrong arguments for opcode ",
+                                     uint32_t(request.opcode), ".");
+    }
+  }
+
+  if (status.ok()) {
+    switch (request.opcode) {
+      case kAddUser:
+        status = auction.addUser(request.name, args[0]);
+        if (status.ok()) {
+          results.push_back(0);
+          status = auction.findUser(request.name, results[0]);
+        }
+        break;
+      case kAddItem:
+        status = auction.addItem(request.name, args[0]);
+        if (status.ok()) {
+          results.push_back(0);
+          status = auction.findItem(request.name, results[0]);
+        }
+        break;
+      case kOpenItem:
+        status = auction.openItem(args[0]);
+        break;
+      case kCloseItem:
+        status = auction.closeItem(args[0], args[1] != 0);
+        break;
+      case kSellItem:
+        status = auction.sellItem(args[0]);
+        break;
+      case kPlaceBid:
+        status = auction.placeBid(args[0], args[1], args[2]);
+        break;
+      case kRemoveItem:
+        status = auction.removeItem(args[0]);
+        break;
+      case kRemoveUser:
+        status = auction.removeUser(args[0]);
+        break;
+      case kFindItem:
+        results.push_back(0);
+        status = auction.findItem(request.name, results[0]);
+        break;
+      case kFindUser:
+        results.push_back(0);
+        status = auction.findUser(request.name, results[0]);
+        break;
+      case kGetQuote: {
+        Quote quote;
+        status = auction.getQuote(args[0], quote);
+        if (status.ok()) {
+          results = {quote.value, quote.leader, quote.num_bids,
+                     uint32_t(quote.open), uint32_t(quote.sold)};
+        }
+        break;
+      }
+      case kGetUser: {
+        const User* user;
+        status = auction.getUser(args[0], user);
+        if (status.ok()) {
+          results = {user->getTotalFunds(), user->getAvailableFunds(),
+                     uint32_t(user->getItemsBidOn().size())};
+        }
+        break;
+      }
+      case kGetRevenue:
+        results.push_back(auction.getRevenue());
+        break;
+      case kGetOpenItems:
+        results = auction.getOpenItems();
+        break;
+      case kGetSoldItems:
+        results = auction.getSoldItems();
+        break;
+      case kRetractBid:
+        status = auction.retractBid(args[0], args[1]);
+        break;
+      case kAcceptDutchPrice:
+        results.push_back(0);
+        status = auction.acceptDutchPrice(args[0], args[1], results[0]);
+        break;
+      case kOpenDutchItem:
+        status = auction.openDutchItem(args[0], args[1], args[2], args[3],
+                                       std::chrono::milliseconds(args[4]));
+        break;
+      case kPlaceBundleBid:
+        results.push_back(0);
+        status = auction.placeBundleBid(
+            args[0], std::vector<uint32_t>(args + 2, args + request.num_args),
+            args[1], results[0]);
+        break;
+      case kClearBundles: {
+        BundleClearing clearing;
+        status = auction.clearBundles(clearing, args[0]);
+        results = {uint32_t(clearing.winning_bundles.size()),
+                   uint32_t(clearing.items_sold.size()),
+                   uint32_t(clearing.optimal)};
+        break;
+      }
+      case kOpenMultiUnitItem:
+        status = auction.openMultiUnitItem(args[0], args[1]);
+        break;
+      case kPlaceQuantityBid:
+        status = auction.placeQuantityBid(args[0], args[1], args[2], args[3]);
+        break;
+    }
+  }
+
+  // A sale whose bids could not be archived has still been made, so it is
+  // numbered and journaled even though the client is told it failed.
+  const bool applied = isCommandApplied(request.opcode, status);
+  const uint64_t sequence = applied ? auction.sequenceCommand() : 0;
+  if (journal && applied) {
+    CommandRecord record = {};
+    record.opcode = request.opcode;
+    std::string_view name = request.name;
+    if (request.opcode == kAcceptDutchPrice) {
+      // A replica's clock shows a different price, so it replays the one
+      // paid here.
+      record.args[0] = args[0];
+      record.args[1] = args[1];
+      record.args[2] = results[0];
+    } else if (request.opcode == kOpenDutchItem ||
+               request.opcode == kPlaceQuantityBid) {
+      // The arguments don't fit the record, so they follow it where a name
+      // would, laid out as a DutchOpening or QuantityOrder.
+      name = std::string_view(reinterpret_cast<const char*>(args),
+                              request.num_args * sizeof(uint32_t));
+      record.name_length = name.size();
+    } else if (request.opcode == kPlaceBundleBid) {
+      // The item IDs follow the record where a name would.
+      name = std::string_view(reinterpret_cast<const char*>(args + 2),
+                              (request.num_args - 2) * sizeof(uint32_t));
+      record.name_length = name.size();
+      record.args[1] = args[0];
+      record.args[2] = args[1];
+    } else if (request.name.empty()) {
+      std::copy(args, args + request.num_args, record.args);
+    } else {
+      record.name_length = request.name.size();
+      record.args[1] = args[0];
+    }
+    journal->append(record, name, sequence, auction);
+  }
+  if (applied && status.ok()) {
+    results.push_back(uint32_t(sequence));
+    results.push_back(uint32_t(sequence >> 32));
+  }
+
+  // Error messages are only copied out when the client asked for them.
+  std::string message;
+  if (!status.ok() && (request.flags & kWantMessage))
+    message = status.error_message();
+  appendResponse(out, status.code(), results.data(), results.size(), message);
+}
+}  // namespace auction_engine
@@ -0,0 +1,162 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "auction.h"
+#include "journal.h"
+#include "protocol.h"
+#include "status.h"
+
+namespace auction_engine {
+
+/**
+ * \brief Serves one auction over TCP and Unix sockets.
+ *
+ * Clients speak the binary protocol in \c protocol.h. The server runs a
+ * single epoll event loop on the thread that calls \c run(), which is also
+ * the only thread that touches the auction. Each time a connection is
+ * readable the loop reads everything available in one go, answers every
+ * complete request in it, and writes all the responses back with one call,
+ * so a client that pipelines requests pays for one read and one write per
+ * batch rather than per request.
+ *
+ * A connection whose responses are not being read stops being read from
+ * once \c kMaxPendingOutput bytes are waiting to be sent.
+ *
+ * Every command that changes the auction is numbered with
+ * \c Auction::sequenceCommand(). The number is returned to the client after
+ * the command's results and journaled with the command.
+ */
+class AuctionServer {
+public:
+  /// Bytes read from a connection at a time.
+  static const size_t kReadSize = 64 * 1024;
+  /// Unsent response bytes at which a connection stops being read.
+  static const size_t kMaxPendingOutput = 1 << 20;
+
+  AuctionServer();
+  ~AuctionServer();
+
+  AuctionServer(const AuctionServer&) = delete;
+  AuctionServer& operator=(const AuctionServer&) = delete;
+
+  /// Return the auction served. Only use it while \c run() is not running.
+  Auction& getAuction() { return auction; }
+
+  /**
+   * \brief Listen for TCP connections.
+   *
+   * \param address
+   *    IPv4 address to listen on, such as \c "127.0.0.1".
+   *
+   * \param port
+   *    Port to listen on, or 0 to pick a free one.
+   *
+   * \param bound_port
+   *    Set to the port listened on.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status listenTcp(const std::string& address, uint16_t port,
+                   uint16_t& bound_port);
+
+  /**
+   * \brief Listen for connections on a Unix socket.
+   *
+   * \param path
+   *    Path of the socket. Any file already there is replaced.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status listenUnix(const std::string& path);
+
+  /**
+   * \brief Journal every command the auction applies.
+   *
+   * Each change to the auction is written to \c journal, including a sale
+   * that returned \c IO_ERROR because its bids could not be archived. It is
+   * flushed before the responses of the batch that made the changes are
+   * sent, so a \c Follower replaying it never lags behind what clients have
+   * been told. Only call this while \c run() is not running.
+   */
+  void setJournal(std::unique_ptr<JournalWriter> journal) {
+    this->journal = std::move(journal);
+  }
+
+  /// Serve connections until \c stop() is called, or until writing the
+  /// journal fails.
+  Status run();
+
+  /// Make \c run() return. Safe to call from any thread or signal handler.
+  void stop();
+
+private:
+  struct Connection {
+    int fd;
+    std::string input;
+    std::string output;
+    /// Bytes of \c output already sent.
+    size_t sent = 0;
+    /// Whether the connection is registered for readability.
+    bool reading = true;
+    /// Whether the connection is registered for writability.
+    bool writing = false;
+  };
+
+  /// Register \c fd with the event loop and remember it as a listener.
+  Status addListener(int fd);
+
+  /// Accept every pending connection on \c listener.
+  void acceptConnections(int listener);
+
+  /// Read and answer the requests available on \c connection. Returns
+  /// \c false if the connection should be closed.
+  bool readRequests(Connection& connection);
+
+  /// Send as much pending output as the socket takes. Returns \c false if
+  /// the connection should be closed.
+  bool writeResponses(Connection& connection);
+
+  /// Update the events \c connection is registered for.
+  void updateEvents(Connection& connection);
+
+  /// Close \c connection and forget it.
+  void closeConnection(int fd);
+
+  /// Apply \c request to the auction and append the response to \c out.
+  void handleRequest(const protocol::Request& request, std::string& out);
+
+  Auction auction;
+  int epoll_fd;
+  /// Written to by \c stop() to wake the event loop.
+  int stop_fd;
+  std::vector<int> listeners;
+  std::vector<std::string> unix_paths;
+  std::unordered_map<int, std::unique_ptr<Connection>> connections;
+  /// Results of the request being handled.
+  std::vector<uint32_t> results;
+  std::unique_ptr<JournalWriter> journal;
+  /// First error writing the journal.
+  Status journal_status;
+};
+}  // namespace auction_engine
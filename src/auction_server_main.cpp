@@ -0,0 +1,145 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "auction_server.h"
+#include "journal.h"
+#include "status.h"
+
+namespace {
+
+auction_engine::AuctionServer* running_server = nullptr;
+/// Set by SIGUSR1 to make a follower take over.
+std::atomic<bool> take_over(false);
+
+void handleSignal(int) {
+  if (running_server)
+    running_server->stop();
+}
+
+void handleTakeOver(int) {
+  take_over.store(true, std::memory_order_relaxed);
+}
+
+void printUsage(const char* program) {
+  std::cerr << "Usage: " << program
+            << " [--address ADDRESS] [--port PORT] [--unix PATH]"
+            << " [--journal PATH] [--hash-interval N] [--follow PATH]"
+            << std::endl
+            << "Serves one auction on TCP ADDRESS:PORT (default"
+            << " 127.0.0.1:7070) and, if given, the Unix socket PATH."
+            << std::endl
+            << "--journal appends every change to PATH, with a state hash"
+            << " every N changes (default 1024)." << std::endl
+            << "--follow first replays the journal at PATH as it grows, and"
+            << " only takes over and starts serving on SIGUSR1." << std::endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string address = "127.0.0.1";
+  uint16_t port = 7070;
+  std::string unix_path;
+  std::string journal_path;
+  uint32_t hash_interval = 1024;
+  std::string follow_path;
+  for (int i=1; i<argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 < argc && arg == "--address") {
+      address = argv[++i];
+    } else if (i + 1 < argc && arg == "--port") {
+      port = atoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--unix") {
+      unix_path = argv[++i];
+    } else if (i + 1 < argc && arg == "--journal") {
+      journal_path = argv[++i];
+    } else if (i + 1 < argc && arg == "--hash-interval") {
+      hash_interval = atoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--follow") {
+      follow_path = argv[++i];
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  auction_engine::AuctionServer server;
+  auction_engine::Status status;
+  if (!follow_path.empty()) {
+    const int fd = open(follow_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      std::cerr << "Could not open \"" << follow_path << "\": "
+                << strerror(errno) << std::endl;
+      return 1;
+    }
+    std::cout << "Following " << follow_path << std::endl;
+    signal(SIGUSR1, handleTakeOver);
+    auction_engine::Follower follower(server.getAuction());
+    status = follower.follow(fd, take_over);
+    close(fd);
+    if (!status.ok()) {
+      std::cerr << status.error_message() << std::endl;
+      return 1;
+    }
+    std::cout << "Taking over after " << follower.getNumApplied()
+              << " commands and " << follower.getNumVerified()
+              << " verified state hashes" << std::endl;
+  }
+  if (!journal_path.empty()) {
+    std::unique_ptr<auction_engine::JournalWriter> journal =
+        std::make_unique<auction_engine::JournalWriter>();
+    status = journal->openFile(journal_path, hash_interval);
+    if (!status.ok()) {
+      std::cerr << status.error_message() << std::endl;
+      return 1;
+    }
+    server.setJournal(std::move(journal));
+  }
+
+  uint16_t bound_port;
+  status = server.listenTcp(address, port, bound_port);
+  if (status.ok() && !unix_path.empty())
+    status = server.listenUnix(unix_path);
+  if (!status.ok()) {
+    std::cerr << status.error_message() << std::endl;
+    return 1;
+  }
+  std::cout << "Listening on " << address << ":" << bound_port;
+  if (!unix_path.empty())
+    std::cout << " and " << unix_path;
+  std::cout << std::endl;
+
+  running_server = &server;
+  signal(SIGINT, handleSignal);
+  signal(SIGTERM, handleSignal);
+  status = server.run();
+  running_server = nullptr;
+  if (!status.ok()) {
+    std::cerr << status.error_message() << std::endl;
+    return 1;
+  }
+  return 0;
+}
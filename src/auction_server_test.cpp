@@ -0,0 +1,161 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "auction_client.h"
+#include "auction_server.h"
+#include "error_codes.h"
+#include "protocol.h"
+#include "status.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+int main() {
+  namespace protocol = auction_engine::protocol;
+  namespace error = auction_engine::error;
+  using auction_engine::AuctionClient;
+  using auction_engine::Status;
+  using protocol::Response;
+
+  auction_engine::AuctionServer server;
+  uint16_t port;
+  const std::string unix_path = "/tmp/auction_server_test." +
+                                std::to_string(getpid()) + ".sock";
+
+  printTest("Testing AuctionServer::listen...()...");
+  Status tcp_status = server.listenTcp("127.0.0.1", 0, port);
+  Status unix_status = server.listenUnix(unix_path);
+  printTestResult(tcp_status.ok() && unix_status.ok() && port != 0);
+  std::thread server_thread([&server]() { server.run(); });
+
+  printTest("Testing requests over TCP...");
+  AuctionClient tcp_client;
+  Status status = tcp_client.connectTcp("127.0.0.1", port);
+  Response alice, bob, rug, open;
+  if (status.ok()) {
+    tcp_client.call(protocol::kAddUser, {1000}, alice, "Alice");
+    tcp_client.call(protocol::kAddUser, {1000}, bob, "Bob");
+    tcp_client.call(protocol::kAddItem, {5}, rug, "Rug");
+    tcp_client.call(protocol::kOpenItem, {rug.results.at(0)}, open);
+  }
+  printTestResult(status.ok() && alice.code == error::OK &&
+                  bob.code == error::OK && rug.code == error::OK &&
+                  open.code == error::OK &&
+                  alice.results[0] != bob.results[0] &&
+                  // Each command is followed by its sequence number.
+                  alice.results.size() == 3 && alice.results[1] == 0 &&
+                  alice.results[2] == 0 && bob.results.at(1) == 1 &&
+                  open.results == std::vector<uint32_t>({3, 0}));
+  const uint32_t alice_id = alice.results.at(0);
+  const uint32_t bob_id = bob.results.at(0);
+  const uint32_t rug_id = rug.results.at(0);
+
+  printTest("Testing pipelined requests over Unix socket...");
+  AuctionClient unix_client;
+  status = unix_client.connectUnix(unix_path);
+  // Alternate bids so each one outbids the last.
+  const uint32_t kNumBids = 900;
+  for (uint32_t value=6; value<6+kNumBids; ++value) {
+    unix_client.send(protocol::kPlaceBid,
+                     {rug_id, value % 2 ? alice_id : bob_id, value});
+  }
+  unix_client.send(protocol::kGetQuote, {rug_id});
+  bool all_ok = status.ok();
+  Response response;
+  for (uint32_t i=0; i<kNumBids && all_ok; ++i) {
+    all_ok = unix_client.receive(response).ok() &&
+             response.code == error::OK &&
+             response.results == std::vector<uint32_t>({4 + i, 0});
+  }
+  Response quote;
+  all_ok = all_ok && unix_client.receive(quote).ok();
+  printTestResult(all_ok && quote.code == error::OK &&
+                  quote.results.size() == 5 &&
+                  quote.results[0] == 5 + kNumBids &&
+                  quote.results[2] == kNumBids && quote.results[3] == 1 &&
+                  unix_client.getNumPending() == 0);
+
+  printTest("Testing error codes without messages...");
+  Response low_bid, funds, missing;
+  tcp_client.call(protocol::kPlaceBid, {rug_id, alice_id, 1}, low_bid);
+  tcp_client.call(protocol::kPlaceBid, {rug_id, bob_id, 5000}, funds);
+  tcp_client.call(protocol::kGetUser, {12345}, missing);
+  printTestResult(low_bid.code == error::INVALID_BID &&
+                  low_bid.message.empty() &&
+                  funds.code == error::INSUFFICIENT_FUNDS &&
+                  missing.code == error::NOT_FOUND);
+
+  printTest("Testing error messages on request...");
+  Response taken;
+  tcp_client.call(protocol::kAddUser, {0}, taken, "Alice", true);
+  printTestResult(taken.code == error::NAME_TAKEN && !taken.message.empty());
+
+  printTest("Testing malformed requests...");
+  Response unknown, wrong_args;
+  tcp_client.call(protocol::Opcode(200), {}, unknown);
+  tcp_client.call(protocol::kPlaceBid, {rug_id}, wrong_args);
+  printTestResult(unknown.code == error::INVALID_REQUEST &&
+                  wrong_args.code == error::INVALID_REQUEST);
+
+  printTest("Testing bid retraction over the server...");
+  // Alice's last bid is retracted, which puts Bob back in the lead, and then
+  // placed again.
+  Response retracted, retracted_quote, missing_bid, rebid;
+  tcp_client.call(protocol::kRetractBid, {rug_id, kNumBids - 1}, retracted);
+  tcp_client.call(protocol::kGetQuote, {rug_id}, retracted_quote);
+  tcp_client.call(protocol::kRetractBid, {rug_id, kNumBids - 1}, missing_bid);
+  tcp_client.call(protocol::kPlaceBid, {rug_id, alice_id, 5 + kNumBids},
+                  rebid);
+  printTestResult(retracted.code == error::OK &&
+                  retracted_quote.results.at(0) == 4 + kNumBids &&
+                  retracted_quote.results.at(1) == bob_id &&
+                  retracted_quote.results.at(2) == kNumBids - 1 &&
+                  missing_bid.code == error::NOT_FOUND &&
+                  rebid.code == error::OK);
+
+  printTest("Testing sale over the server...");
+  Response sold, revenue, sold_items, user;
+  tcp_client.send(protocol::kCloseItem, {rug_id, 1});
+  tcp_client.send(protocol::kGetRevenue, {});
+  tcp_client.send(protocol::kGetSoldItems, {});
+  tcp_client.send(protocol::kGetUser, {alice_id});
+  tcp_client.receive(sold);
+  tcp_client.receive(revenue);
+  tcp_client.receive(sold_items);
+  tcp_client.receive(user);
+  // The last bid, 5 + kNumBids, is odd and so was Alice's.
+  printTestResult(sold.code == error::OK &&
+                  revenue.results.at(0) == 5 + kNumBids &&
+                  sold_items.results == std::vector<uint32_t>{rug_id} &&
+                  user.results.at(0) == 1000 - (5 + kNumBids));
+
+  server.stop();
+  server_thread.join();
+  return 0;
+}
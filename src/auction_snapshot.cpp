@@ -0,0 +1,85 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+#include <stdint.h>
+
+#include "auction_snapshot.h"
+#include "auction.h"
+#include "id_allocator.h"
+#include "paged_column.h"
+
+namespace auction_engine {
+
+AuctionSnapshot::AuctionSnapshot(const Auction& auction)
+    : sequence(auction.getBidSequence()),
+      revenue(auction.revenue),
+      names(auction.names),
+      user_id_column(auction.user_id_column),
+      user_name_column(auction.user_name_column),
+      user_funds_column(auction.user_funds_column),
+      user_hot_column(auction.user_hot_column),
+      user_num_items_column(auction.user_num_items_column),
+      item_id_column(auction.item_id_column),
+      item_name_column(auction.item_name_column),
+      item_hot_column(auction.item_hot_column) {}
+
+std::vector<uint32_t> AuctionSnapshot::getItems() const {
+  return getIds(item_id_column);
+}
+
+std::vector<uint32_t> AuctionSnapshot::getUsers() const {
+  return getIds(user_id_column);
+}
+
+std::vector<uint32_t> AuctionSnapshot::getOpenItems() const {
+  return getItemsWithState(Auction::kItemOpen);
+}
+
+std::vector<uint32_t> AuctionSnapshot::getSoldItems() const {
+  return getItemsWithState(Auction::kItemSold);
+}
+
+bool AuctionSnapshot::isOpen(uint32_t item_id) const {
+  return item_hot_column[IdAllocator::slotOf(item_id)].state &
+         Auction::kItemOpen;
+}
+
+bool AuctionSnapshot::isSold(uint32_t item_id) const {
+  return item_hot_column[IdAllocator::slotOf(item_id)].state &
+         Auction::kItemSold;
+}
+
+std::vector<uint32_t> AuctionSnapshot::getIds(
+    const PagedColumn<uint32_t>& column) {
+  std::vector<uint32_t> ids;
+  for (size_t slot=0; slot<column.size(); ++slot) {
+    if (column[slot] != IdAllocator::kInvalidId)
+      ids.push_back(column[slot]);
+  }
+  return ids;
+}
+
+std::vector<uint32_t> AuctionSnapshot::getItemsWithState(
+    uint8_t state_bits) const {
+  // Empty slots have no state bits set.
+  std::vector<uint32_t> ids;
+  for (size_t slot=0; slot<item_hot_column.size(); ++slot) {
+    if ((item_hot_column[slot].state & state_bits) == state_bits)
+      ids.push_back(item_id_column[slot]);
+  }
+  return ids;
+}
+}  // namespace auction_engine
@@ -0,0 +1,152 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+#include "id_allocator.h"
+#include "name_pool.h"
+#include "paged_column.h"
+#include "records.h"
+
+namespace auction_engine {
+
+/* Forward Declarations */
+class Auction;
+
+/**
+ * \brief A read-only view of an auction at one point in time.
+ *
+ * Returned by \c Auction::getSnapshot(). The snapshot shares the auction's
+ * copy-on-write column pages, so taking one only copies page pointers, and
+ * the auction copies a page the first time it changes it while a snapshot
+ * holds it. A snapshot can be read from any thread while the auction keeps
+ * taking bids, and every read sees the auction exactly as it was when the
+ * snapshot was taken. Pages no longer used by the auction are freed when the
+ * last snapshot holding them is destroyed.
+ *
+ * Funds of users linked to a wallet live in the shared \c WalletLedger and
+ * are not part of the snapshot; they read as zero.
+ *
+ * Functions taking an ID assume it is registered in the snapshot, which can
+ * be checked with \c isItemRegistered() and \c isUserRegistered().
+ */
+class AuctionSnapshot {
+public:
+  /// Snapshot the current state of \c auction.
+  explicit AuctionSnapshot(const Auction& auction);
+
+  /// Return the sequence number the next bid would have had. The snapshot
+  /// includes every bid with a lower sequence number and no others.
+  uint64_t getSequence() const { return sequence; }
+
+  /// Return the auction's revenue.
+  uint32_t getRevenue() const { return revenue; }
+
+  /// Return the IDs of all registered items.
+  std::vector<uint32_t> getItems() const;
+
+  /// Return the IDs of all registered users.
+  std::vector<uint32_t> getUsers() const;
+
+  /// Return the IDs of the items open for bidding.
+  std::vector<uint32_t> getOpenItems() const;
+
+  /// Return the IDs of the items sold.
+  std::vector<uint32_t> getSoldItems() const;
+
+  /// Returns \c true if \c item_id was registered.
+  bool isItemRegistered(uint32_t item_id) const {
+    const uint32_t slot = IdAllocator::slotOf(item_id);
+    return slot < item_id_column.size() && item_id_column[slot] == item_id;
+  }
+
+  /// Returns \c true if \c user_id was registered.
+  bool isUserRegistered(uint32_t user_id) const {
+    const uint32_t slot = IdAllocator::slotOf(user_id);
+    return slot < user_id_column.size() && user_id_column[slot] == user_id;
+  }
+
+  /// Return the name of an item.
+  std::string_view getItemName(uint32_t item_id) const {
+    return names->get(item_name_column[IdAllocator::slotOf(item_id)]);
+  }
+
+  /// Return an item's high bid, or its starting value if it had no bids.
+  uint32_t getCurrentValue(uint32_t item_id) const {
+    return item_hot_column[IdAllocator::slotOf(item_id)].value;
+  }
+
+  /// Return the user with the high bid on an item, or
+  /// \c IdAllocator::kInvalidId.
+  uint32_t getLeader(uint32_t item_id) const {
+    return item_hot_column[IdAllocator::slotOf(item_id)].leader;
+  }
+
+  /// Return the number of bids placed on an item.
+  uint32_t getNumBids(uint32_t item_id) const {
+    return item_hot_column[IdAllocator::slotOf(item_id)].num_bids;
+  }
+
+  /// Returns \c true if an item was open for bidding.
+  bool isOpen(uint32_t item_id) const;
+
+  /// Returns \c true if an item was sold.
+  bool isSold(uint32_t item_id) const;
+
+  /// Return the name of a user.
+  std::string_view getUserName(uint32_t user_id) const {
+    return names->get(user_name_column[IdAllocator::slotOf(user_id)]);
+  }
+
+  /// Return a user's total funds.
+  uint32_t getTotalFunds(uint32_t user_id) const {
+    return user_funds_column[IdAllocator::slotOf(user_id)];
+  }
+
+  /// Return a user's available funds.
+  uint32_t getAvailableFunds(uint32_t user_id) const {
+    return user_hot_column[IdAllocator::slotOf(user_id)].available_funds;
+  }
+
+  /// Return the number of items a user had bid on.
+  uint32_t getNumItemsBidOn(uint32_t user_id) const {
+    return user_num_items_column[IdAllocator::slotOf(user_id)];
+  }
+
+private:
+  /// Return the IDs in \c column other than \c IdAllocator::kInvalidId.
+  static std::vector<uint32_t> getIds(const PagedColumn<uint32_t>& column);
+
+  /// Return the IDs of items whose state has all of \c state_bits set.
+  std::vector<uint32_t> getItemsWithState(uint8_t state_bits) const;
+
+  uint64_t sequence;
+  uint32_t revenue;
+  std::shared_ptr<const NamePool> names;
+  PagedColumn<uint32_t> user_id_column;
+  PagedColumn<uint32_t> user_name_column;
+  PagedColumn<uint32_t> user_funds_column;
+  PagedColumn<HotUser> user_hot_column;
+  PagedColumn<uint32_t> user_num_items_column;
+  PagedColumn<uint32_t> item_id_column;
+  PagedColumn<uint32_t> item_name_column;
+  PagedColumn<HotItem> item_hot_column;
+};
+}  // namespace auction_engine
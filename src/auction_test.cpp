@@ -16,10 +16,18 @@ limitations under the License.
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
 
 #include "auction.h"
+#include "auction_snapshot.h"
 #include "bid.h"
 #include "error.h"
+#include "id_allocator.h"
 #include "item.h"
 #include "print.h"
 #include "status.h"
@@ -189,5 +197,552 @@ int main() {
 
   auction.sellItem(sunflowers->getId());
 
+  printTest("Testing Auction::placeBid() raising a bid...");
+  auction_engine::Auction raise_auction;
+  raise_auction.addUser("Alice", 100);
+  raise_auction.addUser("Bob", 100);
+  raise_auction.addItem("Rug", 10);
+  raise_auction.openItem(0);
+  raise_auction.placeBid(0, 0, 60);
+  raise_auction.placeBid(0, 1, 70);
+  // Alice can raise her bid of 60 by her 40 available funds.
+  status = raise_auction.placeBid(0, 0, 100);
+  bool raised = status.ok();
+  status = raise_auction.placeBid(0, 0, 101);
+  const auction_engine::User* raise_alice;
+  raise_auction.getUser(0, raise_alice);
+  printTestResult(raised &&
+                  auction_engine::error::IsInsufficientFunds(status) &&
+                  raise_alice->getAvailableFunds() == 0);
+
+  printTest("Testing Auction::enableArchive()...");
+  const char* archive_path = "auction_test_archive.bin";
+  auction_engine::Auction archived_auction;
+  status = archived_auction.enableArchive(archive_path);
+  archived_auction.addUser("Alice", 1000);
+  archived_auction.addUser("Bob", 1000);
+  archived_auction.addItem("Rug", 10);
+  archived_auction.openItem(0);
+  archived_auction.placeBid(0, 0, 100);
+  archived_auction.placeBid(0, 1, 200);
+  archived_auction.placeBid(0, 0, 300);
+  archived_auction.sellItem(0);
+  const auction_engine::Item* archived_rug;
+  const auction_engine::User* archived_alice, *archived_bob;
+  archived_auction.getItem(0, archived_rug);
+  archived_auction.getUser(0, archived_alice);
+  archived_auction.getUser(1, archived_bob);
+  printTestResult(status.ok() && archived_rug->isArchived() &&
+                  archived_rug->getBids().size() == 3 &&
+                  archived_rug->getCurrentValue() == 300 &&
+                  archived_alice->getBids().size() == 2 &&
+                  archived_alice->getBidValueOnItem(0) == 300 &&
+                  archived_alice->getTotalFunds() == 700 &&
+                  archived_bob->getAvailableFunds() == 1000 &&
+                  archived_bob->getItemsBidOn().size() == 1);
+  std::remove(archive_path);
+
+  printTest("Testing Auction::removeItem()...");
+  auction_engine::Auction removal_auction;
+  removal_auction.addUser("Alice", 1000);
+  removal_auction.addUser("Bob", 1000);
+  removal_auction.addItem("Rug", 10);
+  removal_auction.addItem("Ficus", 10);
+  removal_auction.openItem(0);
+  removal_auction.placeBid(0, 0, 100);
+  removal_auction.placeBid(0, 1, 200);
+  status = removal_auction.removeItem(0);
+  bool open_rejected = auction_engine::error::IsItemUnavailable(status);
+  removal_auction.closeItem(0);
+  status = removal_auction.removeItem(0);
+  const auction_engine::User* removal_bob;
+  removal_auction.getUser(1, removal_bob);
+  printTestResult(open_rejected && status.ok() &&
+                  !removal_auction.isItemRegistered(0) &&
+                  removal_auction.isOpen(0) == false &&
+                  removal_auction.getItems().size() == 1 &&
+                  removal_bob->getAvailableFunds() == 1000 &&
+                  removal_bob->getItemsBidOn().empty());
+
+  printTest("Testing Auction::removeUser()...");
+  removal_auction.openItem(1);
+  removal_auction.placeBid(1, 0, 50);
+  status = removal_auction.removeUser(0);
+  bool active_rejected = auction_engine::error::IsUserActive(status);
+  status = removal_auction.removeUser(1);
+  printTestResult(active_rejected && status.ok() &&
+                  removal_auction.isUserRegistered(0) &&
+                  !removal_auction.isUserRegistered(1));
+
+  printTest("Testing ID recycling...");
+  removal_auction.addItem("Sunflowers", 10);
+  std::vector<uint32_t> recycled_items = removal_auction.getItems();
+  const auction_engine::Item* sunflowers_item;
+  removal_auction.getItem(recycled_items[0], sunflowers_item);
+  status = removal_auction.placeBid(0, 0, 100);
+  printTestResult(recycled_items.size() == 2 &&
+                  recycled_items[0] != 0 &&
+                  sunflowers_item->getName() == "Sunflowers" &&
+                  auction_engine::error::IsNotFound(status));
+
+  printTest("Testing Auction::compact()...");
+  removal_auction.closeItem(1, true);
+  removal_auction.removeItem(recycled_items[0]);
+  removal_auction.compact();
+  printTestResult(removal_auction.getItems().size() == 1 &&
+                  removal_auction.isSold(1) &&
+                  removal_auction.getRevenue() == 50);
+
+  printTest("Testing name reuse...");
+  status = removal_auction.addItem("Ficus", 10);
+  bool taken_rejected = auction_engine::error::IsNameTaken(status);
+  status = removal_auction.addUser("Bob", 500);
+  std::vector<uint32_t> reused_users = removal_auction.getUsers();
+  const auction_engine::User* new_bob;
+  removal_auction.getUser(reused_users[1], new_bob);
+  status = removal_auction.addItem("Bob", 10);
+  const auction_engine::Item* bob_item;
+  removal_auction.getItem(removal_auction.getItems()[0], bob_item);
+  printTestResult(taken_rejected && status.ok() && reused_users.size() == 2 &&
+                  new_bob->getName() == "Bob" &&
+                  new_bob->getTotalFunds() == 500 &&
+                  bob_item->getName().data() == new_bob->getName().data());
+
+  printTest("Testing Auction::recycleRetiredIds()...");
+  auction_engine::Auction rolling_auction;
+  uint32_t rolling_id = 0;
+  for (uint32_t i=0; i<=auction_engine::IdAllocator::kMaxGeneration; ++i) {
+    rolling_auction.addUser("Daily", 10);
+    rolling_auction.findUser("Daily", rolling_id);
+    rolling_auction.removeUser(rolling_id);
+  }
+  const uint32_t last_generation_id = rolling_id;
+  uint32_t retired_id = 0, recycled_id = 0;
+  rolling_auction.addUser("Retired", 10);
+  rolling_auction.findUser("Retired", retired_id);
+  rolling_auction.recycleRetiredIds();
+  rolling_auction.addUser("Recycled", 10);
+  rolling_auction.findUser("Recycled", recycled_id);
+  using auction_engine::IdAllocator;
+  printTestResult(IdAllocator::slotOf(last_generation_id) == 0 &&
+                  IdAllocator::slotOf(retired_id) == 1 &&
+                  recycled_id == 0 &&
+                  !rolling_auction.isUserRegistered(last_generation_id));
+
+  printTest("Testing Auction::findUser() and findItem()...");
+  uint32_t found_user, found_item, unused_id;
+  bool found = removal_auction.findUser("Bob", found_user).ok() &&
+               removal_auction.findItem("Bob", found_item).ok();
+  status = removal_auction.findUser("Nobody", unused_id);
+  printTestResult(found && found_user == new_bob->getId() &&
+                  found_item == bob_item->getId() &&
+                  auction_engine::error::IsNotFound(status));
+
+  printTest("Testing Auction::getQuote()...");
+  auction_engine::Auction quote_auction;
+  quote_auction.addUser("Alice", 1000000);
+  quote_auction.addUser("Bob", 1000000);
+  quote_auction.addItem("Rug", 0);
+  quote_auction.openItem(0);
+  // Bids alternate between Alice and Bob and go up by one, so a consistent
+  // quote's value, leader and number of bids always agree.
+  std::atomic<bool> bidding(true);
+  std::atomic<bool> consistent(true);
+  std::thread reader([&]() {
+    auction_engine::Quote quote;
+    while (bidding.load()) {
+      if (!quote_auction.getQuote(0, quote).ok() ||
+          quote.value != quote.num_bids ||
+          (quote.num_bids && quote.leader != (quote.num_bids - 1) % 2))
+        consistent.store(false);
+    }
+  });
+  for (uint32_t value=1; value<=20000; ++value)
+    quote_auction.placeBid(0, (value - 1) % 2, value);
+  bidding.store(false);
+  reader.join();
+  quote_auction.closeItem(0, true);
+  auction_engine::Quote sold_quote, missing_quote;
+  quote_auction.getQuote(0, sold_quote);
+  status = quote_auction.getQuote(1, missing_quote);
+  printTestResult(consistent.load() && sold_quote.sold && !sold_quote.open &&
+                  sold_quote.num_bids == 20000 &&
+                  auction_engine::error::IsNotFound(status));
+
+  printTest("Testing Auction::getSnapshot()...");
+  auction_engine::Auction snapshot_auction;
+  snapshot_auction.addUser("Alice", 1000000);
+  snapshot_auction.addUser("Bob", 10000000);
+  // Enough items to fill several column pages.
+  for (uint32_t i=0; i<3000; ++i) {
+    snapshot_auction.addItem("Item " + std::to_string(i), i);
+    snapshot_auction.openItem(i);
+  }
+  snapshot_auction.placeBid(0, 0, 10);
+  std::shared_ptr<const auction_engine::AuctionSnapshot> snapshot =
+      snapshot_auction.getSnapshot();
+  // Read the snapshot on another thread while bidding and selling go on.
+  std::atomic<bool> unchanged(true);
+  std::thread snapshot_reader([&]() {
+    for (int pass=0; pass<20; ++pass) {
+      if (snapshot->getItems().size() != 3000 ||
+          snapshot->getOpenItems().size() != 3000 ||
+          !snapshot->getSoldItems().empty() ||
+          snapshot->getCurrentValue(0) != 10 ||
+          snapshot->getLeader(0) != 0 ||
+          snapshot->getCurrentValue(2999) != 2999 ||
+          snapshot->getAvailableFunds(1) != 10000000)
+        unchanged.store(false);
+    }
+  });
+  for (uint32_t i=0; i<3000; ++i)
+    snapshot_auction.placeBid(i, 1, i + 20);
+  snapshot_auction.closeItem(0, true);
+  snapshot_auction.addItem("Late", 0);
+  snapshot_reader.join();
+  const auction_engine::Item* first_item;
+  snapshot_auction.getItem(0, first_item);
+  printTestResult(unchanged.load() && snapshot->getSequence() == 1 &&
+                  snapshot->getItemName(0) == "Item 0" &&
+                  snapshot->getNumItemsBidOn(0) == 1 &&
+                  !snapshot->isItemRegistered(3000) &&
+                  first_item->getCurrentValue() == 20 &&
+                  snapshot_auction.isSold(0) &&
+                  snapshot_auction.getBidSequence() == 3001);
+
+  printTest("Testing Auction::openDutchItem()...");
+  auction_engine::Auction dutch_auction;
+  dutch_auction.addUser("Alice", 500);
+  dutch_auction.addUser("Bob", 50);
+  dutch_auction.addItem("Clock", 0);
+  dutch_auction.addItem("Vase", 0);
+  dutch_auction.addItem("Bowl", 0);
+  dutch_auction.openItem(2);
+  dutch_auction.placeBid(2, 0, 5);
+  dutch_auction.closeItem(2);
+  // The clock's price does not move within an hour; the vase's drops to its
+  // floor straight away.
+  status = dutch_auction.openDutchItem(0, 400, 100, 10, std::chrono::hours(1));
+  auction_engine::Status vase_status = dutch_auction.openDutchItem(
+      1, 900, 40, 100, std::chrono::nanoseconds(1));
+  auction_engine::Status bad_floor = dutch_auction.openDutchItem(
+      2, 10, 20, 1, std::chrono::seconds(1));
+  auction_engine::Status has_bids = dutch_auction.openDutchItem(
+      2, 20, 10, 1, std::chrono::seconds(1));
+  auction_engine::Status reopened = dutch_auction.openDutchItem(
+      0, 400, 100, 10, std::chrono::hours(1));
+  auction_engine::Status bid_status = dutch_auction.placeBid(0, 0, 450);
+  uint32_t clock_price = 0, vase_price = 0;
+  dutch_auction.getDutchPrice(0, clock_price);
+  dutch_auction.getDutchPrice(1, vase_price);
+  auction_engine::DutchClock clock;
+  dutch_auction.getDutchClock(0, clock);
+  printTestResult(status.ok() && vase_status.ok() &&
+                  auction_engine::error::IsInvalidRequest(bad_floor) &&
+                  auction_engine::error::IsItemUnavailable(has_bids) &&
+                  auction_engine::error::IsItemUnavailable(reopened) &&
+                  auction_engine::error::IsInvalidBid(bid_status) &&
+                  dutch_auction.isOpen(0) && clock_price == 400 &&
+                  vase_price == 40 &&
+                  clock.getPrice(clock.start + std::chrono::hours(3)) == 370 &&
+                  clock.getPrice(clock.start + std::chrono::hours(500)) ==
+                      100);
+
+  printTest("Testing Auction::acceptDutchPrice()...");
+  uint32_t paid = 0;
+  auction_engine::Status poor = dutch_auction.acceptDutchPrice(0, 1, paid);
+  status = dutch_auction.acceptDutchPrice(0, 0, paid);
+  uint32_t late_paid = 0;
+  auction_engine::Status late = dutch_auction.acceptDutchPrice(0, 1,
+                                                               late_paid);
+  uint32_t vase_paid = 0;
+  vase_status = dutch_auction.acceptDutchPrice(1, 1, vase_paid);
+  auction_engine::Status no_clock = dutch_auction.getDutchPrice(0,
+                                                                clock_price);
+  const auction_engine::User* clock_buyer;
+  const auction_engine::User* vase_buyer;
+  dutch_auction.getUser(0, clock_buyer);
+  dutch_auction.getUser(1, vase_buyer);
+  printTestResult(auction_engine::error::IsInsufficientFunds(poor) &&
+                  status.ok() && paid == 400 &&
+                  auction_engine::error::IsItemUnavailable(late) &&
+                  vase_status.ok() && vase_paid == 40 &&
+                  auction_engine::error::IsItemUnavailable(no_clock) &&
+                  dutch_auction.isSold(0) && dutch_auction.isSold(1) &&
+                  !dutch_auction.isOpen(0) &&
+                  dutch_auction.getRevenue() == 440 &&
+                  // Alice's bid on the unsold bowl still holds 5.
+                  clock_buyer->getTotalFunds() == 100 &&
+                  clock_buyer->getAvailableFunds() == 95 &&
+                  vase_buyer->getTotalFunds() == 10 && late_paid == 0);
+
+  printTest("Testing clearUniformPrice()...");
+  std::vector<auction_engine::QuantityBid> quantity_bids = {
+      {0, 3, 10, 0}, {1, 4, 12, 1}, {2, 5, 10, 2}, {3, 2, 9, 3}};
+  std::vector<uint32_t> filled;
+  const uint32_t clearing_price =
+      auction_engine::clearUniformPrice(9, quantity_bids, filled);
+  std::vector<uint32_t> none_filled;
+  printTestResult(clearing_price == 10 &&
+                  filled == std::vector<uint32_t>({3, 4, 2, 0}) &&
+                  auction_engine::clearUniformPrice(9, {}, none_filled) == 0 &&
+                  none_filled.empty());
+
+  printTest("Testing Auction::placeQuantityBid()...");
+  auction_engine::Auction unit_auction;
+  unit_auction.addUser("Alice", 1000);
+  unit_auction.addUser("Bob", 1000);
+  unit_auction.addUser("Carol", 100);
+  unit_auction.addUser("Dave", 200);
+  unit_auction.addItem("Tickets", 5);
+  unit_auction.addItem("Poster", 0);
+  status = unit_auction.openMultiUnitItem(0, 10);
+  auction_engine::Status no_units = unit_auction.openMultiUnitItem(1, 0);
+  unit_auction.openItem(1);
+  auction_engine::Status ordinary = unit_auction.placeQuantityBid(1, 0, 1, 5);
+  bool bids_ok = unit_auction.placeQuantityBid(0, 0, 4, 20).ok() &&
+                 unit_auction.placeQuantityBid(0, 1, 5, 15).ok() &&
+                 unit_auction.placeQuantityBid(0, 2, 3, 15).ok() &&
+                 unit_auction.placeQuantityBid(0, 3, 5, 10).ok();
+  auction_engine::Status below_reserve =
+      unit_auction.placeQuantityBid(0, 1, 2, 4);
+  auction_engine::Status too_many = unit_auction.placeQuantityBid(0, 0, 11, 10);
+  auction_engine::Status too_costly =
+      unit_auction.placeQuantityBid(0, 2, 10, 20);
+  auction_engine::Status single_bid = unit_auction.placeBid(0, 0, 50);
+  auction_engine::Status active = unit_auction.removeUser(2);
+  const auction_engine::User* partial_bidder;
+  unit_auction.getUser(2, partial_bidder);
+  printTestResult(status.ok() && bids_ok &&
+                  auction_engine::error::IsInvalidRequest(no_units) &&
+                  auction_engine::error::IsInvalidBid(ordinary) &&
+                  auction_engine::error::IsInvalidBid(below_reserve) &&
+                  auction_engine::error::IsInvalidBid(too_many) &&
+                  auction_engine::error::IsInsufficientFunds(too_costly) &&
+                  auction_engine::error::IsInvalidBid(single_bid) &&
+                  auction_engine::error::IsUserActive(active) &&
+                  partial_bidder->getAvailableFunds() == 55 &&
+                  unit_auction.getTotalCommittedFunds() == 250);
+
+  printTest("Testing uniform-price clearing of an item...");
+  status = unit_auction.closeItem(0, true);
+  const auction_engine::MultiUnitLot* lot = nullptr;
+  unit_auction.getMultiUnitLot(0, lot);
+  const auction_engine::User* unit_users[4];
+  for (uint32_t i=0; i<4; ++i)
+    unit_auction.getUser(i, unit_users[i]);
+  // Alice and Bob are filled in full and Carol gets the last unit, all at
+  // the lowest filled price; Dave's lower bid gets nothing.
+  printTestResult(status.ok() && lot && lot->clearing_price == 15 &&
+                  lot->allocations.size() == 3 &&
+                  lot->allocations[2].user_id == 2 &&
+                  lot->allocations[2].quantity == 1 &&
+                  lot->allocations[2].cost == 15 &&
+                  unit_auction.getRevenue() == 150 &&
+                  unit_users[0]->getTotalFunds() == 940 &&
+                  unit_users[0]->getAvailableFunds() == 940 &&
+                  unit_users[1]->getTotalFunds() == 925 &&
+                  unit_users[2]->getTotalFunds() == 85 &&
+                  unit_users[2]->getAvailableFunds() == 85 &&
+                  unit_users[2]->getItemsWon() == std::vector<uint32_t>{0} &&
+                  unit_users[3]->getTotalFunds() == 200 &&
+                  unit_users[3]->getAvailableFunds() == 200 &&
+                  unit_users[3]->getItemsWon().empty() &&
+                  unit_auction.getTotalCommittedFunds() == 0 &&
+                  unit_auction.removeUser(2).ok() &&
+                  unit_auction.removeItem(0).ok());
+
+  printTest("Testing Auction::getItemAnalytics()...");
+  auction_engine::Auction stats_auction;
+  stats_auction.addUser("Alice", 1000);
+  stats_auction.addUser("Bob", 1000);
+  stats_auction.addItem("Globe", 10);
+  stats_auction.addItem("Atlas", 0);
+  const auto hour_before = std::chrono::duration_cast<std::chrono::hours>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  stats_auction.openItem(0);
+  stats_auction.openItem(1);
+  // Increments of 10, 5 and 15 from the starting value of 10.
+  stats_auction.placeBid(0, 0, 20);
+  stats_auction.placeBid(0, 1, 25);
+  stats_auction.placeBid(0, 0, 40);
+  stats_auction.placeBid(0, 1, 30);
+  stats_auction.closeItem(0, true);
+  auction_engine::ItemAnalytics globe, atlas;
+  status = stats_auction.getItemAnalytics(0, globe);
+  stats_auction.getItemAnalytics(1, atlas);
+  auction_engine::Status missing_stats = stats_auction.getItemAnalytics(7, atlas);
+  const auto hour_after = std::chrono::duration_cast<std::chrono::hours>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  const std::map<int64_t, uint64_t>& by_hour =
+      stats_auction.getRevenueByHour();
+  printTestResult(status.ok() && globe.num_bids == 3 &&
+                  globe.num_bidders == 2 && globe.total_increment == 30 &&
+                  globe.getAverageIncrement() == 10 &&
+                  globe.first_bid >= globe.opened &&
+                  globe.getTimeToFirstBid() >=
+                      std::chrono::system_clock::duration::zero() &&
+                  atlas.num_bids == 0 && atlas.num_bidders == 0 &&
+                  atlas.getAverageIncrement() == 0 &&
+                  atlas.opened >= globe.opened &&
+                  atlas.getTimeToFirstBid() ==
+                      std::chrono::system_clock::duration::zero() &&
+                  auction_engine::error::IsNotFound(missing_stats) &&
+                  by_hour.size() == 1 &&
+                  by_hour.begin()->first >= hour_before &&
+                  by_hour.begin()->first <= hour_after &&
+                  by_hour.begin()->second == 40);
+
+  printTest("Testing Auction::getMemoryUsage()...");
+  const char* budget_path = "auction_test_budget.bin";
+  auction_engine::Auction budget_auction;
+  const auction_engine::MemoryUsage empty_usage =
+      budget_auction.getMemoryUsage();
+  status = budget_auction.setMemoryBudget(1 << 20);
+  const bool needs_archive = auction_engine::error::IsInvalidRequest(status);
+  budget_auction.enableArchive(budget_path);
+  budget_auction.addUser("Alice", 1000000);
+  budget_auction.addUser("Bob", 1000000);
+  for (uint32_t i=0; i<4; ++i) {
+    budget_auction.addItem("Lot " + std::to_string(i), 0);
+    budget_auction.openItem(i);
+    for (uint32_t value=1; value<=200; ++value)
+      budget_auction.placeBid(i, value % 2, value);
+  }
+  const auction_engine::MemoryUsage bid_usage =
+      budget_auction.getMemoryUsage();
+  printTestResult(needs_archive && empty_usage.bids == 0 &&
+                  bid_usage.bids >= 800 * sizeof(auction_engine::Bid) &&
+                  bid_usage.items > empty_usage.items &&
+                  bid_usage.users > empty_usage.users &&
+                  bid_usage.indexes > empty_usage.indexes &&
+                  bid_usage.strings > empty_usage.strings &&
+                  bid_usage.getTotal() ==
+                      bid_usage.items + bid_usage.users + bid_usage.bids +
+                      bid_usage.indexes + bid_usage.strings);
+
+  printTest("Testing Auction::setMemoryBudget()...");
+  // With room to spare, sold items keep their bids in memory.
+  status = budget_auction.setMemoryBudget(size_t(1) << 40);
+  for (uint32_t i=0; i<4; ++i)
+    budget_auction.sellItem(i);
+  const auction_engine::Item* lots[4];
+  bool kept = status.ok();
+  for (uint32_t i=0; i<4; ++i) {
+    budget_auction.getItem(i, lots[i]);
+    kept = kept && !lots[i]->isArchived();
+  }
+  // Half the bids must go, so the two lots sold first are archived.
+  const auction_engine::MemoryUsage sold_usage =
+      budget_auction.getMemoryUsage();
+  const size_t budget = sold_usage.getTotal() - sold_usage.bids / 2;
+  status = budget_auction.setMemoryBudget(budget);
+  const bool trimmed = status.ok() && lots[0]->isArchived() &&
+                       lots[1]->isArchived() && !lots[2]->isArchived() &&
+                       !lots[3]->isArchived() &&
+                       budget_auction.getMemoryUsage().getTotal() <= budget &&
+                       lots[0]->getBids().size() == 200;
+  status = budget_auction.setMemoryBudget(0);
+  printTestResult(kept && trimmed && status.ok() && lots[2]->isArchived() &&
+                  lots[3]->isArchived() &&
+                  budget_auction.getMemoryUsage().bids == 0 &&
+                  lots[3]->getCurrentValue() == 200);
+  std::remove(budget_path);
+
+  printTest("Testing Auction::retractBid()...");
+  auction_engine::Auction retract_auction;
+  retract_auction.addUser("Alice", 1000);
+  retract_auction.addUser("Bob", 1000);
+  retract_auction.addItem("Rug", 10);
+  retract_auction.openItem(0);
+  retract_auction.placeBid(0, 0, 100);
+  retract_auction.placeBid(0, 1, 200);
+  retract_auction.placeBid(0, 0, 300);
+  retract_auction.placeBid(0, 1, 400);
+  const auction_engine::Item* retract_rug;
+  const auction_engine::User* retract_alice, *retract_bob;
+  retract_auction.getItem(0, retract_rug);
+  retract_auction.getUser(0, retract_alice);
+  retract_auction.getUser(1, retract_bob);
+  // Bob's leading bid goes, and Alice leads again with her 300.
+  status = retract_auction.retractBid(0, 3);
+  const bool leader_restored =
+      status.ok() && retract_rug->getCurrentValue() == 300 &&
+      retract_rug->getCurrentBid()->user_id == 0 &&
+      retract_rug->getNumBids() == 3 &&
+      retract_bob->getAvailableFunds() == 800 &&
+      retract_bob->getBidValueOnItem(0) == 200;
+  // Alice's standing bid goes too, so her 100 stands and leads alone once
+  // Bob's other bid is retracted.
+  retract_auction.retractBid(0, 2);
+  retract_auction.retractBid(0, 1);
+  auction_engine::ItemAnalytics retract_analytics;
+  retract_auction.getItemAnalytics(0, retract_analytics);
+  auction_engine::Quote retract_quote;
+  retract_auction.getQuote(0, retract_quote);
+  printTestResult(leader_restored && retract_rug->getCurrentValue() == 100 &&
+                  retract_rug->getNumBids() == 1 &&
+                  retract_alice->getAvailableFunds() == 900 &&
+                  retract_bob->getAvailableFunds() == 1000 &&
+                  retract_bob->getItemsBidOn().empty() &&
+                  retract_quote.leader == 0 && retract_quote.value == 100 &&
+                  retract_quote.num_bids == 1 &&
+                  retract_analytics.num_bids == 1 &&
+                  retract_analytics.num_bidders == 1 &&
+                  retract_analytics.total_increment == 90);
+
+  printTest("Testing Auction::retractBid() errors...");
+  auction_engine::Status missing_bid = retract_auction.retractBid(0, 3);
+  auction_engine::Status missing_item = retract_auction.retractBid(7, 0);
+  // Retracted numbers are not reused.
+  retract_auction.placeBid(0, 1, 150);
+  const uint32_t next_number = retract_rug->getCurrentBid()->number;
+  retract_auction.retractBid(0, 0);
+  const bool to_starting_value =
+      retract_auction.retractBid(0, 4).ok() &&
+      retract_rug->getCurrentValue() == 10 &&
+      retract_rug->getCurrentBid() == nullptr &&
+      retract_alice->getAvailableFunds() == 1000 &&
+      retract_bob->getAvailableFunds() == 1000;
+  retract_auction.placeBid(0, 0, 50);
+  retract_auction.closeItem(0, true);
+  auction_engine::Status sold_bid = retract_auction.retractBid(0, 5);
+  printTestResult(auction_engine::error::IsNotFound(missing_bid) &&
+                  auction_engine::error::IsNotFound(missing_item) &&
+                  next_number == 4 && to_starting_value &&
+                  auction_engine::error::IsItemUnavailable(sold_bid) &&
+                  retract_alice->getTotalFunds() == 950);
+
+  printTest("Testing Auction::retractBid() on many bids...");
+  auction_engine::Auction busy_auction;
+  busy_auction.addUser("Alice", 1000000);
+  busy_auction.addUser("Bob", 1000000);
+  busy_auction.addItem("Clock", 0);
+  busy_auction.openItem(0);
+  const uint32_t kNumRetractBids = 50000;
+  for (uint32_t value=1; value<=kNumRetractBids; ++value)
+    busy_auction.placeBid(0, value % 2, value);
+  // Unwind the last thousand leaders, then drop one bid from the middle.
+  bool unwound = true;
+  for (uint32_t number=kNumRetractBids-1; number>=kNumRetractBids-1000;
+       --number) {
+    unwound = unwound && busy_auction.retractBid(0, number).ok();
+  }
+  busy_auction.retractBid(0, 20000);
+  const auction_engine::Item* busy_clock;
+  const auction_engine::User* busy_alice, *busy_bob;
+  busy_auction.getItem(0, busy_clock);
+  busy_auction.getUser(0, busy_alice);
+  busy_auction.getUser(1, busy_bob);
+  printTestResult(unwound &&
+                  busy_clock->getNumBids() == kNumRetractBids - 1001 &&
+                  busy_clock->getCurrentValue() == kNumRetractBids - 1000 &&
+                  busy_clock->getCurrentBid()->user_id == 0 &&
+                  busy_clock->getBid(20000)->number == 20001 &&
+                  busy_alice->getAvailableFunds() ==
+                      1000000 - (kNumRetractBids - 1000) &&
+                  busy_bob->getAvailableFunds() ==
+                      1000000 - (kNumRetractBids - 1001));
+
   return 0;
 }
@@ -26,8 +26,10 @@ namespace auction_engine {
  */
 struct Bid {
   /// Create bid.
-  Bid(uint32_t value, uint32_t user_id, uint32_t item_id, uint16_t number)
-      : value(value), user_id(user_id), item_id(item_id), number(number) {}
+  Bid(uint32_t value, uint32_t user_id, uint32_t item_id, uint32_t number,
+      uint64_t sequence=0)
+      : value(value), user_id(user_id), item_id(item_id), number(number),
+        sequence(sequence) {}
 
   /// Value of the bid.
   uint32_t value;
@@ -39,7 +41,11 @@ struct Bid {
   uint32_t item_id;
 
   /// Number of the bid for the item it was placed on.
-  uint16_t number;
+  uint32_t number;
+
+  /// Position of the bid among all bids accepted by the auction, or by every
+  /// auction sharing its \c Sequencer.
+  uint64_t sequence;
 
   bool operator==(const Bid& rhs) { return value == rhs.value; }
 
@@ -53,4 +59,15 @@ struct Bid {
 
   bool operator>=(const Bid& rhs) { return value >= rhs.value; }
 };
+
+static_assert(sizeof(Bid) == 24, "Bid records are archived and exported raw");
+
+/// A bid not yet placed, waiting to be applied with others on the same item.
+struct PendingBid {
+  /// User placing the bid.
+  uint32_t user_id;
+
+  /// Value of the bid.
+  uint32_t value;
+};
 }  // namespace auction_engine
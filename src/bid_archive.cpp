@@ -0,0 +1,141 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "bid.h"
+#include "bid_archive.h"
+#include "error.h"
+#include "status.h"
+
+namespace auction_engine {
+namespace {
+
+static_assert(std::is_trivially_copyable<Bid>::value,
+              "Bids are archived as raw records.");
+
+/// Address space reserved per segment. Only the part backed by the file is
+/// ever touched, so this costs nothing until it is written.
+const uint64_t kSegmentReserve = uint64_t(1) << 36;
+/// The file is grown in steps of this size to keep ftruncate() calls rare.
+const uint64_t kFileGrowth = uint64_t(1) << 22;
+
+inline uint64_t roundUp(uint64_t size, uint64_t multiple) {
+  return (size + multiple - 1) / multiple * multiple;
+}
+}  // namespace
+
+BidArchive::BidArchive() : fd(-1), file_size(0), bytes_used(0) {}
+
+BidArchive::~BidArchive() { close(); }
+
+void BidArchive::close() {
+  if (fd < 0)
+    return;
+  // Drop the unused tail of the last growth step. A file that is longer than
+  // needed is harmless, so failure is ignored.
+  if (!segments.empty()) {
+    const Segment& last = segments.back();
+    int ignored = ftruncate(fd, last.offset + last.used);
+    (void) ignored;
+  }
+  for (const Segment& segment: segments)
+    munmap(segment.addr, segment.reserved);
+  segments.clear();
+  ::close(fd);
+  fd = -1;
+}
+
+Status BidArchive::open(const std::string& path) {
+  close();
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return error::IoError("Unable to open bid archive \"", path, "\": ",
+                          std::strerror(errno));
+  }
+  this->path = path;
+  file_size = 0;
+  bytes_used = 0;
+  return Status::OK();
+}
+
+Status BidArchive::addSegment(uint64_t size) {
+  const uint64_t page_size = sysconf(_SC_PAGESIZE);
+  const uint64_t end = segments.empty() ? 0 :
+      segments.back().offset + segments.back().used;
+  const uint64_t offset = roundUp(end, page_size);
+  const uint64_t reserved = std::max(kSegmentReserve, roundUp(size, page_size));
+  void* addr = mmap(nullptr, reserved, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_NORESERVE, fd, offset);
+  if (addr == MAP_FAILED) {
+    return error::IoError("Unable to map bid archive \"", path, "\": ",
+                          std::strerror(errno));
+  }
+  segments.push_back({static_cast<char*>(addr), offset, reserved, 0});
+  return Status::OK();
+}
+
+Status BidArchive::reserveFile(uint64_t size) {
+  const Segment& segment = segments.back();
+  const uint64_t needed = segment.offset + size;
+  if (needed <= file_size)
+    return Status::OK();
+  const uint64_t new_size = std::min(roundUp(needed, kFileGrowth),
+                                     segment.offset + segment.reserved);
+  if (ftruncate(fd, new_size) != 0) {
+    return error::IoError("Unable to grow bid archive \"", path, "\": ",
+                          std::strerror(errno));
+  }
+  file_size = new_size;
+  return Status::OK();
+}
+
+Status BidArchive::append(const std::vector<const Bid*>& bids,
+                          const Bid*& archived) {
+  if (!isOpen()) {
+    return error::IoError("Bid archive is not open.");
+  }
+
+  const uint64_t size = bids.size() * sizeof(Bid);
+  if (segments.empty() ||
+      segments.back().used + size > segments.back().reserved) {
+    Status status = addSegment(size);
+    if (!status.ok())
+      return status;
+  }
+
+  Segment& segment = segments.back();
+  Status status = reserveFile(segment.used + size);
+  if (!status.ok())
+    return status;
+
+  Bid* out = reinterpret_cast<Bid*>(segment.addr + segment.used);
+  for (size_t i=0; i<bids.size(); ++i)
+    std::memcpy(&out[i], bids[i], sizeof(Bid));
+  segment.used += size;
+  bytes_used += size;
+  archived = out;
+  return Status::OK();
+}
+}  // namespace auction_engine
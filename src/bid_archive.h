@@ -0,0 +1,103 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "bid.h"
+#include "status.h"
+
+namespace auction_engine {
+
+/**
+ * \brief Append-only, memory-mapped store for bid histories.
+ *
+ * Bids are copied into a file as raw \c Bid records and read back through a
+ * shared mapping of that file, so archived history lives in the page cache
+ * instead of on the heap. The file is mapped in large reserved segments that
+ * are never moved or unmapped while the archive is open, so pointers returned
+ * by \c append() stay valid for the lifetime of the archive.
+ */
+class BidArchive {
+public:
+  BidArchive();
+  ~BidArchive();
+
+  BidArchive(const BidArchive&) = delete;
+  BidArchive& operator=(const BidArchive&) = delete;
+
+  /**
+   * \brief Create the archive file.
+   *
+   * Any existing file at \c path is truncated.
+   *
+   * \param path
+   *    Path of the archive file.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status open(const std::string& path);
+
+  /// Returns \c true if the archive file is open.
+  bool isOpen() const { return fd >= 0; }
+
+  /**
+   * \brief Append a run of bids to the archive.
+   *
+   * \param bids
+   *    The bids to copy into the archive, in order.
+   *
+   * \param archived
+   *    Set to the first archived record. The run is contiguous, so record
+   *    \c i is at \c archived[i].
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status append(const std::vector<const Bid*>& bids, const Bid*& archived);
+
+  /// Return the number of bytes of bid records written to the archive.
+  uint64_t getBytesUsed() const { return bytes_used; }
+
+private:
+  /// One reserved mapping of the file.
+  struct Segment {
+    char* addr;
+    /// File offset the segment is mapped at.
+    uint64_t offset;
+    /// Bytes of address space reserved for the segment.
+    uint64_t reserved;
+    /// Bytes of the segment written so far.
+    uint64_t used;
+  };
+
+  /// Map a new segment able to hold at least \c size bytes.
+  Status addSegment(uint64_t size);
+
+  /// Grow the file so it covers the first \c size bytes of the last segment.
+  Status reserveFile(uint64_t size);
+
+  void close();
+
+  int fd;
+  std::string path;
+  std::vector<Segment> segments;
+  /// Current size of the file.
+  uint64_t file_size;
+  uint64_t bytes_used;
+};
+}  // namespace auction_engine
@@ -0,0 +1,240 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+
+#include "bid.h"
+#include "bid_export.h"
+#include "auction.h"
+#include "item.h"
+#include "error.h"
+#include "status.h"
+
+namespace auction_engine {
+namespace {
+
+const char kMagic[8] = {'A', 'E', 'B', 'I', 'D', 'C', 'O', 'L'};
+const uint32_t kVersion = 2;
+
+struct ColumnDesc {
+  uint32_t column_id;
+  uint32_t width;
+};
+
+const ColumnDesc kColumns[] = {
+  {kBidColumnValue, sizeof(uint32_t)},
+  {kBidColumnUserId, sizeof(uint32_t)},
+  {kBidColumnItemId, sizeof(uint32_t)},
+  {kBidColumnNumber, sizeof(uint32_t)},
+  {kBidColumnSequence, sizeof(uint64_t)},
+};
+const uint32_t kNumColumns = sizeof(kColumns) / sizeof(kColumns[0]);
+
+inline size_t padding(size_t size) { return (8 - size % 8) % 8; }
+
+template <typename T>
+Status readColumn(std::istream& in, uint32_t num_rows, std::vector<T>& column) {
+  size_t offset = column.size();
+  column.resize(offset + num_rows);
+  size_t size = num_rows * sizeof(T);
+  char pad[8];
+  in.read(reinterpret_cast<char*>(column.data() + offset), size);
+  in.read(pad, padding(size));
+  if (!in) {
+    return error::IoError("Bid export ended in the middle of a block.");
+  }
+  return Status::OK();
+}
+}  // namespace
+
+BidExporter::BidExporter(const Auction& auction, std::ostream& out,
+                         BidExportOptions options)
+    : auction(auction),
+      out(out),
+      options(options),
+      item_index(0),
+      next_sequence(options.first_sequence),
+      end_sequence(std::min(options.last_sequence, auction.getBidSequence())),
+      header_written(false),
+      finished(false),
+      rows_written(0) {
+  item_ids = options.item_ids.empty() ? auction.getItems() : options.item_ids;
+  if (options.sold_only) {
+    item_ids.erase(std::remove_if(item_ids.begin(), item_ids.end(),
+        [&auction](uint32_t id) { return !auction.isSold(id); }),
+        item_ids.end());
+  }
+  if (this->options.block_rows == 0)
+    this->options.block_rows = 1;
+}
+
+void BidExporter::gather() {
+  block.value.clear();
+  block.user_id.clear();
+  block.item_id.clear();
+  block.number.clear();
+  block.sequence.clear();
+
+  while (block.size() < options.block_rows && item_index < item_ids.size()) {
+    const Item* item;
+    if (!auction.getItem(item_ids[item_index], item).ok()) {
+      ++item_index;
+      next_sequence = options.first_sequence;
+      continue;
+    }
+
+    // Bids on an item are found in sequence order, so skip straight to the
+    // first one not yet exported.
+    const size_t room = options.block_rows - block.size();
+    bids.clear();
+    item->getBidsFrom(next_sequence, room, bids);
+    bool item_done = bids.size() < room;
+    for (const Bid* bid: bids) {
+      if (bid->sequence >= end_sequence) {
+        item_done = true;
+        break;
+      }
+      block.value.push_back(bid->value);
+      block.user_id.push_back(bid->user_id);
+      block.item_id.push_back(bid->item_id);
+      block.number.push_back(bid->number);
+      block.sequence.push_back(bid->sequence);
+      next_sequence = bid->sequence + 1;
+    }
+
+    if (item_done) {
+      ++item_index;
+      next_sequence = options.first_sequence;
+    }
+  }
+}
+
+Status BidExporter::write(const void* data, size_t size) {
+  static const char kZeros[8] = {0};
+  out.write(static_cast<const char*>(data), size);
+  out.write(kZeros, padding(size));
+  if (!out) {
+    return error::IoError("Failed to write bid export after ",
+                          rows_written, " rows.");
+  }
+  return Status::OK();
+}
+
+Status BidExporter::exportBlock(bool& done) {
+  done = finished;
+  if (finished)
+    return Status::OK();
+
+  if (!header_written) {
+    const uint32_t header[2] = {kVersion, kNumColumns};
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    Status status = write(kColumns, sizeof(kColumns));
+    if (!status.ok())
+      return status;
+    header_written = true;
+  }
+
+  gather();
+  const uint32_t block_header[2] = {static_cast<uint32_t>(block.size()), 0};
+  Status status = write(block_header, sizeof(block_header));
+  if (!status.ok())
+    return status;
+
+  if (block.size() == 0) {
+    status = write(&rows_written, sizeof(rows_written));
+    if (!status.ok())
+      return status;
+    out.flush();
+    finished = done = true;
+    return Status::OK();
+  }
+
+  const size_t rows = block.size();
+  if (!(status = write(block.value.data(), rows * sizeof(uint32_t))).ok() ||
+      !(status = write(block.user_id.data(), rows * sizeof(uint32_t))).ok() ||
+      !(status = write(block.item_id.data(), rows * sizeof(uint32_t))).ok() ||
+      !(status = write(block.number.data(), rows * sizeof(uint32_t))).ok() ||
+      !(status = write(block.sequence.data(), rows * sizeof(uint64_t))).ok()) {
+    return status;
+  }
+  rows_written += rows;
+  return Status::OK();
+}
+
+Status BidExporter::exportAll() {
+  bool done = false;
+  while (!done) {
+    Status status = exportBlock(done);
+    if (!status.ok())
+      return status;
+  }
+  return Status::OK();
+}
+
+Status readBidExport(std::istream& in, BidColumns& columns) {
+  char magic[8];
+  uint32_t header[2];
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char*>(header), sizeof(header));
+  if (!in || std::memcmp(magic, kMagic, sizeof(magic)) != 0) {
+    return error::IoError("Stream is not a bid export.");
+  }
+  if (header[0] != kVersion || header[1] != kNumColumns) {
+    return error::IoError("Unsupported bid export version ", header[0], ".");
+  }
+
+  ColumnDesc columns_read[kNumColumns];
+  in.read(reinterpret_cast<char*>(columns_read), sizeof(columns_read));
+  if (!in || std::memcmp(columns_read, kColumns, sizeof(kColumns)) != 0) {
+    return error::IoError("Unexpected bid export column layout.");
+  }
+
+  uint64_t rows_read = 0;
+  while (true) {
+    uint32_t block_header[2];
+    in.read(reinterpret_cast<char*>(block_header), sizeof(block_header));
+    if (!in) {
+      return error::IoError("Bid export is missing its end marker.");
+    }
+    const uint32_t num_rows = block_header[0];
+    if (num_rows == 0)
+      break;
+
+    Status status;
+    if (!(status = readColumn(in, num_rows, columns.value)).ok() ||
+        !(status = readColumn(in, num_rows, columns.user_id)).ok() ||
+        !(status = readColumn(in, num_rows, columns.item_id)).ok() ||
+        !(status = readColumn(in, num_rows, columns.number)).ok() ||
+        !(status = readColumn(in, num_rows, columns.sequence)).ok()) {
+      return status;
+    }
+    rows_read += num_rows;
+  }
+
+  uint64_t total_rows;
+  in.read(reinterpret_cast<char*>(&total_rows), sizeof(total_rows));
+  if (!in || total_rows != rows_read) {
+    return error::IoError("Bid export row count ", rows_read,
+                          " does not match its trailer.");
+  }
+  return Status::OK();
+}
+}  // namespace auction_engine
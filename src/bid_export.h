@@ -0,0 +1,165 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+
+#include "auction.h"
+#include "status.h"
+
+/**
+ * \file
+ * \brief Columnar export of bid history.
+ *
+ * Bids are written as a small header followed by blocks of rows. Inside a
+ * block every column is stored contiguously as a packed array of its native
+ * type, so a reader can load a whole column with a single read:
+ *
+ *     header: char magic[8] = "AEBIDCOL"
+ *             uint32_t version
+ *             uint32_t num_columns
+ *             num_columns x { uint32_t column_id, uint32_t width }
+ *     block:  uint32_t num_rows, uint32_t reserved
+ *             num_columns x { num_rows * width bytes, zero padded to 8 }
+ *     end:    a block with num_rows == 0, then uint64_t total_rows
+ *
+ * All integers are written in the host's byte order.
+ */
+
+namespace auction_engine {
+
+/// Column IDs used in the export header.
+enum BidColumnId : uint32_t {
+  kBidColumnValue = 0,
+  kBidColumnUserId = 1,
+  kBidColumnItemId = 2,
+  kBidColumnNumber = 3,
+  kBidColumnSequence = 4
+};
+
+/**
+ * \brief Options selecting which bids a \c BidExporter writes.
+ */
+struct BidExportOptions {
+  /// Items to export bids for. If empty, every item registered when the
+  /// export starts is exported.
+  std::vector<uint32_t> item_ids;
+  /// Only export bids placed on items that are sold.
+  bool sold_only = false;
+  /// First bid sequence number to export (inclusive).
+  uint64_t first_sequence = 0;
+  /// Last bid sequence number to export (exclusive). Bids accepted after the
+  /// export starts are never exported, whatever this is set to.
+  uint64_t last_sequence = UINT64_MAX;
+  /// Maximum number of rows written per block.
+  uint32_t block_rows = 1 << 16;
+};
+
+/**
+ * \brief Bid history loaded column by column.
+ */
+struct BidColumns {
+  std::vector<uint32_t> value;
+  std::vector<uint32_t> user_id;
+  std::vector<uint32_t> item_id;
+  std::vector<uint32_t> number;
+  std::vector<uint64_t> sequence;
+
+  /// Return the number of rows.
+  size_t size() const { return value.size(); }
+};
+
+/**
+ * \brief Streams bid history out of an auction in columnar blocks.
+ *
+ * The set of bids exported is fixed when the exporter is created: only bids
+ * with a sequence number lower than \c Auction::getBidSequence() at that point
+ * are written. This lets the caller interleave \c exportBlock() with further
+ * bidding on the same auction, pausing the auction for at most one block at a
+ * time, and still get a consistent export. A bid retracted before the block
+ * that would hold it is written is left out, and the other bids are still
+ * exported exactly once.
+ */
+class BidExporter {
+public:
+  BidExporter(const Auction& auction, std::ostream& out,
+              BidExportOptions options=BidExportOptions());
+
+  /**
+   * \brief Write the next block of bids.
+   *
+   * The header is written before the first block, and the end marker is
+   * written once no bids are left.
+   *
+   * \param done
+   *    Set to \c true once the end marker has been written.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status exportBlock(bool& done);
+
+  /// Write every remaining block. Returns \c Status containing error code and
+  /// message.
+  Status exportAll();
+
+  /// Return the number of rows written so far.
+  uint64_t getRowsWritten() const { return rows_written; }
+
+private:
+  /// Gather up to \c block_rows rows into the column buffers.
+  void gather();
+
+  /// Write \c size bytes to the stream padded to a multiple of 8.
+  Status write(const void* data, size_t size);
+
+  const Auction& auction;
+  std::ostream& out;
+  BidExportOptions options;
+  /// Items left to visit, in export order.
+  std::vector<uint32_t> item_ids;
+  /// Index into \c item_ids of the item being exported.
+  size_t item_index;
+  /// Lowest sequence number left to export on the current item. Bids are
+  /// found by sequence rather than by position since retracting a bid shifts
+  /// the ones after it.
+  uint64_t next_sequence;
+  /// Sequence number bound captured when the export started.
+  uint64_t end_sequence;
+  /// Bids of the current item gathered for the block.
+  std::vector<const Bid*> bids;
+  bool header_written;
+  bool finished;
+  uint64_t rows_written;
+  /// Column buffers for the block being written.
+  BidColumns block;
+};
+
+/**
+ * \brief Read a complete bid export written by \c BidExporter.
+ *
+ * \param in
+ *    The stream to read from.
+ *
+ * \param columns
+ *    Columns to append the exported rows to.
+ *
+ * \return \c Status containing error code and message.
+ */
+Status readBidExport(std::istream& in, BidColumns& columns);
+}  // namespace auction_engine
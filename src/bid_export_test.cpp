@@ -0,0 +1,137 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+#include "auction.h"
+#include "bid.h"
+#include "bid_export.h"
+#include "item.h"
+#include "status.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+int main() {
+  auction_engine::Auction auction;
+  auction.addUser("Alice", 10000);
+  auction.addUser("Bob", 10000);
+  auction.addItem("Rug", 10);
+  auction.addItem("Ficus", 20);
+  auction.addItem("Sunflowers", 30);
+  for (uint32_t item_id: auction.getItems())
+    auction.openItem(item_id);
+
+  // Interleave bids across items so sequence order differs from item order.
+  for (uint32_t i=0; i<100; ++i) {
+    auction.placeBid(i % 3, i % 2, 100 + i);
+  }
+  auction.closeItem(1, true);
+
+  printTest("Testing BidExporter::exportAll()...");
+  std::stringstream all;
+  auction_engine::BidExportOptions options;
+  options.block_rows = 7;
+  auction_engine::BidExporter exporter(auction, all, options);
+  auction_engine::Status status = exporter.exportAll();
+  printTestResult(status.ok() && exporter.getRowsWritten() == 100);
+
+  printTest("Testing readBidExport()...");
+  auction_engine::BidColumns columns;
+  status = auction_engine::readBidExport(all, columns);
+  bool match = status.ok() && columns.size() == 100;
+  for (size_t i=0; match && i<columns.size(); ++i) {
+    const auction_engine::Item* item;
+    auction.getItem(columns.item_id[i], item);
+    const auction_engine::Bid* bid = item->getBid(columns.number[i]);
+    match = bid->value == columns.value[i] &&
+            bid->user_id == columns.user_id[i] &&
+            bid->sequence == columns.sequence[i];
+  }
+  printTestResult(match);
+
+  printTest("Testing BidExportOptions::sold_only...");
+  std::stringstream sold;
+  options = auction_engine::BidExportOptions();
+  options.sold_only = true;
+  auction_engine::BidExporter(auction, sold, options).exportAll();
+  columns = auction_engine::BidColumns();
+  auction_engine::readBidExport(sold, columns);
+  printTestResult(columns.size() == 33 && columns.item_id.front() == 1 &&
+                  columns.item_id.back() == 1);
+
+  printTest("Testing sequence range export...");
+  std::stringstream range;
+  options = auction_engine::BidExportOptions();
+  options.first_sequence = 10;
+  options.last_sequence = 20;
+  auction_engine::BidExporter(auction, range, options).exportAll();
+  columns = auction_engine::BidColumns();
+  auction_engine::readBidExport(range, columns);
+  bool in_range = columns.size() == 10;
+  for (uint64_t sequence: columns.sequence)
+    in_range = in_range && sequence >= 10 && sequence < 20;
+  printTestResult(in_range);
+
+  printTest("Testing export while bidding...");
+  std::stringstream live;
+  options = auction_engine::BidExportOptions();
+  options.block_rows = 5;
+  auction_engine::BidExporter live_exporter(auction, live, options);
+  bool done = false;
+  uint32_t value = 1000;
+  while (!done) {
+    live_exporter.exportBlock(done);
+    auction.placeBid(0, value % 2, value);
+    ++value;
+  }
+  columns = auction_engine::BidColumns();
+  auction_engine::readBidExport(live, columns);
+  printTestResult(columns.size() == 100 && auction.getBidSequence() > 100);
+
+  printTest("Testing export while retracting bids...");
+  auction_engine::Auction retracting;
+  retracting.addUser("Alice", 10000);
+  retracting.addUser("Bob", 10000);
+  retracting.addItem("Rug", 10);
+  retracting.openItem(0);
+  for (uint32_t i=0; i<10; ++i)
+    retracting.placeBid(0, i % 2, 100 + i);
+  std::stringstream retracted;
+  options = auction_engine::BidExportOptions();
+  options.block_rows = 3;
+  auction_engine::BidExporter retract_exporter(retracting, retracted, options);
+  retract_exporter.exportBlock(done);
+  // Retract one bid already exported and one not yet exported.
+  status = retracting.retractBid(0, 1);
+  retracting.retractBid(0, 5);
+  retract_exporter.exportAll();
+  columns = auction_engine::BidColumns();
+  auction_engine::readBidExport(retracted, columns);
+  printTestResult(status.ok() && columns.number ==
+                  std::vector<uint32_t>({0, 1, 2, 3, 4, 6, 7, 8, 9}));
+
+  return 0;
+}
@@ -0,0 +1,281 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bulk_load.h"
+#include "auction.h"
+#include "error.h"
+#include "status.h"
+
+namespace auction_engine {
+
+namespace {
+
+/// Fewest bytes of CSV worth parsing on a thread of their own.
+const size_t kMinBytesPerThread = 1 << 20;
+/// Fewest entries worth checking on a thread of their own.
+const size_t kMinEntriesPerThread = 1 << 16;
+
+/// Return how many threads to split \c amount of work over.
+unsigned threadsFor(size_t amount, size_t min_per_thread,
+                    unsigned num_threads) {
+  if (num_threads == 0)
+    num_threads = std::thread::hardware_concurrency();
+  const size_t useful = std::max<size_t>(1, amount / min_per_thread);
+  return std::max<size_t>(1, std::min<size_t>(num_threads, useful));
+}
+
+/// Call \c body with every index below \c num_threads, each on a thread of
+/// its own except index 0, which runs on the caller's.
+void runParallel(unsigned num_threads,
+                 const std::function<void(unsigned)>& body) {
+  std::vector<std::thread> threads;
+  for (unsigned index=1; index<num_threads; ++index)
+    threads.emplace_back(body, index);
+  body(0);
+  for (std::thread& thread: threads)
+    thread.join();
+}
+
+/// Entries parsed from one chunk of a CSV file.
+struct Chunk {
+  std::vector<BulkEntry> entries;
+  /// Lines parsed, blank ones included.
+  size_t num_lines = 0;
+  /// Why the chunk's last line could not be parsed, or \c nullptr.
+  const char* error = nullptr;
+};
+
+/// Return the offset chunk \c index of \c num_chunks starts at: the start of
+/// the first line at or after its share of \c data.
+size_t chunkStart(std::string_view data, size_t index, size_t num_chunks) {
+  if (index == 0)
+    return 0;
+  if (index == num_chunks)
+    return data.size();
+  const size_t newline = data.find('\n', data.size() * index / num_chunks);
+  return newline == std::string_view::npos ? data.size() : newline + 1;
+}
+
+/// Parse the lines of \c data into \c chunk, stopping at the first bad one.
+void parseChunk(std::string_view data, bool first_chunk, Chunk& chunk) {
+  size_t pos = 0;
+  while (pos < data.size()) {
+    size_t end = data.find('\n', pos);
+    if (end == std::string_view::npos)
+      end = data.size();
+    std::string_view line = data.substr(pos, end - pos);
+    pos = end + 1;
+    const bool first_line = first_chunk && chunk.num_lines == 0;
+    ++chunk.num_lines;
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    if (line.empty())
+      continue;
+
+    const size_t comma = line.rfind(',');
+    if (comma == std::string_view::npos) {
+      chunk.error = "has no comma";
+      return;
+    }
+    const std::string_view text = line.substr(comma + 1);
+    uint32_t value;
+    const auto [parsed_end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || parsed_end != text.data() + text.size()) {
+      if (first_line)
+        continue;
+      chunk.error = "does not end in a value from 0 to 4294967295";
+      return;
+    }
+    chunk.entries.push_back({line.substr(0, comma), value});
+  }
+}
+
+/// Unmaps and closes a CSV file when a load returns.
+struct Mapping {
+  int fd = -1;
+  void* addr = MAP_FAILED;
+  size_t size = 0;
+
+  ~Mapping() {
+    if (addr != MAP_FAILED)
+      munmap(addr, size);
+    if (fd >= 0)
+      ::close(fd);
+  }
+};
+
+/// Map and parse the CSV file at \c path and register its entries with
+/// \c add.
+Status loadCsv(const std::string& path, unsigned num_threads,
+               BulkLoadReport& report,
+               const std::function<Status(const std::vector<BulkEntry>&)>&
+                   add) {
+  report = BulkLoadReport();
+  Mapping mapping;
+  mapping.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat file_stat;
+  if (mapping.fd < 0 || fstat(mapping.fd, &file_stat) < 0) {
+    return error::IoError("Could not open CSV file \"", path, "\": ",
+                          strerror(errno));
+  }
+  mapping.size = file_stat.st_size;
+  std::string_view data;
+  if (mapping.size) {
+    mapping.addr = mmap(nullptr, mapping.size, PROT_READ, MAP_PRIVATE,
+                        mapping.fd, 0);
+    if (mapping.addr == MAP_FAILED) {
+      return error::IoError("Could not map CSV file \"", path, "\": ",
+                            strerror(errno));
+    }
+    madvise(mapping.addr, mapping.size, MADV_SEQUENTIAL);
+    data = std::string_view(static_cast<const char*>(mapping.addr),
+                            mapping.size);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<BulkEntry> entries;
+  Status status = parseCsv(data, num_threads, entries);
+  const auto parsed = std::chrono::steady_clock::now();
+  report.parse_seconds = std::chrono::duration<double>(parsed - start).count();
+  if (!status.ok()) {
+    return Status(status.code(),
+                  "\"" + path + "\": " + status.error_message());
+  }
+
+  // The names point into the mapping, which must outlive adding them.
+  status = add(entries);
+  report.load_seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - parsed).count();
+  if (!status.ok()) {
+    return Status(status.code(),
+                  "\"" + path + "\": " + status.error_message());
+  }
+  report.num_loaded = entries.size();
+  return Status::OK();
+}
+}  // namespace
+
+Status parseCsv(std::string_view data, unsigned num_threads,
+                std::vector<BulkEntry>& entries) {
+  entries.clear();
+  const unsigned num_chunks =
+      threadsFor(data.size(), kMinBytesPerThread, num_threads);
+  std::vector<Chunk> chunks(num_chunks);
+  runParallel(num_chunks, [&](unsigned index) {
+    const size_t begin = chunkStart(data, index, num_chunks);
+    const size_t end = chunkStart(data, index + 1, num_chunks);
+    parseChunk(data.substr(begin, end - begin), index == 0, chunks[index]);
+  });
+
+  size_t num_lines = 0, num_entries = 0;
+  for (const Chunk& chunk: chunks) {
+    if (chunk.error) {
+      return error::InvalidRequest("Line ", num_lines + chunk.num_lines, " ",
+                                   chunk.error, ".");
+    }
+    num_lines += chunk.num_lines;
+    num_entries += chunk.entries.size();
+  }
+  entries.reserve(num_entries);
+  for (const Chunk& chunk: chunks)
+    entries.insert(entries.end(), chunk.entries.cbegin(),
+                   chunk.entries.cend());
+  return Status::OK();
+}
+
+size_t findFirstTakenName(
+    const std::vector<BulkEntry>& entries, unsigned num_threads,
+    const std::function<bool(std::string_view)>& taken) {
+  const size_t num_entries = entries.size();
+  const unsigned num_parts =
+      threadsFor(num_entries, kMinEntriesPerThread, num_threads);
+
+  // Check each part of the entries against the names already taken, and sort
+  // its entries into shards by the hash of their name.
+  std::vector<std::vector<std::vector<size_t>>> shards(
+      num_parts, std::vector<std::vector<size_t>>(num_parts));
+  std::vector<size_t> first_taken(num_parts, num_entries);
+  runParallel(num_parts, [&](unsigned part) {
+    const size_t begin = num_entries * part / num_parts;
+    const size_t end = num_entries * (part + 1) / num_parts;
+    const std::hash<std::string_view> hash;
+    for (size_t index=begin; index<end; ++index) {
+      const std::string_view name = entries[index].name;
+      if (first_taken[part] == num_entries && taken(name))
+        first_taken[part] = index;
+      shards[part][hash(name) % num_parts].push_back(index);
+    }
+  });
+
+  // Repeats of a name all land in one shard, which sees them in order, so the
+  // first repeat a shard finds is the first in the entries.
+  std::vector<size_t> first_repeat(num_parts, num_entries);
+  runParallel(num_parts, [&](unsigned shard) {
+    size_t shard_size = 0;
+    for (unsigned part=0; part<num_parts; ++part)
+      shard_size += shards[part][shard].size();
+    std::unordered_set<std::string_view> seen;
+    seen.reserve(shard_size);
+    for (unsigned part=0; part<num_parts; ++part) {
+      for (size_t index: shards[part][shard]) {
+        if (!seen.insert(entries[index].name).second) {
+          first_repeat[shard] = index;
+          return;
+        }
+      }
+    }
+  });
+
+  return std::min(*std::min_element(first_taken.cbegin(), first_taken.cend()),
+                  *std::min_element(first_repeat.cbegin(),
+                                    first_repeat.cend()));
+}
+
+Status loadUsersCsv(Auction& auction, const std::string& path,
+                    unsigned num_threads, BulkLoadReport& report) {
+  return loadCsv(path, num_threads, report,
+                 [&](const std::vector<BulkEntry>& entries) {
+                   return auction.addUsers(entries, num_threads);
+                 });
+}
+
+Status loadItemsCsv(Auction& auction, const std::string& path,
+                    unsigned num_threads, BulkLoadReport& report) {
+  return loadCsv(path, num_threads, report,
+                 [&](const std::vector<BulkEntry>& entries) {
+                   return auction.addItems(entries, num_threads);
+                 });
+}
+}  // namespace auction_engine
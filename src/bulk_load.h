@@ -0,0 +1,133 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "status.h"
+
+/**
+ * \file
+ * \brief Registering users and items in bulk, from CSV files.
+ *
+ * A CSV file has one user or item per line: its name, a comma, and its funds
+ * or starting value as a decimal number. The name runs up to the last comma
+ * on the line, so it may contain commas itself, and is taken as it is,
+ * without unquoting. Blank lines and a trailing carriage return are ignored,
+ * and a first line whose value is not a number is taken for a header and
+ * skipped.
+ *
+ * Files are parsed in parallel chunks straight out of a read-only mapping,
+ * then registered with \c Auction::addUsers() or \c Auction::addItems().
+ */
+
+namespace auction_engine {
+
+/* Forward Declarations */
+class Auction;
+
+/// A user's or item's name and its funds or starting value.
+struct BulkEntry {
+  std::string_view name;
+  uint32_t value;
+};
+
+/// Outcome of \c loadUsersCsv() or \c loadItemsCsv().
+struct BulkLoadReport {
+  /// Number of users or items registered.
+  uint64_t num_loaded = 0;
+  /// Time spent parsing the file.
+  double parse_seconds = 0;
+  /// Time spent checking names and registering entries.
+  double load_seconds = 0;
+
+  /// Return the number of entries loaded per second, parsing included.
+  double getEntriesPerSecond() const {
+    const double seconds = parse_seconds + load_seconds;
+    return seconds > 0 ? num_loaded / seconds : 0;
+  }
+};
+
+/**
+ * \brief Parse CSV data into entries, in parallel chunks.
+ *
+ * \param data
+ *    The CSV data. The names of the entries point into it.
+ *
+ * \param num_threads
+ *    Most threads to parse with, or 0 for one per hardware thread. Small
+ *    inputs use fewer.
+ *
+ * \param entries
+ *    Set to the entries, in the order of their lines.
+ *
+ * \return \c Status containing error code and message. An
+ *    \c INVALID_REQUEST error names the first line that could not be parsed.
+ */
+Status parseCsv(std::string_view data, unsigned num_threads,
+                std::vector<BulkEntry>& entries);
+
+/**
+ * \brief Find the first entry whose name is taken, in parallel.
+ *
+ * \param entries
+ *    The entries to check.
+ *
+ * \param num_threads
+ *    Most threads to check with, or 0 for one per hardware thread.
+ *
+ * \param taken
+ *    Returns \c true if a name is already in use. Called from several threads
+ *    at once.
+ *
+ * \return The index of the first entry whose name is taken or used by an
+ *    earlier entry, or \c entries.size() if there is none.
+ */
+size_t findFirstTakenName(const std::vector<BulkEntry>& entries,
+                          unsigned num_threads,
+                          const std::function<bool(std::string_view)>& taken);
+
+/**
+ * \brief Register the users in a CSV file of names and funds.
+ *
+ * \param auction
+ *    The auction to add the users to.
+ *
+ * \param path
+ *    Path of the CSV file.
+ *
+ * \param num_threads
+ *    Most threads to use, or 0 for one per hardware thread.
+ *
+ * \param report
+ *    Set to the number of users added and the time taken.
+ *
+ * \return \c Status containing error code and message. Nothing is added if
+ *    the file cannot be read or parsed or any name is taken.
+ */
+Status loadUsersCsv(Auction& auction, const std::string& path,
+                    unsigned num_threads, BulkLoadReport& report);
+
+/// Register the items in a CSV file of names and starting values. Works like
+/// \c loadUsersCsv().
+Status loadItemsCsv(Auction& auction, const std::string& path,
+                    unsigned num_threads, BulkLoadReport& report);
+}  // namespace auction_engine
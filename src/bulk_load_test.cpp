@@ -0,0 +1,186 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "auction.h"
+#include "bulk_load.h"
+#include "error.h"
+#include "item.h"
+#include "status.h"
+#include "user.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+int main() {
+  namespace error = auction_engine::error;
+  using auction_engine::Auction;
+  using auction_engine::BulkEntry;
+  using auction_engine::Status;
+
+  printTest("Testing parseCsv()...");
+  std::vector<BulkEntry> entries;
+  Status status = auction_engine::parseCsv(
+      "name,funds\r\nAlice,100\r\n\nSmith, Bob,2500\nCarol,0", 1, entries);
+  std::vector<BulkEntry> bad_entries;
+  Status bad = auction_engine::parseCsv("Alice,1\nBob,-2\n", 1, bad_entries);
+  Status no_comma = auction_engine::parseCsv("Alice,1\n\nBob\n", 1,
+                                             bad_entries);
+  Status too_big = auction_engine::parseCsv("Alice,1\nBob,4294967296", 1,
+                                            bad_entries);
+  printTestResult(status.ok() && entries.size() == 3 &&
+                  entries[0].name == "Alice" && entries[0].value == 100 &&
+                  entries[1].name == "Smith, Bob" &&
+                  entries[1].value == 2500 && entries[2].name == "Carol" &&
+                  entries[2].value == 0 && error::IsInvalidRequest(bad) &&
+                  bad.error_message().find("Line 2 ") == 0 &&
+                  no_comma.error_message().find("Line 3 ") == 0 &&
+                  error::IsInvalidRequest(too_big));
+
+  printTest("Testing parseCsv() in parallel chunks...");
+  // Several megabytes, so that every thread gets a chunk.
+  std::string csv = "name,starting_value\n";
+  const uint32_t kNumEntries = 300000;
+  for (uint32_t i=0; i<kNumEntries; ++i)
+    csv += "Item number " + std::to_string(i) + "," + std::to_string(i) + "\n";
+  std::vector<BulkEntry> serial, parallel;
+  status = auction_engine::parseCsv(csv, 1, serial);
+  Status parallel_status = auction_engine::parseCsv(csv, 4, parallel);
+  bool same = serial.size() == kNumEntries &&
+              parallel.size() == kNumEntries;
+  for (uint32_t i=0; same && i<kNumEntries; ++i) {
+    same = serial[i].name == parallel[i].name &&
+           parallel[i].value == i;
+  }
+  csv += "Broken line\n";
+  Status late_error = auction_engine::parseCsv(csv, 4, parallel);
+  printTestResult(status.ok() && parallel_status.ok() && same &&
+                  late_error.error_message().find(
+                      "Line " + std::to_string(kNumEntries + 2) + " ") == 0);
+
+  printTest("Testing findFirstTakenName()...");
+  auto none_taken = [](std::string_view) { return false; };
+  const size_t unique = auction_engine::findFirstTakenName(serial, 4,
+                                                           none_taken);
+  // Repeat an early name late, and take a name in between.
+  std::vector<BulkEntry> repeated = serial;
+  repeated[250000].name = repeated[1000].name;
+  const size_t repeat = auction_engine::findFirstTakenName(repeated, 4,
+                                                           none_taken);
+  const size_t repeat_serial =
+      auction_engine::findFirstTakenName(repeated, 1, none_taken);
+  const size_t taken = auction_engine::findFirstTakenName(
+      repeated, 4, [](std::string_view name) {
+        return name == "Item number 123456";
+      });
+  printTestResult(unique == kNumEntries && repeat == 250000 &&
+                  repeat_serial == 250000 && taken == 123456);
+
+  printTest("Testing Auction::addUsers() IDs...");
+  // Bulk and one-by-one registration reuse released slots the same way.
+  Auction bulk_auction, sequential_auction;
+  for (Auction* auction: {&bulk_auction, &sequential_auction}) {
+    for (int i=0; i<5; ++i)
+      auction->addUser("Early " + std::to_string(i), 10);
+    auction->removeUser(1);
+    auction->removeUser(3);
+  }
+  std::vector<BulkEntry> users(serial.begin(), serial.begin() + 1000);
+  status = bulk_auction.addUsers(users, 4);
+  for (const BulkEntry& user: users)
+    sequential_auction.addUser(user.name, user.value);
+  bool same_ids = status.ok() &&
+                  bulk_auction.getUsers() == sequential_auction.getUsers();
+  for (uint32_t user_id: bulk_auction.getUsers()) {
+    const auction_engine::User* bulk_user;
+    const auction_engine::User* sequential_user;
+    bulk_auction.getUser(user_id, bulk_user);
+    sequential_auction.getUser(user_id, sequential_user);
+    uint32_t found_id;
+    same_ids = same_ids &&
+               bulk_user->getName() == sequential_user->getName() &&
+               bulk_user->getTotalFunds() ==
+                   sequential_user->getTotalFunds() &&
+               bulk_auction.findUser(bulk_user->getName(), found_id).ok() &&
+               found_id == user_id;
+  }
+  printTestResult(same_ids && bulk_auction.getUsers().size() == 1003 &&
+                  bulk_auction.getStateHash() ==
+                      sequential_auction.getStateHash());
+
+  printTest("Testing Auction::addItems() name taken...");
+  Auction taken_auction;
+  taken_auction.addItem("Item number 7", 0);
+  // A user may share an item's name, but no two items can.
+  Status user_status = taken_auction.addUsers(users);
+  status = taken_auction.addItems(users);
+  Status repeat_status = taken_auction.addItems(
+      {{"Vase", 1}, {"Lamp", 2}, {"Vase", 3}});
+  printTestResult(user_status.ok() && error::IsNameTaken(status) &&
+                  status.error_message().find("Entry 7:") == 0 &&
+                  error::IsNameTaken(repeat_status) &&
+                  repeat_status.error_message().find("Entry 2:") == 0 &&
+                  taken_auction.getItems().size() == 1 &&
+                  taken_auction.addItems({}).ok());
+
+  printTest("Testing loadUsersCsv() and loadItemsCsv()...");
+  const char* users_path = "bulk_load_test_users.csv";
+  const char* items_path = "bulk_load_test_items.csv";
+  {
+    std::ofstream users_file(users_path);
+    users_file << "name,funds\nAlice,100\nBob,200\n";
+    std::ofstream items_file(items_path);
+    items_file << csv.substr(0, csv.size() - sizeof("Broken line\n") + 1);
+  }
+  Auction csv_auction;
+  auction_engine::BulkLoadReport user_report, item_report, missing_report;
+  status = auction_engine::loadUsersCsv(csv_auction, users_path, 0,
+                                        user_report);
+  Status item_status = auction_engine::loadItemsCsv(csv_auction, items_path,
+                                                    4, item_report);
+  Status missing = auction_engine::loadItemsCsv(csv_auction, "no_such.csv",
+                                                0, missing_report);
+  Status again = auction_engine::loadUsersCsv(csv_auction, users_path, 0,
+                                              user_report);
+  uint32_t bob_id, last_item_id;
+  const auction_engine::Item* last_item = nullptr;
+  csv_auction.findUser("Bob", bob_id);
+  csv_auction.findItem("Item number 299999", last_item_id);
+  csv_auction.getItem(last_item_id, last_item);
+  std::remove(users_path);
+  std::remove(items_path);
+  printTestResult(status.ok() && item_status.ok() && bob_id == 1 &&
+                  item_report.num_loaded == kNumEntries &&
+                  last_item_id == kNumEntries - 1 && last_item &&
+                  last_item->getStartingValue() == kNumEntries - 1 &&
+                  error::IsIoError(missing) && error::IsNameTaken(again) &&
+                  csv_auction.getUsers().size() == 2);
+
+  return 0;
+}
@@ -0,0 +1,297 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bundle.h"
+
+namespace auction_engine {
+
+namespace {
+
+/// Union-find over dense item indices, to split bids into components.
+class DisjointSets {
+public:
+  explicit DisjointSets(size_t size) : parents(size) {
+    std::iota(parents.begin(), parents.end(), 0);
+  }
+
+  uint32_t find(uint32_t index) {
+    while (parents[index] != index) {
+      parents[index] = parents[parents[index]];
+      index = parents[index];
+    }
+    return index;
+  }
+
+  void unite(uint32_t a, uint32_t b) {
+    parents[find(a)] = find(b);
+  }
+
+private:
+  std::vector<uint32_t> parents;
+};
+
+/**
+ * \brief Branch and bound over the bids of one component.
+ *
+ * The component's items are renumbered densely, most contested first, so
+ * that the search decides the items that constrain the most bids early.
+ * Bounds are kept in whole numbers: each item's bound is its best bid value
+ * per item rounded up, which keeps the bound admissible and exact to add up.
+ */
+class ComponentSearch {
+public:
+  ComponentSearch(const std::vector<BundleBid>& bids,
+                  const std::vector<size_t>& component, uint64_t max_nodes);
+
+  /// Find the best set of bids, or the best within the node limit.
+  void run();
+
+  /// Indices into the component of the winning bids.
+  std::vector<uint32_t> best;
+  uint64_t best_value;
+  uint64_t num_nodes;
+  bool stopped;
+
+private:
+  /// Decide the undecided items from \c item on, given the bids chosen so
+  /// far are worth \c value and the undecided items at most \c bound.
+  void search(uint32_t item, uint64_t value, uint64_t bound);
+
+  /// Whether none of \c bid's items is taken.
+  bool isFree(uint32_t bid) const;
+
+  /// Mark \c bid's items as taken or free.
+  void setTaken(uint32_t bid, bool taken);
+
+  uint64_t max_nodes;
+  /// Value of each bid.
+  std::vector<uint32_t> bid_values;
+  /// Dense indices of each bid's items, in ascending order.
+  std::vector<std::vector<uint32_t>> bid_items;
+  /// Sum of the bounds of each bid's items.
+  std::vector<uint64_t> bid_bounds;
+  /// Bids whose first item is each item, most valuable first.
+  std::vector<std::vector<uint32_t>> bids_by_item;
+  /// Most any bid containing each item is worth per item, rounded up.
+  std::vector<uint64_t> item_bounds;
+  /// Whether each item is in a chosen bid.
+  std::vector<char> taken;
+  /// Bids chosen on the current branch.
+  std::vector<uint32_t> chosen;
+};
+
+ComponentSearch::ComponentSearch(const std::vector<BundleBid>& bids,
+                                 const std::vector<size_t>& component,
+                                 uint64_t max_nodes)
+    : best_value(0), num_nodes(0), stopped(false), max_nodes(max_nodes) {
+  // Number the items by how many bids contain them, most first.
+  std::unordered_map<uint32_t, uint32_t> item_counts;
+  for (size_t index: component) {
+    for (uint32_t item_id: bids[index].item_ids)
+      ++item_counts[item_id];
+  }
+  std::vector<std::pair<uint32_t, uint32_t>> items(item_counts.begin(),
+                                                   item_counts.end());
+  std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) {
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+  });
+  std::unordered_map<uint32_t, uint32_t> dense;
+  for (uint32_t i=0; i<items.size(); ++i)
+    dense[items[i].first] = i;
+
+  const size_t num_items = items.size();
+  item_bounds.assign(num_items, 0);
+  bids_by_item.resize(num_items);
+  taken.assign(num_items, 0);
+  for (size_t index: component) {
+    const BundleBid& bid = bids[index];
+    std::vector<uint32_t> local;
+    for (uint32_t item_id: bid.item_ids)
+      local.push_back(dense[item_id]);
+    std::sort(local.begin(), local.end());
+    const uint64_t share = (uint64_t(bid.value) + local.size() - 1) /
+                           local.size();
+    for (uint32_t item: local)
+      item_bounds[item] = std::max(item_bounds[item], share);
+    bid_values.push_back(bid.value);
+    bid_items.push_back(std::move(local));
+  }
+
+  for (uint32_t bid=0; bid<bid_items.size(); ++bid) {
+    uint64_t bound = 0;
+    for (uint32_t item: bid_items[bid])
+      bound += item_bounds[item];
+    bid_bounds.push_back(bound);
+    bids_by_item[bid_items[bid].front()].push_back(bid);
+  }
+  for (std::vector<uint32_t>& item_bids: bids_by_item) {
+    std::stable_sort(item_bids.begin(), item_bids.end(),
+                     [this](uint32_t a, uint32_t b) {
+                       return bid_values[a] > bid_values[b];
+                     });
+  }
+}
+
+void ComponentSearch::run() {
+  // A greedy solution, favouring value per item, prunes from the start.
+  std::vector<uint32_t> order(bid_values.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return bid_values[a] / std::sqrt(double(bid_items[a].size())) >
+           bid_values[b] / std::sqrt(double(bid_items[b].size()));
+  });
+  for (uint32_t bid: order) {
+    if (isFree(bid)) {
+      setTaken(bid, true);
+      best.push_back(bid);
+      best_value += bid_values[bid];
+    }
+  }
+  std::fill(taken.begin(), taken.end(), 0);
+
+  const uint64_t bound = std::accumulate(item_bounds.begin(),
+                                         item_bounds.end(), uint64_t(0));
+  search(0, 0, bound);
+}
+
+void ComponentSearch::search(uint32_t item, uint64_t value, uint64_t bound) {
+  if (stopped)
+    return;
+  if (max_nodes && num_nodes >= max_nodes) {
+    stopped = true;
+    return;
+  }
+  ++num_nodes;
+
+  // Items already in a chosen bid have had their bounds taken off.
+  while (item < taken.size() && taken[item])
+    ++item;
+  if (item == taken.size()) {
+    if (value > best_value) {
+      best_value = value;
+      best = chosen;
+    }
+    return;
+  }
+  if (value + bound <= best_value)
+    return;
+
+  for (uint32_t bid: bids_by_item[item]) {
+    if (!isFree(bid))
+      continue;
+    const uint64_t bid_bound = bound - bid_bounds[bid];
+    if (value + bid_values[bid] + bid_bound <= best_value)
+      continue;
+    setTaken(bid, true);
+    chosen.push_back(bid);
+    search(item + 1, value + bid_values[bid], bid_bound);
+    chosen.pop_back();
+    setTaken(bid, false);
+  }
+  // Leave the item unsold.
+  search(item + 1, value, bound - item_bounds[item]);
+}
+
+bool ComponentSearch::isFree(uint32_t bid) const {
+  for (uint32_t item: bid_items[bid]) {
+    if (taken[item])
+      return false;
+  }
+  return true;
+}
+
+void ComponentSearch::setTaken(uint32_t bid, bool is_taken) {
+  for (uint32_t item: bid_items[bid])
+    taken[item] = is_taken;
+}
+}  // namespace
+
+void determineWinners(const std::vector<BundleBid>& bids, uint64_t max_nodes,
+                      WinnerDetermination& result) {
+  result = WinnerDetermination();
+
+  std::unordered_map<uint32_t, uint32_t> item_indices;
+  for (const BundleBid& bid: bids) {
+    for (uint32_t item_id: bid.item_ids)
+      item_indices.emplace(item_id, item_indices.size());
+  }
+  DisjointSets sets(item_indices.size());
+  for (const BundleBid& bid: bids) {
+    for (size_t i=1; i<bid.item_ids.size(); ++i) {
+      sets.unite(item_indices[bid.item_ids[0]],
+                 item_indices[bid.item_ids[i]]);
+    }
+  }
+
+  std::unordered_map<uint32_t, size_t> component_of_root;
+  std::vector<std::vector<size_t>> components;
+  for (size_t index=0; index<bids.size(); ++index) {
+    if (bids[index].item_ids.empty())
+      continue;
+    const uint32_t root = sets.find(item_indices[bids[index].item_ids[0]]);
+    auto it = component_of_root.emplace(root, components.size()).first;
+    if (it->second == components.size())
+      components.emplace_back();
+    components[it->second].push_back(index);
+  }
+  result.num_components = components.size();
+
+  // The biggest components start first, since they take the longest.
+  std::stable_sort(components.begin(), components.end(),
+                   [](const auto& a, const auto& b) {
+                     return a.size() > b.size();
+                   });
+  std::vector<ComponentSearch> searches;
+  searches.reserve(components.size());
+  for (const std::vector<size_t>& component: components)
+    searches.emplace_back(bids, component, max_nodes);
+
+  std::atomic<size_t> next(0);
+  auto work = [&searches, &next]() {
+    size_t index;
+    while ((index = next.fetch_add(1, std::memory_order_relaxed)) <
+           searches.size())
+      searches[index].run();
+  };
+  const size_t num_threads = std::min<size_t>(
+      std::max(1u, std::thread::hardware_concurrency()), searches.size());
+  std::vector<std::thread> threads;
+  for (size_t i=1; i<num_threads; ++i)
+    threads.emplace_back(work);
+  work();
+  for (std::thread& thread: threads)
+    thread.join();
+
+  for (size_t c=0; c<searches.size(); ++c) {
+    const ComponentSearch& search = searches[c];
+    for (uint32_t bid: search.best)
+      result.winners.push_back(components[c][bid]);
+    result.revenue += search.best_value;
+    result.optimal = result.optimal && !search.stopped;
+    result.num_nodes += search.num_nodes;
+  }
+  std::sort(result.winners.begin(), result.winners.end());
+}
+}  // namespace auction_engine
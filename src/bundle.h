@@ -0,0 +1,85 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace auction_engine {
+
+/// A bid for a set of items that is only won whole.
+struct BundleBid {
+  /// User that placed the bid.
+  uint32_t user_id;
+  /// Distinct IDs of the items in the bundle, in ascending order.
+  std::vector<uint32_t> item_ids;
+  /// Price offered for the whole bundle.
+  uint32_t value;
+};
+
+/// Outcome of \c determineWinners().
+struct WinnerDetermination {
+  /// Indices of the winning bids, in ascending order. No two share an item.
+  std::vector<size_t> winners;
+  /// Total value of the winning bids.
+  uint64_t revenue = 0;
+  /// Whether every component was searched to the end. If not, the winners
+  /// are the best found within the node limit.
+  bool optimal = true;
+  /// Number of search nodes expanded over all components.
+  uint64_t num_nodes = 0;
+  /// Number of independent components the bids split into.
+  size_t num_components = 0;
+};
+
+/**
+ * \brief Choose the non-overlapping bids worth the most in total.
+ *
+ * Bids that share an item, directly or through other bids, form a
+ * component; components are independent, so they are solved separately and
+ * in parallel. Each is solved by a depth-first branch and bound: the items
+ * are decided one at a time, either by a bid whose first undecided item it
+ * is or by leaving it unsold, and a branch is dropped when its value plus an
+ * upper bound on the undecided items cannot beat the best solution so far.
+ * The bound gives each undecided item the best value per item of any bid
+ * containing it, and the search starts from a greedy solution.
+ *
+ * \param bids
+ *    The bids. A bid on a single item is a bundle of one.
+ *
+ * \param max_nodes
+ *    Most search nodes to expand per component before settling for the
+ *    best solution found, or 0 for no limit.
+ *
+ * \param result
+ *    Set to the winning bids.
+ */
+void determineWinners(const std::vector<BundleBid>& bids, uint64_t max_nodes,
+                      WinnerDetermination& result);
+
+/// Outcome of \c Auction::clearBundles().
+struct BundleClearing {
+  /// IDs of the bundle bids that won, in ascending order.
+  std::vector<uint32_t> winning_bundles;
+  /// IDs of the items sold, whether in a bundle or to their high bidder.
+  std::vector<uint32_t> items_sold;
+  /// Revenue from the items sold.
+  uint64_t revenue = 0;
+  /// Whether the winners were proven to be the best possible.
+  bool optimal = true;
+};
+}  // namespace auction_engine
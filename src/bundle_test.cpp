@@ -0,0 +1,242 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "analytics.h"
+#include "auction.h"
+#include "bid.h"
+#include "bundle.h"
+#include "error.h"
+#include "item.h"
+#include "memory_usage.h"
+#include "status.h"
+#include "user.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+namespace {
+
+using auction_engine::BundleBid;
+
+/// Whether no two of \c winners share an item and \c revenue is their value.
+bool isFeasible(const std::vector<BundleBid>& bids,
+                const auction_engine::WinnerDetermination& result) {
+  std::vector<uint32_t> items;
+  uint64_t revenue = 0;
+  for (size_t index: result.winners) {
+    items.insert(items.end(), bids[index].item_ids.begin(),
+                 bids[index].item_ids.end());
+    revenue += bids[index].value;
+  }
+  std::sort(items.begin(), items.end());
+  return std::adjacent_find(items.begin(), items.end()) == items.end() &&
+         revenue == result.revenue;
+}
+
+/// Find the best revenue by trying every subset of \c bids.
+uint64_t bruteForce(const std::vector<BundleBid>& bids) {
+  uint64_t best = 0;
+  for (uint32_t subset=0; subset<(1u << bids.size()); ++subset) {
+    uint64_t used = 0;
+    uint64_t value = 0;
+    bool feasible = true;
+    for (size_t i=0; feasible && i<bids.size(); ++i) {
+      if (!(subset & (1u << i)))
+        continue;
+      for (uint32_t item_id: bids[i].item_ids) {
+        feasible = feasible && !(used & (1ull << item_id));
+        used |= 1ull << item_id;
+      }
+      value += bids[i].value;
+    }
+    if (feasible)
+      best = std::max(best, value);
+  }
+  return best;
+}
+
+/// Make \c num_bids random bundles of up to \c max_size items drawn from
+/// \c num_items items starting at \c first_item.
+void addRandomBids(std::mt19937& random, uint32_t first_item,
+                   uint32_t num_items, size_t num_bids, size_t max_size,
+                   std::vector<BundleBid>& bids) {
+  for (size_t i=0; i<num_bids; ++i) {
+    BundleBid bid = {uint32_t(i), {}, 0};
+    const size_t size = 1 + random() % max_size;
+    for (size_t j=0; j<size; ++j)
+      bid.item_ids.push_back(first_item + random() % num_items);
+    std::sort(bid.item_ids.begin(), bid.item_ids.end());
+    bid.item_ids.erase(std::unique(bid.item_ids.begin(), bid.item_ids.end()),
+                       bid.item_ids.end());
+    bid.value = bid.item_ids.size() * (50 + random() % 100);
+    bids.push_back(bid);
+  }
+}
+}  // namespace
+
+int main() {
+  namespace error = auction_engine::error;
+  using auction_engine::Auction;
+  using auction_engine::Status;
+  using auction_engine::WinnerDetermination;
+
+  printTest("Testing determineWinners()...");
+  std::vector<BundleBid> bids = {
+      {0, {1, 2}, 10}, {1, {2, 3}, 10}, {2, {1}, 4}, {3, {3}, 7}, {4, {4}, 5}};
+  WinnerDetermination result;
+  auction_engine::determineWinners(bids, 0, result);
+  printTestResult(result.winners == std::vector<size_t>({0, 3, 4}) &&
+                  result.revenue == 22 && result.optimal &&
+                  result.num_components == 2 && isFeasible(bids, result));
+
+  printTest("Testing determineWinners() optimality...");
+  std::mt19937 random(42);
+  bool all_optimal = true;
+  for (int trial=0; trial<200; ++trial) {
+    std::vector<BundleBid> trial_bids;
+    addRandomBids(random, 0, 10, 16, 4, trial_bids);
+    auction_engine::determineWinners(trial_bids, 0, result);
+    all_optimal = all_optimal && result.optimal &&
+                  isFeasible(trial_bids, result) &&
+                  result.revenue == bruteForce(trial_bids);
+  }
+  printTestResult(all_optimal);
+
+  printTest("Testing determineWinners() node limit...");
+  std::vector<BundleBid> large_bids;
+  addRandomBids(random, 0, 200, 3000, 6, large_bids);
+  auction_engine::determineWinners(large_bids, 100, result);
+  printTestResult(!result.optimal && result.num_nodes <= 100 &&
+                  !result.winners.empty() && isFeasible(large_bids, result));
+
+  printTest("Testing determineWinners() components...");
+  // Four thousand bundles over four hundred groups of ten items, each
+  // group making up one or more components.
+  std::vector<BundleBid> grouped_bids;
+  for (uint32_t group=0; group<400; ++group)
+    addRandomBids(random, group * 10, 10, 10, 4, grouped_bids);
+  auction_engine::determineWinners(grouped_bids, 0, result);
+  printTestResult(result.optimal && result.num_components >= 400 &&
+                  isFeasible(grouped_bids, result));
+
+  printTest("Testing Auction::placeBundleBid()...");
+  Auction auction;
+  auction.addUser("Alice", 1000);
+  auction.addUser("Bob", 1000);
+  auction.addUser("Carol", 1000);
+  for (uint32_t i=0; i<5; ++i) {
+    auction.addItem("Item " + std::to_string(i), 0);
+    auction.openItem(i);
+  }
+  auction.closeItem(4);
+  auction.placeBid(0, 0, 30);
+  auction.placeBid(1, 1, 40);
+  auction.placeBid(2, 0, 10);
+  uint32_t carol_bundle, bob_bundle, unused;
+  Status status = auction.placeBundleBid(2, {1, 0}, 100, carol_bundle);
+  Status bob_status = auction.placeBundleBid(1, {1, 2}, 60, bob_bundle);
+  Status repeated = auction.placeBundleBid(1, {1, 1}, 60, unused);
+  Status closed = auction.placeBundleBid(1, {3, 4}, 60, unused);
+  Status too_costly = auction.placeBundleBid(2, {3}, 901, unused);
+  Status pending = auction.removeUser(2);
+  const auction_engine::User* carol;
+  auction.getUser(2, carol);
+  printTestResult(status.ok() && bob_status.ok() &&
+                  error::IsInvalidBid(repeated) &&
+                  error::IsItemUnavailable(closed) &&
+                  error::IsInsufficientFunds(too_costly) &&
+                  error::IsUserActive(pending) &&
+                  carol->getAvailableFunds() == 900);
+
+  printTest("Testing Auction::clearBundles()...");
+  auction_engine::BundleClearing clearing;
+  status = auction.clearBundles(clearing);
+  const auction_engine::User* users[3];
+  for (uint32_t i=0; i<3; ++i)
+    auction.getUser(i, users[i]);
+  auction_engine::Quote quote;
+  auction.getQuote(0, quote);
+  // Carol's bundle and Alice's bid on item 2 beat Bob's bundle with
+  // Alice's bid on item 0, and both beat selling the items one by one.
+  printTestResult(status.ok() && clearing.optimal &&
+                  clearing.winning_bundles ==
+                      std::vector<uint32_t>{carol_bundle} &&
+                  clearing.items_sold == std::vector<uint32_t>({0, 1, 2}) &&
+                  clearing.revenue == 110 && auction.getRevenue() == 110 &&
+                  auction.isSold(0) && auction.isSold(1) &&
+                  auction.isSold(2) && auction.isOpen(3) &&
+                  quote.leader == 2 && quote.value == 50 && quote.sold &&
+                  users[0]->getTotalFunds() == 990 &&
+                  users[0]->getAvailableFunds() == 990 &&
+                  users[1]->getTotalFunds() == 1000 &&
+                  users[1]->getAvailableFunds() == 1000 &&
+                  users[2]->getTotalFunds() == 900 &&
+                  users[2]->getAvailableFunds() == 900 &&
+                  users[2]->getItemsWon() == std::vector<uint32_t>({0, 1}) &&
+                  auction.getTotalCommittedFunds() == 0 &&
+                  auction.removeUser(1).ok());
+
+  printTest("Testing bundle sales in the bid history...");
+  const auction_engine::Item* sold_item;
+  auction.getItem(0, sold_item);
+  const auction_engine::Bid* winning_bid = sold_item->getCurrentBid();
+  auction_engine::ItemAnalytics analytics;
+  auction.getItemAnalytics(0, analytics);
+  printTestResult(sold_item->getNumBids() == 2 &&
+                  winning_bid->user_id == 2 && winning_bid->value == 50 &&
+                  sold_item->getCurrentValue() == 50 &&
+                  analytics.num_bids == 2 && analytics.num_bidders == 2 &&
+                  users[2]->alreadyBidOnItem(0));
+
+  printTest("Testing bundle bids in getMemoryUsage()...");
+  Auction counted;
+  counted.addUser("Alice", 1000);
+  for (uint32_t i=0; i<3; ++i)
+    counted.addItem("Item " + std::to_string(i), 0);
+  counted.openMultiUnitItem(0, 2);
+  counted.openItem(1);
+  counted.openItem(2);
+  const size_t no_bids = counted.getMemoryUsage().bids;
+  counted.placeQuantityBid(0, 0, 2, 10);
+  const size_t quantity_bid = counted.getMemoryUsage().bids;
+  counted.placeBundleBid(0, {1, 2}, 30, unused);
+  const size_t bundle_bid = counted.getMemoryUsage().bids;
+  // With an item closed the bundle is settled without selling anything.
+  counted.closeItem(2);
+  counted.clearBundles(clearing);
+  const size_t cleared = counted.getMemoryUsage().bids;
+  counted.closeItem(0, false);
+  counted.removeItem(0);
+  printTestResult(no_bids == 0 && quantity_bid > no_bids &&
+                  bundle_bid > quantity_bid && cleared == quantity_bid &&
+                  counted.getMemoryUsage().bids == 0);
+
+  return 0;
+}
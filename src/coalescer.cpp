@@ -0,0 +1,89 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "coalescer.h"
+#include "auction.h"
+#include "auction_host.h"
+#include "bid.h"
+#include "status.h"
+
+namespace auction_engine {
+
+BidCoalescer::BidCoalescer(AuctionHost& host, size_t max_batch)
+    : host(host),
+      max_batch(max_batch ? max_batch : 1),
+      num_bids(0),
+      num_batches(0) {}
+
+Status BidCoalescer::submitBid(uint32_t auction_id, uint32_t item_id,
+                               uint32_t user_id, uint32_t value,
+                               Callback done) {
+  const uint64_t key = uint64_t(auction_id) << 32 | item_id;
+  Shard& shard = shardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  std::shared_ptr<Batch>& open_batch = shard.open_batches[key];
+  if (open_batch && open_batch->bids.size() < max_batch) {
+    open_batch->bids.push_back({user_id, value});
+    open_batch->callbacks.push_back(std::move(done));
+    num_bids.fetch_add(1, std::memory_order_relaxed);
+    return Status::OK();
+  }
+
+  // The batch is queued while the shard is locked, so that no bid can join
+  // a batch whose task was never queued. A full batch stays queued; its task
+  // just won't find it open any more.
+  auto batch = std::make_shared<Batch>();
+  batch->bids.push_back({user_id, value});
+  batch->callbacks.push_back(std::move(done));
+  Status status = host.submit(
+      auction_id, [this, key, item_id, batch](Auction& auction) {
+        placeBatch(auction, key, item_id, batch);
+      });
+  if (!status.ok()) {
+    if (!open_batch)
+      shard.open_batches.erase(key);
+    return status;
+  }
+  open_batch = std::move(batch);
+  num_bids.fetch_add(1, std::memory_order_relaxed);
+  num_batches.fetch_add(1, std::memory_order_relaxed);
+  return Status::OK();
+}
+
+void BidCoalescer::placeBatch(Auction& auction, uint64_t key,
+                              uint32_t item_id,
+                              const std::shared_ptr<Batch>& batch) {
+  {
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.open_batches.find(key);
+    if (it != shard.open_batches.end() && it->second == batch)
+      shard.open_batches.erase(it);
+  }
+
+  std::vector<Status> results;
+  auction.placeCoalescedBids(item_id, batch->bids, results);
+  for (size_t index = 0; index < results.size(); ++index) {
+    if (batch->callbacks[index])
+      batch->callbacks[index](std::move(results[index]));
+  }
+}
+}  // namespace auction_engine
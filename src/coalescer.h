@@ -0,0 +1,145 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "auction_host.h"
+#include "bid.h"
+#include "status.h"
+
+namespace auction_engine {
+
+/**
+ * \brief Places bids on hot items in batches rather than one at a time.
+ *
+ * Bids submitted for an item join its open batch, and the first bid of a
+ * batch queues one task on the \c AuctionHost to place the whole batch with
+ * \c Auction::placeCoalescedBids(). The window a batch collects bids over is
+ * the time until that task runs, so an idle item places each bid as soon as
+ * it would have anyway, while an item whose auction is busy gathers every
+ * bid that arrives meanwhile into one task. Only the bid that wins a batch
+ * is recorded; the rest are rejected without touching the auction, which is
+ * what lets a contended item absorb many more bids per second.
+ *
+ * Batching weakens the order bids are applied in. A batch takes the place
+ * in the auction's queue of its first bid, so a bid that joins it later is
+ * applied before any task submitted to the same auction in between, such as
+ * a \c placeBid() or \c retractBid() for the same item sent straight to the
+ * host. Bids within a batch keep their order. Callers that need bids on an
+ * item applied strictly in submission order should send all of them through
+ * the coalescer, or all through the host, but not both.
+ *
+ * Safe to use from any thread. Batches are kept in \c kNumShards
+ * independently locked shards, so submitters for different items rarely
+ * wait for each other.
+ */
+class BidCoalescer {
+public:
+  /// Called on a host thread with the result of a bid.
+  using Callback = std::function<void(Status)>;
+
+  /// Number of independently locked shards.
+  static const size_t kNumShards = 64;
+  /// Default for the most bids placed as one batch.
+  static const size_t kDefaultMaxBatch = 4096;
+
+  /**
+   * \param host
+   *    Host of the auctions bid on.
+   *
+   * \param max_batch
+   *    Most bids placed as one batch. A bid arriving for a full batch starts
+   *    the next one.
+   */
+  explicit BidCoalescer(AuctionHost& host,
+                        size_t max_batch=kDefaultMaxBatch);
+
+  BidCoalescer(const BidCoalescer&) = delete;
+  BidCoalescer& operator=(const BidCoalescer&) = delete;
+
+  /**
+   * \brief Add a bid to its item's open batch.
+   *
+   * A bid that joins an open batch is placed where the batch's first bid
+   * was queued, ahead of tasks submitted to the auction since then.
+   *
+   * \param auction_id
+   *    ID of the auction in the host.
+   *
+   * \param item_id
+   *    The id of the item to bid on.
+   *
+   * \param user_id
+   *    The id of the user placing the bid.
+   *
+   * \param value
+   *    The value of the bid.
+   *
+   * \param done
+   *    Called with the result of the bid once its batch is placed. May be
+   *    empty.
+   *
+   * \return \c Status containing error code and message. OK means the bid was
+   *    queued, not that it was placed.
+   */
+  Status submitBid(uint32_t auction_id, uint32_t item_id, uint32_t user_id,
+                   uint32_t value, Callback done=Callback());
+
+  /// Return the number of bids submitted so far.
+  uint64_t getNumBids() const {
+    return num_bids.load(std::memory_order_relaxed);
+  }
+
+  /// Return the number of batches queued so far.
+  uint64_t getNumBatches() const {
+    return num_batches.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Batch {
+    std::vector<PendingBid> bids;
+    std::vector<Callback> callbacks;
+  };
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    /// Batches queued but not yet taken by their task, by auction and item.
+    std::unordered_map<uint64_t, std::shared_ptr<Batch>> open_batches;
+  };
+
+  Shard& shardOf(uint64_t key) {
+    return shards[(key * 0x9e3779b97f4a7c15ULL) >> 58];
+  }
+
+  /// Close the batch and place its bids.
+  void placeBatch(Auction& auction, uint64_t key, uint32_t item_id,
+                  const std::shared_ptr<Batch>& batch);
+
+  AuctionHost& host;
+  const size_t max_batch;
+  std::atomic<uint64_t> num_bids;
+  std::atomic<uint64_t> num_batches;
+  Shard shards[kNumShards];
+};
+}  // namespace auction_engine
@@ -0,0 +1,243 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "auction.h"
+#include "auction_host.h"
+#include "bid.h"
+#include "coalescer.h"
+#include "error.h"
+#include "item.h"
+#include "status.h"
+#include "user.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+namespace {
+
+/// Add Alice, Bob and Carol and open a vase for them to bid on.
+void setUpAuction(auction_engine::Auction& auction) {
+  auction.addUser("Alice", 100);
+  auction.addUser("Bob", 1000);
+  auction.addUser("Carol", 1000);
+  auction.addItem("Vase", 10);
+  auction.openItem(0);
+}
+
+/// Return the funds each user has available.
+std::vector<uint32_t> availableFunds(const auction_engine::Auction& auction) {
+  std::vector<uint32_t> funds;
+  for (uint32_t user_id : auction.getUsers()) {
+    const auction_engine::User* user;
+    auction.getUser(user_id, user);
+    funds.push_back(user->getAvailableFunds());
+  }
+  return funds;
+}
+}  // namespace
+
+int main() {
+  namespace error = auction_engine::error;
+  using auction_engine::Auction;
+  using auction_engine::Item;
+  using auction_engine::PendingBid;
+  using auction_engine::Status;
+
+  printTest("Testing Auction::placeCoalescedBids()...");
+  // Bob already leads, so his raise to 1000 is covered by his standing bid,
+  // while Alice's bid of 200 is more than she has. User 9 doesn't exist.
+  const std::vector<PendingBid> batch = {
+      {0, 50}, {1, 60}, {0, 200}, {2, 60}, {1, 1000}, {2, 65}, {9, 80},
+      {1, 70}, {2, 70}};
+  Auction sequential, coalesced;
+  setUpAuction(sequential);
+  setUpAuction(coalesced);
+  sequential.placeBid(0, 1, 40);
+  coalesced.placeBid(0, 1, 40);
+  std::vector<Status> results;
+  coalesced.placeCoalescedBids(0, batch, results);
+  std::vector<bool> sequential_ok;
+  for (const PendingBid& bid : batch)
+    sequential_ok.push_back(sequential.placeBid(0, bid.user_id, bid.value).ok());
+  const Item* sequential_item;
+  const Item* coalesced_item;
+  sequential.getItem(0, sequential_item);
+  coalesced.getItem(0, coalesced_item);
+  // Alice's bid of 50 was outbid in the batch, so unlike one at a time it
+  // holds none of her funds.
+  printTestResult(results.size() == batch.size() &&
+                  error::IsInvalidBid(results[0]) &&
+                  error::IsInvalidBid(results[1]) &&
+                  error::IsInsufficientFunds(results[2]) &&
+                  error::IsInvalidBid(results[3]) && results[4].ok() &&
+                  error::IsInvalidBid(results[5]) &&
+                  error::IsNotFound(results[6]) &&
+                  error::IsInvalidBid(results[7]) &&
+                  error::IsInvalidBid(results[8]) &&
+                  sequential_ok[0] && sequential_ok[4] &&
+                  coalesced_item->getCurrentValue() ==
+                      sequential_item->getCurrentValue() &&
+                  coalesced_item->getCurrentBid()->user_id ==
+                      sequential_item->getCurrentBid()->user_id &&
+                  coalesced_item->getNumBids() == 2 &&
+                  availableFunds(coalesced) ==
+                      std::vector<uint32_t>({100, 0, 1000}));
+
+  printTest("Testing placeCoalescedBids() outbid bids...");
+  // Every bid here would have been accepted one at a time; only the last
+  // survives, and the same bid value twice leaves the earlier one leading.
+  Auction ladder;
+  setUpAuction(ladder);
+  ladder.placeCoalescedBids(0, {{1, 20}, {2, 30}, {0, 40}, {2, 40}}, results);
+  const Item* rung;
+  ladder.getItem(0, rung);
+  const std::vector<uint32_t> ladder_funds = availableFunds(ladder);
+  printTestResult(error::IsInvalidBid(results[0]) &&
+                  error::IsInvalidBid(results[1]) && results[2].ok() &&
+                  error::IsInvalidBid(results[3]) &&
+                  rung->getNumBids() == 1 && rung->getCurrentValue() == 40 &&
+                  rung->getCurrentBid()->user_id == 0 &&
+                  ladder_funds == std::vector<uint32_t>({60, 1000, 1000}));
+
+  printTest("Testing placeCoalescedBids() closed item...");
+  ladder.closeItem(0);
+  ladder.placeCoalescedBids(0, {{1, 50}, {2, 60}}, results);
+  std::vector<Status> missing;
+  ladder.placeCoalescedBids(5, {{1, 50}}, missing);
+  std::vector<Status> none;
+  ladder.placeCoalescedBids(0, {}, none);
+  printTestResult(error::IsItemUnavailable(results[0]) &&
+                  error::IsItemUnavailable(results[1]) &&
+                  error::IsNotFound(missing[0]) && none.empty());
+
+  auction_engine::AuctionHost host(4);
+  const uint32_t auction_id = host.addAuction();
+  host.submit(auction_id, [](Auction& auction) {
+    for (int user = 0; user < 8; ++user)
+      auction.addUser("User " + std::to_string(user), 1u << 30);
+    auction.addItem("Painting", 0);
+    auction.addItem("Clock", 0);
+    auction.openItem(0);
+    auction.openItem(1);
+  });
+  host.drain();
+
+  std::mutex results_mutex;
+  size_t num_ok = 0, num_rejected = 0;
+  auto record = [&](Status status) {
+    std::lock_guard<std::mutex> lock(results_mutex);
+    num_ok += status.ok();
+    num_rejected += error::IsInvalidBid(status);
+  };
+  size_t num_recorded = 0;
+  auto count_bids = [&](Auction& auction) {
+    const Item* item;
+    auction.getItem(0, item);
+    num_recorded = item->getNumBids();
+  };
+
+  printTest("Testing BidCoalescer batches a busy item...");
+  // Hold the auction's strand so that bids pile up in one batch.
+  auction_engine::BidCoalescer coalescer(host);
+  std::atomic<bool> blocked(false), release(false);
+  host.submit(auction_id, [&](Auction&) {
+    blocked.store(true);
+    while (!release.load())
+      std::this_thread::yield();
+  });
+  while (!blocked.load())
+    std::this_thread::yield();
+  bool submitted = true;
+  for (uint32_t value = 1; value <= 100; ++value)
+    submitted = submitted &&
+                coalescer.submitBid(auction_id, 0, value % 8, value,
+                                    record).ok();
+  release.store(true);
+  host.drain();
+  host.submit(auction_id, count_bids);
+  host.drain();
+  auction_engine::Quote quote;
+  host.getQuote(auction_id, 0, quote);
+  printTestResult(submitted && coalescer.getNumBids() == 100 &&
+                  coalescer.getNumBatches() == 1 && num_ok == 1 &&
+                  num_rejected == 99 && num_recorded == 1 &&
+                  quote.value == 100 && quote.leader == 4);
+
+  printTest("Testing BidCoalescer batch size...");
+  auction_engine::BidCoalescer small_batches(host, 10);
+  num_ok = num_rejected = 0;
+  blocked.store(false);
+  release.store(false);
+  host.submit(auction_id, [&](Auction&) {
+    blocked.store(true);
+    while (!release.load())
+      std::this_thread::yield();
+  });
+  while (!blocked.load())
+    std::this_thread::yield();
+  for (uint32_t value = 101; value <= 200; ++value)
+    small_batches.submitBid(auction_id, 0, value % 8, value, record);
+  Status not_hosted = small_batches.submitBid(auction_id + 1, 0, 0, 300);
+  release.store(true);
+  host.drain();
+  host.submit(auction_id, count_bids);
+  host.drain();
+  host.getQuote(auction_id, 0, quote);
+  printTestResult(small_batches.getNumBatches() == 10 && num_ok == 10 &&
+                  num_rejected == 90 && num_recorded == 11 &&
+                  quote.value == 200 && error::IsNotFound(not_hosted));
+
+  printTest("Testing BidCoalescer from many threads...");
+  // Each thread raises its own bid on the clock, so the winner is whoever
+  // bids the highest value overall.
+  auction_engine::BidCoalescer contended(host);
+  num_ok = num_rejected = 0;
+  const int kNumThreads = 4;
+  const uint32_t kBidsPerThread = 20000;
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kNumThreads; ++thread) {
+    threads.emplace_back([&, thread] {
+      for (uint32_t bid = 1; bid <= kBidsPerThread; ++bid)
+        contended.submitBid(auction_id, 1, thread, bid * kNumThreads + thread,
+                            record);
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  host.drain();
+  host.getQuote(auction_id, 1, quote);
+  printTestResult(num_ok + num_rejected == kNumThreads * kBidsPerThread &&
+                  num_ok >= 1 &&
+                  contended.getNumBatches() <= num_ok + num_rejected &&
+                  quote.value == kBidsPerThread * kNumThreads + 3 &&
+                  quote.leader == 3);
+
+  host.drain();
+  return 0;
+}
@@ -0,0 +1,368 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "command_file.h"
+#include "auction.h"
+#include "bundle.h"
+#include "error.h"
+#include "protocol.h"
+#include "status.h"
+
+namespace auction_engine {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Command files are read in place as little-endian records");
+
+namespace {
+
+const char kMagic[8] = {'A', 'E', 'C', 'M', 'D', 'S', '\0', '\0'};
+const uint32_t kVersion = 1;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t num_records;
+  /// Offset of the name table from the start of the file.
+  uint64_t names_offset;
+};
+
+static_assert(sizeof(FileHeader) == 32, "FileHeader must be packed");
+
+/// Unmaps and closes a command file when ingest returns.
+struct Mapping {
+  int fd = -1;
+  void* addr = MAP_FAILED;
+  size_t size = 0;
+
+  ~Mapping() {
+    if (addr != MAP_FAILED)
+      munmap(addr, size);
+    if (fd >= 0)
+      ::close(fd);
+  }
+};
+}  // namespace
+
+CommandFileWriter::~CommandFileWriter() {
+  if (file)
+    fclose(file);
+}
+
+Status CommandFileWriter::open(const std::string& path) {
+  if (file)
+    fclose(file);
+  num_records = 0;
+  names.clear();
+  file = fopen(path.c_str(), "wb");
+  if (!file) {
+    return error::IoError("Could not create command file \"", path, "\": ",
+                          strerror(errno));
+  }
+  // The header is filled in by close().
+  const FileHeader header = {};
+  fwrite(&header, sizeof(header), 1, file);
+  return Status::OK();
+}
+
+void CommandFileWriter::addUser(std::string_view name, uint32_t funds) {
+  write(protocol::kAddUser, names.size(), funds, 0, name);
+}
+
+void CommandFileWriter::addItem(std::string_view name,
+                                uint32_t starting_value) {
+  write(protocol::kAddItem, names.size(), starting_value, 0, name);
+}
+
+void CommandFileWriter::openItem(uint32_t item_id) {
+  write(protocol::kOpenItem, item_id);
+}
+
+void CommandFileWriter::closeItem(uint32_t item_id, bool sell) {
+  write(protocol::kCloseItem, item_id, sell);
+}
+
+void CommandFileWriter::sellItem(uint32_t item_id) {
+  write(protocol::kSellItem, item_id);
+}
+
+void CommandFileWriter::placeBid(uint32_t item_id, uint32_t user_id,
+                                 uint32_t value) {
+  write(protocol::kPlaceBid, item_id, user_id, value);
+}
+
+void CommandFileWriter::removeItem(uint32_t item_id) {
+  write(protocol::kRemoveItem, item_id);
+}
+
+void CommandFileWriter::removeUser(uint32_t user_id) {
+  write(protocol::kRemoveUser, user_id);
+}
+
+void CommandFileWriter::retractBid(uint32_t item_id, uint32_t bid_number) {
+  write(protocol::kRetractBid, item_id, bid_number);
+}
+
+void CommandFileWriter::acceptDutchPrice(uint32_t item_id, uint32_t user_id,
+                                         uint32_t price) {
+  write(protocol::kAcceptDutchPrice, item_id, user_id, price);
+}
+
+void CommandFileWriter::openDutchItem(const DutchOpening& opening) {
+  write(protocol::kOpenDutchItem, names.size(), 0, 0,
+        std::string_view(reinterpret_cast<const char*>(&opening),
+                         sizeof(opening)));
+}
+
+void CommandFileWriter::placeBundleBid(uint32_t user_id,
+                                       const std::vector<uint32_t>& item_ids,
+                                       uint32_t value) {
+  write(protocol::kPlaceBundleBid, names.size(), user_id, value,
+        std::string_view(reinterpret_cast<const char*>(item_ids.data()),
+                         item_ids.size() * sizeof(uint32_t)));
+}
+
+void CommandFileWriter::clearBundles(uint32_t max_nodes) {
+  write(protocol::kClearBundles, max_nodes);
+}
+
+void CommandFileWriter::openMultiUnitItem(uint32_t item_id,
+                                          uint32_t num_units) {
+  write(protocol::kOpenMultiUnitItem, item_id, num_units);
+}
+
+void CommandFileWriter::placeQuantityBid(const QuantityOrder& order) {
+  write(protocol::kPlaceQuantityBid, names.size(), 0, 0,
+        std::string_view(reinterpret_cast<const char*>(&order),
+                         sizeof(order)));
+}
+
+void CommandFileWriter::write(protocol::Opcode opcode, uint32_t arg0,
+                              uint32_t arg1, uint32_t arg2,
+                              std::string_view name) {
+  CommandRecord record = {};
+  record.opcode = opcode;
+  record.name_length = name.size();
+  record.args[0] = arg0;
+  record.args[1] = arg1;
+  record.args[2] = arg2;
+  names.append(name.data(), record.name_length);
+  fwrite(&record, sizeof(record), 1, file);
+  ++num_records;
+}
+
+Status CommandFileWriter::close() {
+  if (!file)
+    return error::IoError("No command file is open.");
+
+  FileHeader header = {};
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.record_size = sizeof(CommandRecord);
+  header.num_records = num_records;
+  header.names_offset = sizeof(FileHeader) +
+                        num_records * sizeof(CommandRecord);
+  fwrite(names.data(), 1, names.size(), file);
+  fseek(file, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, file);
+  const bool failed = ferror(file);
+  const bool close_failed = fclose(file) != 0;
+  file = nullptr;
+  if (failed || close_failed)
+    return error::IoError("Writing the command file failed.");
+  return Status::OK();
+}
+
+bool isCommandApplied(uint8_t opcode, const Status& status) {
+  const bool sale = opcode == protocol::kCloseItem ||
+                    opcode == protocol::kSellItem ||
+                    opcode == protocol::kAcceptDutchPrice ||
+                    opcode == protocol::kClearBundles;
+  return protocol::changesAuction(opcode) &&
+         (status.ok() || (sale && error::IsIoError(status)));
+}
+
+namespace {
+
+/// Apply \c record to \c auction without numbering it. The auction's own
+/// operations check the command again, which costs little next to applying
+/// it and is how a follower notices one that fails where the leader's
+/// succeeded.
+Status applyRecord(Auction& auction, const CommandRecord& record,
+                   std::string_view name) {
+  const uint32_t* args = record.args;
+  switch (record.opcode) {
+    case protocol::kAddUser:
+      return auction.addUser(name, args[1]);
+    case protocol::kAddItem:
+      return auction.addItem(name, args[1]);
+    case protocol::kOpenItem:
+      return auction.openItem(args[0]);
+    case protocol::kCloseItem:
+      return auction.closeItem(args[0], args[1] != 0);
+    case protocol::kSellItem:
+      return auction.sellItem(args[0]);
+    case protocol::kPlaceBid:
+      return auction.placeBid(args[0], args[1], args[2]);
+    case protocol::kRemoveItem:
+      return auction.removeItem(args[0]);
+    case protocol::kRemoveUser:
+      return auction.removeUser(args[0]);
+    case protocol::kRetractBid:
+      return auction.retractBid(args[0], args[1]);
+    case protocol::kAcceptDutchPrice:
+      return auction.acceptDutchPriceAt(args[0], args[1], args[2]);
+    case protocol::kOpenDutchItem: {
+      DutchOpening opening;
+      if (name.size() != sizeof(opening))
+        return error::InvalidRequest("A Dutch opening must be ",
+                                     sizeof(opening), " bytes.");
+      memcpy(&opening, name.data(), sizeof(opening));
+      return auction.openDutchItem(opening.item_id, opening.start_price,
+                                   opening.floor_price, opening.decrement,
+                                   std::chrono::milliseconds(opening.tick_ms));
+    }
+    case protocol::kPlaceBundleBid: {
+      if (name.size() % sizeof(uint32_t)) {
+        return error::InvalidRequest("A bundle's item IDs must be ",
+                                     sizeof(uint32_t), " bytes each.");
+      }
+      std::vector<uint32_t> item_ids(name.size() / sizeof(uint32_t));
+      memcpy(item_ids.data(), name.data(), name.size());
+      uint32_t bundle_id;
+      return auction.placeBundleBid(args[1], std::move(item_ids), args[2],
+                                    bundle_id);
+    }
+    case protocol::kClearBundles: {
+      BundleClearing clearing;
+      return auction.clearBundles(clearing, args[0]);
+    }
+    case protocol::kOpenMultiUnitItem:
+      return auction.openMultiUnitItem(args[0], args[1]);
+    case protocol::kPlaceQuantityBid: {
+      QuantityOrder order;
+      if (name.size() != sizeof(order))
+        return error::InvalidRequest("A quantity bid must be ",
+                                     sizeof(order), " bytes.");
+      memcpy(&order, name.data(), sizeof(order));
+      return auction.placeQuantityBid(order.item_id, order.user_id,
+                                      order.quantity, order.unit_price);
+    }
+    default:
+      return error::InvalidRequest("Unknown opcode ", uint32_t(record.opcode),
+                                   ".");
+  }
+}
+}  // namespace
+
+Status applyCommand(Auction& auction, const CommandRecord& record,
+                    std::string_view name) {
+  auction.beginCommand();
+  Status status = applyRecord(auction, record, name);
+  if (isCommandApplied(record.opcode, status))
+    auction.sequenceCommand();
+  return status;
+}
+
+Status ingestCommandFile(Auction& auction, const std::string& path,
+                         IngestReport& report) {
+  report = IngestReport();
+  Mapping mapping;
+  mapping.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat file_stat;
+  if (mapping.fd < 0 || fstat(mapping.fd, &file_stat) < 0) {
+    return error::IoError("Could not open command file \"", path, "\": ",
+                          strerror(errno));
+  }
+  mapping.size = file_stat.st_size;
+  if (mapping.size < sizeof(FileHeader))
+    return error::IoError("\"", path, "\" is not a command file.");
+  mapping.addr = mmap(nullptr, mapping.size, PROT_READ, MAP_PRIVATE,
+                      mapping.fd, 0);
+  if (mapping.addr == MAP_FAILED) {
+    return error::IoError("Could not map command file \"", path, "\": ",
+                          strerror(errno));
+  }
+  madvise(mapping.addr, mapping.size, MADV_SEQUENTIAL);
+
+  const char* data = static_cast<const char*>(mapping.addr);
+  const FileHeader& header = *reinterpret_cast<const FileHeader*>(data);
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion ||
+      header.record_size != sizeof(CommandRecord) ||
+      header.num_records > (mapping.size - sizeof(FileHeader)) /
+                           sizeof(CommandRecord) ||
+      header.names_offset != sizeof(FileHeader) +
+                             header.num_records * sizeof(CommandRecord)) {
+    return error::IoError("\"", path, "\" is not a valid command file.");
+  }
+  report.num_records = header.num_records;
+
+  const CommandRecord* records =
+      reinterpret_cast<const CommandRecord*>(data + sizeof(FileHeader));
+  const char* names = data + header.names_offset;
+  const uint64_t names_size = mapping.size - header.names_offset;
+
+  const auto start = std::chrono::steady_clock::now();
+  Status status;
+  uint64_t index = 0;
+  for (; index<header.num_records; ++index) {
+    const CommandRecord& record = records[index];
+    std::string_view name;
+    if (record.name_length) {
+      if (uint64_t(record.args[0]) + record.name_length > names_size) {
+        status = error::IoError("The name is outside the name table.");
+        break;
+      }
+      name = std::string_view(names + record.args[0], record.name_length);
+    }
+    status = applyCommand(auction, record, name);
+    if (status.ok())
+      continue;
+    if (!isCommandApplied(record.opcode, status))
+      break;
+    if (report.num_unarchived++ == 0) {
+      report.archive_status = Status(status.code(),
+                                     "Record " + std::to_string(index) +
+                                     ": " + status.error_message());
+    }
+    status = Status::OK();
+  }
+  report.num_applied = index;
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  if (!status.ok()) {
+    return Status(status.code(),
+                  "Record " + std::to_string(index) + ": " +
+                  status.error_message());
+  }
+  return Status::OK();
+}
+}  // namespace auction_engine
@@ -0,0 +1,215 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "protocol.h"
+#include "status.h"
+
+/**
+ * \file
+ * \brief Files of recorded auction commands and applying them in bulk.
+ *
+ * A command file is a 32-byte header, then one 16-byte \c CommandRecord per
+ * command, then a table holding the names of the users and items added. All
+ * values are little-endian. The records are read straight out of a read-only
+ * mapping of the file, so nothing is copied or parsed before a command is
+ * applied.
+ */
+
+namespace auction_engine {
+
+/* Forward Declarations */
+class Auction;
+
+/// One recorded command, as laid out in a command file.
+struct CommandRecord {
+  /// A \c protocol::Opcode for which \c protocol::changesAuction() holds.
+  uint8_t opcode;
+  uint8_t reserved;
+  /// Length of the name of an added user or item, of a \c DutchOpening or
+  /// \c QuantityOrder, or of the item IDs of a bundle bid.
+  uint16_t name_length;
+  /// Arguments, in the order the \c protocol::Opcode lists them, except that
+  /// an added user's or item's name is replaced by its offset in the name
+  /// table, an accepted Dutch price carries the price paid third, and a
+  /// bundle bid carries the offset of its item IDs first and its user and
+  /// value after it.
+  uint32_t args[3];
+};
+
+static_assert(sizeof(CommandRecord) == 16, "CommandRecord must be packed");
+
+/// The arguments of a \c kOpenDutchItem command. They don't fit in a
+/// \c CommandRecord, so they are stored where an added user's name would be
+/// and the record itself only carries their offset in the name table.
+struct DutchOpening {
+  uint32_t item_id;
+  uint32_t start_price;
+  uint32_t floor_price;
+  uint32_t decrement;
+  uint32_t tick_ms;
+};
+
+static_assert(sizeof(DutchOpening) == 20, "DutchOpening must be packed");
+
+/// The arguments of a \c kPlaceQuantityBid command, stored after its record
+/// like a \c DutchOpening.
+struct QuantityOrder {
+  uint32_t item_id;
+  uint32_t user_id;
+  uint32_t quantity;
+  uint32_t unit_price;
+};
+
+static_assert(sizeof(QuantityOrder) == 16, "QuantityOrder must be packed");
+
+/// Outcome of \c ingestCommandFile().
+struct IngestReport {
+  /// Number of records in the file.
+  uint64_t num_records = 0;
+  /// Number of records applied before the first failure, or all of them.
+  uint64_t num_applied = 0;
+  /// Number of the applied records that were sales whose bids could not be
+  /// archived.
+  uint64_t num_unarchived = 0;
+  /// Why the first of those sales could not archive its bids, or OK.
+  Status archive_status;
+  /// Time spent applying records.
+  double seconds = 0;
+
+  /// Return the number of records applied per second.
+  double getRecordsPerSecond() const {
+    return seconds > 0 ? num_applied / seconds : 0;
+  }
+};
+
+/**
+ * \brief Writes a command file.
+ *
+ * Records are streamed to the file as they are added. Names are kept in
+ * memory and written after the records by \c close().
+ */
+class CommandFileWriter {
+public:
+  CommandFileWriter() : file(nullptr), num_records(0) {}
+  ~CommandFileWriter();
+
+  CommandFileWriter(const CommandFileWriter&) = delete;
+  CommandFileWriter& operator=(const CommandFileWriter&) = delete;
+
+  /// Create the file at \c path, replacing any file already there.
+  Status open(const std::string& path);
+
+  void addUser(std::string_view name, uint32_t funds);
+  void addItem(std::string_view name, uint32_t starting_value);
+  void openItem(uint32_t item_id);
+  void closeItem(uint32_t item_id, bool sell);
+  void sellItem(uint32_t item_id);
+  void placeBid(uint32_t item_id, uint32_t user_id, uint32_t value);
+  void removeItem(uint32_t item_id);
+  void removeUser(uint32_t user_id);
+  void retractBid(uint32_t item_id, uint32_t bid_number);
+  void acceptDutchPrice(uint32_t item_id, uint32_t user_id, uint32_t price);
+  void openDutchItem(const DutchOpening& opening);
+  void placeBundleBid(uint32_t user_id, const std::vector<uint32_t>& item_ids,
+                      uint32_t value);
+  void clearBundles(uint32_t max_nodes);
+  void openMultiUnitItem(uint32_t item_id, uint32_t num_units);
+  void placeQuantityBid(const QuantityOrder& order);
+
+  /// Write the name table and header and close the file.
+  Status close();
+
+private:
+  /// Append a record to the file.
+  void write(protocol::Opcode opcode, uint32_t arg0, uint32_t arg1=0,
+             uint32_t arg2=0, std::string_view name=std::string_view());
+
+  FILE* file;
+  uint64_t num_records;
+  std::string names;
+};
+
+/**
+ * \brief Return whether a command changed the auction it was applied to.
+ *
+ * A command that \c protocol::changesAuction() and that succeeded did. So
+ * did a sale or a bundle clearing that returned \c IO_ERROR because a sold
+ * item's bids could not be archived.
+ *
+ * \param opcode
+ *    The command's \c protocol::Opcode.
+ *
+ * \param status
+ *    The \c Status the command returned.
+ */
+bool isCommandApplied(uint8_t opcode, const Status& status);
+
+/**
+ * \brief Apply one recorded command to an auction.
+ *
+ * A command that changes the auction is numbered with
+ * \c Auction::sequenceCommand(), as the server numbered it.
+ *
+ * \param auction
+ *    The auction to apply the command to.
+ *
+ * \param record
+ *    The command.
+ *
+ * \param name
+ *    The name of the user or item the command adds, if it adds one, the
+ *    bytes of the \c DutchOpening or \c QuantityOrder a \c kOpenDutchItem
+ *    or \c kPlaceQuantityBid command carries, or the item IDs a
+ *    \c kPlaceBundleBid command carries.
+ *
+ * \return \c Status containing error code and message.
+ */
+Status applyCommand(Auction& auction, const CommandRecord& record,
+                    std::string_view name);
+
+/**
+ * \brief Apply every command in a command file to an auction.
+ *
+ * Commands are applied in order with the auction's own operations and stop
+ * at the first one that fails. A sale that returns \c IO_ERROR because its
+ * bids could not be archived was still applied, as \c isCommandApplied()
+ * says, so it does not stop the ingest and is counted in
+ * \c report.num_unarchived instead.
+ *
+ * \param auction
+ *    The auction to apply the commands to.
+ *
+ * \param path
+ *    Path of the command file.
+ *
+ * \param report
+ *    Set to the number of records applied and the time taken. If a command
+ *    fails, \c report.num_applied is the index of its record.
+ *
+ * \return \c Status of the first command that failed, with the index of its
+ *    record added to the message, or an \c IO_ERROR if the file could not be
+ *    read.
+ */
+Status ingestCommandFile(Auction& auction, const std::string& path,
+                         IngestReport& report);
+}  // namespace auction_engine
@@ -0,0 +1,187 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "auction.h"
+#include "command_file.h"
+#include "dutch_clock.h"
+#include "error.h"
+#include "item.h"
+#include "status.h"
+#include "user.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+int main() {
+  const std::string path = "/tmp/command_file_test." +
+                           std::to_string(getpid()) + ".cmd";
+  const uint32_t kNumItems = 100;
+  const uint32_t kBidsPerItem = 1000;
+
+  printTest("Testing CommandFileWriter...");
+  auction_engine::CommandFileWriter writer;
+  auction_engine::Status status = writer.open(path);
+  writer.addUser("Alice", 100000000);
+  writer.addUser("Bob", 100000000);
+  for (uint32_t item=0; item<kNumItems; ++item) {
+    writer.addItem("Item " + std::to_string(item), 0);
+    writer.openItem(item);
+  }
+  for (uint32_t value=1; value<=kBidsPerItem; ++value) {
+    for (uint32_t item=0; item<kNumItems; ++item)
+      writer.placeBid(item, value % 2, value);
+  }
+  writer.closeItem(0, true);
+  writer.closeItem(1, false);
+  writer.removeItem(1);
+  const uint64_t kNumRecords = 2 + 2*kNumItems + kNumItems*kBidsPerItem + 3;
+  printTestResult(status.ok() && writer.close().ok());
+
+  printTest("Testing ingestCommandFile()...");
+  auction_engine::Auction auction;
+  auction_engine::IngestReport report;
+  status = auction_engine::ingestCommandFile(auction, path, report);
+  const auction_engine::Item* last_item;
+  const auction_engine::User* first_user;
+  auction.getItem(kNumItems - 1, last_item);
+  auction.getUser(0, first_user);
+  uint32_t alice_id;
+  auction.findUser("Alice", alice_id);
+  printTestResult(status.ok() && report.num_records == kNumRecords &&
+                  report.num_applied == kNumRecords &&
+                  report.getRecordsPerSecond() > 0 &&
+                  auction.getItems().size() == kNumItems - 1 &&
+                  last_item->getName() == "Item " +
+                                          std::to_string(kNumItems - 1) &&
+                  last_item->getCurrentValue() == kBidsPerItem &&
+                  auction.isSold(0) && auction.getRevenue() == kBidsPerItem &&
+                  first_user->getName() == "Alice" && alice_id == 0);
+
+  printTest("Testing ingest stopping at a failure...");
+  writer.open(path);
+  writer.addUser("Carol", 10);
+  writer.addItem("Lamp", 0);
+  writer.openItem(0);
+  writer.placeBid(0, 0, 5);
+  writer.placeBid(0, 0, 50);
+  writer.placeBid(0, 0, 6);
+  writer.close();
+  auction_engine::Auction failing_auction;
+  status = auction_engine::ingestCommandFile(failing_auction, path, report);
+  printTestResult(auction_engine::error::IsInsufficientFunds(status) &&
+                  report.num_applied == 4 && report.num_records == 6 &&
+                  status.error_message().find("Record 4") == 0 &&
+                  // Each command applied took a sequence number.
+                  failing_auction.getBidSequence() == 4 &&
+                  failing_auction.getCommandSequence() == 3);
+
+  printTest("Testing ingest of a Dutch opening...");
+  writer.open(path);
+  writer.addItem("Clock", 0);
+  writer.openDutchItem({0, 1000, 100, 10, 500});
+  writer.addUser("Dave", 10);
+  writer.close();
+  auction_engine::Auction dutch_auction;
+  status = auction_engine::ingestCommandFile(dutch_auction, path, report);
+  auction_engine::DutchClock clock;
+  uint32_t dave_id;
+  printTestResult(status.ok() && report.num_applied == 3 &&
+                  dutch_auction.getDutchClock(0, clock).ok() &&
+                  clock.start_price == 1000 && clock.floor_price == 100 &&
+                  clock.decrement == 10 &&
+                  clock.tick == std::chrono::milliseconds(500) &&
+                  dutch_auction.findUser("Dave", dave_id).ok());
+
+  printTest("Testing ingest of bundle bids...");
+  writer.open(path);
+  writer.addUser("Erin", 100);
+  for (uint32_t item=0; item<3; ++item) {
+    writer.addItem("Item " + std::to_string(item), 0);
+    writer.openItem(item);
+  }
+  writer.placeBundleBid(0, {2, 0}, 60);
+  writer.clearBundles(0);
+  writer.close();
+  auction_engine::Auction bundle_auction;
+  status = auction_engine::ingestCommandFile(bundle_auction, path, report);
+  printTestResult(status.ok() && report.num_applied == 9 &&
+                  bundle_auction.isSold(0) && bundle_auction.isSold(2) &&
+                  bundle_auction.isOpen(1) &&
+                  bundle_auction.getRevenue() == 60);
+
+  printTest("Testing ingest of quantity bids...");
+  writer.open(path);
+  writer.addUser("Frank", 100);
+  writer.addItem("Seats", 1);
+  writer.openMultiUnitItem(0, 2);
+  writer.placeQuantityBid({0, 0, 2, 7});
+  writer.sellItem(0);
+  writer.close();
+  auction_engine::Auction lot_auction;
+  status = auction_engine::ingestCommandFile(lot_auction, path, report);
+  printTestResult(status.ok() && report.num_applied == 5 &&
+                  lot_auction.isSold(0) && lot_auction.getRevenue() == 14);
+
+  printTest("Testing ingest past an unarchived sale...");
+  writer.open(path);
+  writer.addUser("Grace", 100);
+  writer.addItem("Clock", 1);
+  writer.openItem(0);
+  writer.placeBid(0, 0, 9);
+  writer.sellItem(0);
+  writer.addItem("Chair", 1);
+  writer.close();
+  // Bids cannot be mapped into /dev/null, so the sale cannot archive them.
+  auction_engine::Auction unarchived_auction;
+  unarchived_auction.enableArchive("/dev/null");
+  status = auction_engine::ingestCommandFile(unarchived_auction, path,
+                                             report);
+  printTestResult(status.ok() && report.num_applied == 6 &&
+                  report.num_unarchived == 1 &&
+                  auction_engine::error::IsIoError(report.archive_status) &&
+                  report.archive_status.error_message().find("Record 4") ==
+                      0 &&
+                  unarchived_auction.isSold(0) &&
+                  unarchived_auction.getRevenue() == 9 &&
+                  unarchived_auction.getItems().size() == 2);
+
+  printTest("Testing ingest of an invalid file...");
+  FILE* garbage = fopen(path.c_str(), "wb");
+  fputs("not a command file at all, just some text", garbage);
+  fclose(garbage);
+  status = auction_engine::ingestCommandFile(failing_auction, path, report);
+  bool invalid_rejected = auction_engine::error::IsIoError(status);
+  status = auction_engine::ingestCommandFile(failing_auction,
+                                             path + ".missing", report);
+  printTestResult(invalid_rejected &&
+                  auction_engine::error::IsIoError(status));
+
+  remove(path.c_str());
+  return 0;
+}
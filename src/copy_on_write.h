@@ -0,0 +1,69 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace auction_engine {
+
+/**
+ * \brief A value shared by reference count until someone changes it.
+ *
+ * Copying only copies a pointer, and the copy shares the value with the
+ * original until one of them writes to it. Writes go through \c mutate(),
+ * which first gives the writer its own copy of the value if anyone else
+ * still shares it, the same way \c PagedColumn treats its pages. A holder
+ * that was never written to reads as a default-constructed value without
+ * allocating one.
+ *
+ * A holder and its copies may be used from different threads, as long as
+ * each one is only used by one thread at a time.
+ */
+template <typename T>
+class CopyOnWrite {
+public:
+  /// Return the value.
+  const T& operator*() const { return value ? *value : empty(); }
+  const T* operator->() const { return &**this; }
+
+  /// Return a writable reference to the value, copying it first if it is
+  /// shared.
+  T& mutate() {
+    if (!value) {
+      value = std::make_shared<T>();
+    } else if (value.use_count() != 1) {
+      value = std::make_shared<T>(*value);
+    } else {
+      // Pair with the release in the last sharer's reference drop, so its
+      // reads of the value happen before this write.
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *value;
+  }
+
+  /// Drop the value, leaving the holder reading as a default value.
+  void reset() { value.reset(); }
+
+private:
+  static const T& empty() {
+    static const T empty_value{};
+    return empty_value;
+  }
+
+  std::shared_ptr<T> value;
+};
+}  // namespace auction_engine
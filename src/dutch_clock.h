@@ -0,0 +1,65 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+
+namespace auction_engine {
+
+/**
+ * \brief The falling price of an item sold by Dutch auction.
+ *
+ * The price starts at \c start_price when the clock starts and drops by
+ * \c decrement at the end of every \c tick until it reaches \c floor_price.
+ * It is never stored as it falls; anyone holding the clock computes the
+ * price for a given time with \c getPrice().
+ */
+struct DutchClock {
+  /// Price when the clock starts.
+  uint32_t start_price;
+  /// Lowest price the item is offered at.
+  uint32_t floor_price;
+  /// Amount the price drops by every tick.
+  uint32_t decrement;
+  /// Time between price drops. Must be positive.
+  std::chrono::steady_clock::duration tick;
+  /// Time the clock started.
+  std::chrono::steady_clock::time_point start;
+
+  /// Return the price at time \c now.
+  uint32_t getPrice(std::chrono::steady_clock::time_point now) const {
+    if (now <= start)
+      return start_price;
+    const uint64_t num_ticks = (now - start) / tick;
+    const uint64_t drop = num_ticks * decrement;
+    const uint64_t room = start_price - floor_price;
+    // A drop that overflowed is bigger than any room there is.
+    if (drop > room || (decrement && drop / decrement != num_ticks))
+      return floor_price;
+    return start_price - drop;
+  }
+
+  /// Return \c true if the clock shows \c price at some time.
+  bool shows(uint32_t price) const {
+    if (price > start_price || price < floor_price)
+      return false;
+    if (price == floor_price || price == start_price)
+      return true;
+    return decrement && (start_price - price) % decrement == 0;
+  }
+};
+}  // namespace auction_engine
@@ -52,7 +52,7 @@ template <typename... Args>
       concatArgs(args...));
 }
 /// Function to test whether error status has code \c INSUFFICIENT_FUNDS.
-inline bool IsInsufficientFunds(::auction_engine::Status& status) {
+inline bool IsInsufficientFunds(const ::auction_engine::Status& status) {
   return status.code() == ::auction_engine::error::INSUFFICIENT_FUNDS;
 }
 
@@ -63,7 +63,7 @@ template <typename... Args>
       concatArgs(args...));
 }
 /// Function to test whether error status has code \c INVALID_BID.
-inline bool IsInvalidBid(::auction_engine::Status& status) {
+inline bool IsInvalidBid(const ::auction_engine::Status& status) {
   return status.code() == ::auction_engine::error::INVALID_BID;
 }
 
@@ -74,7 +74,7 @@ template <typename... Args>
       concatArgs(args...));
 }
 /// Function to test whether error status has code \c NOT_FOUND.
-inline bool IsNotFound(::auction_engine::Status& status) {
+inline bool IsNotFound(const ::auction_engine::Status& status) {
   return status.code() == ::auction_engine::error::NOT_FOUND;
 }
 
@@ -85,7 +85,7 @@ template <typename... Args>
       concatArgs(args...));
 }
 /// Function to test whether error status has code \c ITEM_UNAVAILABLE.
-inline bool IsItemUnavailable(::auction_engine::Status& status) {
+inline bool IsItemUnavailable(const ::auction_engine::Status& status) {
   return status.code() == ::auction_engine::error::ITEM_UNAVAILABLE;
 }
 
@@ -96,7 +96,7 @@ template <typename... Args>
       concatArgs(args...));
 }
 /// Function to test whether error status has code \c NAME_TAKEN.
-inline bool IsNameTaken(::auction_engine::Status& status) {
+inline bool IsNameTaken(const ::auction_engine::Status& status) {
   return status.code() == ::auction_engine::error::NAME_TAKEN;
 }
 
@@ -107,8 +107,63 @@ template <typename... Args>
       concatArgs(args...));
 }
 /// Function to test whether error status has code \c NO_BID.
-inline bool IsNoBid(::auction_engine::Status& status) {
+inline bool IsNoBid(const ::auction_engine::Status& status) {
   return status.code() == ::auction_engine::error::NO_BID;
 }
+
+/// Function to create \c IO_ERROR error status.
+template <typename... Args>
+::auction_engine::Status IoError(Args... args) {
+  return ::auction_engine::Status(::auction_engine::error::IO_ERROR,
+      concatArgs(args...));
+}
+/// Function to test whether error status has code \c IO_ERROR.
+inline bool IsIoError(const ::auction_engine::Status& status) {
+  return status.code() == ::auction_engine::error::IO_ERROR;
+}
+
+/// Function to create \c RESOURCE_EXHAUSTED error status.
+template <typename... Args>
+::auction_engine::Status ResourceExhausted(Args... args) {
+  return ::auction_engine::Status(::auction_engine::error::RESOURCE_EXHAUSTED,
+      concatArgs(args...));
+}
+/// Function to test whether error status has code \c RESOURCE_EXHAUSTED.
+inline bool IsResourceExhausted(const ::auction_engine::Status& status) {
+  return status.code() == ::auction_engine::error::RESOURCE_EXHAUSTED;
+}
+
+/// Function to create \c USER_ACTIVE error status.
+template <typename... Args>
+::auction_engine::Status UserActive(Args... args) {
+  return ::auction_engine::Status(::auction_engine::error::USER_ACTIVE,
+      concatArgs(args...));
+}
+/// Function to test whether error status has code \c USER_ACTIVE.
+inline bool IsUserActive(const ::auction_engine::Status& status) {
+  return status.code() == ::auction_engine::error::USER_ACTIVE;
+}
+
+/// Function to create \c INVALID_REQUEST error status.
+template <typename... Args>
+::auction_engine::Status InvalidRequest(Args... args) {
+  return ::auction_engine::Status(::auction_engine::error::INVALID_REQUEST,
+      concatArgs(args...));
+}
+/// Function to test whether error status has code \c INVALID_REQUEST.
+inline bool IsInvalidRequest(const ::auction_engine::Status& status) {
+  return status.code() == ::auction_engine::error::INVALID_REQUEST;
+}
+
+/// Function to create \c STATE_DIVERGED error status.
+template <typename... Args>
+::auction_engine::Status StateDiverged(Args... args) {
+  return ::auction_engine::Status(::auction_engine::error::STATE_DIVERGED,
+      concatArgs(args...));
+}
+/// Function to test whether error status has code \c STATE_DIVERGED.
+inline bool IsStateDiverged(const ::auction_engine::Status& status) {
+  return status.code() == ::auction_engine::error::STATE_DIVERGED;
+}
 }  // namespace error
 }  // namespace auction_engine
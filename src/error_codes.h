@@ -39,7 +39,22 @@ namespace error {
   NAME_TAKEN,
 
   // Attempted to sell item with no bid
-  NO_BID
+  NO_BID,
+
+  // Reading or writing an external file or stream failed.
+  IO_ERROR,
+
+  // No more IDs or other capacity is available for the request.
+  RESOURCE_EXHAUSTED,
+
+  // Attempted to remove a user that still has bids on unsold items.
+  USER_ACTIVE,
+
+  // A request could not be decoded or its arguments are invalid.
+  INVALID_REQUEST,
+
+  // A replica's state no longer matches the state of the auction it follows.
+  STATE_DIVERGED
 };  
 
 }  // namespace error
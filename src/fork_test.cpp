@@ -0,0 +1,212 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "auction.h"
+#include "bid.h"
+#include "bulk_load.h"
+#include "error.h"
+#include "item.h"
+#include "quote_board.h"
+#include "status.h"
+#include "user.h"
+#include "wallet_ledger.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+int main() {
+  namespace error = auction_engine::error;
+  using auction_engine::Auction;
+  using auction_engine::Status;
+
+  Auction auction;
+  auction.addUser("Alice", 1000);
+  auction.addUser("Bob", 1000);
+  auction.addItem("Rug", 10);
+  auction.addItem("Lamp", 20);
+  auction.openItem(0);
+  auction.openItem(1);
+  auction.placeBid(0, 0, 100);
+  auction.placeBid(0, 1, 200);
+
+  printTest("Testing Auction::fork()...");
+  std::unique_ptr<Auction> fork;
+  Status status = auction.fork(fork);
+  uint32_t rug_id = 99, alice_id = 99;
+  Status found_rug = fork->findItem("Rug", rug_id);
+  Status found_alice = fork->findUser("Alice", alice_id);
+  const auction_engine::Item* fork_rug;
+  fork->getItem(0, fork_rug);
+  printTestResult(status.ok() &&
+                  fork->getStateHash() == auction.getStateHash() &&
+                  fork->getItems() == auction.getItems() &&
+                  fork->getUsers() == auction.getUsers() &&
+                  found_rug.ok() && rug_id == 0 && found_alice.ok() &&
+                  alice_id == 0 && fork_rug->getNumBids() == 2 &&
+                  fork_rug->getCurrentBid()->user_id == 1 &&
+                  fork->getRevenue() == auction.getRevenue());
+
+  printTest("Testing changes to a fork...");
+  const uint64_t hash = auction.getStateHash();
+  const auction_engine::Item* rug;
+  const auction_engine::User* alice;
+  auction.getItem(0, rug);
+  auction.getUser(0, alice);
+  const auction_engine::Bid* high_bid = rug->getCurrentBid();
+  fork->placeBid(0, 0, 300);
+  fork->placeBid(1, 1, 50);
+  fork->closeItem(0, true);
+  const auction_engine::User* fork_alice;
+  fork->getUser(0, fork_alice);
+  printTestResult(auction.getStateHash() == hash &&
+                  auction.isOpen(0) && !auction.isSold(0) &&
+                  rug->getNumBids() == 2 && rug->getCurrentValue() == 200 &&
+                  rug->getCurrentBid() == high_bid &&
+                  high_bid->value == 200 &&
+                  alice->getAvailableFunds() == 900 &&
+                  alice->getItemsWon().empty() &&
+                  fork->isSold(0) && fork_alice->getTotalFunds() == 700 &&
+                  fork_alice->getItemsWon() == std::vector<uint32_t>{0} &&
+                  fork->getRevenue() == 300 && auction.getRevenue() == 0);
+
+  printTest("Testing changes to a forked auction...");
+  const uint64_t fork_hash = fork->getStateHash();
+  auction.placeBid(1, 0, 500);
+  auction.closeItem(1, true);
+  const auction_engine::Item* fork_lamp;
+  fork->getItem(1, fork_lamp);
+  printTestResult(fork->getStateHash() == fork_hash &&
+                  fork_lamp->getCurrentValue() == 50 &&
+                  fork_lamp->getCurrentBid()->user_id == 1 &&
+                  fork->isOpen(1) && auction.isSold(1) &&
+                  alice->getTotalFunds() == 500);
+
+  printTest("Testing names added to a fork...");
+  fork->addUser("Carol", 100);
+  auction.addUser("Dave", 100);
+  uint32_t carol_id = 0, dave_id = 0;
+  Status fork_carol = fork->findUser("Carol", carol_id);
+  Status fork_dave = fork->findUser("Dave", dave_id);
+  Status carol = auction.findUser("Carol", carol_id);
+  Status dave = auction.findUser("Dave", dave_id);
+  fork->removeUser(carol_id);
+  Status re_add = fork->addUser("Carol", 100);
+  const auction_engine::User* fork_carol_user = nullptr;
+  fork->findUser("Carol", carol_id);
+  fork->getUser(carol_id, fork_carol_user);
+  Status taken = fork->addUser("Alice", 1);
+  printTestResult(fork_carol.ok() && error::IsNotFound(fork_dave) &&
+                  error::IsNotFound(carol) && dave.ok() && dave_id == 2 &&
+                  re_add.ok() && fork_carol_user->getName() == "Carol" &&
+                  error::IsNameTaken(taken));
+
+  printTest("Testing a fork of a fork...");
+  std::unique_ptr<Auction> grandchild;
+  status = fork->fork(grandchild);
+  const uint64_t child_hash = fork->getStateHash();
+  grandchild->placeBid(1, 0, 60);
+  const auction_engine::Item* grandchild_lamp;
+  grandchild->getItem(1, grandchild_lamp);
+  uint32_t grandchild_carol = 99;
+  Status found_carol = grandchild->findUser("Carol", grandchild_carol);
+  printTestResult(status.ok() && grandchild_lamp->getCurrentValue() == 60 &&
+                  fork_lamp->getCurrentValue() == 50 &&
+                  fork->getStateHash() == child_hash &&
+                  found_carol.ok() && grandchild_carol == carol_id);
+
+  printTest("Testing Auction::getQuote() on a fork...");
+  auction_engine::Quote quote, missing;
+  Status quoted = grandchild->getQuote(1, quote);
+  Status not_found = grandchild->getQuote(7, missing);
+  printTestResult(quoted.ok() && quote.item_id == 1 && quote.value == 60 &&
+                  quote.leader == 0 && quote.num_bids == 2 && quote.open &&
+                  !quote.sold && error::IsNotFound(not_found));
+
+  printTest("Testing a fork outliving archived bids...");
+  const char* archive_path = "fork_test_archive.bin";
+  std::unique_ptr<Auction> archived(new Auction());
+  archived->enableArchive(archive_path);
+  archived->addUser("Alice", 1000);
+  archived->addItem("Rug", 10);
+  archived->openItem(0);
+  archived->placeBid(0, 0, 100);
+  archived->placeBid(0, 0, 150);
+  archived->closeItem(0, true);
+  std::unique_ptr<Auction> archived_fork;
+  archived->fork(archived_fork);
+  archived.reset();
+  const auction_engine::Item* archived_rug;
+  archived_fork->getItem(0, archived_rug);
+  const bool readable = archived_rug->isArchived() &&
+                        archived_rug->getNumBids() == 2 &&
+                        archived_rug->getBid(1)->value == 150;
+  status = archived_fork->removeItem(0);
+  printTestResult(readable && status.ok() && archived_fork->getItems().empty());
+  std::remove(archive_path);
+
+  printTest("Testing a bulk load into a fork...");
+  std::unique_ptr<Auction> loaded;
+  auction.fork(loaded);
+  const size_t auction_users = auction.getUsers().size();
+  std::vector<std::string> names;
+  for (uint32_t i = 0; i < 200000; ++i)
+    names.push_back("Bidder " + std::to_string(i));
+  std::vector<auction_engine::BulkEntry> entries;
+  for (const std::string& name : names)
+    entries.push_back({name, 10});
+  entries.push_back({"Alice", 10});
+  // The parent keeps adding names to the pool the fork looks names up in.
+  std::thread parent_thread([&auction]() {
+    for (int i = 0; i < 1000; ++i)
+      auction.addUser("Parent " + std::to_string(i), 10);
+  });
+  Status taken_load = loaded->addUsers(entries, 4);
+  entries.pop_back();
+  Status bulk_load = loaded->addUsers(entries, 4);
+  parent_thread.join();
+  uint32_t loaded_id = 0, parent_id = 0;
+  Status found_loaded = loaded->findUser("Bidder 199999", loaded_id);
+  Status parent_loaded = auction.findUser("Bidder 0", parent_id);
+  Status loaded_parent = loaded->findUser("Parent 0", parent_id);
+  printTestResult(error::IsNameTaken(taken_load) && bulk_load.ok() &&
+                  found_loaded.ok() &&
+                  loaded->getUsers().size() == auction_users + 200000 &&
+                  error::IsNotFound(parent_loaded) &&
+                  error::IsNotFound(loaded_parent));
+
+  printTest("Testing Auction::fork() with a ledger...");
+  Auction ledger_auction;
+  ledger_auction.setLedger(std::make_shared<auction_engine::WalletLedger>());
+  std::unique_ptr<Auction> ledger_fork;
+  status = ledger_auction.fork(ledger_fork);
+  printTestResult(error::IsInvalidRequest(status) && !ledger_fork);
+
+  return 0;
+}
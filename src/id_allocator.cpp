@@ -0,0 +1,90 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <stdint.h>
+
+#include "id_allocator.h"
+
+namespace auction_engine {
+
+static_assert(IdAllocator::kMaxGeneration <= UINT8_MAX,
+              "Slot generations are stored in a byte.");
+
+const uint32_t IdAllocator::kSlotBits;
+const uint32_t IdAllocator::kMaxSlots;
+const uint32_t IdAllocator::kMaxGeneration;
+const uint32_t IdAllocator::kInvalidId;
+
+bool IdAllocator::allocate(uint32_t& id) {
+  uint32_t slot;
+  if (!free_slots.empty()) {
+    std::pop_heap(free_slots.begin(), free_slots.end(),
+                  std::greater<uint32_t>());
+    slot = free_slots.back();
+    free_slots.pop_back();
+  } else if (slots.size() < kMaxSlots) {
+    slot = slots.size();
+    slots.push_back({0, false});
+  } else {
+    return false;
+  }
+
+  slots[slot].live = true;
+  ++num_live;
+  id = idOf(slot);
+  return true;
+}
+
+void IdAllocator::release(uint32_t id) {
+  if (!isLive(id))
+    return;
+  Slot& slot = slots[slotOf(id)];
+  slot.live = false;
+  --num_live;
+  if (slot.generation == kMaxGeneration) {
+    retired_slots.push_back(slotOf(id));
+    return;
+  }
+  ++slot.generation;
+  free_slots.push_back(slotOf(id));
+  std::push_heap(free_slots.begin(), free_slots.end(),
+                 std::greater<uint32_t>());
+}
+
+uint32_t IdAllocator::getSlotEnd() const {
+  uint32_t end = slots.size();
+  while (end > 0 && !slots[end-1].live)
+    --end;
+  return end;
+}
+
+void IdAllocator::recycleRetired() {
+  for (uint32_t slot: retired_slots) {
+    slots[slot].generation = 0;
+    free_slots.push_back(slot);
+    std::push_heap(free_slots.begin(), free_slots.end(),
+                   std::greater<uint32_t>());
+  }
+  retired_slots.clear();
+}
+
+void IdAllocator::compact() {
+  free_slots.shrink_to_fit();
+  retired_slots.shrink_to_fit();
+}
+}  // namespace auction_engine
@@ -0,0 +1,139 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+namespace auction_engine {
+
+/**
+ * \brief Allocates generation-tagged IDs over a recyclable set of slots.
+ *
+ * An ID packs a slot index into its low \c kSlotBits bits and the slot's
+ * generation into the remaining high bits. Releasing an ID frees its slot for
+ * reuse and bumps the slot's generation, so an ID kept after its entity was
+ * removed no longer matches and is rejected by \c isLive(). A slot whose
+ * generation would wrap is retired instead of reused, until the owner knows
+ * no stale ID can still be held and calls \c recycleRetired(). Freed slots
+ * are handed out lowest first, which keeps the live slots packed at the
+ * front.
+ *
+ * At most \c kMaxSlots IDs are live at once. Without recycling, each slot
+ * can be handed out \c kMaxGeneration + 1 times in all.
+ *
+ * The first ID handed out for each slot has generation 0, so an allocator that
+ * never releases anything assigns the IDs 0, 1, 2, ...
+ */
+class IdAllocator {
+public:
+  /// Number of ID bits used for the slot index.
+  static const uint32_t kSlotBits = 24;
+  /// Number of slots available.
+  static const uint32_t kMaxSlots = uint32_t(1) << kSlotBits;
+  /// Largest generation a slot can have. The generation above it is left
+  /// unused so that \c kInvalidId is never allocated.
+  static const uint32_t kMaxGeneration = (uint32_t(1) << (32 - kSlotBits)) - 2;
+  /// An ID that is never allocated.
+  static const uint32_t kInvalidId = UINT32_MAX;
+
+  IdAllocator() : num_live(0) {}
+
+  /// Return the slot index of \c id.
+  static uint32_t slotOf(uint32_t id) { return id & (kMaxSlots - 1); }
+
+  /// Return the generation of \c id.
+  static uint32_t generationOf(uint32_t id) { return id >> kSlotBits; }
+
+  /**
+   * \brief Allocate a new ID.
+   *
+   * \param id
+   *    Set to the new ID.
+   *
+   * \return \c true on success, \c false if every slot is in use or retired.
+   */
+  bool allocate(uint32_t& id);
+
+  /// Release a live \c id, making its slot available for reuse.
+  void release(uint32_t id);
+
+  /// Returns \c true if \c id was allocated and has not been released.
+  bool isLive(uint32_t id) const {
+    const uint32_t slot = slotOf(id);
+    return slot < slots.size() && slots[slot].live &&
+           slots[slot].generation == generationOf(id);
+  }
+
+  /// Return the live ID for \c slot. Assumes the slot is live.
+  uint32_t idOf(uint32_t slot) const {
+    return (uint32_t(slots[slot].generation) << kSlotBits) | slot;
+  }
+
+  /// Returns \c true if \c slot holds a live ID.
+  bool isSlotLive(uint32_t slot) const {
+    return slot < slots.size() && slots[slot].live;
+  }
+
+  /// Return the number of slots ever used. Every live slot is below this.
+  uint32_t getNumSlots() const { return slots.size(); }
+
+  /// Return the number of live IDs.
+  uint32_t getNumLive() const { return num_live; }
+
+  /// Return the number of released slots waiting to be reused, which
+  /// \c allocate() hands out before any new slot.
+  uint32_t getNumReusable() const { return free_slots.size(); }
+
+  /// Return the number of slots retired because their generation ran out.
+  uint32_t getNumRetired() const { return retired_slots.size(); }
+
+  /**
+   * \brief Make the retired slots reusable again, starting over at
+   *    generation 0.
+   *
+   * IDs once handed out for those slots become valid again when the slots
+   * are reused, so this must only be called once no ID released from them
+   * can still be presented, e.g. after every client has reconnected.
+   */
+  void recycleRetired();
+
+  /// Return the number of IDs that can still be allocated.
+  uint32_t getNumFree() const {
+    return free_slots.size() + (kMaxSlots - slots.size());
+  }
+
+  /// Return one past the highest live slot.
+  uint32_t getSlotEnd() const;
+
+  /// Release memory held by the free list beyond what it needs.
+  void compact();
+
+private:
+  struct Slot {
+    uint8_t generation;
+    bool live;
+  };
+
+  std::vector<Slot> slots;
+  /// Min-heap of released slots available for reuse.
+  std::vector<uint32_t> free_slots;
+  /// Released slots whose generation ran out, waiting for
+  /// \c recycleRetired().
+  std::vector<uint32_t> retired_slots;
+  uint32_t num_live;
+};
+}  // namespace auction_engine
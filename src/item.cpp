@@ -13,14 +13,189 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <stdint.h>
 
+#include "bid.h"
 #include "item.h"
+#include "auction.h"
+#include "id_allocator.h"
 
 namespace auction_engine {
 
+namespace {
+
+/// Add a slot to the Fenwick tree \c counts, counting 1 for it. The new
+/// node sums the nodes under it, of which there is one on average.
+void appendCount(std::vector<uint32_t>& counts) {
+  const size_t node = counts.size() + 1;
+  uint32_t count = 1;
+  for (size_t step=1; step < (node & -node); step <<= 1)
+    count += counts[node - step - 1];
+  counts.push_back(count);
+}
+
+/// Stop counting \c slot in the Fenwick tree \c counts.
+void removeCount(std::vector<uint32_t>& counts, size_t slot) {
+  for (size_t node=slot+1; node<=counts.size(); node += node & -node)
+    --counts[node-1];
+}
+
+/// Return how many of the slots before \c slot the Fenwick tree \c counts
+/// counts.
+size_t countBefore(const std::vector<uint32_t>& counts, size_t slot) {
+  size_t count = 0;
+  for (size_t node=slot; node; node -= node & -node)
+    count += counts[node-1];
+  return count;
+}
+}  // namespace
+
+Item::Item(Auction& auction, uint32_t id)
+    : auction(auction),
+      id(id),
+      slot(IdAllocator::slotOf(id)) {}
+
+Item::Item(Auction& auction, uint32_t id, std::string_view name,
+           uint32_t starting_value)
+    : Item(auction, id) {
+  auction.claimItemSlot(id, name, starting_value);
+}
+
+std::string_view Item::getName() const {
+  return auction.names->get(auction.item_name_column[slot]);
+}
+
+std::vector<const Bid*> Item::getBids() const {
+  const ItemRecord& item = record();
+  std::vector<const Bid*> bids;
+  bids.reserve(getNumBids());
+  if (item.archived_bids) {
+    for (size_t i=0; i<item.num_archived_bids; ++i)
+      bids.push_back(&item.archived_bids[i]);
+  } else {
+    for (const std::shared_ptr<const Bid>& bid: item.bids) {
+      if (bid)
+        bids.push_back(bid.get());
+    }
+  }
+  return bids;
+}
+
+void Item::getBidsFrom(uint64_t sequence, size_t max_bids,
+                       std::vector<const Bid*>& bids) const {
+  const ItemRecord& item = record();
+  if (item.archived_bids) {
+    const Bid* end = item.archived_bids + item.num_archived_bids;
+    const Bid* it = std::partition_point(
+        item.archived_bids, end,
+        [sequence](const Bid& bid) { return bid.sequence < sequence; });
+    for (; it != end && max_bids; ++it, --max_bids)
+      bids.push_back(it);
+    return;
+  }
+
+  // Search the bids left by index, then walk their slots from the first
+  // one found.
+  size_t low = 0, high = getNumBids();
+  while (low < high) {
+    const size_t mid = low + (high - low) / 2;
+    if (getBid(mid)->sequence < sequence)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if (low == getNumBids())
+    return;
+  for (size_t slot=getBid(low)->number;
+       slot < item.bids.size() && max_bids; ++slot) {
+    if (item.bids[slot]) {
+      bids.push_back(item.bids[slot].get());
+      --max_bids;
+    }
+  }
+}
+
 const uint32_t Item::getCurrentValue() const {
-  return bids.empty() ? starting_value : bids.back()->value;
+  return auction.item_hot_column[slot].value;
+}
+
+void Item::addBid(std::shared_ptr<const Bid> bid) {
+  HotItem& hot = auction.item_hot_column.mutate(slot);
+  hot.value = bid->value;
+  hot.leader = bid->user_id;
+  ++hot.num_bids;
+  ItemRecord& item = mutableRecord();
+  item.bids.push_back(std::move(bid));
+  appendCount(item.live_bid_counts);
+  auction.publishQuote(id);
+}
+
+void Item::addBidder(uint32_t user_id) {
+  mutableRecord().bidders.push_back(user_id);
+}
+
+const Bid* Item::findBid(uint32_t number, const Bid*& previous) const {
+  const ItemRecord& item = record();
+  if (item.archived_bids || number >= item.bids.size() || !item.bids[number])
+    return nullptr;
+  const size_t index = item.num_retracted_bids ?
+      countBefore(item.live_bid_counts, number) : number;
+  previous = index ? getBid(index-1) : nullptr;
+  return item.bids[number].get();
+}
+
+void Item::removeBid(uint32_t number) {
+  ItemRecord& item = mutableRecord();
+  item.bids[number].reset();
+  removeCount(item.live_bid_counts, number);
+  ++item.num_retracted_bids;
+  const Bid* leader = getCurrentBid();
+  HotItem& hot = auction.item_hot_column.mutate(slot);
+  hot.value = leader ? leader->value : item.starting_value;
+  hot.leader = leader ? leader->user_id : IdAllocator::kInvalidId;
+  --hot.num_bids;
+  auction.publishQuote(id);
+}
+
+void Item::removeBidder(uint32_t user_id) {
+  std::vector<uint32_t>& bidders = mutableRecord().bidders;
+  bidders.erase(std::find(bidders.begin(), bidders.end(), user_id));
+}
+
+void Item::archiveBids(const Bid* archived) {
+  ItemRecord& item = mutableRecord();
+  item.num_archived_bids = getNumBids();
+  item.archived_bids = archived;
+  std::vector<std::shared_ptr<const Bid>>().swap(item.bids);
+  std::vector<uint32_t>().swap(item.live_bid_counts);
+  std::vector<uint32_t>().swap(item.bidders);
+}
+
+size_t Item::findSlot(size_t index) const {
+  // Descend the tree from its largest node, skipping every node that counts
+  // no more bids than are still to be passed.
+  const std::vector<uint32_t>& counts = record().live_bid_counts;
+  size_t node = 0;
+  for (size_t step=std::bit_floor(counts.size()); step; step >>= 1) {
+    if (node + step <= counts.size() && counts[node + step - 1] <= index) {
+      node += step;
+      index -= counts[node-1];
+    }
+  }
+  return node;
+}
+
+const ItemRecord& Item::record() const {
+  return *auction.item_record_column[slot];
+}
+
+ItemRecord& Item::mutableRecord() {
+  return auction.item_record_column.mutate(slot).mutate();
 }
 }  // namespace auction_engine
@@ -15,11 +15,14 @@ limitations under the License.
 
 # pragma once
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stdint.h>
 
 #include "bid.h"
+#include "records.h"
 #include "auction.h"
 
 namespace auction_engine {
@@ -31,55 +34,167 @@ class Auction;
 /**
  * \brief Item class.
  *
- * This class stores information related to a single item in the auction.
+ * This class is a view of a single item in the auction. The item's current
+ * value and high bidder are stored in the auction's item columns at the slot
+ * of the item's ID, and its cold data in an \c ItemRecord in another column
+ * there, so an auction only creates the view once the item is looked up.
  */
 class Item {
 public:
-  Item(const Auction& auction, uint32_t id, std::string name, 
-       uint32_t starting_value=0)
-      : auction(auction),
-        id(id),
-        name(name),
-        starting_value(starting_value) {}
+  /// Create a view of the item registered in \c auction with \c id.
+  Item(Auction& auction, uint32_t id);
+
+  /// Create a view of a new item with \c id, claiming its slot in
+  /// \c auction's columns.
+  Item(Auction& auction, uint32_t id, std::string_view name,
+       uint32_t starting_value=0);
 
   /// Return all bids placed on the item.
-  std::vector<const Bid*> getBids() const { return bids; }
+  std::vector<const Bid*> getBids() const;
+
+  /// Return the number of bids placed on the item.
+  size_t getNumBids() const {
+    const ItemRecord& item = record();
+    return item.archived_bids ? item.num_archived_bids :
+                                item.bids.size() - item.num_retracted_bids;
+  }
+
+  /// Return the bid at \c index in the order bids were placed. Assumes
+  /// \c index is less than \c getNumBids(). This takes constant time, or
+  /// logarithmic time once a bid on the item has been retracted.
+  const Bid* getBid(size_t index) const {
+    const ItemRecord& item = record();
+    if (item.archived_bids)
+      return &item.archived_bids[index];
+    if (!item.num_retracted_bids)
+      return item.bids[index].get();
+    return item.bids[findSlot(index)].get();
+  }
+
+  /**
+   * \brief Append the bids placed from a sequence number on to a list.
+   *
+   * Bid numbers and sequence numbers rise together, so the first bid is
+   * found by binary search, in logarithmic time, or in time squared in the
+   * logarithm of the number of bids once one has been retracted.
+   *
+   * \param sequence
+   *    The lowest \c Bid::sequence to append.
+   *
+   * \param max_bids
+   *    The most bids to append.
+   *
+   * \param bids
+   *    The list to append the bids to, in the order they were placed.
+   */
+  void getBidsFrom(uint64_t sequence, size_t max_bids,
+                   std::vector<const Bid*>& bids) const;
+
+  /// Returns \c true if the item's bids have been moved to a \c BidArchive.
+  bool isArchived() const { return record().archived_bids != nullptr; }
 
   /// Return the item's id.
   const uint32_t getId() const { return id; }
 
-  /// Return the item's name.
-  const std::string getName() const { return name; }
+  /// Return the item's name. The view stays valid as long as the auction.
+  std::string_view getName() const;
 
-  /// Return the current bid on the item.
+  /// Return the current bid on the item. Accepted bids only ever rise, so
+  /// the leading bid is always the last one left.
   const Bid* getCurrentBid() const { 
-    return bids.empty() ? nullptr : bids.back();
+    const size_t num_bids = getNumBids();
+    return num_bids ? getBid(num_bids-1) : nullptr;
   }
 
   /// Return the current value of the item.
   const uint32_t getCurrentValue() const;
 
   /// Return the starting value of the item.
-  const uint32_t getStartingValue() const { return starting_value; }
+  const uint32_t getStartingValue() const { return record().starting_value; }
+
+  /// Return the users that have bid on the item, in the order of their first
+  /// bid. Empty once the item's bids are archived.
+  const std::vector<uint32_t>& getBidders() const { return record().bidders; }
 
   /**
    * \brief Adds a bid to the item. Assume \c bid is a valid bid.
    *
    * \param Bid
-   *    The bid to place on the item 
+   *    The bid to place on the item, which the item keeps alive.
+   */
+  void addBid(std::shared_ptr<const Bid> bid);
+
+  /// Record that \c user_id has bid on the item for the first time.
+  void addBidder(uint32_t user_id);
+
+  /// Return the number the next bid placed on the item is given.
+  uint32_t getNextBidNumber() const {
+    return getNumBids() + record().num_retracted_bids;
+  }
+
+  /**
+   * \brief Find a bid that has not been archived by its number.
+   *
+   * Bids are indexed by number, so this takes constant time, or logarithmic
+   * time once a bid on the item has been retracted.
+   *
+   * \param number
+   *    The \c Bid::number to look for.
+   *
+   * \param previous
+   *    Set to the bid placed before it, or \c nullptr if there is none.
+   *
+   * \return The bid, or \c nullptr if the item has no such bid.
+   */
+  const Bid* findBid(uint32_t number, const Bid*& previous) const;
+
+  /**
+   * \brief Remove a retracted bid from the item.
+   *
+   * If the bid was leading, the bid before it takes the lead, or the item
+   * goes back to its starting value if there is none. Since accepted bids
+   * only ever rise, that is the highest bid left. The bid's slot is kept
+   * empty, so this takes logarithmic time.
+   *
+   * \param number
+   *    Number of the bid, which must not be archived.
    */
-  void addBid(const Bid& bid) { bids.push_back(&bid); }
+  void removeBid(uint32_t number);
+
+  /// Forget that \c user_id has bid on the item, once none of their bids are
+  /// left on it. The bidders are searched in order, so this takes time
+  /// linear in their number.
+  void removeBidder(uint32_t user_id);
+
+  /**
+   * \brief Replace the item's bids with an archived copy.
+   *
+   * This releases the item's bid list and its list of bidders. Bids no fork
+   * of the auction still holds are freed.
+   *
+   * \param archived
+   *    The first of \c getNumBids() archived bids, in the order they were
+   *    placed.
+   */
+  void archiveBids(const Bid* archived);
 
 protected:
+  /// Return the slot in \c ItemRecord::bids of the bid at \c index, counting
+  /// only bids that have not been retracted.
+  size_t findSlot(size_t index) const;
+
+  /// Return the item's record.
+  const ItemRecord& record() const;
+
+  /// Return the item's record for writing, copying it first if it is shared
+  /// with a fork.
+  ItemRecord& mutableRecord();
+
   /// The \c Auction this item is a part of.
-  const Auction& auction;
+  Auction& auction;
   /// Id of item.
   const uint32_t id;
-  /// Name of item.
-  std::string name;
-  /// All bids placed on the item.
-  std::vector<const Bid*> bids;
-  /// Starting value of item.
-  uint32_t starting_value;
+  /// Slot of the item's ID in the auction's item columns.
+  const uint32_t slot;
 };
 }  // namespace auction_engine
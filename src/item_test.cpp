@@ -17,6 +17,7 @@ limitations under the License.
 #include <memory>
 #include <iostream>
 #include <iomanip>
+#include <vector>
 
 #include "bid.h"
 #include "error.h"
@@ -68,7 +69,7 @@ int main() {
   const auction_engine::Bid bid(bid_value, bid_user_id, id, bid_number);
 
   printTest("Testing Item::addBid()...");
-  item->addBid(bid);
+  item->addBid(std::make_shared<const auction_engine::Bid>(bid));
   printTestResult(true);
 
   printTest("Testing Item::getBid()...");
@@ -80,5 +81,43 @@ int main() {
   printTest("Testing Item::getCurrentValue()...");
   printTestResult(item->getCurrentValue() == bid.value);
 
+  printTest("Testing Bid::number past 65535 bids...");
+  auction.addUser("Alice", 1000000);
+  auction.addItem("Clock", 0);
+  auction.openItem(0);
+  const uint32_t kNumBids = 70000;
+  for (uint32_t value=1; value<=kNumBids; ++value)
+    auction.placeBid(0, 0, value);
+  const auction_engine::Item* clock;
+  auction.getItem(0, clock);
+  printTestResult(clock->getNumBids() == kNumBids &&
+                  clock->getBid(65536)->number == 65536 &&
+                  clock->getCurrentBid()->number == kNumBids - 1 &&
+                  clock->getCurrentBid()->sequence == kNumBids - 1);
+
+  printTest("Testing Item::getBidsFrom()...");
+  for (uint32_t number=30000; number<40000; ++number)
+    auction.retractBid(0, number);
+  std::vector<const auction_engine::Bid*> from_gap, from_start, from_end;
+  clock->getBidsFrom(35000, 3, from_gap);
+  clock->getBidsFrom(0, 2, from_start);
+  clock->getBidsFrom(kNumBids, 5, from_end);
+  printTestResult(from_gap.size() == 3 && from_gap[0]->number == 40000 &&
+                  from_gap[2]->number == 40002 && from_start.size() == 2 &&
+                  from_start[1]->number == 1 && from_end.empty());
+
+  printTest("Testing Item::getBid() after retractions...");
+  const auction_engine::Bid* before_gap;
+  const auction_engine::Bid* missing = clock->findBid(35000, before_gap);
+  const auction_engine::Bid* after_gap = clock->findBid(40000, before_gap);
+  auction.retractBid(0, kNumBids - 1);
+  printTestResult(clock->getNumBids() == kNumBids - 10001 &&
+                  clock->getBid(29999)->number == 29999 &&
+                  clock->getBid(30000)->number == 40000 &&
+                  after_gap == clock->getBid(30000) && !missing &&
+                  before_gap->number == 29999 &&
+                  clock->getCurrentBid()->number == kNumBids - 2 &&
+                  clock->getCurrentValue() == kNumBids - 1);
+
   return 0;
 }
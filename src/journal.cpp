@@ -0,0 +1,207 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "journal.h"
+#include "auction.h"
+#include "command_file.h"
+#include "error.h"
+#include "status.h"
+
+namespace auction_engine {
+
+namespace {
+
+/// Bytes read from a journal at a time.
+const size_t kReadSize = 64 * 1024;
+/// How long a follower waits before checking a tailed file or idle pipe
+/// again, in milliseconds.
+const int kIdleWaitMs = 1;
+
+/// Return the size of a name padded to a whole number of records.
+size_t paddedSize(size_t name_length) {
+  return (name_length + sizeof(CommandRecord) - 1) &
+         ~(sizeof(CommandRecord) - 1);
+}
+}  // namespace
+
+JournalWriter::~JournalWriter() {
+  if (fd >= 0) {
+    flush();
+    close(fd);
+  }
+}
+
+void JournalWriter::open(int fd, uint32_t hash_interval) {
+  if (this->fd >= 0)
+    close(this->fd);
+  this->fd = fd;
+  this->hash_interval = hash_interval;
+  num_since_hash = 0;
+  next_sequence = 0;
+  buffer.clear();
+}
+
+Status JournalWriter::openFile(const std::string& path,
+                               uint32_t hash_interval) {
+  const int file_fd = ::open(path.c_str(),
+                             O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (file_fd < 0) {
+    return error::IoError("Could not open journal \"", path, "\": ",
+                          strerror(errno));
+  }
+  open(file_fd, hash_interval);
+  return Status::OK();
+}
+
+void JournalWriter::append(const CommandRecord& record, std::string_view name,
+                           uint64_t sequence, const Auction& auction) {
+  if (sequence != next_sequence) {
+    CommandRecord sequence_record = {};
+    sequence_record.opcode = kSequenceRecord;
+    sequence_record.args[0] = uint32_t(sequence);
+    sequence_record.args[1] = uint32_t(sequence >> 32);
+    buffer.append(reinterpret_cast<const char*>(&sequence_record),
+                  sizeof(sequence_record));
+  }
+  next_sequence = sequence + 1;
+  buffer.append(reinterpret_cast<const char*>(&record), sizeof(record));
+  buffer.append(name.data(), record.name_length);
+  buffer.append(paddedSize(record.name_length) - record.name_length, '\0');
+  if (hash_interval && ++num_since_hash == hash_interval)
+    appendStateHash(auction);
+}
+
+void JournalWriter::appendStateHash(const Auction& auction) {
+  const uint64_t hash = auction.getStateHash();
+  CommandRecord record = {};
+  record.opcode = kStateHashRecord;
+  record.args[0] = uint32_t(hash);
+  record.args[1] = uint32_t(hash >> 32);
+  buffer.append(reinterpret_cast<const char*>(&record), sizeof(record));
+  num_since_hash = 0;
+}
+
+Status JournalWriter::flush() {
+  size_t written = 0;
+  while (written < buffer.size()) {
+    const ssize_t num_written = write(fd, buffer.data() + written,
+                                      buffer.size() - written);
+    if (num_written < 0) {
+      if (errno == EINTR)
+        continue;
+      buffer.erase(0, written);
+      return error::IoError("Writing the journal failed: ", strerror(errno));
+    }
+    written += num_written;
+  }
+  buffer.clear();
+  return Status::OK();
+}
+
+Status Follower::apply(const char* data, size_t size, size_t& consumed) {
+  consumed = 0;
+  while (size - consumed >= sizeof(CommandRecord)) {
+    CommandRecord record;
+    memcpy(&record, data + consumed, sizeof(record));
+    const size_t entry_size = sizeof(record) +
+                              paddedSize(record.name_length);
+    if (size - consumed < entry_size)
+      break;
+
+    if (record.opcode == kStateHashRecord) {
+      const uint64_t hash = uint64_t(record.args[1]) << 32 | record.args[0];
+      if (auction.getStateHash() != hash) {
+        return error::StateDiverged(
+            "State hash differs from the leader's after ", num_applied,
+            " commands.");
+      }
+      ++num_verified;
+    } else if (record.opcode == kSequenceRecord) {
+      next_sequence = uint64_t(record.args[1]) << 32 | record.args[0];
+    } else {
+      const std::string_view name(data + consumed + sizeof(record),
+                                  record.name_length);
+      Status status = applyCommand(auction, record, name);
+      if (!status.ok() && !isCommandApplied(record.opcode, status)) {
+        // The leader only journals commands that changed its auction.
+        return error::StateDiverged("Command ", num_applied,
+                                    " failed on the follower: ",
+                                    status.error_message());
+      }
+      if (!status.ok())
+        ++num_unarchived;
+      ++num_applied;
+      command_sequence = next_sequence++;
+    }
+    consumed += entry_size;
+  }
+  return Status::OK();
+}
+
+Status Follower::follow(int fd, const std::atomic<bool>& stop) {
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) < 0)
+    return error::IoError("Could not read the journal: ", strerror(errno));
+  const bool tail = S_ISREG(file_stat.st_mode);
+
+  // Stop is only honoured once everything written so far has been applied,
+  // so that a follower taking over has caught up with the leader.
+  std::string buffer;
+  while (true) {
+    if (!tail) {
+      // Wait for the leader with a timeout, so that stop is noticed.
+      pollfd poll_fd = {fd, POLLIN, 0};
+      const int ready = poll(&poll_fd, 1, kIdleWaitMs);
+      if (ready == 0 && stop.load(std::memory_order_relaxed))
+        return Status::OK();
+      if (ready == 0 || (ready < 0 && errno == EINTR))
+        continue;
+    }
+    const size_t old_size = buffer.size();
+    buffer.resize(old_size + kReadSize);
+    const ssize_t num_read = read(fd, &buffer[old_size], kReadSize);
+    buffer.resize(old_size + (num_read > 0 ? num_read : 0));
+    if (num_read < 0) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+      return error::IoError("Reading the journal failed: ", strerror(errno));
+    }
+    if (num_read == 0) {
+      // A closed pipe or socket means the leader is gone; a file may grow.
+      if (!tail || stop.load(std::memory_order_relaxed))
+        return Status::OK();
+      usleep(kIdleWaitMs * 1000);
+      continue;
+    }
+    size_t consumed;
+    Status status = apply(buffer.data(), buffer.size(), consumed);
+    buffer.erase(0, consumed);
+    if (!status.ok())
+      return status;
+  }
+}
+}  // namespace auction_engine
@@ -0,0 +1,201 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "command_file.h"
+#include "status.h"
+
+/**
+ * \file
+ * \brief The command journal a leader writes and a follower replays.
+ *
+ * A journal is a stream of \c CommandRecord entries in the order the leader
+ * applied them. The name of an added user or item follows its record
+ * directly, padded to a multiple of the record size, so a journal can be
+ * read as it is written. Every so often the leader also writes a state hash
+ * record, and the follower checks that its own auction hashes the same once
+ * it has applied everything before it.
+ *
+ * Each command carries the sequence number the leader gave it. Most take
+ * the number after the previous command's, so that number is implied, and
+ * a sequence record is only written before a command numbered otherwise.
+ */
+
+namespace auction_engine {
+
+/* Forward Declarations */
+class Auction;
+
+/// Opcode of a journal record carrying the leader's state hash, split over
+/// \c args[0] (low half) and \c args[1] (high half).
+const uint8_t kStateHashRecord = 0xFF;
+
+/// Opcode of a journal record giving the sequence number of the command
+/// after it, split over \c args[0] (low half) and \c args[1] (high half).
+const uint8_t kSequenceRecord = 0xFE;
+
+/**
+ * \brief Writes the commands an auction applies to a journal.
+ *
+ * Entries are buffered until \c flush(), which the leader calls before it
+ * acknowledges the commands, so a follower is never behind on a command a
+ * client has seen succeed.
+ */
+class JournalWriter {
+public:
+  JournalWriter()
+      : fd(-1), hash_interval(0), num_since_hash(0), next_sequence(0) {}
+  ~JournalWriter();
+
+  JournalWriter(const JournalWriter&) = delete;
+  JournalWriter& operator=(const JournalWriter&) = delete;
+
+  /**
+   * \brief Write the journal to an open file, pipe or socket.
+   *
+   * \param fd
+   *    Descriptor to write to. The writer takes ownership of it.
+   *
+   * \param hash_interval
+   *    Number of commands between state hashes, or 0 for none.
+   */
+  void open(int fd, uint32_t hash_interval);
+
+  /// Append the journal to the file at \c path, creating it if needed.
+  Status openFile(const std::string& path, uint32_t hash_interval);
+
+  /**
+   * \brief Journal a command \c auction has just applied.
+   *
+   * It is preceded by a sequence record if \c sequence is not the one after
+   * the previous command's, and followed by the state hash if one is due.
+   *
+   * \param record
+   *    The command.
+   *
+   * \param name
+   *    The bytes that follow the record, \c record.name_length of them.
+   *
+   * \param sequence
+   *    The number \c Auction::sequenceCommand() gave the command.
+   *
+   * \param auction
+   *    The auction that applied it.
+   */
+  void append(const CommandRecord& record, std::string_view name,
+              uint64_t sequence, const Auction& auction);
+
+  /// Journal \c auction's current state hash.
+  void appendStateHash(const Auction& auction);
+
+  /// Write everything buffered.
+  Status flush();
+
+private:
+  int fd;
+  uint32_t hash_interval;
+  uint32_t num_since_hash;
+  /// Sequence number implied for the next command.
+  uint64_t next_sequence;
+  std::string buffer;
+};
+
+/**
+ * \brief Keeps an auction in step with a leader by replaying its journal.
+ *
+ * The follower's auction must start in the same state as the leader's did
+ * when it began journaling, normally empty. As long as it only changes
+ * through the follower it stays identical to the leader, so it can take
+ * over as soon as \c follow() returns.
+ */
+class Follower {
+public:
+  explicit Follower(Auction& auction)
+      : auction(auction),
+        num_applied(0),
+        num_verified(0),
+        num_unarchived(0),
+        next_sequence(0),
+        command_sequence(0) {}
+
+  /**
+   * \brief Apply the complete journal entries at the start of a buffer.
+   *
+   * \param data
+   *    Journal bytes.
+   *
+   * \param size
+   *    Number of bytes at \c data.
+   *
+   * \param consumed
+   *    Set to the number of bytes applied. The rest are the start of an
+   *    entry not yet complete.
+   *
+   * \return \c Status containing error code and message. A
+   *    \c STATE_DIVERGED error means a state hash did not match.
+   */
+  Status apply(const char* data, size_t size, size_t& consumed);
+
+  /**
+   * \brief Read and apply a journal until the leader stops writing it.
+   *
+   * Returns once a pipe or socket is closed by the leader, or once \c stop
+   * is set and everything written so far has been applied. A regular file
+   * is tailed: at its end the follower waits for the leader to write more.
+   * Entries are applied as soon as they are read.
+   *
+   * \param fd
+   *    Descriptor to read the journal from.
+   *
+   * \param stop
+   *    Set by another thread to stop following, e.g. to take over.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status follow(int fd, const std::atomic<bool>& stop);
+
+  /// Return the number of commands applied.
+  uint64_t getNumApplied() const { return num_applied; }
+
+  /// Return the number of state hashes that matched.
+  uint64_t getNumVerified() const { return num_verified; }
+
+  /// Return the number of sales applied whose bids the follower's auction
+  /// could not archive. They are counted in \c getNumApplied(), since the
+  /// items were still sold.
+  uint64_t getNumUnarchived() const { return num_unarchived; }
+
+  /// Return the sequence number the leader gave the last command applied,
+  /// or 0 if none has been. It differs from the follower's own auction's
+  /// \c getCommandSequence() when the leader shares a \c Sequencer.
+  uint64_t getCommandSequence() const { return command_sequence; }
+
+private:
+  Auction& auction;
+  uint64_t num_applied;
+  uint64_t num_verified;
+  uint64_t num_unarchived;
+  /// Sequence number of the next command, as the leader numbered it.
+  uint64_t next_sequence;
+  uint64_t command_sequence;
+};
+}  // namespace auction_engine
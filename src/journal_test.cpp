@@ -0,0 +1,486 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "auction.h"
+#include "auction_client.h"
+#include "auction_server.h"
+#include "command_file.h"
+#include "error.h"
+#include "journal.h"
+#include "protocol.h"
+#include "sequencer.h"
+#include "status.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+namespace {
+
+/// Build a journal record the way a leader does.
+auction_engine::CommandRecord makeRecord(uint8_t opcode, uint32_t arg0,
+                                         uint32_t arg1=0, uint32_t arg2=0) {
+  auction_engine::CommandRecord record = {};
+  record.opcode = opcode;
+  record.args[0] = arg0;
+  record.args[1] = arg1;
+  record.args[2] = arg2;
+  return record;
+}
+
+/// Apply a command to the leader's auction and journal it.
+bool lead(auction_engine::Auction& auction,
+          auction_engine::JournalWriter& journal,
+          const auction_engine::CommandRecord& record,
+          std::string_view name=std::string_view()) {
+  auction_engine::CommandRecord named = record;
+  named.name_length = name.size();
+  if (!auction_engine::applyCommand(auction, named, name).ok())
+    return false;
+  journal.append(named, name, auction.getCommandSequence(), auction);
+  return true;
+}
+
+/// Run a small auction on the leader.
+bool runAuction(auction_engine::Auction& auction,
+                auction_engine::JournalWriter& journal) {
+  namespace protocol = auction_engine::protocol;
+  bool ok = lead(auction, journal, makeRecord(protocol::kAddUser, 0, 100000),
+                 "Alice") &&
+            lead(auction, journal, makeRecord(protocol::kAddUser, 0, 100000),
+                 "Bob");
+  for (uint32_t item=0; ok && item<10; ++item) {
+    ok = lead(auction, journal, makeRecord(protocol::kAddItem, 0, item),
+              "Item " + std::to_string(item)) &&
+         lead(auction, journal, makeRecord(protocol::kOpenItem, item));
+  }
+  for (uint32_t value=10; ok && value<100; ++value) {
+    ok = lead(auction, journal,
+              makeRecord(protocol::kPlaceBid, value % 10, value / 10 % 2,
+                         value));
+  }
+  return ok &&
+         lead(auction, journal, makeRecord(protocol::kCloseItem, 3, 1)) &&
+         lead(auction, journal, makeRecord(protocol::kCloseItem, 4, 0)) &&
+         lead(auction, journal, makeRecord(protocol::kRemoveItem, 4));
+}
+
+std::string readFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+}  // namespace
+
+int main() {
+  namespace protocol = auction_engine::protocol;
+  namespace error = auction_engine::error;
+  using auction_engine::Auction;
+  using auction_engine::Follower;
+  using auction_engine::JournalWriter;
+  using auction_engine::Status;
+
+  const std::string path = "/tmp/journal_test." + std::to_string(getpid()) +
+                           ".journal";
+
+  printTest("Testing Auction::getStateHash()...");
+  Auction first, second;
+  first.addUser("Alice", 100);
+  second.addUser("Alice", 100);
+  const bool same_hash = first.getStateHash() == second.getStateHash();
+  second.addItem("Lamp", 5);
+  const bool item_changes_hash = first.getStateHash() != second.getStateHash();
+  first.addItem("Lamb", 5);
+  printTestResult(same_hash && item_changes_hash &&
+                  first.getStateHash() != second.getStateHash());
+
+  printTest("Testing Auction::getStateHash() on other sales...");
+  Auction dutch_first, dutch_second;
+  for (Auction* auction : {&dutch_first, &dutch_second}) {
+    auction->addUser("Alice", 1000);
+    auction->addItem("Clock", 0);
+  }
+  dutch_first.openDutchItem(0, 1000, 100, 10, std::chrono::seconds(1));
+  dutch_second.openDutchItem(0, 1000, 100, 10, std::chrono::seconds(1));
+  // Clocks started at different times still match.
+  const bool same_clocks =
+      dutch_first.getStateHash() == dutch_second.getStateHash();
+  dutch_second.closeItem(0, false);
+  dutch_second.openDutchItem(0, 1000, 100, 20, std::chrono::seconds(1));
+  Auction lot_first, lot_second;
+  for (Auction* auction : {&lot_first, &lot_second}) {
+    auction->addUser("Alice", 1000);
+    auction->addItem("Chairs", 1);
+    auction->openMultiUnitItem(0, 4);
+  }
+  // Both bids reserve the same funds.
+  lot_first.placeQuantityBid(0, 0, 2, 5);
+  lot_second.placeQuantityBid(0, 0, 1, 10);
+  Auction bundle_first, bundle_second;
+  uint32_t bundle_id;
+  for (Auction* auction : {&bundle_first, &bundle_second}) {
+    auction->addUser("Alice", 1000);
+    for (uint32_t item=0; item<3; ++item) {
+      auction->addItem("Item " + std::to_string(item), 1);
+      auction->openItem(item);
+    }
+  }
+  // Both bundles reserve the same funds.
+  bundle_first.placeBundleBid(0, {0, 1}, 10, bundle_id);
+  bundle_second.placeBundleBid(0, {0, 2}, 10, bundle_id);
+  printTestResult(same_clocks &&
+                  dutch_first.getStateHash() != dutch_second.getStateHash() &&
+                  lot_first.getStateHash() != lot_second.getStateHash() &&
+                  bundle_first.getStateHash() != bundle_second.getStateHash());
+
+  printTest("Testing Follower over a pipe...");
+  int pipe_fds[2];
+  bool ok = pipe(pipe_fds) == 0;
+  Auction leader, standby;
+  Follower follower(standby);
+  std::atomic<bool> stop(false);
+  Status follow_status;
+  std::thread follow_thread([&]() {
+    follow_status = follower.follow(pipe_fds[0], stop);
+  });
+  {
+    JournalWriter journal;
+    journal.open(pipe_fds[1], 16);
+    ok = ok && runAuction(leader, journal);
+    journal.appendStateHash(leader);
+    ok = ok && journal.flush().ok();
+  }
+  // Closing the journal ends the follower.
+  follow_thread.join();
+  close(pipe_fds[0]);
+  printTestResult(ok && follow_status.ok() &&
+                  follower.getNumApplied() == 115 &&
+                  follower.getNumVerified() == 115 / 16 + 1 &&
+                  standby.getStateHash() == leader.getStateHash() &&
+                  standby.getRevenue() == leader.getRevenue() &&
+                  standby.getItems() == leader.getItems());
+
+  printTest("Testing Follower detecting divergence...");
+  remove(path.c_str());
+  {
+    Auction journaled;
+    JournalWriter journal;
+    ok = journal.openFile(path, 1).ok() && runAuction(journaled, journal) &&
+         journal.flush().ok();
+  }
+  const std::string journal_bytes = readFile(path);
+  Auction diverged;
+  diverged.addUser("Mallory", 1);
+  Follower diverged_follower(diverged);
+  size_t consumed;
+  Status status = diverged_follower.apply(journal_bytes.data(),
+                                          journal_bytes.size(), consumed);
+  printTestResult(ok && error::IsStateDiverged(status) &&
+                  diverged_follower.getNumApplied() == 1 &&
+                  diverged_follower.getNumVerified() == 0);
+
+  printTest("Testing Follower with partial entries...");
+  Auction partial;
+  Follower partial_follower(partial);
+  // Feed the journal a few bytes at a time, as a pipe might deliver it.
+  std::string pending;
+  ok = true;
+  for (size_t offset=0; ok && offset<journal_bytes.size(); offset+=7) {
+    pending.append(journal_bytes, offset, 7);
+    ok = partial_follower.apply(pending.data(), pending.size(),
+                                consumed).ok();
+    pending.erase(0, consumed);
+  }
+  printTestResult(ok && pending.empty() &&
+                  partial_follower.getNumApplied() == 115 &&
+                  partial_follower.getNumVerified() == 115 &&
+                  partial.getStateHash() == leader.getStateHash());
+
+  printTest("Testing Follower past an unarchived sale...");
+  // Bids cannot be mapped into /dev/null, so the sale cannot archive them.
+  Auction unarchived;
+  unarchived.enableArchive("/dev/null");
+  Follower unarchived_follower(unarchived);
+  status = unarchived_follower.apply(journal_bytes.data(),
+                                     journal_bytes.size(), consumed);
+  printTestResult(status.ok() && consumed == journal_bytes.size() &&
+                  unarchived_follower.getNumApplied() == 115 &&
+                  unarchived_follower.getNumUnarchived() == 1 &&
+                  unarchived.isSold(3) && !unarchived.isSold(4));
+
+  printTest("Testing Follower sequence numbers...");
+  remove(path.c_str());
+  auto sequencer = std::make_shared<auction_engine::Sequencer>();
+  Auction numbered, neighbour;
+  numbered.setSequencer(sequencer);
+  neighbour.setSequencer(sequencer);
+  {
+    JournalWriter journal;
+    ok = journal.openFile(path, 0).ok() &&
+         lead(numbered, journal, makeRecord(protocol::kAddUser, 0, 10),
+              "Alice");
+    // Another auction takes numbers between the leader's commands.
+    neighbour.addUser("Bob", 10);
+    neighbour.sequenceCommand();
+    ok = ok && lead(numbered, journal, makeRecord(protocol::kAddItem, 0, 1),
+                    "Lamp") &&
+         lead(numbered, journal, makeRecord(protocol::kOpenItem, 0)) &&
+         journal.flush().ok();
+  }
+  const std::string numbered_bytes = readFile(path);
+  Auction numbered_standby;
+  Follower numbered_follower(numbered_standby);
+  status = numbered_follower.apply(numbered_bytes.data(),
+                                   numbered_bytes.size(), consumed);
+  // Only the gap needs a sequence record.
+  printTestResult(ok && status.ok() &&
+                  numbered_bytes.size() ==
+                      sizeof(auction_engine::CommandRecord) * 6 &&
+                  numbered.getCommandSequence() == 3 &&
+                  numbered_follower.getCommandSequence() == 3 &&
+                  numbered_standby.getCommandSequence() == 2);
+
+  printTest("Testing applyCommand() after a direct bid...");
+  // A bid placed directly is not numbered as a command, and the next
+  // numbered command does not take its number.
+  numbered.placeBid(0, 0, 5);
+  const uint64_t after_bid = numbered.getBidSequence();
+  auction_engine::CommandRecord carol = makeRecord(protocol::kAddUser, 0, 10);
+  carol.name_length = 5;
+  status = auction_engine::applyCommand(numbered, carol, "Carol");
+  printTestResult(status.ok() && numbered.getCommandSequence() == after_bid);
+
+  printTest("Testing Follower tailing a server's journal...");
+  remove(path.c_str());
+  auction_engine::AuctionServer server;
+  std::unique_ptr<JournalWriter> server_journal =
+      std::make_unique<JournalWriter>();
+  ok = server_journal->openFile(path, 4).ok();
+  server.setJournal(std::move(server_journal));
+  uint16_t port;
+  ok = ok && server.listenTcp("127.0.0.1", 0, port).ok();
+  std::thread server_thread([&server]() { server.run(); });
+
+  Auction tail_standby;
+  Follower tail_follower(tail_standby);
+  const int tail_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  std::atomic<bool> take_over(false);
+  Status tail_status;
+  std::thread tail_thread([&]() {
+    tail_status = tail_follower.follow(tail_fd, take_over);
+  });
+
+  auction_engine::AuctionClient client;
+  protocol::Response alice, lamp, open_lamp, bid, taken, vase, open_vase,
+                     unsold;
+  ok = ok && client.connectTcp("127.0.0.1", port).ok() &&
+       client.call(protocol::kAddUser, {500}, alice, "Alice").ok() &&
+       client.call(protocol::kAddItem, {3}, lamp, "Lamp").ok() &&
+       client.call(protocol::kOpenItem, {lamp.results.at(0)},
+                   open_lamp).ok() &&
+       client.call(protocol::kPlaceBid,
+                   {lamp.results.at(0), alice.results.at(0), 40}, bid).ok() &&
+       // Failed commands are not journaled.
+       client.call(protocol::kAddUser, {1}, taken, "Alice").ok() &&
+       client.call(protocol::kAddItem, {3}, vase, "Vase").ok() &&
+       client.call(protocol::kOpenItem, {vase.results.at(0)},
+                   open_vase).ok() &&
+       // Selling an item without bids fails and leaves it open.
+       client.call(protocol::kCloseItem, {vase.results.at(0), 1},
+                   unsold).ok();
+  // Every acknowledged command is already in the journal.
+  take_over.store(true);
+  tail_thread.join();
+  close(tail_fd);
+  server.stop();
+  server_thread.join();
+  printTestResult(ok && tail_status.ok() && bid.code == error::OK &&
+                  taken.code == error::NAME_TAKEN &&
+                  unsold.code == error::NO_BID &&
+                  server.getAuction().isOpen(vase.results.at(0)) &&
+                  tail_follower.getNumApplied() == 6 &&
+                  tail_follower.getNumVerified() == 1 &&
+                  // Every applied command was numbered alike.
+                  tail_standby.getCommandSequence() == 5 &&
+                  tail_follower.getCommandSequence() == 5 &&
+                  server.getAuction().getCommandSequence() == 5 &&
+                  bid.results == std::vector<uint32_t>({3, 0}) &&
+                  tail_standby.getStateHash() ==
+                      server.getAuction().getStateHash());
+
+  printTest("Testing Follower replaying a Dutch sale...");
+  remove(path.c_str());
+  auction_engine::AuctionServer dutch_server;
+  std::unique_ptr<JournalWriter> dutch_journal =
+      std::make_unique<JournalWriter>();
+  ok = dutch_journal->openFile(path, 4).ok();
+  dutch_server.setJournal(std::move(dutch_journal));
+  ok = ok && dutch_server.listenTcp("127.0.0.1", 0, port).ok();
+  std::thread dutch_thread([&dutch_server]() { dutch_server.run(); });
+  auction_engine::AuctionClient dutch_client;
+  protocol::Response buyer, dutch_item, opened, accepted;
+  ok = ok && dutch_client.connectTcp("127.0.0.1", port).ok() &&
+       dutch_client.call(protocol::kAddUser, {1000}, buyer, "Alice").ok() &&
+       dutch_client.call(protocol::kAddItem, {0}, dutch_item, "Clock").ok() &&
+       dutch_client.call(protocol::kOpenDutchItem,
+                         {dutch_item.results.at(0), 1000, 100, 10, 1},
+                         opened).ok();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ok = ok && dutch_client.call(protocol::kAcceptDutchPrice,
+                               {dutch_item.results.at(0), buyer.results.at(0)},
+                               accepted).ok();
+  dutch_server.stop();
+  dutch_thread.join();
+  const Auction& dutch_leader = dutch_server.getAuction();
+  const uint32_t price = accepted.results.empty() ? 0 : accepted.results[0];
+  // The standby opens the item from the journal after the leader did, so
+  // its clock shows a higher price while it replays the acceptance.
+  const std::string dutch_bytes = readFile(path);
+  Auction dutch_standby;
+  Follower dutch_follower(dutch_standby);
+  status = dutch_follower.apply(dutch_bytes.data(), dutch_bytes.size(),
+                                consumed);
+  Auction off_step;
+  off_step.addUser("Alice", 1000);
+  off_step.addItem("Clock", 0);
+  off_step.openDutchItem(0, 1000, 100, 10, std::chrono::milliseconds(1));
+  Status off_step_status = off_step.acceptDutchPriceAt(0, 0, 995);
+  printTestResult(ok && status.ok() && opened.code == error::OK &&
+                  accepted.code == error::OK && price < 1000 &&
+                  dutch_follower.getNumApplied() == 4 &&
+                  dutch_follower.getNumVerified() == 1 &&
+                  dutch_standby.getRevenue() == price &&
+                  dutch_standby.getStateHash() ==
+                      dutch_leader.getStateHash() &&
+                  error::IsInvalidBid(off_step_status) &&
+                  off_step.acceptDutchPriceAt(0, 0, 990).ok() &&
+                  off_step.getRevenue() == 990);
+
+  printTest("Testing Follower replaying a bundle clearing...");
+  remove(path.c_str());
+  auction_engine::AuctionServer bundle_server;
+  std::unique_ptr<JournalWriter> bundle_journal =
+      std::make_unique<JournalWriter>();
+  ok = bundle_journal->openFile(path, 4).ok();
+  bundle_server.setJournal(std::move(bundle_journal));
+  ok = ok && bundle_server.listenTcp("127.0.0.1", 0, port).ok();
+  std::thread bundle_thread([&bundle_server]() { bundle_server.run(); });
+  auction_engine::AuctionClient bundle_client;
+  protocol::Response response, alice_bundle, bob_bundle, cleared;
+  ok = ok && bundle_client.connectTcp("127.0.0.1", port).ok() &&
+       bundle_client.call(protocol::kAddUser, {1000}, response, "Alice").ok() &&
+       bundle_client.call(protocol::kAddUser, {1000}, response, "Bob").ok();
+  for (uint32_t item=0; ok && item<3; ++item) {
+    ok = bundle_client.call(protocol::kAddItem, {1}, response,
+                            "Item " + std::to_string(item)).ok() &&
+         bundle_client.call(protocol::kOpenItem, {item}, response).ok();
+  }
+  // Alice's bundle is worth more than Bob's bundle and Bob's bid together.
+  ok = ok && bundle_client.call(protocol::kPlaceBid, {0, 1, 100},
+                                response).ok() &&
+       bundle_client.call(protocol::kPlaceBundleBid, {0, 500, 1, 0},
+                          alice_bundle).ok() &&
+       bundle_client.call(protocol::kPlaceBundleBid, {1, 300, 1, 2},
+                          bob_bundle).ok() &&
+       bundle_client.call(protocol::kClearBundles, {0}, cleared).ok();
+  bundle_server.stop();
+  bundle_thread.join();
+  const Auction& bundle_leader = bundle_server.getAuction();
+  const std::string bundle_bytes = readFile(path);
+  Auction bundle_standby;
+  Follower bundle_follower(bundle_standby);
+  status = bundle_follower.apply(bundle_bytes.data(), bundle_bytes.size(),
+                                 consumed);
+  printTestResult(ok && status.ok() && alice_bundle.code == error::OK &&
+                  alice_bundle.results.at(0) == 0 &&
+                  bob_bundle.results.at(0) == 1 &&
+                  cleared.results.size() == 5 &&
+                  cleared.results[0] == 1 && cleared.results[1] == 2 &&
+                  cleared.results[2] == 1 &&
+                  // The clearing took a number for each item it sold.
+                  cleared.results[3] == 12 &&
+                  bundle_follower.getCommandSequence() == 12 &&
+                  bundle_follower.getNumApplied() == 12 &&
+                  bundle_follower.getNumVerified() == 3 &&
+                  bundle_standby.getRevenue() == 500 &&
+                  bundle_standby.isSold(0) && bundle_standby.isSold(1) &&
+                  bundle_standby.isOpen(2) &&
+                  bundle_standby.getStateHash() ==
+                      bundle_leader.getStateHash());
+
+  printTest("Testing Follower replaying a multi-unit sale...");
+  remove(path.c_str());
+  auction_engine::AuctionServer lot_server;
+  std::unique_ptr<JournalWriter> lot_journal =
+      std::make_unique<JournalWriter>();
+  ok = lot_journal->openFile(path, 4).ok();
+  lot_server.setJournal(std::move(lot_journal));
+  ok = ok && lot_server.listenTcp("127.0.0.1", 0, port).ok();
+  std::thread lot_thread([&lot_server]() { lot_server.run(); });
+  auction_engine::AuctionClient lot_client;
+  protocol::Response lot_opened, alice_units, bob_units, lot_sold;
+  // Three units go to Alice's two and one of Bob's at Bob's price.
+  ok = ok && lot_client.connectTcp("127.0.0.1", port).ok() &&
+       lot_client.call(protocol::kAddUser, {1000}, response, "Alice").ok() &&
+       lot_client.call(protocol::kAddUser, {1000}, response, "Bob").ok() &&
+       lot_client.call(protocol::kAddItem, {1}, response, "Tickets").ok() &&
+       lot_client.call(protocol::kOpenMultiUnitItem, {0, 3},
+                       lot_opened).ok() &&
+       lot_client.call(protocol::kPlaceQuantityBid, {0, 0, 2, 10},
+                       alice_units).ok() &&
+       lot_client.call(protocol::kPlaceQuantityBid, {0, 1, 2, 8},
+                       bob_units).ok() &&
+       lot_client.call(protocol::kSellItem, {0}, lot_sold).ok();
+  lot_server.stop();
+  lot_thread.join();
+  const std::string lot_bytes = readFile(path);
+  Auction lot_standby;
+  Follower lot_follower(lot_standby);
+  status = lot_follower.apply(lot_bytes.data(), lot_bytes.size(), consumed);
+  const auction_engine::MultiUnitLot* standby_lot = nullptr;
+  lot_standby.getMultiUnitLot(0, standby_lot);
+  printTestResult(ok && status.ok() && lot_opened.code == error::OK &&
+                  alice_units.code == error::OK &&
+                  bob_units.code == error::OK && lot_sold.code == error::OK &&
+                  lot_follower.getNumApplied() == 7 &&
+                  lot_follower.getNumVerified() == 1 &&
+                  standby_lot && standby_lot->clearing_price == 8 &&
+                  lot_standby.getRevenue() == 24 &&
+                  lot_standby.getStateHash() ==
+                      lot_server.getAuction().getStateHash());
+
+  remove(path.c_str());
+  return 0;
+}
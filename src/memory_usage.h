@@ -0,0 +1,54 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <stddef.h>
+
+namespace auction_engine {
+
+/**
+ * \brief Estimated bytes an auction holds, by kind of structure.
+ *
+ * Figures are estimates from counts the auction keeps as it goes, so taking
+ * them costs the same however large the auction is. Heap overhead is
+ * included at a typical allocator's rate; spare vector capacity and pages
+ * shared with snapshots are not told apart, and quantity and bundle bids are
+ * counted by size alone.
+ */
+struct MemoryUsage {
+  /// Item objects, their slots and their columns.
+  size_t items = 0;
+
+  /// User objects, their slots and their columns.
+  size_t users = 0;
+
+  /// Bids held in memory, including quantity and bundle bids, and the lists
+  /// of them kept by items and users. Archived bids are not counted.
+  size_t bids = 0;
+
+  /// Lookups from names to IDs, from items to their bidders and from users to
+  /// the items they bid on, the open and sold item lists and the quote board.
+  size_t indexes = 0;
+
+  /// Names in the name pool.
+  size_t strings = 0;
+
+  /// Return the estimated total.
+  size_t getTotal() const {
+    return items + users + bids + indexes + strings;
+  }
+};
+}  // namespace auction_engine
@@ -0,0 +1,49 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <stdint.h>
+
+#include "multi_unit.h"
+
+namespace auction_engine {
+
+uint32_t clearUniformPrice(uint32_t num_units,
+                           const std::vector<QuantityBid>& bids,
+                           std::vector<uint32_t>& filled) {
+  // Sort indices rather than the bids so filled lines up with them.
+  std::vector<uint32_t> order(bids.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&bids](uint32_t a, uint32_t b) {
+    if (bids[a].unit_price != bids[b].unit_price)
+      return bids[a].unit_price > bids[b].unit_price;
+    return bids[a].sequence < bids[b].sequence;
+  });
+
+  filled.assign(bids.size(), 0);
+  uint32_t remaining = num_units;
+  uint32_t clearing_price = 0;
+  for (uint32_t index: order) {
+    if (!remaining)
+      break;
+    filled[index] = std::min(remaining, bids[index].quantity);
+    remaining -= filled[index];
+    clearing_price = bids[index].unit_price;
+  }
+  return clearing_price;
+}
+}  // namespace auction_engine
@@ -0,0 +1,87 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+namespace auction_engine {
+
+/// A bid for several units of a multi-unit item at one price per unit.
+struct QuantityBid {
+  /// User that placed the bid.
+  uint32_t user_id;
+  /// Number of units wanted.
+  uint32_t quantity;
+  /// Highest price the user will pay per unit.
+  uint32_t unit_price;
+  /// Auction-wide sequence number, which breaks ties between equal prices.
+  uint64_t sequence;
+};
+
+/// Units of a multi-unit item awarded to one \c QuantityBid.
+struct UnitAllocation {
+  /// User that placed the bid.
+  uint32_t user_id;
+  /// Number of units awarded, at most the bid's quantity.
+  uint32_t quantity;
+  /// Amount paid: \c quantity times the clearing price.
+  uint32_t cost;
+};
+
+/**
+ * \brief The units, bids and outcome of a multi-unit item.
+ *
+ * A multi-unit item sells \c num_units identical units. Each bid asks for a
+ * quantity at a price per unit, and the funds for the whole quantity are
+ * reserved when it is placed. When the item is sold every winning bid pays
+ * the same clearing price per unit.
+ */
+struct MultiUnitLot {
+  /// Number of units for sale.
+  uint32_t num_units = 0;
+  /// Bids in the order they were placed.
+  std::vector<QuantityBid> bids;
+  /// Price every unit sold for, set when the item is sold.
+  uint32_t clearing_price = 0;
+  /// Units awarded to each winning bid, in the order the bids were placed.
+  /// Set when the item is sold.
+  std::vector<UnitAllocation> allocations;
+};
+
+/**
+ * \brief Clear a multi-unit item at a uniform price.
+ *
+ * Bids are filled from the highest price down, earlier bids first among
+ * equal prices, until the units run out; the last bid filled may only get
+ * part of its quantity. Every unit sells at the price of the lowest bid that
+ * is filled. Takes O(n log n) time in the number of bids.
+ *
+ * \param num_units
+ *    Number of units for sale.
+ *
+ * \param bids
+ *    The bids placed on the item.
+ *
+ * \param filled
+ *    Set to the number of units awarded to each bid, indexed like \c bids.
+ *
+ * \return The clearing price, or 0 if there are no bids.
+ */
+uint32_t clearUniformPrice(uint32_t num_units,
+                           const std::vector<QuantityBid>& bids,
+                           std::vector<uint32_t>& filled);
+}  // namespace auction_engine
@@ -0,0 +1,121 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <utility>
+#include <stdint.h>
+
+#include "name_pool.h"
+
+namespace auction_engine {
+
+const size_t NamePool::kBlockSize;
+const uint32_t NamePool::kFirstChunkBits;
+const uint32_t NamePool::kMaxChunks;
+
+NamePool::NamePool(std::shared_ptr<const NamePool> base)
+    : block_used(kBlockSize),
+      bytes_allocated(base->getBytesAllocated()),
+      base_size(base->size()) {
+  // Set on the base owner's thread, which creates layers, so its later
+  // interns take the lock.
+  base->has_layers.store(true, std::memory_order_relaxed);
+  this->base = std::move(base);
+}
+
+uint32_t NamePool::intern(std::string_view name) {
+  // Only the owner changes the index, so its own lookups need no lock.
+  auto it = handles.find(name);
+  if (it != handles.end())
+    return it->second;
+  uint32_t base_handle;
+  if (base && base->find(name, base_handle) && base_handle < base_size)
+    return base_handle;
+
+  const uint32_t local = num_entries;
+  const uint32_t chunk = chunkOf(local);
+  if (!entry_chunks[chunk])
+    entry_chunks[chunk].reset(new Entry[size_t(1) << (chunk + kFirstChunkBits)]);
+  const char* data = store(name);
+  entry_chunks[chunk][offsetOf(local, chunk)] =
+      {data, static_cast<uint32_t>(name.size())};
+  ++num_entries;
+  const uint32_t handle = base_size + local;
+  if (has_layers.load(std::memory_order_relaxed)) {
+    std::unique_lock<std::shared_mutex> lock(handles_mutex);
+    handles.emplace(std::string_view(data, name.size()), handle);
+  } else {
+    handles.emplace(std::string_view(data, name.size()), handle);
+  }
+  return handle;
+}
+
+bool NamePool::find(std::string_view name, uint32_t& handle) const {
+  {
+    std::shared_lock<std::shared_mutex> lock(handles_mutex, std::defer_lock);
+    if (has_layers.load(std::memory_order_relaxed))
+      lock.lock();
+    auto it = handles.find(name);
+    if (it != handles.end()) {
+      handle = it->second;
+      return true;
+    }
+  }
+  // Names the base took after this layer was created belong to its owner.
+  uint32_t base_handle;
+  if (!base || !base->find(name, base_handle) || base_handle >= base_size)
+    return false;
+  handle = base_handle;
+  return true;
+}
+
+void NamePool::reserve(size_t num_names) {
+  const size_t num_local = num_names > base_size ? num_names - base_size : 0;
+  if (has_layers.load(std::memory_order_relaxed)) {
+    std::unique_lock<std::shared_mutex> lock(handles_mutex);
+    handles.reserve(num_local);
+  } else {
+    handles.reserve(num_local);
+  }
+}
+
+const char* NamePool::store(std::string_view name) {
+  if (name.size() > kBlockSize / 4) {
+    // Give long names their own block, inserted before the current one so
+    // that the current block keeps filling.
+    std::unique_ptr<char[]> block(new char[name.size()]);
+    char* data = block.get();
+    std::memcpy(data, name.data(), name.size());
+    blocks.insert(blocks.empty() ? blocks.end() : blocks.end() - 1,
+                  std::move(block));
+    bytes_allocated += name.size();
+    return data;
+  }
+
+  if (block_used + name.size() > kBlockSize) {
+    blocks.emplace_back(new char[kBlockSize]);
+    bytes_allocated += kBlockSize;
+    block_used = 0;
+  }
+  char* data = blocks.back().get() + block_used;
+  std::memcpy(data, name.data(), name.size());
+  block_used += name.size();
+  return data;
+}
+}  // namespace auction_engine
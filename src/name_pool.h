@@ -0,0 +1,145 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+namespace auction_engine {
+
+/**
+ * \brief Append-only pool of interned names.
+ *
+ * Names are copied once into large arena blocks and referred to by a compact
+ * \c uint32_t handle. Interning the same name twice returns the same handle,
+ * so an item and a user with the same name share storage. Blocks are never
+ * moved or freed while the pool exists, so views returned by \c get() stay
+ * valid for the life of the pool.
+ *
+ * The handle table is also kept in chunks that never move, so other threads
+ * may call \c get() for handles they were given while the owner keeps
+ * interning new names.
+ *
+ * A pool can also be layered over a base pool, for a forked auction: it
+ * reads the names the base held when the layer was created through the
+ * base, and gives the names interned into it handles from there on. The
+ * layer only indexes its own names and looks the rest up in the base, so
+ * creating one copies nothing. Once a pool has a layer, its index is guarded
+ * by a lock, so its owner may keep interning names while layers on other
+ * threads look names up in it; names it interns after a layer was created
+ * are not part of that layer.
+ */
+class NamePool {
+public:
+  NamePool() : block_used(kBlockSize) {}
+
+  /// Create a pool layered over the names \c base holds now.
+  explicit NamePool(std::shared_ptr<const NamePool> base);
+
+  NamePool(const NamePool&) = delete;
+  NamePool& operator=(const NamePool&) = delete;
+
+  /// Return the handle for \c name, adding it to the pool if needed.
+  uint32_t intern(std::string_view name);
+
+  /**
+   * \brief Look up the handle for \c name without adding it.
+   *
+   * \param name
+   *    Name to look up.
+   *
+   * \param handle
+   *    Set to the name's handle if it is in the pool.
+   *
+   * \return \c true if \c name is in the pool.
+   */
+  bool find(std::string_view name, uint32_t& handle) const;
+
+  /// Return the name for a \c handle returned by \c intern().
+  std::string_view get(uint32_t handle) const {
+    if (handle < base_size)
+      return base->get(handle);
+    handle -= base_size;
+    const uint32_t chunk = chunkOf(handle);
+    const Entry& entry = entry_chunks[chunk][offsetOf(handle, chunk)];
+    return std::string_view(entry.data, entry.size);
+  }
+
+  /// Return the number of distinct names in the pool, including those read
+  /// from a base pool.
+  size_t size() const { return base_size + num_entries; }
+
+  /// Make room for \c num_names names in total without rehashing.
+  void reserve(size_t num_names);
+
+  /// Return the number of bytes of arena blocks allocated, including those
+  /// of a base pool when the layer was created.
+  size_t getBytesAllocated() const { return bytes_allocated; }
+
+private:
+  /// Size of an arena block. Longer names get a block of their own.
+  static const size_t kBlockSize = 64 * 1024;
+
+  struct Entry {
+    const char* data;
+    uint32_t size;
+  };
+
+  /// Log2 of the number of entries in the first chunk of the handle table.
+  static const uint32_t kFirstChunkBits = 8;
+  /// Enough chunks to hold every 32-bit handle.
+  static const uint32_t kMaxChunks = 32 - kFirstChunkBits + 1;
+
+  /// Return the chunk of the handle table holding \c handle.
+  static uint32_t chunkOf(uint32_t handle) {
+    const uint64_t biased = uint64_t(handle) + (uint64_t(1) << kFirstChunkBits);
+    return 63 - __builtin_clzll(biased) - kFirstChunkBits;
+  }
+
+  /// Return the index of \c handle within \c chunk.
+  static uint32_t offsetOf(uint32_t handle, uint32_t chunk) {
+    const uint64_t biased = uint64_t(handle) + (uint64_t(1) << kFirstChunkBits);
+    return biased - (uint64_t(1) << (chunk + kFirstChunkBits));
+  }
+
+  /// Copy \c name into the arena.
+  const char* store(std::string_view name);
+
+
+  std::vector<std::unique_ptr<char[]>> blocks;
+  /// Bytes used in the last block.
+  size_t block_used;
+  size_t bytes_allocated = 0;
+  /// Handle table, from \c base_size on. Chunk k holds
+  /// 2^(k + kFirstChunkBits) entries.
+  std::unique_ptr<Entry[]> entry_chunks[kMaxChunks];
+  uint32_t num_entries = 0;
+  /// Pool holding the names with handles below \c base_size, if any.
+  std::shared_ptr<const NamePool> base;
+  uint32_t base_size = 0;
+  /// Handles by name, from \c base_size on. Keys point into the arena.
+  std::unordered_map<std::string_view, uint32_t> handles;
+  /// Whether a pool has been layered over this one, after which \c handles
+  /// is only changed under \c handles_mutex.
+  mutable std::atomic<bool> has_layers{false};
+  mutable std::shared_mutex handles_mutex;
+};
+}  // namespace auction_engine
@@ -0,0 +1,125 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stddef.h>
+
+namespace auction_engine {
+
+/**
+ * \brief A column of values stored in fixed-size copy-on-write pages.
+ *
+ * Copying a column only copies its page pointers, and the copy shares every
+ * page with the original until one of them writes to it. Writes go through
+ * \c mutate(), which first gives the writer its own copy of the page if any
+ * other column still shares it. This makes a copy a cheap point-in-time
+ * snapshot: the original keeps changing while the copy stays as it was, and
+ * the pages only the copy still holds are freed when it is destroyed.
+ *
+ * A column and its copies may be used from different threads, as long as
+ * each one is only used by one thread at a time.
+ */
+template <typename T>
+class PagedColumn {
+public:
+  /// Log2 of the number of values in a page.
+  static const size_t kPageBits = 10;
+  /// Number of values in a page.
+  static const size_t kPageSize = size_t(1) << kPageBits;
+
+  /// Create an empty column whose new entries are set to \c fill.
+  explicit PagedColumn(T fill=T()) : fill(fill), num_values(0) {}
+
+  /// Return the number of values in the column.
+  size_t size() const { return num_values; }
+
+  /// Return the value at \c index.
+  const T& operator[](size_t index) const {
+    return pages[index >> kPageBits]->values[index & (kPageSize - 1)];
+  }
+
+  /// Return a writable reference to the value at \c index, copying its page
+  /// first if it is shared.
+  T& mutate(size_t index) {
+    std::shared_ptr<Page>& page = pages[index >> kPageBits];
+    if (page.use_count() != 1) {
+      page = std::make_shared<Page>(*page);
+    } else {
+      // Pair with the release in the last sharer's reference drop, so its
+      // reads of the page happen before this write.
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return page->values[index & (kPageSize - 1)];
+  }
+
+  /// Resize the column to \c size values. New values are set to the fill
+  /// value.
+  void resize(size_t size) {
+    const size_t old_size = num_values;
+    const size_t old_num_pages = pages.size();
+    pages.resize((size + kPageSize - 1) >> kPageBits);
+    num_values = size;
+    // Reset the old tail of the last page kept, which may hold stale values.
+    const size_t kept_end = std::min(size, old_num_pages << kPageBits);
+    for (size_t i=old_size; i<kept_end; ++i)
+      mutate(i) = fill;
+    for (size_t i=old_num_pages; i<pages.size(); ++i) {
+      pages[i] = std::make_shared<Page>();
+      std::fill(pages[i]->values, pages[i]->values + kPageSize, fill);
+    }
+  }
+
+  /// Release memory held for pages beyond the column's size.
+  void shrink_to_fit() { pages.shrink_to_fit(); }
+
+  /// Return the number of bytes of pages and page pointers held, counting
+  /// pages shared with copies in full.
+  size_t getBytesAllocated() const {
+    return pages.capacity() * sizeof(pages[0]) + pages.size() * sizeof(Page);
+  }
+
+  /// Return the number of pages. Page \c i holds the values from index
+  /// \c i*kPageSize on.
+  size_t getNumPages() const { return pages.size(); }
+
+  /// Return the values of page \c page, for scanning them in bulk.
+  const T* getPage(size_t page) const { return pages[page]->values; }
+
+  /// Return the number of values in use in page \c page.
+  size_t getPageLength(size_t page) const {
+    return std::min(kPageSize, num_values - (page << kPageBits));
+  }
+
+private:
+  struct Page {
+    T values[kPageSize];
+  };
+
+  std::vector<std::shared_ptr<Page>> pages;
+  T fill;
+  size_t num_values;
+};
+
+template <typename T>
+const size_t PagedColumn<T>::kPageBits;
+
+template <typename T>
+const size_t PagedColumn<T>::kPageSize;
+}  // namespace auction_engine
@@ -21,6 +21,7 @@ limitations under the License.
 
 #include "bid.h"
 #include "auction.h"
+#include "auction_snapshot.h"
 #include "item.h"
 #include "user.h"
 
@@ -150,5 +151,43 @@ void printUserList(const Auction& auction,
   }
   printLine(5);
 }
+
+void printItemList(const AuctionSnapshot& snapshot,
+                   const std::vector<uint32_t> item_ids) {
+  printEntry("Item Name");
+  printEntry("Item ID");
+  printEntry("Current Value");
+  printEntry("Sold?");
+  std::cout << std::endl;
+  printLine(4);
+  for (auto const& item_id: item_ids) {
+    printEntry(snapshot.getItemName(item_id));
+    printEntry(item_id);
+    printEntry(snapshot.getCurrentValue(item_id));
+    snapshot.isSold(item_id) ? printEntry("Yes") : printEntry("No");
+    std::cout << std::endl;
+  }
+  printLine(4);
+}
+
+void printUserList(const AuctionSnapshot& snapshot,
+                   const std::vector<uint32_t> user_ids) {
+  printEntry("User Name");
+  printEntry("User ID");
+  printEntry("Total Funds");
+  printEntry("Avail. Funds");
+  printEntry("# Items Bid On");
+  std::cout << std::endl;
+  printLine(5);
+  for (auto const& user_id: user_ids) {
+    printEntry(snapshot.getUserName(user_id));
+    printEntry(user_id);
+    printEntry(snapshot.getTotalFunds(user_id));
+    printEntry(snapshot.getAvailableFunds(user_id));
+    printEntry(snapshot.getNumItemsBidOn(user_id));
+    std::cout << std::endl;
+  }
+  printLine(5);
+}
 }  // namespace print
 }  // namespace auction_engine
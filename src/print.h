@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <vector>
 
+#include "auction_snapshot.h"
 #include "bid.h"
 #include "item.h"
 #include "user.h"
@@ -36,5 +37,11 @@ void printItemList(const Auction& auction, const std::vector<uint32_t> item_ids)
 
 void printUserList(const Auction& auction, const std::vector<uint32_t> user_ids);
 
+void printItemList(const AuctionSnapshot& snapshot,
+                   const std::vector<uint32_t> item_ids);
+
+void printUserList(const AuctionSnapshot& snapshot,
+                   const std::vector<uint32_t> user_ids);
+
 }  // namespace print
 }  // namespace auction_engine
@@ -0,0 +1,166 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <string>
+#include <string_view>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+#include "error_codes.h"
+
+namespace auction_engine {
+namespace protocol {
+
+namespace {
+
+void putU16(std::string& out, uint16_t value) {
+  out.push_back(char(value));
+  out.push_back(char(value >> 8));
+}
+
+void putU32(std::string& out, uint32_t value) {
+  const char bytes[4] = {char(value), char(value >> 8), char(value >> 16),
+                         char(value >> 24)};
+  out.append(bytes, 4);
+}
+
+uint16_t getU16(const char* data) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  return uint16_t(bytes[0]) | uint16_t(bytes[1]) << 8;
+}
+
+uint32_t getU32(const char* data) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  return uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 |
+         uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24;
+}
+
+/// Reserve the length prefix of a frame and return its position.
+size_t beginFrame(std::string& out) {
+  const size_t start = out.size();
+  out.append(kFrameHeaderSize, '\0');
+  return start;
+}
+
+/// Fill in the length prefix of the frame begun at \c start.
+void endFrame(std::string& out, size_t start) {
+  const uint32_t body_size = out.size() - start - kFrameHeaderSize;
+  for (size_t i=0; i<kFrameHeaderSize; ++i)
+    out[start + i] = char(body_size >> (8 * i));
+}
+}  // namespace
+
+bool changesAuction(uint8_t opcode) {
+  // Every opcode is listed, so -Wswitch flags one added without a decision.
+  switch (Opcode(opcode)) {
+    case kAddUser:
+    case kAddItem:
+    case kOpenItem:
+    case kCloseItem:
+    case kSellItem:
+    case kPlaceBid:
+    case kRemoveItem:
+    case kRemoveUser:
+    case kRetractBid:
+    case kAcceptDutchPrice:
+    case kOpenDutchItem:
+    case kPlaceBundleBid:
+    case kClearBundles:
+    case kOpenMultiUnitItem:
+    case kPlaceQuantityBid:
+      return true;
+    case kFindItem:
+    case kFindUser:
+    case kGetQuote:
+    case kGetUser:
+    case kGetRevenue:
+    case kGetOpenItems:
+    case kGetSoldItems:
+      return false;
+  }
+  return false;
+}
+
+bool nextFrame(const char* data, size_t size, uint32_t& body_size) {
+  if (size < kFrameHeaderSize)
+    return false;
+  body_size = getU32(data);
+  return size - kFrameHeaderSize >= body_size;
+}
+
+void appendRequest(std::string& out, uint8_t opcode, uint8_t flags,
+                   std::string_view name, const uint32_t* args,
+                   size_t num_args) {
+  const size_t start = beginFrame(out);
+  out.push_back(char(opcode));
+  out.push_back(char(flags));
+  putU16(out, name.size());
+  out.append(name.data(), name.size());
+  for (size_t i=0; i<num_args; ++i)
+    putU32(out, args[i]);
+  endFrame(out, start);
+}
+
+bool parseRequest(const char* body, size_t size, Request& request) {
+  if (size < 4)
+    return false;
+  request.opcode = body[0];
+  request.flags = body[1];
+  const size_t name_size = getU16(body + 2);
+  if (size - 4 < name_size)
+    return false;
+  request.name = std::string_view(body + 4, name_size);
+  const size_t args_size = size - 4 - name_size;
+  if (args_size % 4 || args_size / 4 > kMaxArgs)
+    return false;
+  request.num_args = args_size / 4;
+  for (size_t i=0; i<request.num_args; ++i)
+    request.args[i] = getU32(body + 4 + name_size + 4*i);
+  return true;
+}
+
+void appendResponse(std::string& out, error::Code code,
+                    const uint32_t* results, size_t num_results,
+                    std::string_view message) {
+  const size_t start = beginFrame(out);
+  out.push_back(char(code));
+  if (code == error::OK) {
+    for (size_t i=0; i<num_results; ++i)
+      putU32(out, results[i]);
+  } else {
+    out.append(message.data(), message.size());
+  }
+  endFrame(out, start);
+}
+
+bool parseResponse(const char* body, size_t size, Response& response) {
+  if (size < 1)
+    return false;
+  response.code = error::Code(body[0]);
+  response.results.clear();
+  response.message.clear();
+  if (response.code != error::OK) {
+    response.message.assign(body + 1, size - 1);
+    return true;
+  }
+  if ((size - 1) % 4)
+    return false;
+  for (size_t offset=1; offset<size; offset+=4)
+    response.results.push_back(getU32(body + offset));
+  return true;
+}
+}  // namespace protocol
+}  // namespace auction_engine
@@ -0,0 +1,172 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "error_codes.h"
+
+/**
+ * \file
+ * \brief The binary protocol spoken by \c AuctionServer and \c AuctionClient.
+ *
+ * Every message is a frame: a little-endian \c uint32_t giving the length of
+ * the body, then the body. A request body is
+ *
+ *    uint8  opcode
+ *    uint8  flags
+ *    uint16 name length, followed by that many bytes of name
+ *    uint32 arguments, as many as fit in the rest of the body
+ *
+ * and a response body is
+ *
+ *    uint8  error::Code
+ *    uint32 results, if the code is OK
+ *    the error message, if the code is not OK and the request set
+ *    \c kWantMessage
+ *
+ * A command that changes the auction (see \c changesAuction()) returns its
+ * sequence number as two more results after the ones its \c Opcode lists,
+ * low half first.
+ *
+ * Responses are sent in the order the requests were received, so a client
+ * can send many requests before reading any response.
+ */
+
+namespace auction_engine {
+namespace protocol {
+
+/// Operations a request can ask for, with the name and arguments each takes
+/// and the results it returns.
+enum Opcode : uint8_t {
+  /// name, funds -> user ID
+  kAddUser = 1,
+  /// name, starting value -> item ID
+  kAddItem,
+  /// item ID
+  kOpenItem,
+  /// item ID, sell (0 or 1)
+  kCloseItem,
+  /// item ID
+  kSellItem,
+  /// item ID, user ID, value
+  kPlaceBid,
+  /// item ID
+  kRemoveItem,
+  /// user ID
+  kRemoveUser,
+  /// name -> item ID
+  kFindItem,
+  /// name -> user ID
+  kFindUser,
+  /// item ID -> value, leader, number of bids, open (0 or 1), sold (0 or 1)
+  kGetQuote,
+  /// user ID -> total funds, available funds, number of items bid on
+  kGetUser,
+  /// -> revenue
+  kGetRevenue,
+  /// -> IDs of the items open for bidding
+  kGetOpenItems,
+  /// -> IDs of the items sold
+  kGetSoldItems,
+  /// item ID, bid number
+  kRetractBid,
+  /// item ID, user ID -> price paid
+  kAcceptDutchPrice,
+  /// item ID, start price, floor price, decrement, tick in milliseconds
+  kOpenDutchItem,
+  /// user ID, value, then the IDs of the items in the bundle -> bundle ID
+  kPlaceBundleBid,
+  /// most search nodes per group of items, or 0 for no limit -> number of
+  /// bundles won, number of items sold, optimal (0 or 1)
+  kClearBundles,
+  /// item ID, number of units
+  kOpenMultiUnitItem,
+  /// item ID, user ID, quantity, price per unit
+  kPlaceQuantityBid
+};
+
+/// Returns \c true if \c opcode names a command that changes the auction,
+/// which the server numbers and journals when it succeeds.
+bool changesAuction(uint8_t opcode);
+
+/// Request flag asking for the error message with an error response.
+const uint8_t kWantMessage = 1;
+
+/// Largest frame body accepted. Larger frames end the connection.
+const uint32_t kMaxFrameSize = 1 << 20;
+
+/// Size of the length prefix of a frame.
+const size_t kFrameHeaderSize = 4;
+
+/// Most arguments a request can carry. A bundle bid sent as a request can
+/// therefore hold at most \c kMaxArgs - 2 items.
+const size_t kMaxArgs = 8;
+
+/// A decoded request. \c name points into the buffer it was decoded from.
+struct Request {
+  uint8_t opcode;
+  uint8_t flags;
+  std::string_view name;
+  uint32_t args[kMaxArgs];
+  size_t num_args;
+};
+
+/// A decoded response.
+struct Response {
+  error::Code code;
+  std::vector<uint32_t> results;
+  std::string message;
+};
+
+/**
+ * \brief Find the first complete frame in a buffer.
+ *
+ * \param data
+ *    Start of the buffered bytes.
+ *
+ * \param size
+ *    Number of bytes buffered.
+ *
+ * \param body_size
+ *    Set to the size of the frame's body if it is complete.
+ *
+ * \return \c true if the buffer starts with a complete frame.
+ */
+bool nextFrame(const char* data, size_t size, uint32_t& body_size);
+
+/// Append a request frame to \c out.
+void appendRequest(std::string& out, uint8_t opcode, uint8_t flags,
+                   std::string_view name, const uint32_t* args,
+                   size_t num_args);
+
+/// Decode a request body. Returns \c false if it is malformed.
+bool parseRequest(const char* body, size_t size, Request& request);
+
+/// Append a response frame to \c out. \c message is only sent if \c code is
+/// not OK and not empty.
+void appendResponse(std::string& out, error::Code code,
+                    const uint32_t* results, size_t num_results,
+                    std::string_view message);
+
+/// Decode a response body. Returns \c false if it is malformed.
+bool parseResponse(const char* body, size_t size, Response& response);
+}  // namespace protocol
+}  // namespace auction_engine
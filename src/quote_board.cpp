@@ -0,0 +1,131 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "quote_board.h"
+#include "id_allocator.h"
+
+namespace auction_engine {
+
+const uint32_t QuoteBoard::kFirstChunkBits;
+const uint32_t QuoteBoard::kMaxChunks;
+
+namespace {
+
+const uint32_t kOpen = 1;
+const uint32_t kSold = 2;
+}  // namespace
+
+uint32_t QuoteBoard::chunkOf(uint32_t slot) {
+  // Chunk k holds 2^(k + kFirstChunkBits) records. Offsetting the slot by the
+  // size of the first chunk makes its highest set bit select the chunk.
+  const uint64_t biased = uint64_t(slot) + (uint64_t(1) << kFirstChunkBits);
+  return 63 - __builtin_clzll(biased) - kFirstChunkBits;
+}
+
+uint32_t QuoteBoard::offsetOf(uint32_t slot, uint32_t chunk) {
+  const uint64_t biased = uint64_t(slot) + (uint64_t(1) << kFirstChunkBits);
+  return biased - (uint64_t(1) << (chunk + kFirstChunkBits));
+}
+
+QuoteBoard::QuoteBoard() {
+  for (std::atomic<Record*>& chunk: chunks)
+    chunk.store(nullptr, std::memory_order_relaxed);
+}
+
+QuoteBoard::~QuoteBoard() {
+  for (std::atomic<Record*>& chunk: chunks)
+    delete[] chunk.load(std::memory_order_relaxed);
+}
+
+void QuoteBoard::reserve(uint32_t slot) {
+  const uint32_t chunk = chunkOf(slot);
+  if (chunks[chunk].load(std::memory_order_relaxed))
+    return;
+
+  const size_t size = size_t(1) << (chunk + kFirstChunkBits);
+  Record* records = new Record[size];
+  for (size_t i=0; i<size; ++i) {
+    records[i].sequence.store(0, std::memory_order_relaxed);
+    records[i].item_id.store(IdAllocator::kInvalidId,
+                             std::memory_order_relaxed);
+    records[i].value.store(0, std::memory_order_relaxed);
+    records[i].leader.store(IdAllocator::kInvalidId,
+                            std::memory_order_relaxed);
+    records[i].num_bids.store(0, std::memory_order_relaxed);
+    records[i].flags.store(0, std::memory_order_relaxed);
+  }
+  // Readers that see the pointer also see the initialised records.
+  chunks[chunk].store(records, std::memory_order_release);
+}
+
+size_t QuoteBoard::getBytesAllocated() const {
+  size_t bytes = 0;
+  for (uint32_t chunk=0; chunk<kMaxChunks; ++chunk) {
+    if (chunks[chunk].load(std::memory_order_relaxed))
+      bytes += sizeof(Record) << (chunk + kFirstChunkBits);
+  }
+  return bytes;
+}
+
+QuoteBoard::Record* QuoteBoard::find(uint32_t slot) const {
+  const uint32_t chunk = chunkOf(slot);
+  Record* records = chunks[chunk].load(std::memory_order_acquire);
+  if (!records)
+    return nullptr;
+  return &records[offsetOf(slot, chunk)];
+}
+
+void QuoteBoard::publish(uint32_t slot, const Quote& quote) {
+  Record& record = *find(slot);
+  const uint32_t sequence = record.sequence.load(std::memory_order_relaxed);
+  record.sequence.store(sequence + 1, std::memory_order_relaxed);
+  // Keep the field stores below from being seen before the odd sequence.
+  std::atomic_thread_fence(std::memory_order_release);
+  record.item_id.store(quote.item_id, std::memory_order_relaxed);
+  record.value.store(quote.value, std::memory_order_relaxed);
+  record.leader.store(quote.leader, std::memory_order_relaxed);
+  record.num_bids.store(quote.num_bids, std::memory_order_relaxed);
+  record.flags.store((quote.open ? kOpen : 0) | (quote.sold ? kSold : 0),
+                     std::memory_order_relaxed);
+  record.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool QuoteBoard::read(uint32_t slot, Quote& quote) const {
+  const Record* record = find(slot);
+  if (!record)
+    return false;
+
+  uint32_t before, after, flags;
+  do {
+    before = record->sequence.load(std::memory_order_acquire);
+    quote.item_id = record->item_id.load(std::memory_order_relaxed);
+    quote.value = record->value.load(std::memory_order_relaxed);
+    quote.leader = record->leader.load(std::memory_order_relaxed);
+    quote.num_bids = record->num_bids.load(std::memory_order_relaxed);
+    flags = record->flags.load(std::memory_order_relaxed);
+    // Keep the field loads above from moving past the second sequence load.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = record->sequence.load(std::memory_order_relaxed);
+  } while ((before & 1) || before != after);
+
+  quote.open = flags & kOpen;
+  quote.sold = flags & kSold;
+  return true;
+}
+}  // namespace auction_engine
@@ -0,0 +1,109 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace auction_engine {
+
+/// A consistent snapshot of an item's bidding state.
+struct Quote {
+  /// ID of the item, or \c IdAllocator::kInvalidId for an empty slot.
+  uint32_t item_id;
+  /// High bid, or the starting value if there are no bids.
+  uint32_t value;
+  /// User that placed the high bid, or \c IdAllocator::kInvalidId.
+  uint32_t leader;
+  /// Number of bids placed.
+  uint32_t num_bids;
+  /// Whether the item is open for bidding.
+  bool open;
+  /// Whether the item has been sold.
+  bool sold;
+};
+
+/**
+ * \brief Per-slot item quotes that other threads can read without locking.
+ *
+ * One thread, the one applying bids to the auction, publishes quotes; any
+ * number of other threads read them. Each record is guarded by a sequence
+ * lock: the writer makes the sequence odd, updates the fields and makes it
+ * even again, and a reader retries if the sequence was odd or changed while it
+ * copied the fields. Readers never write shared memory, so they do not slow
+ * the writer down, and the writer never waits for readers.
+ *
+ * Records are kept in chunks that double in size and are never moved, so a
+ * reader can look up a slot while the writer is adding items.
+ */
+class QuoteBoard {
+public:
+  QuoteBoard();
+  ~QuoteBoard();
+
+  QuoteBoard(const QuoteBoard&) = delete;
+  QuoteBoard& operator=(const QuoteBoard&) = delete;
+
+  /// Make sure \c slot has a record. Writer only.
+  void reserve(uint32_t slot);
+
+  /// Publish \c quote for \c slot, which must be reserved. Writer only.
+  void publish(uint32_t slot, const Quote& quote);
+
+  /**
+   * \brief Read the quote for a slot. Safe to call from any thread.
+   *
+   * \param slot
+   *    Slot to read.
+   *
+   * \param quote
+   *    Set to the last quote published for the slot.
+   *
+   * \return \c true if the slot has a record.
+   */
+  bool read(uint32_t slot, Quote& quote) const;
+
+  /// Return the number of bytes of records allocated.
+  size_t getBytesAllocated() const;
+
+private:
+  struct Record {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> item_id;
+    std::atomic<uint32_t> value;
+    std::atomic<uint32_t> leader;
+    std::atomic<uint32_t> num_bids;
+    std::atomic<uint32_t> flags;
+  };
+
+  /// Log2 of the number of records in the first chunk.
+  static const uint32_t kFirstChunkBits = 6;
+  /// Enough chunks to hold a record for every item slot.
+  static const uint32_t kMaxChunks = 32 - kFirstChunkBits;
+
+  /// Return the chunk holding \c slot.
+  static uint32_t chunkOf(uint32_t slot);
+
+  /// Return the index of \c slot within \c chunk.
+  static uint32_t offsetOf(uint32_t slot, uint32_t chunk);
+
+  /// Return the record for \c slot, or \c nullptr if its chunk is missing.
+  Record* find(uint32_t slot) const;
+
+  std::atomic<Record*> chunks[kMaxChunks];
+};
+}  // namespace auction_engine
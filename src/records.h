@@ -0,0 +1,109 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bid.h"
+#include "id_allocator.h"
+
+namespace auction_engine {
+
+/**
+ * \brief The fields of a user read to validate each bid.
+ *
+ * They are packed into one column of 8-byte records, so validating a bid
+ * reads a single cache line of the user's state.
+ */
+struct alignas(8) HotUser {
+  /// Available funds. Zero for empty slots.
+  uint32_t available_funds = 0;
+  /// Wallet the user bids from, or \c IdAllocator::kInvalidId if the user
+  /// bids with their own funds.
+  uint32_t wallet = IdAllocator::kInvalidId;
+};
+
+/**
+ * \brief The fields of an item read to validate each bid.
+ *
+ * They are packed into one column of 16-byte records, aligned so that none
+ * straddles a cache line.
+ */
+struct alignas(16) HotItem {
+  /// Current value: the high bid, or the starting value if there are no bids.
+  uint32_t value = 0;
+  /// User that placed the high bid, or \c IdAllocator::kInvalidId.
+  uint32_t leader = IdAllocator::kInvalidId;
+  /// Number of bids placed.
+  uint32_t num_bids = 0;
+  /// \c Auction::ItemState bits.
+  uint8_t state = 0;
+};
+
+static_assert(sizeof(HotUser) == 8 && sizeof(HotItem) == 16,
+              "Hot fields are packed into 8- and 16-byte records.");
+
+/**
+ * \brief The cold data of a user: the bids they placed and items they won.
+ *
+ * Records are kept in an auction column and shared with the auction's forks
+ * until one of them changes the user, so they hold no reference back to an
+ * auction.
+ */
+struct UserRecord {
+  /// \c Bids the user has placed, indexed by item id, each item's in the
+  /// order of their numbers. The bids are kept alive by the items' records.
+  std::map<uint32_t, std::vector<const Bid*>> bids_placed;
+  /// Sorted IDs of archived items the user has bid on.
+  std::vector<uint32_t> archived_items;
+  /// The \c Items this user has won.
+  std::vector<uint32_t> items_won;
+};
+
+/**
+ * \brief The cold data of an item: its bid history and bidders.
+ *
+ * Records are kept in an auction column and shared with the auction's forks
+ * until one of them changes the item, so they hold no reference back to an
+ * auction.
+ */
+struct ItemRecord {
+  /// Starting value of item.
+  uint32_t starting_value = 0;
+  /// All bids placed on the item, indexed by bid number, with \c nullptr in
+  /// place of those retracted. Accepted bids only ever rise, so the last one
+  /// left leads. A bid is freed once no record holds it any more.
+  std::vector<std::shared_ptr<const Bid>> bids;
+  /// Fenwick tree over \c bids counting those not retracted, so the bid at
+  /// an index or the one before a retracted bid is found in logarithmic
+  /// time. Node \c i, counting from 1, covers the \c i & -i slots that end
+  /// at slot \c i - 1.
+  std::vector<uint32_t> live_bid_counts;
+  /// Number of bids retracted. Their numbers are not given out again.
+  uint32_t num_retracted_bids = 0;
+  /// Users that have bid on the item, in the order of their first bid.
+  /// Cleared when the bids are archived.
+  std::vector<uint32_t> bidders;
+  /// Archived bids, or \c nullptr if the bids are held in \c bids.
+  const Bid* archived_bids = nullptr;
+  /// Number of archived bids.
+  size_t num_archived_bids = 0;
+};
+}  // namespace auction_engine
@@ -0,0 +1,305 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define AUCTION_ENGINE_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+#include "scan.h"
+
+namespace auction_engine {
+namespace scan {
+namespace {
+
+// Append the index of each set bit of a lane mask, offset by \c base.
+inline void appendMask(uint32_t mask, uint32_t base,
+                       std::vector<uint32_t>& out) {
+  while (mask) {
+    out.push_back(base + __builtin_ctz(mask));
+    mask &= mask - 1;
+  }
+}
+
+void findLessScalar(Strided values, size_t n, uint32_t bound,
+                    std::vector<uint32_t>& out, size_t i=0) {
+  for (; i<n; ++i) {
+    if (values[i] < bound)
+      out.push_back(i);
+  }
+}
+
+void findInRangeScalar(Strided values, size_t n, uint32_t min, uint32_t max,
+                       std::vector<uint32_t>& out, size_t i=0) {
+  for (; i<n; ++i) {
+    if (values[i] >= min && values[i] <= max)
+      out.push_back(i);
+  }
+}
+
+uint64_t sumScalar(const uint32_t* values, size_t n, size_t i=0) {
+  uint64_t total = 0;
+  for (; i<n; ++i)
+    total += values[i];
+  return total;
+}
+
+uint64_t sumDifferenceScalar(Strided a, Strided b, size_t n, size_t i=0) {
+  uint64_t total = 0;
+  for (; i<n; ++i)
+    total += a[i] - b[i];
+  return total;
+}
+
+#ifdef AUCTION_ENGINE_SCAN_X86
+
+// SSE2 has no unsigned 32-bit compare, so values are biased into signed
+// range and compared as signed integers.
+const uint32_t kSignBit = 0x80000000u;
+
+// Load values \c i to \c i+3. Fields of 8- and 16-byte records are
+// gathered with shuffles of whole records.
+inline __m128i loadSse2(Strided values, size_t i) {
+  const uint32_t* p = values.values + i * values.stride;
+  switch (values.stride) {
+  case 1:
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  case 2: {
+    __m128 lo = _mm_loadu_ps(reinterpret_cast<const float*>(p));
+    __m128 hi = _mm_loadu_ps(reinterpret_cast<const float*>(p + 4));
+    return _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+  }
+  case 4: {
+    __m128i lo = _mm_unpacklo_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4)));
+    __m128i hi = _mm_unpacklo_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)));
+    return _mm_unpacklo_epi64(lo, hi);
+  }
+  default:
+    return _mm_setr_epi32(p[0], p[values.stride], p[2 * values.stride],
+                          p[3 * values.stride]);
+  }
+}
+
+void findLessSse2(Strided values, size_t n, uint32_t bound,
+                  std::vector<uint32_t>& out) {
+  const __m128i bias = _mm_set1_epi32(kSignBit);
+  const __m128i vbound = _mm_set1_epi32(bound ^ kSignBit);
+  size_t i = 0;
+  for (; i+4<=n; i+=4) {
+    __m128i v = loadSse2(values, i);
+    __m128i lt = _mm_cmplt_epi32(_mm_xor_si128(v, bias), vbound);
+    appendMask(_mm_movemask_ps(_mm_castsi128_ps(lt)), i, out);
+  }
+  findLessScalar(values, n, bound, out, i);
+}
+
+void findInRangeSse2(Strided values, size_t n, uint32_t min, uint32_t max,
+                     std::vector<uint32_t>& out) {
+  const __m128i bias = _mm_set1_epi32(kSignBit);
+  const __m128i vmin = _mm_set1_epi32(min ^ kSignBit);
+  const __m128i vmax = _mm_set1_epi32(max ^ kSignBit);
+  size_t i = 0;
+  for (; i+4<=n; i+=4) {
+    __m128i v = _mm_xor_si128(loadSse2(values, i), bias);
+    // min <= v <= max is !(v < min) && !(v > max).
+    __m128i out_of_range = _mm_or_si128(_mm_cmplt_epi32(v, vmin),
+                                        _mm_cmpgt_epi32(v, vmax));
+    uint32_t mask = ~_mm_movemask_ps(_mm_castsi128_ps(out_of_range)) & 0xf;
+    appendMask(mask, i, out);
+  }
+  findInRangeScalar(values, n, min, max, out, i);
+}
+
+inline uint64_t horizontalSum(__m128i acc) {
+  return static_cast<uint64_t>(_mm_cvtsi128_si64(acc)) +
+         static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc)));
+}
+
+uint64_t sumSse2(const uint32_t* values, size_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i+4<=n; i+=4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, zero));
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, zero));
+  }
+  return horizontalSum(acc) + sumScalar(values, n, i);
+}
+
+uint64_t sumDifferenceSse2(Strided a, Strided b, size_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i+4<=n; i+=4) {
+    __m128i v = _mm_sub_epi32(loadSse2(a, i), loadSse2(b, i));
+    acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, zero));
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, zero));
+  }
+  return horizontalSum(acc) + sumDifferenceScalar(a, b, n, i);
+}
+
+// Offsets of eight values \c stride apart, for gathering them.
+__attribute__((target("avx2")))
+inline __m256i gatherIndex(size_t stride) {
+  return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                            _mm256_set1_epi32(stride));
+}
+
+// Load values \c i to \c i+7, gathering them at \c index unless they are
+// contiguous.
+__attribute__((target("avx2")))
+inline __m256i loadAvx2(Strided values, size_t i, __m256i index) {
+  const uint32_t* p = values.values + i * values.stride;
+  if (values.stride == 1)
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  return _mm256_i32gather_epi32(reinterpret_cast<const int*>(p), index, 4);
+}
+
+__attribute__((target("avx2")))
+void findLessAvx2(Strided values, size_t n, uint32_t bound,
+                  std::vector<uint32_t>& out) {
+  const __m256i index = gatherIndex(values.stride);
+  const __m256i vbound = _mm256_set1_epi32(bound);
+  size_t i = 0;
+  for (; i+8<=n; i+=8) {
+    __m256i v = loadAvx2(values, i, index);
+    // v >= bound exactly when max(v, bound) == v.
+    __m256i ge = _mm256_cmpeq_epi32(_mm256_max_epu32(v, vbound), v);
+    uint32_t mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(ge)) & 0xff;
+    appendMask(mask, i, out);
+  }
+  findLessScalar(values, n, bound, out, i);
+}
+
+__attribute__((target("avx2")))
+void findInRangeAvx2(Strided values, size_t n, uint32_t min, uint32_t max,
+                     std::vector<uint32_t>& out) {
+  const __m256i index = gatherIndex(values.stride);
+  const __m256i vmin = _mm256_set1_epi32(min);
+  const __m256i vmax = _mm256_set1_epi32(max);
+  size_t i = 0;
+  for (; i+8<=n; i+=8) {
+    __m256i v = loadAvx2(values, i, index);
+    __m256i in_range = _mm256_and_si256(
+        _mm256_cmpeq_epi32(_mm256_max_epu32(v, vmin), v),
+        _mm256_cmpeq_epi32(_mm256_min_epu32(v, vmax), v));
+    appendMask(_mm256_movemask_ps(_mm256_castsi256_ps(in_range)), i, out);
+  }
+  findInRangeScalar(values, n, min, max, out, i);
+}
+
+__attribute__((target("avx2")))
+inline uint64_t horizontalSum(__m256i acc) {
+  __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc),
+                               _mm256_extracti128_si256(acc, 1));
+  return static_cast<uint64_t>(_mm_cvtsi128_si64(half)) +
+         static_cast<uint64_t>(_mm_extract_epi64(half, 1));
+}
+
+__attribute__((target("avx2")))
+uint64_t sumAvx2(const uint32_t* values, size_t n) {
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i+8<=n; i+=8) {
+    __m256i v = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(values + i));
+    acc = _mm256_add_epi64(acc,
+        _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v)));
+    acc = _mm256_add_epi64(acc,
+        _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1)));
+  }
+  return horizontalSum(acc) + sumScalar(values, n, i);
+}
+
+__attribute__((target("avx2")))
+uint64_t sumDifferenceAvx2(Strided a, Strided b, size_t n) {
+  const __m256i a_index = gatherIndex(a.stride);
+  const __m256i b_index = gatherIndex(b.stride);
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i+8<=n; i+=8) {
+    __m256i v = _mm256_sub_epi32(loadAvx2(a, i, a_index),
+                                 loadAvx2(b, i, b_index));
+    acc = _mm256_add_epi64(acc,
+        _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v)));
+    acc = _mm256_add_epi64(acc,
+        _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1)));
+  }
+  return horizontalSum(acc) + sumDifferenceScalar(a, b, n, i);
+}
+#endif  // AUCTION_ENGINE_SCAN_X86
+}  // namespace
+
+Isa getBestIsa() {
+#ifdef AUCTION_ENGINE_SCAN_X86
+  static const Isa best = __builtin_cpu_supports("avx2") ? kAvx2 : kSse2;
+  return best;
+#else
+  return kScalar;
+#endif
+}
+
+void findLess(Strided values, size_t n, uint32_t bound,
+              std::vector<uint32_t>& out, Isa isa) {
+#ifdef AUCTION_ENGINE_SCAN_X86
+  if (isa == kAvx2)
+    return findLessAvx2(values, n, bound, out);
+  if (isa == kSse2)
+    return findLessSse2(values, n, bound, out);
+#endif
+  findLessScalar(values, n, bound, out);
+}
+
+void findInRange(Strided values, size_t n, uint32_t min, uint32_t max,
+                 std::vector<uint32_t>& out, Isa isa) {
+#ifdef AUCTION_ENGINE_SCAN_X86
+  if (isa == kAvx2)
+    return findInRangeAvx2(values, n, min, max, out);
+  if (isa == kSse2)
+    return findInRangeSse2(values, n, min, max, out);
+#endif
+  findInRangeScalar(values, n, min, max, out);
+}
+
+uint64_t sum(const uint32_t* values, size_t n, Isa isa) {
+#ifdef AUCTION_ENGINE_SCAN_X86
+  if (isa == kAvx2)
+    return sumAvx2(values, n);
+  if (isa == kSse2)
+    return sumSse2(values, n);
+#endif
+  return sumScalar(values, n);
+}
+
+uint64_t sumDifference(Strided a, Strided b, size_t n, Isa isa) {
+#ifdef AUCTION_ENGINE_SCAN_X86
+  if (isa == kAvx2)
+    return sumDifferenceAvx2(a, b, n);
+  if (isa == kSse2)
+    return sumDifferenceSse2(a, b, n);
+#endif
+  return sumDifferenceScalar(a, b, n);
+}
+}  // namespace scan
+}  // namespace auction_engine
@@ -0,0 +1,79 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \file
+ * \brief Bulk scan kernels over \c uint32_t columns, contiguous or strided.
+ *
+ * On x86-64 each kernel picks an AVX2 or SSE2 implementation at runtime based
+ * on what the CPU supports. Other targets use a scalar implementation. All
+ * implementations return identical results.
+ */
+
+namespace auction_engine {
+namespace scan {
+
+/// Instruction sets a kernel can be run with.
+enum Isa {
+  kScalar,
+  kSse2,
+  kAvx2
+};
+
+/// Return the best instruction set supported by the running CPU.
+Isa getBestIsa();
+
+/**
+ * \brief Every \c stride-th \c uint32_t from \c values on.
+ *
+ * With a stride above 1 this reads one field of an array of records, such as
+ * a page of an auction's packed item or user fields. Converts from a plain
+ * pointer with a stride of 1.
+ */
+struct Strided {
+  Strided(const uint32_t* values, size_t stride=1)
+      : values(values), stride(stride) {}
+
+  /// Return value \c i.
+  uint32_t operator[](size_t i) const { return values[i * stride]; }
+
+  const uint32_t* values;
+  size_t stride;
+};
+
+/// Append to \c out every index \c i below \c n with \c values[i] < \c bound.
+void findLess(Strided values, size_t n, uint32_t bound,
+              std::vector<uint32_t>& out, Isa isa=getBestIsa());
+
+/// Append to \c out every index \c i below \c n with \c min <= \c values[i]
+/// <= \c max.
+void findInRange(Strided values, size_t n, uint32_t min, uint32_t max,
+                 std::vector<uint32_t>& out, Isa isa=getBestIsa());
+
+/// Return the sum of the first \c n values.
+uint64_t sum(const uint32_t* values, size_t n, Isa isa=getBestIsa());
+
+/// Return the sum of \c a[i] - \c b[i] over the first \c n values. Assumes
+/// \c a[i] >= \c b[i] for every \c i.
+uint64_t sumDifference(Strided a, Strided b, size_t n, Isa isa=getBestIsa());
+
+}  // namespace scan
+}  // namespace auction_engine
@@ -0,0 +1,153 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+#include "auction.h"
+#include "scan.h"
+#include "status.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+int main() {
+  namespace scan = auction_engine::scan;
+
+  // Odd length so every kernel has a scalar tail to handle.
+  std::mt19937 rng(42);
+  std::vector<uint32_t> a(1003), b(1003);
+  for (size_t i=0; i<a.size(); ++i) {
+    a[i] = rng();
+    b[i] = a[i] - a[i] % 1000;
+  }
+  a[5] = 0;
+  a[6] = UINT32_MAX;
+
+  std::vector<scan::Isa> isas = { scan::kScalar };
+  if (scan::getBestIsa() >= scan::kSse2)
+    isas.push_back(scan::kSse2);
+  if (scan::getBestIsa() >= scan::kAvx2)
+    isas.push_back(scan::kAvx2);
+
+  printTest("Testing scan::findLess()...");
+  std::vector<uint32_t> expected, found;
+  scan::findLess(a.data(), a.size(), 1u << 31, expected, scan::kScalar);
+  bool match = !expected.empty();
+  for (scan::Isa isa: isas) {
+    found.clear();
+    scan::findLess(a.data(), a.size(), 1u << 31, found, isa);
+    match = match && found == expected;
+  }
+  printTestResult(match);
+
+  printTest("Testing scan::findInRange()...");
+  expected.clear();
+  scan::findInRange(a.data(), a.size(), 0, 1u << 30, expected, scan::kScalar);
+  match = std::find(expected.cbegin(), expected.cend(), 5) != expected.cend() &&
+          std::find(expected.cbegin(), expected.cend(), 6) == expected.cend();
+  for (scan::Isa isa: isas) {
+    found.clear();
+    scan::findInRange(a.data(), a.size(), 0, 1u << 30, found, isa);
+    match = match && found == expected;
+  }
+  printTestResult(match);
+
+  printTest("Testing scan::sum()...");
+  match = true;
+  for (scan::Isa isa: isas) {
+    match = match && scan::sum(a.data(), a.size(), isa) ==
+                     scan::sum(a.data(), a.size(), scan::kScalar);
+  }
+  printTestResult(match && scan::sum(a.data(), a.size()) > UINT32_MAX);
+
+  printTest("Testing scan::sumDifference()...");
+  match = true;
+  for (scan::Isa isa: isas) {
+    match = match &&
+        scan::sumDifference(a.data(), b.data(), a.size(), isa) ==
+        scan::sumDifference(a.data(), b.data(), a.size(), scan::kScalar);
+  }
+  printTestResult(match);
+
+  printTest("Testing strided scans...");
+  // Every field of records of one, two, four and five values, the last
+  // taking the generic path.
+  match = true;
+  for (size_t stride: {1, 2, 4, 5}) {
+    std::vector<uint32_t> records(a.size() * stride, 7);
+    for (size_t i=0; i<a.size(); ++i)
+      records[i * stride] = a[i];
+    const scan::Strided strided(records.data(), stride);
+    for (scan::Isa isa: isas) {
+      std::vector<uint32_t> less, in_range, contiguous_less, contiguous_range;
+      scan::findLess(strided, a.size(), 1u << 31, less, isa);
+      scan::findLess(a.data(), a.size(), 1u << 31, contiguous_less, isa);
+      scan::findInRange(strided, a.size(), 0, 1u << 30, in_range, isa);
+      scan::findInRange(a.data(), a.size(), 0, 1u << 30, contiguous_range,
+                        isa);
+      match = match && less == contiguous_less &&
+              in_range == contiguous_range &&
+              scan::sumDifference(strided, b.data(), a.size(), isa) ==
+                  scan::sumDifference(a.data(), b.data(), a.size(), isa);
+    }
+  }
+  printTestResult(match);
+
+  auction_engine::Auction auction;
+  auction.addUser("Alice", 1000);
+  auction.addUser("Bob", 500);
+  auction.addUser("Carol", 50);
+  auction.addItem("Rug", 10);
+  auction.addItem("Ficus", 300);
+  auction.addItem("Sunflowers", 50);
+  auction.openItem(0);
+  auction.openItem(1);
+  auction.placeBid(0, 0, 900);
+  auction.placeBid(1, 1, 400);
+
+  printTest("Testing findUsersWithAvailableFundsBelow()...");
+  std::vector<uint32_t> poor = auction.findUsersWithAvailableFundsBelow(150);
+  printTestResult(poor == std::vector<uint32_t>({0, 1, 2}) &&
+                  auction.findUsersWithAvailableFundsBelow(100) ==
+                      std::vector<uint32_t>({2}));
+
+  printTest("Testing findOpenItemsWithValueIn()...");
+  printTestResult(auction.findOpenItemsWithValueIn(0, 500) ==
+                      std::vector<uint32_t>({1}) &&
+                  auction.findOpenItemsWithValueIn(0, 1000).size() == 2);
+
+  printTest("Testing getTotalCommittedFunds()...");
+  bool committed = auction.getTotalCommittedFunds() == 1300 &&
+                   auction.getTotalFunds() == 1550;
+  auction.closeItem(0, true);
+  auction.removeUser(0);
+  printTestResult(committed && auction.getTotalCommittedFunds() == 400 &&
+                  auction.getTotalFunds() == 550 &&
+                  auction.findUsersWithAvailableFundsBelow(200) ==
+                      std::vector<uint32_t>({1, 2}));
+
+  return 0;
+}
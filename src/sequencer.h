@@ -0,0 +1,52 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+namespace auction_engine {
+
+/**
+ * \brief Hands out one 64-bit sequence to any number of auctions and threads.
+ *
+ * Every number \c next() returns is higher than every number it returned
+ * before, on any thread, so bids from auctions sharing a sequencer can be
+ * merged into one unambiguous order by sequence alone. Taking a number is a
+ * single relaxed atomic increment; 64 bits do not wrap in practice.
+ */
+class alignas(64) Sequencer {
+public:
+  explicit Sequencer(uint64_t first=0) : next_sequence(first) {}
+
+  Sequencer(const Sequencer&) = delete;
+  Sequencer& operator=(const Sequencer&) = delete;
+
+  /// Take the next number in the sequence.
+  uint64_t next() {
+    return next_sequence.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Return the number \c next() would return now. Numbers taken later,
+  /// on any thread, are at least this.
+  uint64_t peek() const {
+    return next_sequence.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<uint64_t> next_sequence;
+};
+}  // namespace auction_engine
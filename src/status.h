@@ -16,6 +16,7 @@ limitations under the License.
 #pragma once
 
 #include <string>
+#include <memory>
 
 #include "error_codes.h"
 
@@ -16,51 +16,205 @@ limitations under the License.
 #include <vector>
 #include <stdint.h>
 #include <map>
+#include <algorithm>
+#include <iterator>
 
 #include "bid.h"
 #include "item.h"
 #include "user.h"
+#include "auction.h"
+#include "id_allocator.h"
 
 namespace auction_engine {
 
+User::User(Auction& auction, uint32_t id)
+    : auction(auction),
+      id(id),
+      slot(IdAllocator::slotOf(id)) {}
+
+User::User(Auction& auction, uint32_t id, std::string_view name,
+           uint32_t funds)
+    : User(auction, id) {
+  auction.claimUserSlot(id, name, funds);
+}
+
+std::string_view User::getName() const {
+  return auction.names->get(auction.user_name_column[slot]);
+}
+
+namespace {
+
+// Collect the bids a user placed on an archived item.
+void getArchivedBids(const Auction& auction, uint32_t user_id,
+                     uint32_t item_id, std::vector<const Bid*>& bids) {
+  const Item* item;
+  if (!auction.getItem(item_id, item).ok())
+    return;
+  for (size_t i=0; i<item->getNumBids(); ++i) {
+    const Bid* bid = item->getBid(i);
+    if (bid->user_id == user_id)
+      bids.push_back(bid);
+  }
+}
+}  // namespace
+
+uint32_t User::getAvailableFunds() const {
+  const uint32_t wallet_id = auction.user_hot_column[slot].wallet;
+  if (wallet_id != IdAllocator::kInvalidId)
+    return auction.ledger->getAvailableFunds(wallet_id);
+  return auction.user_hot_column[slot].available_funds;
+}
+
+uint32_t User::getTotalFunds() const {
+  const uint32_t wallet_id = auction.user_hot_column[slot].wallet;
+  if (wallet_id != IdAllocator::kInvalidId)
+    return auction.ledger->getTotalFunds(wallet_id);
+  return auction.user_funds_column[slot];
+}
+
+uint32_t User::getWalletId() const {
+  return auction.user_hot_column[slot].wallet;
+}
+
 const std::vector<uint32_t> User::getItemsBidOn() const {
+  const UserRecord& user = record();
   std::vector<uint32_t> items_bid_on;
-  for (const auto& kv: bids_placed)
+  for (const auto& kv: user.bids_placed)
     items_bid_on.push_back(kv.first);
+  if (!user.archived_items.empty()) {
+    std::vector<uint32_t> all_items;
+    std::merge(items_bid_on.cbegin(), items_bid_on.cend(),
+               user.archived_items.cbegin(), user.archived_items.cend(),
+               std::back_inserter(all_items));
+    return all_items;
+  }
   return items_bid_on;
 }
 
 const std::vector<const Bid*> User::getBids() const { 
+  const UserRecord& user = record();
   std::vector<const Bid*> bids;
-  for (const auto& kv: bids_placed)
-    bids.insert(bids.cend(), kv.second.cbegin(), kv.second.cend());
+  if (user.archived_items.empty()) {
+    for (const auto& kv: user.bids_placed)
+      bids.insert(bids.cend(), kv.second.cbegin(), kv.second.cend());
+    return bids;
+  }
+
+  for (uint32_t item_id: getItemsBidOn()) {
+    auto it = user.bids_placed.find(item_id);
+    if (it != user.bids_placed.cend())
+      bids.insert(bids.cend(), it->second.cbegin(), it->second.cend());
+    else
+      getArchivedBids(auction, id, item_id, bids);
+  }
   return bids;
 }
 
 uint32_t User::getBidValueOnItem(uint32_t item_id) const {
-  if (bids_placed.count(item_id))
-    return bids_placed.at(item_id).back()->value;
-  else
-    return 0;
+  const UserRecord& user = record();
+  auto it = user.bids_placed.find(item_id);
+  if (it != user.bids_placed.cend())
+    return it->second.back()->value;
+
+  if (std::binary_search(user.archived_items.cbegin(),
+                         user.archived_items.cend(), item_id)) {
+    std::vector<const Bid*> bids;
+    getArchivedBids(auction, id, item_id, bids);
+    if (!bids.empty())
+      return bids.back()->value;
+  }
+  return 0;
+}
+
+bool User::alreadyBidOnItem(uint32_t item_id) const {
+  const UserRecord& user = record();
+  return user.bids_placed.count(item_id) ||
+         std::binary_search(user.archived_items.cbegin(),
+                            user.archived_items.cend(), item_id);
 }
 
 void User::addBid(const Bid& bid) {
-  if (bids_placed.count(bid.item_id)) {
-    available_funds = available_funds - bid.value + \
-                      bids_placed[bid.item_id].back()->value;
-  } else {
+  uint32_t& available_funds =
+      auction.user_hot_column.mutate(slot).available_funds;
+  std::vector<const Bid*>& item_bids =
+      mutableRecord().bids_placed[bid.item_id];
+  // A linked wallet is charged by the auction, which knows who is leading.
+  const bool own_funds = getWalletId() == IdAllocator::kInvalidId;
+  if (own_funds && !item_bids.empty()) {
+    available_funds = available_funds - bid.value + item_bids.back()->value;
+  } else if (own_funds) {
     available_funds -= bid.value;
   }
-  bids_placed[bid.item_id].push_back(&bid);
+  if (item_bids.empty())
+    ++auction.user_num_items_column.mutate(slot);
+  item_bids.push_back(&bid);
+}
+
+void User::removeBid(const Bid& bid) {
+  UserRecord& user = mutableRecord();
+  auto entry = user.bids_placed.find(bid.item_id);
+  std::vector<const Bid*>& item_bids = entry->second;
+  // The user's bids on the item are in the order of their numbers too.
+  auto it = std::lower_bound(item_bids.begin(), item_bids.end(), &bid,
+                             [](const Bid* lhs, const Bid* rhs) {
+                               return lhs->number < rhs->number;
+                             });
+  const bool standing = it + 1 == item_bids.end();
+  item_bids.erase(it);
+  if (standing && getWalletId() == IdAllocator::kInvalidId) {
+    const uint32_t previous = item_bids.empty() ? 0 : item_bids.back()->value;
+    auction.user_hot_column.mutate(slot).available_funds +=
+        bid.value - previous;
+  }
+  if (item_bids.empty()) {
+    user.bids_placed.erase(entry);
+    --auction.user_num_items_column.mutate(slot);
+  }
 }
 
 void User::reportBidResult(uint32_t item_id, bool won) {
-  const Bid* bid = bids_placed.at(item_id).back();
+  const Bid* bid = record().bids_placed.at(item_id).back();
+  if (won)
+    mutableRecord().items_won.push_back(item_id);
+  if (getWalletId() != IdAllocator::kInvalidId)
+    return;
   if (won) {
-    funds -= bid->value;
-    items_won.push_back(item_id);
+    auction.user_funds_column.mutate(slot) -= bid->value;
   } else {
-    available_funds += bid->value;
+    auction.user_hot_column.mutate(slot).available_funds += bid->value;
   }
 }
+
+void User::archiveItem(uint32_t item_id) {
+  if (!record().bids_placed.count(item_id))
+    return;
+  UserRecord& user = mutableRecord();
+  user.bids_placed.erase(item_id);
+  auto it = std::upper_bound(user.archived_items.cbegin(),
+                             user.archived_items.cend(), item_id);
+  user.archived_items.insert(it, item_id);
+}
+
+void User::forgetItem(uint32_t item_id) {
+  if (!alreadyBidOnItem(item_id))
+    return;
+  UserRecord& user = mutableRecord();
+  bool forgotten = user.bids_placed.erase(item_id);
+  auto it = std::lower_bound(user.archived_items.cbegin(),
+                             user.archived_items.cend(), item_id);
+  if (it != user.archived_items.cend() && *it == item_id) {
+    user.archived_items.erase(it);
+    forgotten = true;
+  }
+  if (forgotten)
+    --auction.user_num_items_column.mutate(slot);
+}
+
+const UserRecord& User::record() const {
+  return *auction.user_record_column[slot];
+}
+
+UserRecord& User::mutableRecord() {
+  return auction.user_record_column.mutate(slot).mutate();
+}
 }  // namespace auction_engine
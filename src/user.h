@@ -16,11 +16,13 @@ limitations under the License.
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stdint.h>
 #include <map>
 
 #include "bid.h"
+#include "records.h"
 #include "item.h"
 #include "auction.h"
 
@@ -34,35 +36,49 @@ class Auction;
 /**
  * \brief User class.
  * 
- * This class stores information related to a single user in the auction and
- * provides a function to bid on items.
+ * This class is a view of a single user in the auction and provides a
+ * function to bid on items. The user's funds are stored in the auction's user
+ * columns at the slot of the user's ID, and their cold data in a
+ * \c UserRecord in another column there, so an auction only creates the view
+ * once the user is looked up.
  */
 class User {
 public:
-  User(const Auction& auction, uint32_t id, std::string name, uint32_t funds=0)
-      : auction(auction), id(id), name(name), funds(funds),
-        available_funds(funds) {}
+  /// Create a view of the user registered in \c auction with \c id.
+  User(Auction& auction, uint32_t id);
+
+  /// Create a view of a new user with \c id, claiming its slot in
+  /// \c auction's columns.
+  User(Auction& auction, uint32_t id, std::string_view name,
+       uint32_t funds=0);
       
   /// Return the user's id.
   const uint32_t getId() const { return id; }
 
-  /// Return the user's name.
-  const std::string getName() const { return name; }
+  /// Return the user's name. The view stays valid as long as the auction.
+  std::string_view getName() const;
   
   /// Return all of the user's bids.
   const std::vector<const Bid*> getBids() const;
 
-  /// Return the user's available funds.
-  uint32_t getAvailableFunds() const { return available_funds; }
+  /// Return the user's available funds. For a user linked to a wallet these
+  /// are the wallet's funds.
+  uint32_t getAvailableFunds() const;
 
   /// Return the user's total funds.
-  uint32_t getTotalFunds() const { return funds; }
+  uint32_t getTotalFunds() const;
+
+  /// Return the ID of the wallet the user bids from, or
+  /// \c IdAllocator::kInvalidId if the user has their own funds.
+  uint32_t getWalletId() const;
 
   /// Return all items the user has bid on.
   const std::vector<uint32_t> getItemsBidOn() const;
 
   /// Returh all items the user has won.
-  const std::vector<uint32_t> getItemsWon() const { return items_won; }
+  const std::vector<uint32_t> getItemsWon() const {
+    return record().items_won;
+  }
   
   /**
    * \brief Returns the value of the users highest bid on an item
@@ -83,9 +99,7 @@ public:
    *
    * \return \c true if the user has bid on this item, \c false otherwise.
    */
-  bool alreadyBidOnItem(uint32_t item_id) const {
-    return bids_placed.count(item_id);
-  }
+  bool alreadyBidOnItem(uint32_t item_id) const;
 
   /**
    * \brief Add a bid to the user's placed bids.
@@ -97,6 +111,18 @@ public:
    *    The bid to add.
    */
   void addBid(const Bid& bid);
+
+  /**
+   * \brief Remove a retracted bid from the user's placed bids.
+   *
+   * If it was the user's standing bid on its item, their bid before it takes
+   * its place, and unless they bid from a wallet the difference goes back to
+   * their available funds.
+   *
+   * \param bid
+   *    The bid to remove, which must not be archived.
+   */
+  void removeBid(const Bid& bid);
   
   /**
    * \breif Reports a bid result to the user and does necessary maintenance.
@@ -113,20 +139,49 @@ public:
    */
   void reportBidResult(uint32_t item_id, bool won);
 
+  /// Record that the user won an item whose payment the auction settles
+  /// itself, such as units of a multi-unit item or an item in a bundle.
+  void reportItemWon(uint32_t item_id) {
+    mutableRecord().items_won.push_back(item_id);
+  }
+
+  /**
+   * \brief Release the user's bids on an archived item.
+   *
+   * The user's bids on the item are read back from the archived \c Item
+   * through the auction from then on.
+   *
+   * \param item_id
+   *    The \c Item whose bids have been archived.
+   */
+  void archiveItem(uint32_t item_id);
+
+  /**
+   * \brief Drop the user's bids on an item that is being removed.
+   *
+   * This does not touch the user's funds; any outstanding bid on the item
+   * should be settled with \c reportBidResult() first.
+   *
+   * \param item_id
+   *    The \c Item being removed.
+   */
+  void forgetItem(uint32_t item_id);
+
 protected:
-  /// The \c Auction this user is a part of.
-  const Auction& auction;
+  /// Return the user's record.
+  const UserRecord& record() const;
+
+  /// Return the user's record for writing, copying it first if it is shared
+  /// with a fork.
+  UserRecord& mutableRecord();
+
+  /// The \c Auction this user is a part of. It stores the user's total funds
+  /// and the funds available, which are the total funds minus any standing
+  /// bids.
+  Auction& auction;
   /// Id of user.
   const uint32_t id;
-  /// Name of user.
-  std::string name;
-  /// Total funds of the user.
-  uint32_t funds;
-  /// Funds available. This is the total funds minus any standing bids.
-  uint32_t available_funds;
-  /// \c Bids the user has placed, indexed by item id.
-  std::map<uint32_t, std::vector<const Bid*>> bids_placed;
-  /// The \c Items this user has won.
-  std::vector<uint32_t> items_won;
+  /// Slot of the user's ID in the auction's user columns.
+  const uint32_t slot;
 };
 }  // namespace auction_engine
@@ -0,0 +1,131 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <stdint.h>
+
+#include "wallet_ledger.h"
+#include "error.h"
+#include "status.h"
+
+namespace auction_engine {
+
+const uint32_t WalletLedger::kChunkBits;
+const uint32_t WalletLedger::kMaxChunks;
+const uint32_t WalletLedger::kChunkSize;
+const uint32_t WalletLedger::kMaxWallets;
+
+WalletLedger::WalletLedger() : num_wallets(0) {
+  for (std::atomic<Chunk*>& chunk: chunks)
+    chunk.store(nullptr);
+}
+
+WalletLedger::~WalletLedger() {
+  for (std::atomic<Chunk*>& chunk: chunks)
+    delete chunk.load();
+}
+
+Status WalletLedger::createWallet(uint32_t funds, uint32_t& wallet_id) {
+  // The count is only raised while it is below the cap, so IDs past it are
+  // never handed out, even for a moment.
+  uint32_t id = num_wallets.load();
+  do {
+    if (id >= kMaxWallets) {
+      return error::ResourceExhausted(
+          "The ledger already holds ",
+          kMaxWallets,
+          " wallets.");
+    }
+  } while (!num_wallets.compare_exchange_weak(id, id + 1));
+
+  // The first wallet in a chunk usually allocates it, but a wallet created
+  // concurrently further into the chunk may get there first.
+  std::atomic<Chunk*>& chunk = chunks[id >> kChunkBits];
+  if (!chunk.load()) {
+    Chunk* block = new Chunk();
+    Chunk* expected = nullptr;
+    if (!chunk.compare_exchange_strong(expected, block))
+      delete block;
+  }
+
+  word(id).store(pack(funds, funds));
+  chunk.load()->ready[id & (kChunkSize - 1)].store(true,
+                                                   std::memory_order_release);
+  wallet_id = id;
+  return Status::OK();
+}
+
+bool WalletLedger::isWallet(uint32_t wallet_id) const {
+  if (wallet_id >= kMaxWallets)
+    return false;
+  const Chunk* chunk = chunks[wallet_id >> kChunkBits].load();
+  return chunk && chunk->ready[wallet_id & (kChunkSize - 1)].load(
+                      std::memory_order_acquire);
+}
+
+Status WalletLedger::deposit(uint32_t wallet_id, uint32_t amount) {
+  Word& w = word(wallet_id);
+  uint64_t current = w.load();
+  do {
+    // Available never exceeds total, so only the total can overflow.
+    if (totalOf(current) > UINT32_MAX - amount) {
+      return error::ResourceExhausted(
+          "Depositing ",
+          amount,
+          " would overflow the wallet's balance.");
+    }
+  } while (!w.compare_exchange_weak(
+      current, pack(totalOf(current) + amount, availableOf(current) + amount)));
+  return Status::OK();
+}
+
+Status WalletLedger::withdraw(uint32_t wallet_id, uint32_t amount) {
+  Word& w = word(wallet_id);
+  uint64_t current = w.load();
+  do {
+    if (availableOf(current) < amount) {
+      return error::InsufficientFunds(
+          "Attempted withdrawal ",
+          amount,
+          " is greater than the wallet's available funds.");
+    }
+  } while (!w.compare_exchange_weak(
+      current, pack(totalOf(current) - amount, availableOf(current) - amount)));
+  return Status::OK();
+}
+
+Status WalletLedger::reserve(uint32_t wallet_id, uint32_t amount) {
+  Word& w = word(wallet_id);
+  uint64_t current = w.load();
+  do {
+    if (availableOf(current) < amount) {
+      return error::InsufficientFunds(
+          "Attempted bid value ",
+          amount,
+          " is greater than the wallet's available funds.");
+    }
+  } while (!w.compare_exchange_weak(current, current - amount));
+  return Status::OK();
+}
+
+void WalletLedger::release(uint32_t wallet_id, uint32_t amount) {
+  // Reserved funds are part of the total, so this cannot carry into it.
+  word(wallet_id).fetch_add(amount);
+}
+
+void WalletLedger::settle(uint32_t wallet_id, uint32_t amount) {
+  word(wallet_id).fetch_sub(uint64_t(amount) << 32);
+}
+}  // namespace auction_engine
@@ -0,0 +1,145 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "status.h"
+
+namespace auction_engine {
+
+/**
+ * \brief Funds shared by users across any number of auctions.
+ *
+ * A wallet has a total balance and an available balance; the difference is
+ * reserved by bids that are still leading. Both halves of a wallet are packed
+ * into one 64-bit word and every operation is a single atomic update or a
+ * compare-and-swap loop on that word, so any number of threads, typically
+ * running different auctions, can reserve against the same wallet without
+ * locking and without ever reserving more than its available balance.
+ *
+ * Wallets are stored in fixed-size chunks that are allocated on first use and
+ * never moved, so creating a wallet does not disturb concurrent operations on
+ * existing ones. A wallet is only published once its balance is stored, so
+ * \c isWallet() never reports a wallet whose balance is still being set.
+ */
+class WalletLedger {
+public:
+  /// Number of wallet ID bits used for the index within a chunk.
+  static const uint32_t kChunkBits = 16;
+  /// Number of chunks the ledger can allocate.
+  static const uint32_t kMaxChunks = 256;
+  /// Number of wallets in a chunk.
+  static const uint32_t kChunkSize = uint32_t(1) << kChunkBits;
+  /// Number of wallets the ledger can hold.
+  static const uint32_t kMaxWallets = kMaxChunks << kChunkBits;
+
+  WalletLedger();
+  ~WalletLedger();
+
+  WalletLedger(const WalletLedger&) = delete;
+  WalletLedger& operator=(const WalletLedger&) = delete;
+
+  /**
+   * \brief Create a wallet.
+   *
+   * \param funds
+   *    Initial balance of the wallet.
+   *
+   * \param wallet_id
+   *    Set to the ID of the new wallet.
+   *
+   * \return \c Status containing error code and message.
+   */
+  Status createWallet(uint32_t funds, uint32_t& wallet_id);
+
+  /// Returns \c true if \c wallet_id was returned by \c createWallet(). Its
+  /// balance can then be read and changed from any thread.
+  bool isWallet(uint32_t wallet_id) const;
+
+  /// Return the total balance of a wallet.
+  uint32_t getTotalFunds(uint32_t wallet_id) const {
+    return totalOf(word(wallet_id).load());
+  }
+
+  /// Return the balance of a wallet that is not reserved.
+  uint32_t getAvailableFunds(uint32_t wallet_id) const {
+    return availableOf(word(wallet_id).load());
+  }
+
+  /**
+   * \brief Add funds to a wallet.
+   *
+   * \return \c Status containing error code and message. Fails with
+   *    \c RESOURCE_EXHAUSTED if the total balance would overflow.
+   */
+  Status deposit(uint32_t wallet_id, uint32_t amount);
+
+  /**
+   * \brief Take funds out of a wallet.
+   *
+   * Only the available balance can be withdrawn.
+   *
+   * \return \c Status containing error code and message. Fails with
+   *    \c INSUFFICIENT_FUNDS if less than \c amount is available.
+   */
+  Status withdraw(uint32_t wallet_id, uint32_t amount);
+
+  /**
+   * \brief Reserve funds for a bid.
+   *
+   * \return \c Status containing error code and message. Fails with
+   *    \c INSUFFICIENT_FUNDS if less than \c amount is available.
+   */
+  Status reserve(uint32_t wallet_id, uint32_t amount);
+
+  /// Return \c amount of reserved funds to the available balance, as when a
+  /// bid is outbid. Assumes at least \c amount is reserved.
+  void release(uint32_t wallet_id, uint32_t amount);
+
+  /// Spend \c amount of reserved funds, as when a bid wins. Assumes at least
+  /// \c amount is reserved.
+  void settle(uint32_t wallet_id, uint32_t amount);
+
+private:
+  typedef std::atomic<uint64_t> Word;
+
+  static uint32_t totalOf(uint64_t word) { return word >> 32; }
+  static uint32_t availableOf(uint64_t word) { return word & UINT32_MAX; }
+  static uint64_t pack(uint32_t total, uint32_t available) {
+    return (uint64_t(total) << 32) | available;
+  }
+
+  /// A block of wallets and the flags publishing them.
+  struct Chunk {
+    Word words[kChunkSize];
+    /// Set with release ordering once the wallet's word has been stored.
+    std::atomic<bool> ready[kChunkSize];
+  };
+
+  /// Return the word of \c wallet_id. Assumes the wallet exists.
+  Word& word(uint32_t wallet_id) const {
+    return chunks[wallet_id >> kChunkBits].load()
+        ->words[wallet_id & (kChunkSize - 1)];
+  }
+
+  /// Blocks of wallets, allocated as wallet IDs reach them.
+  std::atomic<Chunk*> chunks[kMaxChunks];
+  /// Number of wallet IDs handed out. Never exceeds \c kMaxWallets.
+  std::atomic<uint32_t> num_wallets;
+};
+}  // namespace auction_engine
@@ -0,0 +1,201 @@
+/* Copyright 2019 Reed Evans. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "auction.h"
+#include "error.h"
+#include "status.h"
+#include "user.h"
+#include "wallet_ledger.h"
+
+inline void printTest(std::string test) {
+  std::cout << std::left << std::setw(48) << std::setfill('.');
+  std::cout << test;
+}
+inline void printTestResult(bool result) {
+  if (result) std::cout << "PASSED";
+  else std::cout << "FAILED";
+  std::cout << std::endl;
+}
+
+int main() {
+  namespace error = auction_engine::error;
+  auto ledger = std::make_shared<auction_engine::WalletLedger>();
+
+  printTest("Testing WalletLedger::createWallet()...");
+  uint32_t alice_wallet, bob_wallet;
+  ledger->createWallet(1000, alice_wallet);
+  ledger->createWallet(500, bob_wallet);
+  printTestResult(alice_wallet == 0 && bob_wallet == 1 &&
+                  ledger->isWallet(bob_wallet) && !ledger->isWallet(2) &&
+                  ledger->getTotalFunds(alice_wallet) == 1000 &&
+                  ledger->getAvailableFunds(alice_wallet) == 1000);
+
+  printTest("Testing WalletLedger::reserve()...");
+  auction_engine::Status status = ledger->reserve(bob_wallet, 400);
+  bool reserved = status.ok();
+  status = ledger->reserve(bob_wallet, 101);
+  printTestResult(reserved && error::IsInsufficientFunds(status) &&
+                  ledger->getAvailableFunds(bob_wallet) == 100 &&
+                  ledger->getTotalFunds(bob_wallet) == 500);
+
+  printTest("Testing WalletLedger::release() and settle()...");
+  ledger->release(bob_wallet, 150);
+  ledger->settle(bob_wallet, 250);
+  printTestResult(ledger->getAvailableFunds(bob_wallet) == 250 &&
+                  ledger->getTotalFunds(bob_wallet) == 250);
+
+  printTest("Testing WalletLedger::deposit() and withdraw()...");
+  ledger->deposit(bob_wallet, 50);
+  ledger->reserve(bob_wallet, 200);
+  status = ledger->withdraw(bob_wallet, 101);
+  bool withdraw_rejected = error::IsInsufficientFunds(status);
+  status = ledger->withdraw(bob_wallet, 100);
+  bool withdrawn = status.ok();
+  status = ledger->deposit(bob_wallet, UINT32_MAX);
+  printTestResult(withdraw_rejected && withdrawn &&
+                  error::IsResourceExhausted(status) &&
+                  ledger->getTotalFunds(bob_wallet) == 200 &&
+                  ledger->getAvailableFunds(bob_wallet) == 0);
+
+  printTest("Testing concurrent WalletLedger::reserve()...");
+  uint32_t shared_wallet;
+  ledger->createWallet(10000, shared_wallet);
+  std::atomic<uint32_t> num_reserved(0);
+  std::vector<std::thread> threads;
+  for (int t=0; t<8; ++t) {
+    threads.emplace_back([&]() {
+      for (int i=0; i<5000; ++i) {
+        if (ledger->reserve(shared_wallet, 3).ok())
+          num_reserved.fetch_add(1);
+      }
+    });
+  }
+  for (std::thread& thread: threads)
+    thread.join();
+  printTestResult(num_reserved.load() == 10000 / 3 &&
+                  ledger->getAvailableFunds(shared_wallet) == 10000 % 3);
+
+  printTest("Testing concurrent WalletLedger::createWallet()...");
+  uint32_t first_wallet = shared_wallet + 1;
+  std::atomic<bool> unfunded(false);
+  threads.clear();
+  for (int t=0; t<4; ++t) {
+    threads.emplace_back([&]() {
+      uint32_t wallet;
+      for (int i=0; i<2000; ++i)
+        ledger->createWallet(7, wallet);
+    });
+  }
+  threads.emplace_back([&]() {
+    for (uint32_t wallet=first_wallet; wallet<first_wallet + 8000; ++wallet) {
+      while (!ledger->isWallet(wallet)) {}
+      if (ledger->getTotalFunds(wallet) != 7)
+        unfunded.store(true);
+    }
+  });
+  for (std::thread& thread: threads)
+    thread.join();
+  printTestResult(!unfunded.load() &&
+                  !ledger->isWallet(first_wallet + 8000) &&
+                  !ledger->isWallet(
+                      auction_engine::WalletLedger::kMaxWallets));
+
+  // Two auctions drawing on the same wallets.
+  auction_engine::Auction gallery, market;
+  gallery.setLedger(ledger);
+  market.setLedger(ledger);
+  uint32_t carol_wallet, dean_wallet;
+  ledger->createWallet(1000, carol_wallet);
+  ledger->createWallet(1000, dean_wallet);
+  for (auction_engine::Auction* auction: { &gallery, &market }) {
+    auction->addUser("Carol", 5);
+    auction->addUser("Dean");
+    auction->addItem("Rug", 10);
+    auction->openItem(0);
+  }
+
+  printTest("Testing Auction::linkWallet()...");
+  status = gallery.linkWallet(0, dean_wallet + 1);
+  bool unknown_rejected = error::IsNotFound(status);
+  gallery.linkWallet(0, carol_wallet);
+  gallery.linkWallet(1, dean_wallet);
+  market.linkWallet(0, carol_wallet);
+  status = market.linkWallet(1, dean_wallet);
+  const auction_engine::User* gallery_carol;
+  gallery.getUser(0, gallery_carol);
+  printTestResult(unknown_rejected && status.ok() &&
+                  gallery_carol->getWalletId() == carol_wallet &&
+                  gallery_carol->getTotalFunds() == 1000 &&
+                  gallery.getTotalFunds() == 0);
+
+  printTest("Testing Auction::placeBid() with a wallet...");
+  gallery.placeBid(0, 0, 600);
+  status = market.placeBid(0, 0, 600);
+  bool oversubscribe_rejected = error::IsInsufficientFunds(status);
+  market.placeBid(0, 0, 300);
+  // Raising a leading bid only reserves the difference.
+  status = market.placeBid(0, 0, 350);
+  printTestResult(oversubscribe_rejected && status.ok() &&
+                  ledger->getAvailableFunds(carol_wallet) == 1000 - 600 - 350);
+
+  printTest("Testing outbid release with a wallet...");
+  gallery.placeBid(0, 1, 700);
+  printTestResult(ledger->getAvailableFunds(carol_wallet) == 1000 - 350 &&
+                  ledger->getAvailableFunds(dean_wallet) == 1000 - 700);
+
+  printTest("Testing Auction::sellItem() with a wallet...");
+  gallery.sellItem(0);
+  market.closeItem(0);
+  market.removeItem(0);
+  printTestResult(ledger->getTotalFunds(dean_wallet) == 300 &&
+                  ledger->getAvailableFunds(dean_wallet) == 300 &&
+                  ledger->getTotalFunds(carol_wallet) == 1000 &&
+                  ledger->getAvailableFunds(carol_wallet) == 1000);
+
+  printTest("Testing Auction::retractBid() with a wallet...");
+  auction_engine::Auction fair;
+  fair.setLedger(ledger);
+  fair.addUser("Carol");
+  fair.addUser("Dean");
+  fair.addItem("Vase", 10);
+  fair.openItem(0);
+  fair.linkWallet(0, carol_wallet);
+  fair.linkWallet(1, dean_wallet);
+  fair.placeBid(0, 0, 200);
+  fair.placeBid(0, 1, 250);
+  status = fair.retractBid(0, 1);
+  const bool moved = status.ok() &&
+                     ledger->getAvailableFunds(carol_wallet) == 800 &&
+                     ledger->getAvailableFunds(dean_wallet) == 300;
+  // Carol can no longer cover her bid, so Dean's stays.
+  fair.placeBid(0, 1, 300);
+  ledger->withdraw(carol_wallet, 900);
+  status = fair.retractBid(0, 2);
+  auction_engine::Quote vase;
+  fair.getQuote(0, vase);
+  printTestResult(moved && error::IsInsufficientFunds(status) &&
+                  vase.leader == 1 && vase.value == 300 &&
+                  ledger->getAvailableFunds(carol_wallet) == 100 &&
+                  ledger->getAvailableFunds(dean_wallet) == 0);
+
+  return 0;
+}